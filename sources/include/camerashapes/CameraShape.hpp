@@ -47,6 +47,19 @@ public :
    * @param ray : we will return the ray into this parameter
    */
   virtual bool getRay(unsigned int x, unsigned int y, Ray& ray)=0;
+
+  /**
+   * Build the ray differentials of the given pixel : the rays of the next
+   * pixel along x and along y (mirrored on the last row and column). They 
+   * give the footprint of the pixel on the surfaces, used to filter the
+   * textures.
+   * @return false if there is no ray differentials for the given pixel
+   * @param x,y : the coordinate of the pixel.
+   * @param ray : the ray of the pixel, as returned by getRay
+   * @param dx,dy : we will return the ray differentials into these parameters
+   */
+  virtual inline bool getRayDifferentials(unsigned int x, unsigned int y, 
+                                          const Ray& ray, Ray& dx, Ray& dy);
   
   /**
    * Return the width of the computable image.
@@ -87,6 +100,50 @@ inline CameraShape::~CameraShape()
   //  Nothing to do !
 }
 
+/**
+ * Build the ray differentials of the given pixel : the rays of the next
+ * pixel along x and along y (mirrored on the last row and column).
+ * Camera shapes with an analytic expression of their rays may override it.
+ */
+inline bool CameraShape::getRayDifferentials(unsigned int x, unsigned int y,
+                                             const Ray& ray, Ray& dx, Ray& dy)
+{
+  //Along x
+  if(x+1 < _width)
+  {
+    if(!getRay(x+1, y, dx))
+      return false;
+  }
+  else
+  {
+    if(x == 0 || !getRay(x-1, y, dx))
+      return false;
+    for(int i=0; i<3; i++)
+    {
+      dx.o[i] = 2*ray.o[i] - dx.o[i];
+      dx.v[i] = 2*ray.v[i] - dx.v[i];
+    }
+  }
+
+  //Along y
+  if(y+1 < _height)
+  {
+    if(!getRay(x, y+1, dy))
+      return false;
+  }
+  else
+  {
+    if(y == 0 || !getRay(x, y-1, dy))
+      return false;
+    for(int i=0; i<3; i++)
+    {
+      dy.o[i] = 2*ray.o[i] - dy.o[i];
+      dy.v[i] = 2*ray.v[i] - dy.v[i];
+    }
+  }
+  return true;
+}
+
 /**
  * Return the width of the computable image.
  */
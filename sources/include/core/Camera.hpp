@@ -25,6 +25,7 @@
 #include <camerashapes/CameraShape.hpp>
 #include <colorhandlers/ColorHandler.hpp>
 #include <structures/Image.hpp>
+#include <structures/TileBuffer.hpp>
 
 class Camera{
 public :
@@ -104,12 +105,36 @@ public :
    */
   void takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, Image& image);
 
+  /**
+   * Compute a part of the image into a tile buffer, then copy the tile into
+   * the image in one block. The tile buffer is reused from one call to the
+   * next, so that no allocation is done for the pixels.
+   * scenery : the scereny into which we have to compute the image
+   * minx, miny, maxx, maxy : boundaries of the part to compute.
+   * tile : the (thread-local) tile buffer used to render the part.
+   * image : the computed image will be placed into this parameter.
+   */
+  void takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, TileBuffer& tile, Image& image);
+
   void local_takeshot(Scenery& scenery, 
                       unsigned int local_minx, unsigned int local_maxx, 
                       unsigned int local_miny, unsigned int local_maxy, 
                       Image& image);
+
+  void local_takeshot(Scenery& scenery, 
+                      unsigned int local_minx, unsigned int local_maxx, 
+                      unsigned int local_miny, unsigned int local_maxy, 
+                      TileBuffer& tile, Image& image);
   
 private :
+  /**
+   * Compute a part of the image into a tile buffer.
+   * scenery : the scereny into which we have to compute the image
+   * minx, miny, maxx, maxy : boundaries of the part to compute.
+   * tile : the tile buffer, resized to the part and filled.
+   */
+  void renderTile(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, TileBuffer& tile);
+
   CameraShape* _shape;
   ColorHandler* _colorhandler;
   std::string _name;
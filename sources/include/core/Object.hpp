@@ -138,6 +138,20 @@ class Object {
                            LightVector& reemitedLight, 
                            unsigned int nbRays, 
                            std::vector<LightVector>& subrays);
+  //! @brief Density (per solid angle) of the rays of getRandomDiffuseRay in
+  //!  a direction, among the rays of the same side of the surface
+  //! @param localBasis Local basis at the computation point
+  //! @param surfaceCoordinate Texture coordinate of the computation point
+  //! @param reemitedLight Remited light to the view direction 
+  //! @param direction Direction of the secondary ray
+  //! @param density Density of the direction
+  //! @param weight Weight getRandomDiffuseRay gives to a ray in this direction
+  //! @return False if the distribution of the material is unknown
+  bool getDiffuseDensity(const Basis& localBasis, 
+                         const Point2D& surfaceCoordinate, 
+                         const LightVector& reemitedLight, 
+                         const Vector& direction, 
+                         Real& density, Real& weight);
   //! @brief Return true if this material has a diffuse component
   //! @return True if this material has a diffuse component
   bool isDiffuse(void) const;
@@ -158,6 +172,20 @@ class Object {
   //! @param surfaceCoordinate Texture coordinate of the computation point
   void getLocalBasis(const Ray& ray, const Real& distance, 
                      Basis& localBasis, Point2D& surfaceCoordinate);
+  //! @brief Differentials of the surface coordinates at an intersection
+  //! @details The ray differentials of the light vector are intersected with 
+  //!  the tangent plane, then mapped onto the surface with the derivatives 
+  //!  given by the shape. Both differentials are null if the light vector has 
+  //!  no ray differentials or if the shape has no derivatives.
+  //! @param light Light vector whose ray hit the object
+  //! @param localBasis Local basis at the intersection point
+  //! @param surfaceCoordinate Texture coordinate of the intersection point
+  //! @param dx Differential of the texture coordinate along x
+  //! @param dy Differential of the texture coordinate along y
+  void getSurfaceDifferentials(const LightVector& light, 
+                               const Basis& localBasis, 
+                               const Point2D& surfaceCoordinate, 
+                               Point2D& dx, Point2D& dy);
   //! @brief Return the bounding box of the object.
   //! @param boundingBox Returned bounding box
   void getBoundingBox(BoundingBox& boundingBox);
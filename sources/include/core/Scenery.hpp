@@ -17,7 +17,10 @@
 #ifndef _SCENERY_HPP
 #define _SCENERY_HPP
 
+#include <vector>
+
 #include <structures/Octree.hpp>
+#include <structures/MeshBVH.hpp>
 
 class Camera;
 class Renderer;
@@ -26,41 +29,6 @@ class Medium;
 class Source;
 class Texture;
 
-class SceneryOctreeVisitor : public OctreeVisitor<Object*> {
-public :
-  /**
-   * Constructor
-   */
-  SceneryOctreeVisitor(Real bias);
-
-  /**
-   * Initialize the visitor and errase the old results.
-   */
-  void init(Object* startingobject=0);
-  
-  /**
-   * Used by Octree : apply the visitor to the given object (that is able to 
-   * intersect the given ray).
-   */
-  void apply(const Ray& ray, Object*& object);
-  
-  /**
-   * Return the minimal intersection distance found at the last visit of the octree.
-   */
-  Real getMinDistance();
-  
-  /**
-   * Return the minimal intersection object found at the last visit of the octree.
-   */
-  Object* getMinDistanceObject();
-
-private :
-  Real _distance;
-  Real _bias;
-  Object* _object;
-  Object* _startingobject;
-};
-
 class ScenerySourceOctreeVisitor : public OctreeVisitor<Source*> {
 public :
   /**
@@ -117,6 +85,14 @@ public :
   unsigned int getNbObject() const;
   Object* getObject(unsigned int i);
 
+  /**
+   * Build the top level hierarchy over the bounding boxes of the objects. It
+   * must be called once all the objects are added and before any intersection
+   * test. The geometry of an object (e.g. a shared mesh and its own hierarchy)
+   * is the bottom level : it is tested only when the ray reaches its box.
+   */
+  void buildHierarchy();
+
   /**
    * Sources accessors
    */
@@ -182,7 +158,9 @@ public :
   bool getNearestIntersectionWithSource(const Ray& ray, Real& distance, Source*& source, Basis& localBasis, Point2D& surfaceCoordinate, Source* startingsource=0);
 
 private :
-  Octree<Object*> _objects;
+  std::vector<Object*> _objects;
+  std::vector<Object*> _orderedObjects; // objects in the order of the leaves
+  MeshBVH _objectHierarchy;
   Octree<Source*> _sources;
   std::vector<Medium*> _mediums;
 	std::vector<Texture*> _textures;
@@ -83,6 +83,12 @@ class Source {
   //! @brief Generate a random photon according to the propriety of the source
   //! @param photon Photon to be generated
   void getRandomPhoton(MultispectralPhoton& photon);
+  //! @brief Give the spatial and directional extent of the emission
+  //! @param bounds Bounding box of the emitting points
+  //! @param axis Axis of the cone bounding the emitted directions
+  //! @param cosAngle Cosine of the half angle of this cone
+  //! @return False if the source is infinite (no bounds)
+  bool getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle);
   //! @brief Intersection test. Return true if the ray intersect the object
   //! @details When an intersection is detected, distance will be the distance 
   //!  from the origin of the ray and the nearest intersection point. Otherwise, 
@@ -144,9 +144,12 @@ class Virtuelium {
   //! @param str_line_snake value the command line argument --line-snake
   //! @param spiral_trigo value the command line argument --spiral-trigo
   //! @param spiral_inverse value the command line argument --spiral-inverse
+  //! @param cost_step value the command line argument --cost
+  //! @param cost_split value the command line argument --cost-split
   void ParseAlgoParam(const std::string& str_line,
                        const std::string& str_line_snake,
-                       bool spiral_trigo, bool spiral_inverse);
+                       bool spiral_trigo, bool spiral_inverse,
+                       int cost_step, int cost_split);
   //! @brief Save the binary data of the rendering init to m_save_init_file
   //! @param data Binary data
   //! @param data_size Size of binary data
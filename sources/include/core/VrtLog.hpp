@@ -96,6 +96,8 @@ inline void VrtLog::Write(const char* logline, ...) {
   vsnprintf(cbuffer, 1024, logline, argList);
   va_end(argList);
 
+  // lines written by concurrent threads must not be mixed
+# pragma omp critical (vrt_log)
   m_stream << cbuffer << std::endl;
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -105,11 +107,14 @@ inline void VrtLog::Write(const char* logline, ...) {
    return;
 
   // write texte
-  m_stream << varname << ": " << std::endl;
-  for (int i = 0; i < size; i++) {
-     m_stream << var[i] << " ";
+# pragma omp critical (vrt_log)
+  {
+    m_stream << varname << ": " << std::endl;
+    for (int i = 0; i < size; i++) {
+       m_stream << var[i] << " ";
+    }
+    m_stream << std::endl;
   }
-  m_stream << std::endl;
 }
 ////////////////////////////////////////////////////////////////////////////////
 inline void VrtLog::Close(void){
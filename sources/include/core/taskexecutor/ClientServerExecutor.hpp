@@ -37,12 +37,13 @@
 #include <core/taskmanager/TaskManagerBase.hpp>
 #include <core/taskmanager/TaskManagerLine.hpp>
 #include <core/taskmanager/TaskManagerSpiral.hpp>
+#include <core/taskmanager/TaskManagerCost.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 //! @see Scenery
 class Scenery;
 ////////////////////////////////////////////////////////////////////////////////
 //! @class TaskBlock
-//! @brief A task block is a set of contiguous task units
+//! @brief A task block is a set of task units, evenly spaced in the list
 class TaskBlock {
  public:
   //! @brief Constructor
@@ -60,7 +61,9 @@ class TaskBlock {
   //! @brief Get the ith task unit of the block
   //! @param local index of the task unit in the block
   //! @return Global index of the task unit
-  inline unsigned int GetTaskUnit(unsigned int idx) { return m_blk_orig + idx; }
+  inline unsigned int GetTaskUnit(unsigned int idx) { 
+    return m_blk_orig + idx * m_blk_stride; 
+  }
   //! @brief Increment the status
   inline void Increment(void) { m_status++; }
   //! @check if a block is finishes or not
@@ -71,6 +74,8 @@ class TaskBlock {
   unsigned int m_blk_orig;
   //! Number of blocks (size of the block)
   unsigned int m_blk_size;
+  //! Distance between two task units of the block (1: contiguous units)
+  unsigned int m_blk_stride;
   //! Number of computed task units in the block
   unsigned int m_status;
 }; // clss TaskBlock
@@ -37,6 +37,7 @@
 #include <core/taskmanager/TaskManagerBase.hpp>
 #include <core/taskmanager/TaskManagerLine.hpp>
 #include <core/taskmanager/TaskManagerSpiral.hpp>
+#include <core/taskmanager/TaskManagerCost.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 //! @see Scenery
 class Scenery;
@@ -0,0 +1,120 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_TASKMANAGERCOST_HPP
+#define GUARD_VRT_TASKMANAGERCOST_HPP
+//!
+//! @file TaskManagerCost.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Derived class for task scheduling in parallel computing
+//!
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <math.h>
+#include <vector>
+
+#include <core/taskmanager/TaskManagerBase.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @see Scenery
+class Scenery;
+////////////////////////////////////////////////////////////////////////////////
+//! @class TaskManagerCost
+//! @brief Cost-aware task scheduling in parallel computing
+//! @details The cost of each task unit is predicted by a sparse primary-ray
+//!  prepass, unless a cost map has been given (see SetCostMap). Expensive 
+//!  task units are split into smaller ones and the list of tasks is sorted 
+//!  from the most expensive to the cheapest one, so that the dynamic openMP
+//!  scheduling does not end with a single long task.
+class TaskManagerCost: public TaskManagerBase {
+ public:
+  //! @enum CostDefault
+  //! @brief Default values of the additional parameters
+  enum {
+    //! Distance in pixels between two probes of the prepass
+    kDEFAULT_PROBE_STEP = 8,
+    //! Split threshold, in percent of the mean cost of a task unit
+    kDEFAULT_SPLIT_RATIO = 200,
+    //! Minimal width or height of a task unit created by a split
+    kMIN_SPLIT_SIZE = 8
+  };
+
+ public:
+  //! @brief constructor
+  TaskManagerCost(void);
+  //! @brief Destructor
+  virtual ~TaskManagerCost(void);
+  //! @brief Defines all the additional parameters of the derived class
+  //! @param idx Position of the parameter
+  //!  @arg 0: Distance in pixels between two probes of the prepass
+  //!  @arg 1: Split threshold, in percent of the mean cost of a task unit
+  //! @param value Value of the parameter
+  virtual void SetAdditionalParameters(int idx, int value);
+  //! @brief Attach the scenery used by the prepass
+  //! @param scenery Scenery to be rendered
+  inline void SetScenery(Scenery* scenery) { p_scenery = scenery; }
+
+ public:
+  //! @brief Initialize the list of task
+  //! @remarks The prepass is only run when no cost map is available
+  virtual void CreateTaskList(void);
+  //! @brief Estimate the cost of each task unit with a sparse prepass
+  void EstimateCost(void);
+  //! @brief Acces to the cost map (one value per task unit of the grid)
+  inline const std::vector<double>& cost_map(void) const { return m_cost; }
+  //! @brief Replace the cost map (e.g. received from another MPI process)
+  //! @param cost One value per task unit of the grid
+  void SetCostMap(const std::vector<double>& cost);
+
+ private:
+  //! @class CostTask
+  //! @brief Task unit with its predicted cost
+  struct CostTask {
+    //! Area of the image
+    TaskUnit unit;
+    //! Predicted cost
+    double cost;
+    //! Position of the task unit in the grid
+    unsigned int tile;
+  };
+  //! @brief Sort predicate: most expensive first, then grid order
+  static bool MoreExpensive(const CostTask& a, const CostTask& b);
+  //! @brief Split a task unit in n x n smaller ones
+  //! @param task Task unit to be split
+  //! @param n Number of subdivisions per dimension
+  //! @param list List in which the new task units are appended
+  void SplitTask(const CostTask& task, unsigned int n,
+                 std::vector<CostTask>& list);
+
+ private:
+  //! Scenery used by the prepass
+  Scenery* p_scenery;
+  //! Distance in pixels between two probes of the prepass
+  unsigned int m_probe_step;
+  //! Split threshold, in percent of the mean cost
+  unsigned int m_split_ratio;
+  //! Predicted cost of each task unit of the grid
+  std::vector<double> m_cost;
+}; // class TaskManagerCost
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_TASKMANAGERCOST_HPP
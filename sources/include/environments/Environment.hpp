@@ -27,10 +27,14 @@
 //! @remarks
 //! @details This file defines the base environment classs
 #include <stdio.h>
+#include <vector>
 
 #include <core/3DBase.hpp>
 #include <core/LightBase.hpp>
 
+////////////////////////////////////////////////////////////////////////////////
+//! @see MultispectralPhoton
+class MultispectralPhoton;
 ////////////////////////////////////////////////////////////////////////////////
 //! @class Environment
 //! @brief Defines the  base environment mapping
@@ -46,6 +50,58 @@ class Environment {
   //! @brief Add Contribution
   //! @param lightdata Light going to inifinty and that must be modified
   virtual void AddContribution(LightVector& lightdata) = 0;
+  //! @brief Sample the directions of the environment seen from a point
+  //! @details The base environment is not sampled: it only lights the rays 
+  //!  that escape the scenery (see AddContribution).
+  //! @param receiver Point where we need to have the incidents lights rays
+  //! @param reemited Light data as reference for spectral data
+  //! @param incidents Rays from the environment to the receiver are added to 
+  //!  this vector. Their radiance is divided by the density of their 
+  //!  direction and by the number of samples.
+  virtual void GetIncidentLight(const Point& receiver, 
+                                const LightVector& reemited, 
+                                std::vector<LightVector>& incidents);
+  //! @brief Density (per solid angle) of a direction of GetIncidentLight
+  //! @param direction Direction from the receiver toward the environment
+  virtual Real GetDensity(const Vector& direction);
+  //! @brief Number of directions sampled by GetIncidentLight
+  virtual unsigned int GetNbSamples(void) const;
+  //! @brief Power entering a region of the scenery (photon emission)
+  //! @param bounds Bounding box of the scenery
+  virtual Real GetPower(const BoundingBox& bounds);
+  //! @brief Generate a random photon entering a region of the scenery
+  //! @param bounds Bounding box of the scenery
+  //! @param photon Photon to be generated
+  virtual void GetRandomPhoton(const BoundingBox& bounds, 
+                               MultispectralPhoton& photon);
+
+ public:
+  //! @brief Weight of a sample with the power heuristic (multiple importance
+  //!  sampling of the environment and of the diffuse reflection)
+  //! @param nb_samples Number of samples of the strategy of the sample
+  //! @param density Density of the sample with its strategy
+  //! @param nb_other_samples Number of samples of the other strategy
+  //! @param other_density Density of the sample with the other strategy
+  static inline Real GetMISWeight(unsigned int nb_samples, Real density, 
+                                  unsigned int nb_other_samples, 
+                                  Real other_density) {
+    Real f = nb_samples * density;
+    Real g = nb_other_samples * other_density;
+    return (f > 0) ? f * f / (f * f + g * g) : Real(0.0);
+  }
+  //! @brief Density of a direction with the sampling of the diffuse 
+  //!  reflection (cosine-weighted, on the side of the viewer)
+  //! @param normal Normal of the surface
+  //! @param view Direction of the view ray (toward the surface)
+  //! @param direction Direction leaving the surface
+  static inline Real GetDiffuseDensity(const Vector& normal, 
+                                       const Vector& view, 
+                                       const Vector& direction) {
+    Real cos_theta = normal.dot(direction);
+    if (normal.dot(view) > 0)
+      cos_theta = -cos_theta;
+    return (cos_theta > 0) ? cos_theta / Real(M_PI) : Real(0.0);
+  }
 
  protected : 
 }; // class Environment
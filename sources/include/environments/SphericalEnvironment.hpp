@@ -27,18 +27,33 @@
 //! @remarks
 //! @details This file defines a sphere mapping
 #include <environments/Environment.hpp>
+#include <structures/Distribution.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 //! @see Texture
 class Texture;
 ////////////////////////////////////////////////////////////////////////////////
 //! @class SphericalEnvironment
 //! @brief Defines the spherical environment mapping
+//! @details The texture is a sphere map: the whole sphere of directions is 
+//!  mapped on the disk inscribed in the image, and the mapping preserves the
+//!  areas (a texel always covers 16 / (width * height) steradians).\n
+//!  The environment is also a light source: a piecewise constant density 
+//!  proportional to the radiance of the texels is built at load, then 
+//!  directions are drawn with it for the direct lighting (GetIncidentLight) 
+//!  and for the emission of photons.
 class SphericalEnvironment: public Environment { 
+ public:
+  //! Largest size of the grid of the density
+  static const unsigned int kMAX_DENSITY_SIZE = 512;
+
  public:
   //! @brief Constructor
   //! @param envir Spherical environment texture
   //! @param envir_power Power of the SphericalEnvironment
-  SphericalEnvironment(Texture* envir, Real envir_power);
+  //! @param nb_samples Number of directions sampled for the direct lighting
+  //!  (0: the environment only lights the rays escaping the scenery)
+  SphericalEnvironment(Texture* envir, Real envir_power, 
+                       unsigned int nb_samples = 0);
   //! @brief Destructor
   virtual ~SphericalEnvironment(void);
  
@@ -46,12 +61,42 @@ class SphericalEnvironment: public Environment {
   //! @brief Add Contribution
   //! @param lightdata Light going to inifinty and that must be modified
   void AddContribution(LightVector& lightdata);
+  //! @brief Sample the directions of the environment seen from a point
+  void GetIncidentLight(const Point& receiver, const LightVector& reemited, 
+                        std::vector<LightVector>& incidents);
+  //! @brief Density (per solid angle) of a direction of GetIncidentLight
+  Real GetDensity(const Vector& direction);
+  //! @brief Number of directions sampled by GetIncidentLight
+  unsigned int GetNbSamples(void) const;
+  //! @brief Power entering a region of the scenery
+  Real GetPower(const BoundingBox& bounds);
+  //! @brief Generate a random photon entering a region of the scenery
+  void GetRandomPhoton(const BoundingBox& bounds, MultispectralPhoton& photon);
+
+ private:
+  //! @brief Build the density of the directions
+  void BuildDensity(void);
+  //! @brief Texture coordinates of a direction
+  static void GetCoordinates(const Vector& direction, Real& u, Real& v);
+  //! @brief Direction of texture coordinates
+  //! @return False if the coordinates are outside of the sphere map
+  static bool GetDirection(Real u, Real v, Vector& direction);
+  //! @brief Draw a direction
+  //! @return Density (per solid angle) of the direction, 0 if the drawn 
+  //!  coordinates are outside of the sphere map
+  Real SampleDirection(Real& u, Real& v, Vector& direction) const;
 
  private:
   //! Environment map
   Texture* p_environment;
   //! Environment power
   Real m_amount;
+  //! Number of directions sampled for the direct lighting
+  unsigned int m_nb_samples;
+  //! Density of the directions (over the texture coordinates)
+  Distribution2D m_density;
+  //! Integral over the sphere of the mean radiance of the wavelengths
+  Real m_integral;
 }; // class SphericalEnvironment
 ////////////////////////////////////////////////////////////////////////////////
 #endif //GUARD_VRT_SPHERICALENVIRONMENT_HPP
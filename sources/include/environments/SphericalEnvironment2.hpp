@@ -26,24 +26,26 @@
 //! @date 2013
 //! @remarks
 //! @details This file defines a sphere mapping
-#include <environments/Environment.hpp>
+#include <environments/SphericalEnvironment.hpp>
 #include <string>
 ////////////////////////////////////////////////////////////////////////////////
 //! @class SphericalEnvironment2
-//! @brief Defines the spherical environment mapping
-class SphericalEnvironment2: public Environment { 
+//! @brief Defines the spherical environment mapping of an image file
+//! @details Same as SphericalEnvironment, with its own texture
+class SphericalEnvironment2: public SphericalEnvironment { 
  public:
   //! @brief Constructor
   //! @param file Tetxure file
   //! @param envir_power Power of the SphericalEnvironment
-  SphericalEnvironment2(const char* file, Real envir_power);
+  //! @param nb_samples Number of directions sampled for the direct lighting
+  SphericalEnvironment2(const char* file, Real envir_power, 
+                        unsigned int nb_samples = 0);
   //! @brief Destructor
   virtual ~SphericalEnvironment2(void);
- 
- public:
-  //! @brief Add Contribution
-  //! @param lightdata Light going to inifinty and that must be modified
-  void AddContribution(LightVector& lightdata);
+
+ private:
+  //! @brief Load the texture of the environment
+  static Texture* LoadTexture(const char* file);
 
  private:
   //! Environment map
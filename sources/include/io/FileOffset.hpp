@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_FILEOFFSET_HPP
+#define GUARD_VRT_FILEOFFSET_HPP
+//!
+//! @file FileOffset.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Positions beyond 2 GB in the files opened with fopen
+//!
+#include <cstdio>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+////////////////////////////////////////////////////////////////////////////////
+//! @class FileOffset
+//! @brief 64-bit versions of fseek and ftell
+//! @details fseek and ftell use a long, which only has 32 bits with MSVC: 
+//!  they are replaced by _fseeki64 and _ftelli64 on Windows, and by fseeko 
+//!  and ftello elsewhere (off_t has 64 bits on 64-bit systems, or when 
+//!  _FILE_OFFSET_BITS is 64).
+class FileOffset {
+ public:
+  //! @brief Move the position of a file
+  //! @param file File to be moved in
+  //! @param offset Offset in bytes from origin
+  //! @param origin SEEK_SET, SEEK_CUR or SEEK_END
+  //! @return 0 on success, as fseek
+  static inline int Seek(FILE* file, long long offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin);
+#else
+    return fseeko(file, (off_t)offset, origin);
+#endif
+  }
+  //! @brief Position of a file
+  //! @param file File whose position is retrieved
+  //! @return Position in bytes from the beginning, -1 on error
+  static inline long long Tell(FILE* file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (long long)ftello(file);
+#endif
+  }
+}; // class FileOffset
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_FILEOFFSET_HPP
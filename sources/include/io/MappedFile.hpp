@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MAPPEDFILE_HPP
+#define GUARD_VRT_MAPPEDFILE_HPP
+//!
+//! @file MappedFile.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Read only memory mapping of a file
+//!
+#include <cstddef>
+#include <string>
+////////////////////////////////////////////////////////////////////////////////
+//! @class MappedFile
+//! @brief Map a whole file in memory (read only)
+//! @details The pages are loaded by the system on demand: large files are
+//!  parsed without being copied into a buffer first.
+class MappedFile {
+ public:
+  //! @brief Constructor
+  MappedFile(void);
+  //! @brief Destructor (the file is unmapped)
+  ~MappedFile(void);
+
+ public:
+  //! @brief Map a file
+  //! @param filename Name of the file
+  void Open(const std::string& filename);
+  //! @brief Unmap the file
+  void Close(void);
+  //! @brief Acces to the content of the file (NULL if the file is empty)
+  inline const char* data(void) const { return p_data; }
+  //! @brief Acces to the size of the file in bytes
+  inline size_t size(void) const { return m_size; }
+
+ private:
+  //! @brief Not copyable
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+ private:
+  //! Content of the file
+  const char* p_data;
+  //! Size of the file
+  size_t m_size;
+#ifdef _WIN32
+  //! Handles of the file and of the mapping
+  void* p_file;
+  void* p_mapping;
+#else
+  //! Descriptor of the file
+  int m_fd;
+#endif
+}; // class MappedFile
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MAPPEDFILE_HPP
@@ -0,0 +1,81 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_DEFLATE_HPP
+#define GUARD_VRT_DEFLATE_HPP
+//!
+//! @file Deflate.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Minimal zlib (RFC 1950 / 1951) stream encoder
+//!
+#include <cstddef>
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+//! @class Deflate
+//! @brief Minimal zlib stream encoder
+//! @details Data are compressed with a LZ77 matcher (hash chains on 3-byte
+//!  sequences, 32 KB window) and encoded in a single block with the fixed
+//!  Huffman codes of RFC 1951. The output is readable by any zlib inflater,
+//!  e.g. by OpenEXR for the ZIP compressions.
+class Deflate {
+ public:
+  //! @brief Compress a buffer into a zlib stream
+  //! @param data Buffer to be compressed
+  //! @param size Size of the buffer in bytes
+  //! @param out Compressed stream (cleared first)
+  static void Compress(const unsigned char* data, size_t size,
+                       std::vector<unsigned char>& out);
+
+ private:
+  //! @class BitWriter
+  //! @brief Writes bits in the LSB-first order of RFC 1951
+  class BitWriter {
+   public:
+    //! @brief Constructor
+    //! @param out Byte stream receiving the bits
+    BitWriter(std::vector<unsigned char>& out);
+    //! @brief Write the nb lowest bits of value
+    void PutBits(unsigned int value, int nb);
+    //! @brief Write a Huffman code (MSB-first)
+    void PutCode(unsigned int code, int nb);
+    //! @brief Pad the last byte with zeros
+    void Flush(void);
+
+   private:
+    //! Byte stream receiving the bits
+    std::vector<unsigned char>& m_out;
+    //! Pending bits
+    unsigned int m_bits;
+    //! Number of pending bits
+    int m_nb_bits;
+  };
+
+  //! @brief Write a literal/length symbol with the fixed Huffman code
+  static void PutSymbol(BitWriter& writer, unsigned int symbol);
+  //! @brief Write a match (length and distance)
+  static void PutMatch(BitWriter& writer, unsigned int length,
+                       unsigned int distance);
+  //! @brief Adler-32 checksum of a buffer
+  static unsigned int Adler32(const unsigned char* data, size_t size);
+}; // class Deflate
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_DEFLATE_HPP
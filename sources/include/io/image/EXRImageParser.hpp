@@ -0,0 +1,159 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_EXRIMAGEPARSER_HPP
+#define GUARD_VRT_EXRIMAGEPARSER_HPP
+//!
+//! @file EXRImageParser.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details OpenEXR writer for multispectral and polarisation images
+//!
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <structures/Image.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class EXRImageParser
+//! @brief OpenEXR writer (no dependency on the OpenEXR library)
+//! @details Every channel of the image is written as an EXR channel named
+//!  after the channel names of the image (i.e. the names given by the
+//!  ColorHandler of the camera), so spectral and polarisation images keep
+//!  all their channels. Two modes are available:
+//!  @arg save: a whole image in a scanline file;
+//!  @arg Open / WriteRegion / Close: a tiled file written incrementally. A
+//!   tile is written as soon as all its pixels have been rendered, and the
+//!   offset table is kept up to date after each tile.
+//! @remarks PIZ compression is not implemented; ZIP gives similar ratios on
+//!  rendered images.
+class EXRImageParser {
+ public:
+  //! @enum Compression
+  //! @brief Compression of the pixel data (values of the EXR format)
+  enum {
+    kNO_COMPRESSION = 0,
+    kRLE_COMPRESSION = 1,
+    kZIPS_COMPRESSION = 2,
+    kZIP_COMPRESSION = 3
+  };
+  //! @enum PixelType
+  //! @brief Type of the pixel data (values of the EXR format)
+  enum {
+    kHALF = 1,
+    kFLOAT = 2
+  };
+
+ public:
+  //! @brief Constructor
+  //! @param compression Compression of the pixel data
+  //! @param pixel_type Type of the pixel data
+  EXRImageParser(int compression = kZIP_COMPRESSION, int pixel_type = kHALF);
+  //! @brief Destructor
+  ~EXRImageParser(void);
+
+ public:
+  //! @brief Save a whole image in a scanline EXR file
+  //! @param image Image to be saved
+  //! @param filename Name of the file
+  void save(Image& image, std::string filename);
+  //! @brief Create a tiled EXR file to be filled incrementally
+  //! @param image Image to be rendered (only its size and channels are used)
+  //! @param filename Name of the file
+  //! @param tile_width Width of a tile
+  //! @param tile_height Height of a tile
+  void Open(Image& image, const std::string& filename,
+            unsigned int tile_width, unsigned int tile_height);
+  //! @brief Notify that an area of the image has been rendered
+  //! @details Tiles completely rendered are written in the file
+  //! @param image Image being rendered
+  //! @param ulx X-coordinate of the upper-left corner of the area
+  //! @param uly Y-coordinate of the upper-left corner of the area
+  //! @param brx X-coordinate of the bottom-right corner (included)
+  //! @param bry Y-coordinate of the bottom-right corner (included)
+  void WriteRegion(Image& image, unsigned int ulx, unsigned int uly,
+                   unsigned int brx, unsigned int bry);
+  //! @brief Write the remaining tiles and close the tiled file
+  //! @param image Image being rendered
+  void Close(Image& image);
+  //! @brief Return true if a tiled file is opened
+  inline bool IsOpen(void) const { return p_file != NULL; }
+
+ private:
+  //! @brief Sort the channels by name, as required by the EXR format
+  void PrepareChannels(Image& image);
+  //! @brief Build the header of the file
+  //! @param image Image to be saved
+  //! @param tiled True for a tiled file
+  //! @param header Bytes of the header
+  void BuildHeader(Image& image, bool tiled,
+                   std::vector<unsigned char>& header);
+  //! @brief Build the pixel data of a block (scanlines or tile)
+  //! @param image Image to be saved
+  //! @param x, y Upper-left corner of the block
+  //! @param w, h Size of the block
+  //! @param data Pixel data of the block, compressed if it is worth it
+  void EncodeBlock(Image& image, unsigned int x, unsigned int y,
+                   unsigned int w, unsigned int h,
+                   std::vector<unsigned char>& data);
+  //! @brief Write one tile at the end of the tiled file
+  //! @param image Image being rendered
+  //! @param tile Position of the tile
+  void WriteTile(Image& image, unsigned int tile);
+  //! @brief Number of scanlines in a chunk of a scanline file
+  unsigned int LinesPerChunk(void) const;
+  //! @brief Convert a float into a half (round to nearest even)
+  static unsigned short FloatToHalf(float value);
+  //! @brief Byte reordering and delta predictor of the RLE and ZIP modes
+  static void Predict(const std::vector<unsigned char>& raw,
+                      std::vector<unsigned char>& out);
+  //! @brief Run-length encoding of the EXR format
+  static void RunLength(const std::vector<unsigned char>& in,
+                        std::vector<unsigned char>& out);
+
+ private:
+  //! Compression of the pixel data
+  int m_compression;
+  //! Type of the pixel data
+  int m_pixel_type;
+  //! Channels of the image, in the order of the file
+  std::vector<unsigned int> m_channel_order;
+  //! Names of the channels, in the order of the file
+  std::vector<std::string> m_channel_names;
+  //! Tiled file being written
+  FILE* p_file;
+  //! Name of the tiled file
+  std::string m_filename;
+  //! Size of a tile
+  unsigned int m_tile_width;
+  unsigned int m_tile_height;
+  //! Number of tiles per row and column
+  unsigned int m_nb_tiles_x;
+  unsigned int m_nb_tiles_y;
+  //! Position of the offset table in the tiled file
+  long long m_table_pos;
+  //! Number of rendered pixels per tile
+  std::vector<unsigned int> m_coverage;
+  //! Tiles already written
+  std::vector<bool> m_written;
+}; // class EXRImageParser
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_EXRIMAGEPARSER_HPP
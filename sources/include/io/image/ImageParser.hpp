@@ -37,7 +37,7 @@ public :
 
   /**
    * Save an image to a file. The file type will be determined by the
-   * extension.
+   * extension (.mhdri, .exr for half-float ZIP OpenEXR, or any DevIL format).
    * @param image : the Image to save
    * @param filename : the filename of the file to save
    */
@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_LZ4CODEC_HPP
+#define GUARD_VRT_LZ4CODEC_HPP
+//!
+//! @file LZ4Codec.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Fast LZ compression of image chunks
+//!
+#include <cstddef>
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+//! @class LZ4Codec
+//! @brief Compression in the LZ4 block format
+//! @details Greedy matcher on 4-byte sequences with a 64 KB window. The codec
+//!  favours speed over ratio: checkpoints of large spectral images must not
+//!  slow down the rendering. Float data should be shuffled (one plane per
+//!  byte of the floats) before compression, see Shuffle.
+class LZ4Codec {
+ public:
+  //! @brief Compress a buffer
+  //! @param data Buffer to be compressed
+  //! @param size Size of the buffer in bytes
+  //! @param out Compressed block (cleared first)
+  static void Compress(const unsigned char* data, size_t size,
+                       std::vector<unsigned char>& out);
+  //! @brief Decompress a block
+  //! @param data Compressed block
+  //! @param size Size of the compressed block
+  //! @param out Decompressed buffer
+  //! @param out_size Expected size of the decompressed buffer
+  //! @return False if the block is corrupted or does not match out_size
+  static bool Decompress(const unsigned char* data, size_t size,
+                         unsigned char* out, size_t out_size);
+  //! @brief Gather the k-th bytes of all the words in the k-th plane
+  //! @param data Array of words
+  //! @param size Size of the array in bytes (multiple of word_size)
+  //! @param word_size Size of a word in bytes
+  //! @param out Shuffled array (same size)
+  static void Shuffle(const unsigned char* data, size_t size,
+                      size_t word_size, unsigned char* out);
+  //! @brief Inverse of Shuffle
+  static void Unshuffle(const unsigned char* data, size_t size,
+                        size_t word_size, unsigned char* out);
+}; // class LZ4Codec
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_LZ4CODEC_HPP
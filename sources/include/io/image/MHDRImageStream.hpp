@@ -0,0 +1,159 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MHDRIMAGESTREAM_HPP
+#define GUARD_VRT_MHDRIMAGESTREAM_HPP
+//!
+//! @file MHDRImageStream.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Tiled and compressed MHDRI files (version 2)
+//!
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <structures/Image.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class MHDRImageStream
+//! @brief Tile by tile access to MHDRI files (version 2)
+//! @details Layout of a version 2 file:
+//!  @arg "MHDRI2\n"
+//!  @arg "width\theight\tchannels\ttile_width\ttile_height\tcompression\n"
+//!  @arg one line per channel name
+//!  @arg the chunk table: for each tile (row by row), the offset (8 bytes),
+//!   the stored size (4 bytes) and the reserved size (4 bytes), little-endian
+//!  @arg the chunks: pixels of the tile, row by row, channels interleaved.
+//!   A chunk smaller than the raw tile is compressed (LZ4 on byte planes).
+//!  Tiles are read and written independently: a checkpoint only rewrites the
+//!  dirty tiles, in place when the new chunk fits in the reserved size, at
+//!  the end of the file otherwise. Only the tiles whose pixels have all been
+//!  rendered are written by a checkpoint, so that the raster is never read
+//!  while another thread is still writing in the tile.
+class MHDRImageStream {
+ public:
+  //! @enum Compression
+  //! @brief Compression of the chunks
+  enum {
+    kNO_COMPRESSION = 0,
+    kLZ4_COMPRESSION = 1
+  };
+
+ public:
+  //! @brief Constructor
+  MHDRImageStream(void);
+  //! @brief Destructor
+  ~MHDRImageStream(void);
+
+ public:
+  //! @brief Create a new file and write all the tiles of an image
+  //! @param filename Name of the file
+  //! @param image Image to be written
+  //! @param tile_width Width of a tile
+  //! @param tile_height Height of a tile
+  //! @param compression Compression of the chunks
+  void Create(const std::string& filename, Image& image,
+              unsigned int tile_width, unsigned int tile_height,
+              int compression = kLZ4_COMPRESSION);
+  //! @brief Open an existing file (header and chunk table are read)
+  //! @param filename Name of the file
+  void Open(const std::string& filename);
+  //! @brief Close the file
+  void Close(void);
+  //! @brief Return true if a file is opened
+  inline bool IsOpen(void) const { return p_file != NULL; }
+  //! @brief Return true if the file is a version 2 MHDRI file
+  static bool IsStreamFile(const std::string& filename);
+
+ public:
+  //! @brief Allocate an image matching the file (pixels are not read)
+  Image* CreateImage(void) const;
+  //! @brief Read one tile into the image
+  //! @param tile Position of the tile
+  //! @param image Image of the size of the file
+  void ReadTile(unsigned int tile, Image& image);
+  //! @brief Write one tile of the image
+  //! @param image Image of the size of the file
+  //! @param tile Position of the tile
+  void WriteTile(Image& image, unsigned int tile);
+  //! @brief Mark the tiles overlapping a rendered area as dirty
+  //! @param ulx X-coordinate of the upper-left corner of the area
+  //! @param uly Y-coordinate of the upper-left corner of the area
+  //! @param brx X-coordinate of the bottom-right corner (included)
+  //! @param bry Y-coordinate of the bottom-right corner (included)
+  void MarkRegion(unsigned int ulx, unsigned int uly,
+                  unsigned int brx, unsigned int bry);
+  //! @brief Write the dirty tiles (checkpoint)
+  //! @param image Image of the size of the file
+  //! @param finished_only Only the tiles completely rendered are written
+  void FlushDirty(Image& image, bool finished_only = true);
+  //! @brief Acces to the number of tiles
+  inline unsigned int nb_tiles(void) const {
+    return m_nb_tiles_x * m_nb_tiles_y;
+  }
+
+ private:
+  //! @brief Area of the image covered by a tile
+  void GetTileArea(unsigned int tile, unsigned int& x, unsigned int& y,
+                   unsigned int& w, unsigned int& h) const;
+  //! @brief Encode a tile of the image into a chunk
+  void EncodeTile(Image& image, unsigned int tile,
+                  std::vector<unsigned char>& chunk) const;
+  //! @brief Encode (in parallel) then write a list of tiles
+  void WriteTiles(Image& image, const std::vector<unsigned int>& tiles);
+  //! @brief Write an encoded chunk and update the chunk table
+  void WriteChunk(unsigned int tile, const std::vector<unsigned char>& chunk);
+  //! @brief Write one entry of the chunk table
+  void WriteEntry(unsigned int tile);
+
+ private:
+  //! Opened file
+  FILE* p_file;
+  //! Name of the file
+  std::string m_filename;
+  //! Size of the image
+  unsigned int m_width;
+  unsigned int m_height;
+  //! Number of channels
+  unsigned int m_nb_channels;
+  //! Names of the channels
+  std::vector<std::string> m_channel_names;
+  //! Size of a tile
+  unsigned int m_tile_width;
+  unsigned int m_tile_height;
+  //! Number of tiles per row and column
+  unsigned int m_nb_tiles_x;
+  unsigned int m_nb_tiles_y;
+  //! Compression of the chunks
+  int m_compression;
+  //! Position of the chunk table
+  long long m_table_pos;
+  //! Chunk table
+  std::vector<unsigned long long> m_offsets;
+  std::vector<unsigned int> m_sizes;
+  std::vector<unsigned int> m_capacities;
+  //! Dirty tiles
+  std::vector<bool> m_dirty;
+  //! Number of rendered pixels per tile
+  std::vector<unsigned int> m_coverage;
+}; // class MHDRImageStream
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MHDRIMAGESTREAM_HPP
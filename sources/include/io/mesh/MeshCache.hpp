@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MESHCACHE_HPP
+#define GUARD_VRT_MESHCACHE_HPP
+//!
+//! @file MeshCache.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Binary cache of parsed meshes and of their hierarchies
+//!
+#include <string>
+
+#include <objectshapes/MeshData.hpp>
+#include <structures/MeshBVH.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class MeshCache
+//! @brief Compact binary files of indexed meshes (.vmesh)
+//! @details Layout of a version 1 file:
+//!  @arg a header: "VMSH", version, size of Real and of a node, signature of
+//!   the source file (size, modification time, hash of its first and last 
+//!   64 KB), number of elements and offset of each section, checksum of the
+//!   sections
+//!  @arg the sections, each one aligned on 16 bytes: vertices, normals, 
+//!   texture coordinates, vertex/normal/texture indices of the corners, 
+//!   nodes of the hierarchy
+//!  The triangles are stored in the order of the leaves of the hierarchy. 
+//!  The file is mapped in memory and the hierarchy is used in place. A cache 
+//!  file is ignored (and rewritten) if the source file has changed, if it 
+//!  has been written with another size of Real or if its checksum is wrong.
+//!  The cache files are written next to the source files, or in a cache 
+//!  directory (see SetDirectory).
+//! @remarks The methods can be called from several OpenMP threads.
+class MeshCache {
+ public:
+  //! @brief Set the directory of the cache files (empty: next to the sources)
+  static void SetDirectory(const std::string& directory);
+  //! @brief Load the cache of a mesh file
+  //! @param source Name of the mesh file
+  //! @param data Triangles of the mesh, sorted for the hierarchy
+  //! @param hierarchy Hierarchy of the triangles
+  //! @return false if there is no valid cache file
+  static bool Load(const std::string& source, MeshData& data, 
+                   MeshBVH& hierarchy);
+  //! @brief Write the cache of a mesh file (failures are only logged)
+  //! @param source Name of the mesh file
+  //! @param data Triangles of the mesh, sorted for the hierarchy
+  //! @param hierarchy Hierarchy of the triangles
+  static void Save(const std::string& source, const MeshData& data, 
+                   const MeshBVH& hierarchy);
+
+ private:
+  //! @brief Name of the cache file of a mesh file
+  static std::string GetFilename(const std::string& source);
+
+ private:
+  //! Directory of the cache files
+  static std::string s_directory;
+}; // class MeshCache
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MESHCACHE_HPP
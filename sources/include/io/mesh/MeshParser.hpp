@@ -28,18 +28,9 @@
 //! @details Parse several formats of files for 3D meshes
 //!
 #include <string>
-#include <istream>
 
 #include <objectshapes/Mesh.hpp>
-////////////////////////////////////////////////////////////////////////////////
-//! @sruct Face 
-//! @brief This structure is used by the MeshParser for the loading
-struct Face {
- public :
-  Point vertices[3];
-  Vector normals[3];
-  Point2D texcoords[3];
-}; // struct Face
+#include <objectshapes/MeshData.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 //! @class MeshParser
 //! @brief This class is used to load meshes from various file formats
@@ -47,16 +38,34 @@ class MeshParser {
  public:
   //! @brief Load a mesh from a Mesh3 file (VirtueliumIII files)
   //! @param filename File of the mesh to be loaded
+  //! @param compact Quantize the normals and the texture coordinates
+  //! @see MeshCache
   //! @deprecated
-  Mesh* loadMesh3(std::string filename, bool double_sided);
+  Mesh* loadMesh3(std::string filename, bool double_sided, 
+                  bool compact = false);
   //! @brief Load a mesh from a wavefront OBJ file
   //! @param filename File of the mesh to be loaded
-  Mesh* loadOBJ(std::string filename, bool double_sided);
+  //! @param compact Quantize the normals and the texture coordinates
+  //! @see OBJLoader, MeshCache
+  Mesh* loadOBJ(std::string filename, bool double_sided, 
+                bool compact = false);
+  //! @brief Build a mesh from indexed triangles
+  //! @details Triangles without normals on their three corners are flat, 
+  //!  missing texture coordinates are set to 0.
+  //! @param data Triangles of the mesh, moved into the mesh
+  //! @param compact Quantize the normals and the texture coordinates
+  Mesh* buildMesh(MeshData& data, bool double_sided, bool compact = false);
 
- protected:
-  //! @brief Jump to the next character that is not a whitespace
-  //! @param stream : the istream in wich we jump.
-  void eatWhiteSpace(std::istream& stream);
+ private:
+  //! @brief Read the indexed triangles of a Mesh3 file
+  void readMesh3(const std::string& filename, MeshData& data);
+  //! @brief Build the hierarchy of a mesh and sort its triangles
+  void buildHierarchy(MeshData& data, MeshBVH& hierarchy);
+  //! @brief Build a mesh from triangles sorted for their hierarchy
+  //! @param data Triangles of the mesh, moved into the mesh
+  //! @param hierarchy Hierarchy of the triangles, owned by the mesh
+  Mesh* createMesh(MeshData& data, MeshBVH* hierarchy, bool double_sided,
+                   bool compact);
 }; // class MeshParser
 ////////////////////////////////////////////////////////////////////////////////
 #endif //GUARD_VRT_MESHPARSER_HPP
@@ -0,0 +1,51 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_OBJLOADER_HPP
+#define GUARD_VRT_OBJLOADER_HPP
+//!
+//! @file OBJLoader.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Fast loading of wavefront OBJ files
+//!
+#include <string>
+
+#include <objectshapes/MeshData.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class OBJLoader
+//! @brief Load the geometry of a wavefront OBJ file
+//! @details The file is mapped in memory and split into chunks of lines which
+//!  are parsed in parallel (numbers are parsed by hand, without streams nor
+//!  locale). Supported statements:
+//!  @arg v, vn, vt: vertices, normals and texture coordinates
+//!  @arg f: polygons (triangulated as fans), with corners v, v/vt, v//vn or
+//!   v/vt/vn and positive or negative (relative) indices
+//!  The other statements (groups, materials, lines...) are ignored.
+class OBJLoader {
+ public:
+  //! @brief Load the triangles of an OBJ file
+  //! @param filename Name of the file
+  //! @param data Loaded triangles (previous content is erased)
+  static void Load(const std::string& filename, MeshData& data);
+}; // class OBJLoader
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_OBJLOADER_HPP
@@ -63,6 +63,13 @@ private :
    * @return : the parsed LightSource
    */
   LightSource* createPlaneLightSource(XMLTree* node);
+
+  /**
+   * Create the light source by using the informations of the node.
+   * @param node : the XML node to use for the creation.
+   * @return : the parsed LightSource
+   */
+  LightSource* createMeshLightSource(XMLTree* node);
 };
 
 
@@ -19,6 +19,7 @@
 #include <io/XMLTree.hpp>
 #include <io/Parser.hpp>
 #include <objectshapes/ObjectShape.hpp>
+#include <objectshapes/Mesh.hpp>
 #include <structures/HashMap.hpp>
 #include <structures/HashFunctors.hpp>
 
@@ -36,10 +37,29 @@ public :
    */
   ObjectShape* create(XMLTree* node);
 
+  /**
+   * Return the mesh loaded from a file, the file being loaded only by the
+   * first shape (or light source) which uses it. The mesh belongs to the
+   * library.
+   * @param filename : the file of the mesh.
+   * @param obj : true for an OBJ file, false for a Mesh3 file
+   * @param double_sided : true if the normal must be turned toward the ray
+   * @param compact : true to quantize the normals and texture coordinates
+   * @return : the shared mesh
+   */
+  static Mesh* getSharedMesh(const std::string& filename, bool obj, bool double_sided, bool compact);
+
 private :
 
   static HashMap<std::string, ObjectShape*, StringHashFunctor> _shapeLibrary;
 
+  /**
+   * Meshes shared by all the shapes loading the same file with the same
+   * options (key : type, absolute file name and options). The meshes belong
+   * to the library.
+   */
+  static HashMap<std::string, ObjectShape*, StringHashFunctor> _meshLibrary;
+
   /**
    * Create the object shape by using the informations of the node.
    * @return : the parsed ObjectShape
@@ -81,6 +101,15 @@ private :
    */
   ObjectShape* createOBJ(XMLTree* node);
 
+  /**
+   * Return an instance of the mesh loaded from the file of the node, the file
+   * being loaded only by the first shape which uses it.
+   * @param node : the XML node to use for the creation.
+   * @param obj : true for an OBJ file, false for a Mesh3 file
+   * @return : the parsed ObjectShape
+   */
+  ObjectShape* createSharedMesh(XMLTree* node, bool obj);
+
   /**
    * Create the object shape by using the informations of the node.
    * @param node : the XML node to use for the creation.
@@ -102,6 +131,13 @@ private :
    */
   ObjectShape* createScale(XMLTree* node);
 
+  /**
+   * Create the object shape by using the informations of the node.
+   * @param node : the XML node to use for the creation.
+   * @return : the parsed ObjectShape
+   */
+  ObjectShape* createInstance(XMLTree* node);
+
   /**
    * Create the object shape by using the informations of the node.
    * @param node : the XML node to use for the creation.
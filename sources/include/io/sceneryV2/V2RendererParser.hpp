@@ -74,6 +74,13 @@ private:
 	Renderer* CreatePhotonMapping(
       XMLTree* node,
       const HashMap<std::string, Texture*, StringHashFunctor> &textureMap);
+  //! @brief Create a 'Path Tracing' rendering engine
+  //! @param node XML node to be read
+  //! @param textureMap List of decleared textures
+  //! @return Pointer to the created Renderer object
+	Renderer* CreatePathTracing(
+      XMLTree* node,
+      const HashMap<std::string, Texture*, StringHashFunctor> &textureMap);
   //! @brief Create a 'Photon Mapping Estimation' rendering engine
   //! @param node XML node to be read
   //! @param textureMap List of decleared textures
@@ -32,6 +32,7 @@
 //! @todo Allows inclusion of virtuelium xml files
 #include <string>
 #include <fstream>
+#include <vector>
 
 #include <core/Scenery.hpp>
 
@@ -62,22 +63,25 @@ class V2SceneryParser : public Parser {
   //! @param name Name of the texture
   //! @return Return the texture
   Texture* GetTexture(std::string name);
-  //! @brief Add a texture into the scenery
+  //! @brief Create a texture (image and spectralization samples are loaded)
   //! @param node node containing data for the texture
-  void AddTexture(XMLTree* node);
+  //! @return the created texture
+  Texture* CreateTexture(XMLTree* node);
   //! @brief Return the medium
   //! @param name Name of the medium
   //! @return Return the medium
   Medium* GetMedium(std::string name);
-  //! @briefAdd a surface into the scenery
+  //! @brief Create a surface (shape and material are built)
   //! @param node Node containing data for the surface
-  void AddSurface(XMLTree* node);
+  //! @return the created object
+  Object* CreateSurface(XMLTree* node);
   //! @biref Add a camera into the scenery.
   //! @param node Node containing data for the camera
   void AddCamera(XMLTree* node);
-  //! @brief Add a source into the scenery
+  //! @brief Create a source
   //! @param node Node containing data for the source
-  void AddSource(XMLTree* node);
+  //! @return the created source
+  Source* CreateSource(XMLTree* node);
   //! @brief Set the renderer for the scenery (previous renderer will be freed)
   //! @param node Node containing data for the renderer
   void AddRenderer(XMLTree* node);
@@ -87,11 +91,55 @@ class V2SceneryParser : public Parser {
   //!  format.
   //! @param node Node containing data for the renderer
   void AddIncludeScenery(XMLTree* node);
+  //! @brief Build all the deferred elements of the scenery
+  //! @details Textures, surfaces and sources are built by parallel jobs,
+  //!  sorted by waves (see ScheduleJob). Built elements are then added in the
+  //!  order of the scenery file. Called before each renderer or inclusion, 
+  //!  and at the end of the file.
+  void BuildElements(void);
+  //! @brief Free the elements built by the deferred jobs and clear them
+  void DiscardJobs(void);
   //! @brief Build the scenery with all the stored informations. 
   //! @remarks All temporary array will be freed.
   //! @return the generated scenery
   Scenery* GenerateScenery(void);
 
+ private:
+  //! @struct BuildJob
+  //! @brief Element of the scenery whose construction is deferred
+  struct BuildJob {
+    //! Node of the element
+    XMLTree* node;
+    //! Wave of the job: it only depends on jobs of the previous waves
+    unsigned int wave;
+    //! Built element (depending on the markup of the node)
+    Texture* texture;
+    Object* object;
+    Source* source;
+    //! Message of the exception raised by the construction
+    std::string error;
+  };
+  //! @brief Compute the wave of a job
+  //! @details A job waits for the textures if one of its materials is
+  //!  textured, and for the jobs which declare the shapes and materials it
+  //!  reuses by name, or whose mesh files it shares. The names it declares
+  //!  first are registered.
+  //! @param job Job to be scheduled (jobs are scheduled in the file order)
+  //! @param declarations Wave of the job declaring each name
+  void ScheduleJob(
+      BuildJob& job,
+      HashMap<std::string, unsigned int, StringHashFunctor>& declarations);
+  //! @brief Collect the names (and the mesh files) of the nodes of a subtree
+  //! @param node Root of the subtree
+  //! @param library Prefix of the names (one per library)
+  //! @param names Collected names
+  //! @param textured Set to true if a textured material is found
+  static void CollectNames(XMLTree* node, const std::string& library,
+                           std::vector<std::string>& names, bool& textured);
+  //! @brief Build the element of a job
+  //! @remarks Exceptions are caught and stored into the job
+  void RunJob(BuildJob& job);
+
  private:
   //! List of objects in the scene
   std::vector<Object*> m_objects;
@@ -107,6 +155,8 @@ class V2SceneryParser : public Parser {
 	std::vector<Texture*> m_textureList;
   //! List of declared textures with their names
   HashMap<std::string, Texture*, StringHashFunctor> m_textureMap;
+  //! Deferred elements, in the order of the scenery file
+  std::vector<BuildJob> m_jobs;
   //! Renderer read 
   Renderer* p_renderer;
   //! Bias paramerter
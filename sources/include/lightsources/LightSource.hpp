@@ -67,6 +67,17 @@ public :
    * @param photon : the photon to generate;
    */
   virtual void getRandomPhoton(MultispectralPhoton& photon)=0;
+
+  /**
+   * Give the spatial and directional extent of the emission (used for the
+   * selection of the sources, see LightTree).
+   * @param bounds : the bounding box of the emitting points.
+   * @param axis : the axis of the cone bounding the emitted directions.
+   * @param cosAngle : the cosine of the half angle of this cone (-1 for an
+   *   emission in all the directions).
+   * @return false if the source is infinite (no bounds).
+   */
+  virtual bool getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)=0;
 };
 
 /**
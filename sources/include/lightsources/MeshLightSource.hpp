@@ -0,0 +1,119 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _MESHLIGHTSOURCE_HPP
+#define _MESHLIGHTSOURCE_HPP
+
+#include <lightsources/LightSource.hpp>
+#include <objectshapes/Mesh.hpp>
+#include <structures/Distribution.hpp>
+
+/**
+ * This class implement a LightSource emitting uniformly from the triangles
+ * of a mesh (lambertian emission). The points are sampled proportionally to
+ * the area of the triangles.
+ */
+class MeshLightSource : public LightSource{
+public :
+
+  /**
+   * Constructor
+   * @param spectrum : the emited spectrum
+   * @param power : the power of this source (multiplier factor)
+   * @param mesh : the emitting mesh, not owned by the source
+   * @param doubleSided : true if both sides of the triangles emit, only the
+   *   side of the triangle normal (counterclockwise corners) otherwise
+   * @param nbSamples : the number of points sampled for the direct lighting
+   */
+  MeshLightSource(const Spectrum& spectrum, const Real& power, const Mesh* mesh, bool doubleSided, unsigned int nbSamples);
+
+  /**
+   * Virtual destructor
+   */
+  inline virtual ~MeshLightSource();
+
+  /**
+   * Place incidents light data casted form this source into the given vector.
+   * @param receiver : the point where we need to have the incidents lights rays.
+   * @param reemited : a light data as reference for spectral data (generally the
+   *   one that we want to compute for the interaction that will receive the incidents)
+   * @param incidents : incidents light data will be placed into this vector.
+   */
+  virtual void getIncidentLight(const Point& receiver, const LightVector& reemited, std::vector<LightVector>& incidents);
+
+  /**
+   * Return the power of this source (the sum of all wavelenght)
+   * @return the power of the light source
+   */
+  virtual Real getPower();
+
+  /**
+   * Compute the emitted light for direct source view.
+   * @param localBasis : the local basis on the surface of the source.
+   * @param surfaceCoordinate : the surface coordinate on the source surface.
+   * @param emitted : the light data to compute.
+   */
+  virtual void getEmittedLight(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& emitted);
+
+  /**
+   * Generate a random photon according this source spectral and spatial
+   * distribution.
+   * @param photon : the photon to generate;
+   */
+  virtual void getRandomPhoton(MultispectralPhoton& photon);
+
+  /**
+   * Give the spatial and directional extent of the emission.
+   * @param bounds : the bounding box of the emitting points.
+   * @param axis : the axis of the cone bounding the emitted directions.
+   * @param cosAngle : the cosine of the half angle of this cone.
+   * @return false if the source is infinite (no bounds).
+   */
+  virtual bool getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle);
+
+private :
+  /**
+   * Sample a point of the mesh, uniformly distributed over its area.
+   * @param u : random number picking the triangle, then reused in it.
+   * @param v : random number picking the point in the triangle.
+   * @param point : the sampled point.
+   * @param normal : the normal of the triangle (unit vector).
+   */
+  void samplePoint(Real u, Real v, Point& point, Vector& normal) const;
+
+  const Mesh* _mesh;
+  Spectrum _spectrum;
+  Real _lightPower;
+  Real _radiance;      //Emitted radiance (sum of all wavelengths)
+  Real _area;
+  BoundingBox _bounds;
+  bool _doubleSided;
+  unsigned int _nbSamples;
+
+  Distribution1D _triangles; //Area of the triangles
+  std::vector<Vector> _normals; //Unit normal of the triangles
+  Vector _axis;      //Mean normal of the triangles
+  Real _cosNormals;  //Cosine of the widest angle between a normal and _axis
+};
+
+/**
+ * Virtual destructor.
+ */
+inline MeshLightSource::~MeshLightSource()
+{
+  //Nothing to do : the mesh is shared
+}
+  
+#endif //_MESHLIGHTSOURCE_HPP
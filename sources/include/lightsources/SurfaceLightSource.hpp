@@ -65,6 +65,15 @@ public :
    */
   virtual void getRandomPhoton(MultispectralPhoton& photon);
 
+  /**
+   * Give the spatial and directional extent of the emission.
+   * @param bounds : the bounding box of the emitting points.
+   * @param axis : the axis of the cone bounding the emitted directions.
+   * @param cosAngle : the cosine of the half angle of this cone.
+   * @return false if the source is infinite (no bounds).
+   */
+  virtual bool getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle);
+
 private :
   Vector _normal;
   Spectrum _spectrum;
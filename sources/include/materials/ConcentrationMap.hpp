@@ -96,8 +96,9 @@ class ConcentrationMap : public Material {
   bool hasDiffuseMaterial(const std::vector<Material*>& materials);
   //! @brief Says if the material is diffuse
   bool hasSpecularMaterial(const std::vector<Material*>& materials);
-  //! @brief Read a pixel in the map
-  Pixel& getPixel(const Point2D& surfaceCoordinate);
+  //! @brief Read a pixel in the map (pixel must have one channel per 
+  //!  channel of the map)
+  void getPixel(const Point2D& surfaceCoordinate, Pixel& pixel);
 
  private :
   //! Array of embedded materials 
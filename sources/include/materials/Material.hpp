@@ -155,6 +155,26 @@ public :
    */
   virtual void getRandomDiffuseRay(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& reemitedLight, unsigned int nbRays, std::vector<LightVector>& subrays);
 
+  /**
+   * Give the density (per solid angle) of the secondary rays of 
+   * getRandomDiffuseRay in a given direction, among the rays generated on the
+   * same side of the surface, and the weight these rays receive. Renderers 
+   * mixing the diffuse rays with another sampling need both.
+   *
+   * The default implementation does not know its distribution.
+   *
+   * @param localBasis : the local Basis on the object at the computation point.
+   * @param surfaceCoordinate : the surface  coordinate (texture coordinate) of the 
+   *   computation point on the object.
+   * @param reemitedLight : the reemitedLight we want to compute with the ray.
+   * @param direction : the direction of the secondary ray.
+   * @param density : the density of the direction will be placed here.
+   * @param weight : the weight of a secondary ray in this direction will be 
+   *   placed here.
+   * @return : false if the distribution of the rays is unknown.
+   */
+  virtual bool getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight);
+
   /**
    * Return true if this material has a diffuse component.
    * @return : true if this material has a diffuse component.
@@ -167,6 +187,16 @@ public :
    */
   inline bool isSpecular() const;
 
+protected :
+  /**
+   * Density of the directions drawn by rejection of the points of the cube 
+   * outside the sphere of diameter the normal (lambertian materials). This is
+   * 2*cos^3/pi on the side of the normal.
+   * @param normal : the normal of the sampled hemisphere.
+   * @param direction : the sampled direction.
+   */
+  static inline Real getRejectionDensity(const Vector& normal, const Vector& direction);
+
 private :
   bool _diffuse;
   bool _specular;
@@ -201,4 +231,16 @@ inline bool Material::isSpecular() const
   return _specular;
 }
 
+/**
+ * Density of the directions drawn by rejection of the points of the cube 
+ * outside the sphere of diameter the normal (lambertian materials).
+ */
+inline Real Material::getRejectionDensity(const Vector& normal, const Vector& direction)
+{
+  Real cosOi = direction.dot(normal);
+  if(cosOi <= 0)
+    return 0;
+  return 2.0 * cosOi * cosOi * cosOi / M_PI;
+}
+
 #endif //_MATERIAL_HPP
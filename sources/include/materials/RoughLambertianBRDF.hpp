@@ -64,6 +64,12 @@ public :
    */
   virtual void getRandomDiffuseRay(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& reemitedLight, unsigned int nbRays, std::vector<LightVector>& subrays);
 
+  /**
+   * Give the density of the secondary rays of getRandomDiffuseRay in a given
+   * direction and their weight. (See Material::getDiffuseDensity())
+   */
+  virtual bool getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight);
+
   /**
    * This method compute a random reflexion for the given photon based on an
    * russian roulette for handeling the absorption of the photon.
@@ -78,6 +78,13 @@ class TextureBRDF : public Material {
                                    LightVector& reemitedLight, 
                                    unsigned int nbRays, 
                                    std::vector<LightVector>& subrays);
+  //! @brief Density and weight of the secondary rays of the diffuse 
+  //!  reflexion (see Material::getDiffuseDensity)
+  virtual bool getDiffuseDensity(const Basis& localBasis, 
+                                 const Point2D& surfaceCoordinate, 
+                                 const LightVector& reemitedLight, 
+                                 const Vector& direction, 
+                                 Real& density, Real& weight);
   //! @brief compute a random reflexion for the given photon
   //! @details This method uses the russian roulette algorithm for handeling 
   //!  the absorption of the photon
@@ -100,6 +107,8 @@ class TextureBRDF : public Material {
   //! @brief Generate photons for diffuse material (photon mapping only)
   void generatePhoton(const Vector& normal, MultispectralPhoton& photon, 
                       Real mean);
+  //! @brief Width of the footprint of a view ray on the texture, in texels
+  Real getFilterWidth(const LightVector& view) const;
 
  private :
   //! Embedded material
@@ -0,0 +1,78 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_LOWDISCREPANCY_HPP
+#define GUARD_VRT_LOWDISCREPANCY_HPP
+//!
+//! @file LowDiscrepancy.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Stratified point sets for the sampling of light sources
+//!
+#include <common.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class LowDiscrepancy
+//! @brief Low discrepancy point sets in the unit square
+//! @details A set of n points is a Hammersley set ((i + 0.5) / n, radical 
+//!  inverse of i) shifted by a random vector modulo 1 (Cranley-Patterson 
+//!  rotation): each point is uniformly distributed, so the estimates stay 
+//!  unbiased, while the set is stratified for any n.
+class LowDiscrepancy {
+ public:
+  //! @brief Radical inverse in base 2 (van der Corput sequence)
+  static inline Real RadicalInverse2(unsigned int i);
+  //! @brief Point of a shifted Hammersley set
+  //! @param i Index of the point
+  //! @param n Number of points of the set
+  //! @param shift_x Random shift of the set along x, in [0, 1)
+  //! @param shift_y Random shift of the set along y, in [0, 1)
+  //! @param x X-coordinate of the point, in [0, 1)
+  //! @param y Y-coordinate of the point, in [0, 1)
+  static inline void Hammersley(unsigned int i, unsigned int n, 
+                                Real shift_x, Real shift_y, Real& x, Real& y);
+}; // class LowDiscrepancy
+////////////////////////////////////////////////////////////////////////////////
+inline Real LowDiscrepancy::RadicalInverse2(unsigned int i) {
+  i = (i << 16) | (i >> 16);
+  i = ((i & 0x00ff00ffu) << 8) | ((i & 0xff00ff00u) >> 8);
+  i = ((i & 0x0f0f0f0fu) << 4) | ((i & 0xf0f0f0f0u) >> 4);
+  i = ((i & 0x33333333u) << 2) | ((i & 0xccccccccu) >> 2);
+  i = ((i & 0x55555555u) << 1) | ((i & 0xaaaaaaaau) >> 1);
+  return (Real)(i * 2.3283064365386963e-10);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void LowDiscrepancy::Hammersley(unsigned int i, unsigned int n, 
+                                       Real shift_x, Real shift_y, 
+                                       Real& x, Real& y) {
+  x = (i + Real(0.5)) / n + shift_x;
+  y = RadicalInverse2(i) + shift_y;
+  if (x >= 1)
+    x -= 1;
+  if (y >= 1)
+    y -= 1;
+  // Rounding of the shifted coordinates
+  if (x >= 1)
+    x = Real(0.99999);
+  if (y >= 1)
+    y = Real(0.99999);
+}
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_LOWDISCREPANCY_HPP
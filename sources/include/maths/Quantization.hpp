@@ -0,0 +1,178 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_QUANTIZATION_HPP
+#define GUARD_VRT_QUANTIZATION_HPP
+//!
+//! @file Quantization.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Compact encodings of unit vectors and texture coordinates
+//!
+#include <cmath>
+#include <cstring>
+
+#include <common.hpp>
+#include <maths/Point2D.hpp>
+#include <maths/Vector.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class Quantization
+//! @brief Lossy 32-bit encodings of mesh attributes
+//! @details Directions are mapped on an octahedron, then its lower half is 
+//!  folded on the upper one: two 16-bit coordinates give an angular error 
+//!  below 0.01 degree. Texture coordinates are stored as two half floats 
+//!  (11 bits of mantissa, i.e. 1/2048 of a tile for coordinates in [0,1]).
+class Quantization {
+ public:
+  //! @brief Encode a direction (the length is lost)
+  static inline unsigned int PackNormal(const Vector& normal);
+  //! @brief Decode a direction (unit vector)
+  static inline Vector UnpackNormal(unsigned int packed);
+  //! @brief Encode texture coordinates
+  static inline unsigned int PackTexCoord(const Point2D& texcoord);
+  //! @brief Decode texture coordinates
+  static inline Point2D UnpackTexCoord(unsigned int packed);
+  //! @brief Convert a float to a half float (rounded to the nearest)
+  static inline unsigned short FloatToHalf(float value);
+  //! @brief Convert a half float to a float
+  static inline float HalfToFloat(unsigned short half);
+
+ private:
+  //! @brief Signed value in [-1,1] to 16 bits
+  static inline unsigned int ToSnorm16(Real value);
+  //! @brief 16 bits to signed value in [-1,1]
+  static inline Real FromSnorm16(unsigned int bits);
+  //! @brief Sign of a value, 1 for 0
+  static inline Real SignNotZero(Real value) { return value < 0 ? -1 : 1; }
+}; // class Quantization
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Quantization::ToSnorm16(Real value) {
+  if (value > 1)
+    value = 1;
+  if (value < -1)
+    value = -1;
+  int bits = (int)std::floor(value * Real(32767) + Real(0.5));
+  return (unsigned int)(bits & 0xffff);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline Real Quantization::FromSnorm16(unsigned int bits) {
+  Real value = Real((short)(unsigned short)bits) / Real(32767);
+  return (value < -1) ? Real(-1) : value;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Quantization::PackNormal(const Vector& normal) {
+  Real l1 = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+  if (l1 == 0)
+    return 0;
+  Real x = normal[0] / l1;
+  Real y = normal[1] / l1;
+  // Lower half: fold the triangles on the upper half
+  if (normal[2] < 0) {
+    Real folded_x = (1 - std::fabs(y)) * SignNotZero(x);
+    y = (1 - std::fabs(x)) * SignNotZero(y);
+    x = folded_x;
+  }
+  return ToSnorm16(x) | (ToSnorm16(y) << 16);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline Vector Quantization::UnpackNormal(unsigned int packed) {
+  Real x = FromSnorm16(packed & 0xffff);
+  Real y = FromSnorm16(packed >> 16);
+  Real z = 1 - std::fabs(x) - std::fabs(y);
+  if (z < 0) {
+    Real unfolded_x = (1 - std::fabs(y)) * SignNotZero(x);
+    y = (1 - std::fabs(x)) * SignNotZero(y);
+    x = unfolded_x;
+  }
+  Vector normal(x, y, z);
+  normal.normalize();
+  return normal;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Quantization::PackTexCoord(const Point2D& texcoord) {
+  return (unsigned int)FloatToHalf((float)texcoord[0]) 
+       | ((unsigned int)FloatToHalf((float)texcoord[1]) << 16);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline Point2D Quantization::UnpackTexCoord(unsigned int packed) {
+  return Point2D(HalfToFloat((unsigned short)(packed & 0xffff)), 
+                 HalfToFloat((unsigned short)(packed >> 16)));
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned short Quantization::FloatToHalf(float value) {
+  unsigned int bits;
+  memcpy(&bits, &value, 4);
+  unsigned int sign = (bits >> 16) & 0x8000;
+  unsigned int magnitude = bits & 0x7fffffff;
+
+  // NaN and infinities
+  if (magnitude >= 0x7f800000)
+    return (unsigned short)(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+  // Overflow
+  if (magnitude >= 0x477ff000)
+    return (unsigned short)(sign | 0x7c00);
+  // Subnormal halfs (and zero)
+  if (magnitude < 0x38800000) {
+    if (magnitude < 0x33000000)
+      return (unsigned short)sign;
+    unsigned int mantissa = (magnitude & 0x007fffff) | 0x00800000;
+    unsigned int shift = 126 - (magnitude >> 23);
+    unsigned int half = mantissa >> shift;
+    unsigned int rest = mantissa & ((1u << shift) - 1);
+    unsigned int halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return (unsigned short)(sign | half);
+  }
+  // Normal halfs: rebias the exponent, round the mantissa to nearest even
+  unsigned int half = (magnitude - 0x38000000) >> 13;
+  unsigned int rest = magnitude & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return (unsigned short)(sign | half);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline float Quantization::HalfToFloat(unsigned short half) {
+  unsigned int sign = ((unsigned int)half & 0x8000) << 16;
+  unsigned int exponent = (half >> 10) & 0x1f;
+  unsigned int mantissa = half & 0x3ff;
+  unsigned int bits;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // Subnormal half: normalize the mantissa
+    exponent = 113;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  float value;
+  memcpy(&value, &bits, 4);
+  return value;
+}
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_QUANTIZATION_HPP
@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_INSTANCE_HPP
+#define GUARD_VRT_INSTANCE_HPP
+//!
+//! @file Instance.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file defines the affine instance of a shape
+//!
+#include <core/Camera.hpp>
+#include <objectshapes/ObjectShape.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class Instance
+//! @brief Shape placed in the scene by an affine transformation
+//! @details The rays are transformed into the space of the shape, so the 
+//!  shape (usually an instance of a shared mesh, with its own hierarchy) is 
+//!  never copied: thousands of instances only cost their matrices. The 
+//!  distances are given along the rays of the scene, and the local basis is 
+//!  transformed back (normals with the inverse transpose).
+class Instance : public ObjectShape {
+ public :
+  //! @brief Constructor
+  //! @param matrix Object to world transformation, 3x4 matrix row by row
+  //! @param shape Shape to be placed (deleted with the instance)
+  Instance(const Real matrix[12], ObjectShape* shape);
+  //! @brief Destructor
+  virtual ~Instance();
+
+ public:
+  //! @brief Intersection test with p_shape
+  //! @param ray Input ray used by the test
+  //! @param distance If Intersection is detected, then distance will match the 
+  //!  following length : [ray.o, first hit point]; otherwise the distance will  
+  //!  be undetermined
+  //! @return True if the ray intersect the object.
+  virtual bool intersect(const Ray& ray, Real& distance);
+  //! @brief Get the local basis of the placed object
+  virtual void getLocalBasis(const Ray& ray, const Real& distance, 
+                             Basis& localBasis, Point2D& surfaceCoordinate);
+  //! @brief Get the derivatives of the surface point of the placed object
+  virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                     Vector& dpdu, Vector& dpdv);
+  //! @brief Get the bounding box of the placed object
+  virtual void getBoundingBox(BoundingBox& boundingBox);
+
+ private:
+  //! @brief Ray in the space of the shape (unit direction)
+  //! @return Length of the transformed direction (local distance per unit)
+  Real ToLocal(const Ray& ray, Ray& local) const;
+  //! @brief Object to world transformation of a point
+  void TransformPoint(const Real matrix[12], const Point& p, Point& result) const;
+  //! @brief Object to world transformation of a vector
+  void TransformVector(const Real matrix[12], const Vector& v, 
+                       Vector& result) const;
+
+ private:
+  //! @brief Not copyable
+  Instance(const Instance&);
+  Instance& operator=(const Instance&);
+
+ private :
+  //! Object to world transformation
+  Real m_matrix[12];
+  //! World to object transformation
+  Real m_inverse[12];
+  //! Transformation of the normals (inverse transpose, no translation)
+  Real m_normal_matrix[12];
+  //! Shape to be placed
+  ObjectShape* p_shape; 
+}; // class Instance
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_INSTANCE_HPP
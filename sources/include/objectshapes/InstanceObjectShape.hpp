@@ -60,6 +60,12 @@ public :
    */
   inline virtual void getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate);
 
+  /**
+   * Partial derivatives of the intersection point with respect to the
+   * surface coordinates. Return false if they are unknown.
+   */
+  inline virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv);
+
   /**
    * Return the bounding box of the object.
    * boundingBox : we will put the bounding box here
@@ -121,6 +127,15 @@ inline void InstanceObjectShape::getLocalBasis(const Ray& ray, const Real& dista
   _shape->getLocalBasis(ray, distance, localBasis, surfaceCoordinate);
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the
+ * surface coordinates. Return false if they are unknown.
+ */
+inline bool InstanceObjectShape::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  return _shape->getSurfaceDerivatives(ray, distance, dpdu, dpdv);
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
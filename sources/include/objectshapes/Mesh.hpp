@@ -18,45 +18,28 @@
 #define _MESH_HPP
 
 #include <core/Camera.hpp>
+#include <objectshapes/MeshData.hpp>
 #include <objectshapes/ObjectShape.hpp>
-#include <objectshapes/Triangle.hpp>
-#include <structures/Octree.hpp>
+#include <structures/MeshBVH.hpp>
 
-class MeshOctreeVisitor : public OctreeVisitor<Triangle>{
-public :
-  /**
-   * Initialize the visitor and errase the old results.
-   */
-  void init();
-
-  /**
-   * Apply the visitor on a triangle
-   */
-  void apply(const Ray& ray, Triangle& object);
-
-  /**
-   * Return the first intersection distance
-   */
-  Real getMinDistance();
-
-  /**
-   * Return the triangle of the first intersection, NULL otherwise
-   */
-  Triangle* getMinDistanceTriangle();
-private :
-  Real _distance;
-  Triangle* _object;
-};
+#include <limits>
+#include <string>
+#include <vector>
 
 class Mesh : public ObjectShape{
 public :
 
 /**
- * Constructor from triangles array
- * triangles : array that contain all the triangles.
- * nbTriangles : number of triangles contained in the given array
+ * Constructor from indexed triangles
+ * data : shared vertices and attributes, and corners of the triangles in the
+ *   order of the leaves of the hierarchy (see MeshBVH::Build). The arrays
+ *   are moved into the mesh: data is empty after the call.
+ * hierarchy : hierarchy of the triangles, deleted with the mesh
+ * double_sided : true if the normal must be turned toward the ray
+ * compact : true to quantize the normals (octahedral, 2x16 bits) and the
+ *   texture coordinates (half floats)
  */
-Mesh(Triangle* triangles, int nbTriangles);
+Mesh(MeshData& data, MeshBVH* hierarchy, bool double_sided, bool compact = false);
 
 /**
  * Virtual destructor
@@ -88,16 +71,87 @@ virtual bool intersect(const Ray& ray, Real& distance);
  */
 virtual void getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate);
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv);
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
  */
 virtual void getBoundingBox(BoundingBox& boundingBox);
 
+/**
+ * Return the number of triangles of the mesh
+ */
+inline unsigned int getNbTriangles() const;
+
+/**
+ * Get the vertices of a triangle of the mesh
+ */
+inline void getTriangle(unsigned int triangle, Point& a, Point& b, Point& c) const;
+
+/**
+ * Return true if the normal is turned toward the ray
+ */
+inline bool isDoubleSided() const;
+
+/**
+ * Return the memory used by the mesh, in bytes
+ */
+size_t getMemoryUsage() const;
+
+/**
+ * Write the memory used by each array of the mesh in the log
+ * name : name of the mesh in the report
+ */
+void printMemoryReport(const std::string& name) const;
+
 private :
-  MeshOctreeVisitor _visitor;
-  Octree<Triangle>* _triangles;
+/**
+ * Return the nearest triangle hit by the ray, -1 if there is none.
+ * distance : we put the distance of the intersection here.
+ * maxDistance : the triangles further than this distance are ignored.
+ */
+int getNearestTriangle(const Ray& ray, Real& distance, Real maxDistance = std::numeric_limits<Real>::max()) const;
+
+/**
+ * Intersection test with one triangle (Moller-Trumbore).
+ * distance : we put the distance of the intersection here.
+ */
+inline bool intersectTriangle(unsigned int triangle, const Ray& ray, Real& distance) const;
+
+/**
+ * Get the normal of a corner, return false if the corner has no normal
+ */
+inline bool getCornerNormal(unsigned int corner, Vector& normal) const;
+
+/**
+ * Get the texture coordinates of a corner (0 if the corner has none)
+ */
+inline void getCornerTexCoord(unsigned int corner, Point2D& texCoord) const;
+
+  //Shared vertices and attributes (quantized attributes if compact)
+  std::vector<Point> _vertices;
+  std::vector<Vector> _normals;
+  std::vector<unsigned int> _packedNormals;
+  std::vector<Point2D> _texCoords;
+  std::vector<unsigned int> _packedTexCoords;
+  //Corners of the triangles. The attribute indices are empty when the
+  //attributes share the vertex indices.
+  std::vector<unsigned int> _vertexIndices;
+  std::vector<unsigned int> _normalIndices;
+  std::vector<unsigned int> _texCoordIndices;
+  MeshBVH* _hierarchy;
   BoundingBox _boundingbox;
+  bool _doubleSided;
 };
 
 /**
@@ -105,7 +159,33 @@ private :
  */
 Mesh::~Mesh()
 {
-  delete _triangles;
+  delete _hierarchy;
+}
+
+/**
+ * Return the number of triangles of the mesh
+ */
+unsigned int Mesh::getNbTriangles() const
+{
+  return (unsigned int)(_vertexIndices.size() / 3);
+}
+
+/**
+ * Get the vertices of a triangle of the mesh
+ */
+void Mesh::getTriangle(unsigned int triangle, Point& a, Point& b, Point& c) const
+{
+  a = _vertices[_vertexIndices[3*triangle]];
+  b = _vertices[_vertexIndices[3*triangle+1]];
+  c = _vertices[_vertexIndices[3*triangle+2]];
+}
+
+/**
+ * Return true if the normal is turned toward the ray
+ */
+bool Mesh::isDoubleSided() const
+{
+  return _doubleSided;
 }
 
 #endif //_MESH_HPP
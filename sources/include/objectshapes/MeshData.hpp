@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MESHDATA_HPP
+#define GUARD_VRT_MESHDATA_HPP
+//!
+//! @file MeshData.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Indexed description of a triangle mesh
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @struct MeshData
+//! @brief Triangles sharing their vertices and attributes by index
+//! @details Each triangle has three corners. A corner refers to a vertex, 
+//!  and optionally to a normal and to a texture coordinate (kNO_INDEX if the 
+//!  attribute is not given).
+struct MeshData {
+  //! Index of a missing attribute
+  static const unsigned int kNO_INDEX = 0xffffffffu;
+
+  //! Shared vertices and attributes
+  std::vector<Point> vertices;
+  std::vector<Vector> normals;
+  std::vector<Point2D> texcoords;
+  //! Indices of the corners (3 per triangle)
+  std::vector<unsigned int> vertex_indices;
+  std::vector<unsigned int> normal_indices;
+  std::vector<unsigned int> texcoord_indices;
+
+  //! @brief Acces to the number of triangles
+  inline unsigned int nb_triangles(void) const {
+    return (unsigned int)(vertex_indices.size() / 3);
+  }
+  //! @brief Free all the arrays
+  inline void clear(void) {
+    std::vector<Point>().swap(vertices);
+    std::vector<Vector>().swap(normals);
+    std::vector<Point2D>().swap(texcoords);
+    std::vector<unsigned int>().swap(vertex_indices);
+    std::vector<unsigned int>().swap(normal_indices);
+    std::vector<unsigned int>().swap(texcoord_indices);
+  }
+}; // struct MeshData
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MESHDATA_HPP
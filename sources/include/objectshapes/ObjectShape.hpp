@@ -56,6 +56,18 @@ virtual bool intersect(const Ray& ray, Real& distance)=0;
  */
 virtual void getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate)=0;
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if the shape has no such derivatives (the
+ * texture footprint is then unknown).
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+virtual inline bool getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv);
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
@@ -71,4 +83,12 @@ ObjectShape::~ObjectShape()
   //Nothing to do
 }
 
+/**
+ * Partial derivatives of the intersection point, unknown by default
+ */
+bool ObjectShape::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  return false;
+}
+
 #endif //_OBJECT_SHAPE_HPP
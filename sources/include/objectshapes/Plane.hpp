@@ -60,6 +60,17 @@ virtual bool intersect(const Ray& ray, Real& distance);
  */
 virtual void getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate);
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv);
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
@@ -54,6 +54,9 @@ class Scale : public ObjectShape {
   virtual bool intersect(const Ray& ray, Real& distance);
   //! @brief Get the local basis of the scaled object
   virtual void getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate);
+  //! @brief Get the derivatives of the surface point of the scaled object
+  virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                     Vector& dpdu, Vector& dpdv);
   //! @brief Get the bounding box of the scaled object
   virtual void getBoundingBox(BoundingBox& boundingBox);
 
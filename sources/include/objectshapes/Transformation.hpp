@@ -155,6 +155,15 @@ class Transformation : public ObjectShape {
   //!  mapping
   virtual void getLocalBasis(const Ray& ray, const Real& distance, 
                              Basis& local_basis, Point2D& surface_coordinate);
+  //! @brief Get the derivatives of the surface point with respect to the 
+  //!  surface coordinates
+  //! @param ray Input ray
+  //! @param distance Input length from the origin of the ray to the hit point
+  //! @param dpdu Output derivative along the first surface coordinate
+  //! @param dpdv Output derivative along the second surface coordinate
+  //! @return False if the derivatives are unknown
+  virtual bool getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                     Vector& dpdu, Vector& dpdv);
   //! @brief Get the bounding box of the transformed object
   //! @param bounding_box Output bounding box 
   virtual void getBoundingBox(BoundingBox& bounding_box);
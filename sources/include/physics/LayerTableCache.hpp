@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_LAYERTABLECACHE_HPP
+#define GUARD_VRT_LAYERTABLECACHE_HPP
+//!
+//! @file LayerTableCache.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Cache of the precomputed tables of layered materials
+//!
+#include <map>
+#include <string>
+#include <vector>
+
+#include <core/LightBase.hpp>
+#include <structures/Spectrum.hpp>
+#include <structures/Medium.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class LayerTableCache
+//! @brief Memory and disk cache of angle x wavelength tables
+//! @details The tables of layered materials (reflectances and transmittances 
+//!  for each sampled angle) only depend on the media, the thicknesses, the 
+//!  number of samples and the wavelengths. They are identified by a 64-bit 
+//!  hash of these inputs (see Key), kept in memory for the whole run and, if a 
+//!  directory is set, written to disk so that the next jobs (and the other MPI 
+//!  ranks) load them instead of computing them again.
+//! @remarks The methods can be called from several OpenMP threads.
+class LayerTableCache {
+ public:
+  //! @class Key
+  //! @brief FNV-1a hash of the inputs of a table
+  class Key {
+   public:
+    //! @brief Constructor: the wavelengths and the size of Real are hashed
+    //! @param tag Name of the kind of table
+    Key(const char* tag);
+    //! @brief Hash raw bytes
+    Key& Add(const void* data, size_t size);
+    //! @brief Hash an integer
+    Key& Add(unsigned int value);
+    //! @brief Hash a real value
+    Key& Add(Real value);
+    //! @brief Hash all the values of a spectrum
+    Key& Add(const Spectrum& spectrum);
+    //! @brief Hash the optical properties of a medium
+    Key& Add(const Medium& medium);
+    //! @brief Value of the hash
+    inline unsigned long long value(void) const { return m_hash; }
+
+   private:
+    //! Current value of the hash
+    unsigned long long m_hash;
+  }; // class Key
+
+ public:
+  //! @brief Set the directory of the disk cache (empty: no disk cache)
+  static void SetDirectory(const std::string& directory);
+  //! @brief Look for tables in memory, then on disk
+  //! @param key Hash of the inputs of the tables
+  //! @param tables Found tables
+  //! @return true if the tables have been found
+  static bool Find(const Key& key, std::vector<Spectrum>& tables);
+  //! @brief Store computed tables in memory and on disk
+  //! @param key Hash of the inputs of the tables
+  //! @param tables Tables to be stored
+  static void Store(const Key& key, const std::vector<Spectrum>& tables);
+  //! @brief Free the tables kept in memory
+  static void Clear(void);
+
+ private:
+  //! @brief Name of the disk cache file of a key
+  static std::string GetFilename(unsigned long long key);
+  //! @brief Read tables from the disk cache
+  static bool Load(unsigned long long key, std::vector<Spectrum>& tables);
+  //! @brief Write tables into the disk cache
+  static void Save(unsigned long long key, 
+                   const std::vector<Spectrum>& tables);
+
+ private:
+  //! Directory of the disk cache
+  static std::string s_directory;
+  //! Tables kept in memory
+  static std::map<unsigned long long, std::vector<Spectrum> > s_tables;
+}; // class LayerTableCache
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_LAYERTABLECACHE_HPP
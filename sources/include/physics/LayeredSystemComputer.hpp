@@ -52,6 +52,21 @@ public :
    */
   static void computeSpecularLayerSystem(Spectrum& Rs, Spectrum& Rp, Spectrum& Ts, Spectrum& Tp, Real cosOi, std::vector<const Medium*> media, std::vector<Real> thickness);
 
+  /**
+   * Compute the specular reflectance of a layered system for the incident
+   * angles i*PI/(2*samples), i in [0, samples[. The tables are looked up in
+   * (and added to) the LayerTableCache.
+   * 
+   * @param Rs : the reflectance for the S-polarization of each angle.
+   * @param Rp : the reflectance for the P-polarization of each angle.
+   * @param Ts : the transmittance for the S-polarization of each angle.
+   * @param Tp : the transmittance for the P-polarization of each angle.
+   * @param samples : the number of sampled angles.
+   * @param media : the medium of every layer. Note that the first medium is the external medium.
+   * @param thickness : the thickness (in meters) of each layer (note that the first one is not used).
+   */
+  static void computeSpecularLayerTable(std::vector<Spectrum>& Rs, std::vector<Spectrum>& Rp, std::vector<Spectrum>& Ts, std::vector<Spectrum>& Tp, unsigned int samples, const std::vector<const Medium*>& media, const std::vector<Real>& thickness);
+
 private :
   /**
    * Compute the diffuse reflectance of a layered system.
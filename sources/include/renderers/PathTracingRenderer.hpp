@@ -0,0 +1,167 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_PATHTRACINGRENDERER_HPP
+#define GUARD_VRT_PATHTRACINGRENDERER_HPP
+//!
+//! @file PathTracingRenderer.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @remarks
+//! @details This file defines the behaviors of the "Path Tracing" engine
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <core/LightBase.hpp>
+
+#include <core/Object.hpp>
+
+#include <core/Source.hpp>
+
+#include <renderers/Renderer.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @see Environment
+class Environment;
+//! @see Scenery
+class Scenery;
+////////////////////////////////////////////////////////////////////////////////
+//! @class PathTracingRenderer
+//! @brief Defines the "Path Tracing" engine
+//! @details Unidirectional spectral path tracer. Instead of the recursion
+//!  of the other engines (one CastRay per sub-ray), a single continuation is
+//!  sampled at each vertex and the path is traced by a loop:
+//!  @arg the forward pass follows the path from the eye, storing its 
+//!   vertices in an array allocated once per thread, and adds the direct 
+//!   lighting of each vertex (next-event estimation, multiple importance 
+//!   sampling of the environment and of the diffuse rays)
+//!  @arg the backward pass goes from the last vertex to the eye, reemiting 
+//!   the light of each vertex toward the previous one with the material, so
+//!   the polarisation is handled as in the other engines
+//!  The cost of a sample is thus bounded by the maximum depth, without any
+//!  branching.
+class PathTracingRenderer: public Renderer {
+ public:
+  //! @brief Constructor
+  //! @param max_depth Maximum number of bounces of a path
+  //! @param scale Scale of the 3D scene (1 = 1 meter)
+  //! @param envir Pointer to the environment mapping object
+  PathTracingRenderer(int max_depth, Real scale, Environment* envir);
+
+  //! @brief Destructor
+  virtual ~PathTracingRenderer(void);
+ 
+ public:
+  //! @brief Initialize the renderer
+  //! @details This method will all precomputations by itself
+  //! @param scenery Scenery ready for rendering
+  //! @param nb_threads Number of threads used by the rendering process
+  virtual void Init(Scenery& scenery, int nb_threads);
+  //! @brief Initialize the renderer with precomputed data 
+  //! @remarks The precomputed data can be obtained from netwotk for example
+  //! @param scenery Scenery ready for rendering
+  //! @param data Pointer on the precomputed data buffer
+  //! @param data_size Size of the precomputed data buffer
+  virtual void InitWithData(Scenery& scenery, 
+                            unsigned char* data, unsigned int data_size);
+  //! @brief Export precomputed data 
+  //! @remarks The path tracer has no precomputed data
+  //! @param data Pointer that will contain the adress of the exported 
+  //!  data buffer; May be equal to NULL
+  //! @param data_size : Size of the exported data buffer
+  virtual void ExportData(unsigned char** data, unsigned int* data_size);
+    
+ public:
+  //! @brief Compute the light data for a given ray
+  //! @param scenery Scenery ready for rendering
+  //! @param light_data results of computation will be here
+  //! @param depth Maximum number of bounces (m_max_depth if negative)
+  virtual void CastRay(Scenery& scenery, LightVector& light_data, 
+                       int depth = -1);
+
+ private:
+  //! @struct PathVertex
+  //! @brief State of a vertex of a path
+  struct PathVertex {
+    //! Light reemited toward the previous vertex (or the eye)
+    LightVector light;
+    //! Object of the vertex (NULL if the path escaped or hit a source)
+    Object* object;
+    //! Local basis at the vertex
+    Basis local_basis;
+    //! Texture coordinate of the vertex
+    Point2D surface_coordinate;
+    //! True if the light of the next vertex is reflected specularly
+    bool specular;
+    //! Weight of the light of the next vertex (0: end of the path)
+    Real weight;
+    //! Weight of the environment seen by the ray reaching this vertex
+    Real environment_weight;
+    //! True if the ray reaching this vertex sees the sources
+    bool see_sources;
+  };
+
+ private:
+  //! @brief Sample the continuation of a path at a vertex
+  //! @details One ray is uniformly chosen among the specular sub-rays and 
+  //!  the diffuse ray; the russian roulette may then terminate the path.
+  //! @param vertex Vertex of the path, its weight is set
+  //! @param bounce Number of bounces before the vertex
+  //! @param nb_choices Number of specular sub-rays, plus one if the path may
+  //!  continue with a diffuse ray
+  //! @param subrays Selected specular sub-rays (reused for the diffuse ray)
+  //! @param weights Weights of the selected specular sub-rays
+  //! @param throughput Throughput of the path
+  //! @param next Next vertex, its light is set to the continuation ray
+  //! @return False if the path ends at this vertex
+  bool SampleContinuation(PathVertex& vertex, int bounce, 
+                          unsigned int nb_choices, 
+                          std::vector<LightVector>& subrays, 
+                          const std::vector<Real>& weights, 
+                          Real& throughput, PathVertex& next);
+  //! @brief Attenuation of a diffuse ray (largest over its wavelengths)
+  Real GetDiffuseAttenuation(const PathVertex& vertex, 
+                             const LightVector& ray) const;
+  //! @brief Add the contribution of the sources and of the sampled 
+  //!  directions of the environment (next-event estimation)
+  //! @param diffuse_probability Probability of a diffuse continuation of 
+  //!  the path (0 if the path cannot continue with a diffuse ray)
+  void AddDirectContribution(Scenery& scenery, PathVertex& vertex, 
+                             Real diffuse_probability);
+  //! @brief Add the contribution of the sampled directions of the 
+  //!  environment
+  void AddEnvironmentContribution(Scenery& scenery, PathVertex& vertex, 
+                                  Real diffuse_probability);
+ 
+ private : 
+  //! Maximum number of bounces of a path
+  int m_max_depth;
+  //! Scale of the 3D scene (1 = 1 meter)
+  Real m_scale;
+  //! Environment
+  Environment* p_environment;
+  //! Vertices of the paths of each thread
+  std::vector< std::vector<PathVertex> > m_paths;
+  //! Sub-rays of the specular events of each thread
+  std::vector< std::vector<LightVector> > m_subrays;
+}; // class PathTracingRenderer
+////////////////////////////////////////////////////////////////////////////////
+#endif //GUARD_VRT_PATHTRACINGRENDERER_HPP
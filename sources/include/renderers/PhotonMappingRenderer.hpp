@@ -36,6 +36,10 @@
 #include <core/Source.hpp>
 
 #include <structures/MultispectralPhotonMap.hpp>
+#include <structures/ProjectionMap.hpp>
+#include <structures/ImportanceGrid.hpp>
+#include <structures/GuidingTree.hpp>
+#include <structures/IrradianceCache.hpp>
 #include <renderers/Renderer.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 //! @see Environment
@@ -67,6 +71,19 @@ class PhotonMappingRenderer: public Renderer {
 	//! @param estimation_min_distance Minimum length	between 2 bounces in the
   //!  ray-tracing algorithm
   //! @param envir Pointer to the environment mapping object
+  //! @param projection_maps If true, the sources only emit their photons 
+  //!  toward the objects (global maps) or the specular objects (caustic 
+  //!  maps), see ProjectionMap
+  //! @param nb_importons Number of importons traced from the cameras to 
+  //!  select the stored photons (0: all the photons are stored), see 
+  //!  ImportanceGrid
+  //! @param path_guiding If true, the diffuse rays are partly guided by the 
+  //!  incident light learned from the indirect photons, see GuidingTree
+  //! @param irradiance_cache If true, the indirect diffuse irradiance of 
+  //!  the primary hits is interpolated from cached records, see 
+  //!  IrradianceCache
+  //! @param cache_accuracy Maximum error allowed by the interpolation of 
+  //!  the cached irradiance
   PhotonMappingRenderer(int max_depth, Real scale, 
                         unsigned int nb_global_photon, 
                         unsigned int nb_caustic_photon, 
@@ -76,7 +93,12 @@ class PhotonMappingRenderer: public Renderer {
                         Real search_caustic_radius, 
                         unsigned int nb_samples, 
                         Real estimation_min_distance,
-                        Environment* envir);
+                        Environment* envir,
+                        bool projection_maps = false,
+                        unsigned int nb_importons = 0,
+                        bool path_guiding = false,
+                        bool irradiance_cache = false,
+                        Real cache_accuracy = 0.2);
   //! @brief Destructor
   virtual ~PhotonMappingRenderer(void);
  
@@ -117,8 +139,55 @@ class PhotonMappingRenderer: public Renderer {
   //! @param last_object Last object hit
   //! @param precise If false, a fast estimation will be done; this 
   //!  paramater can be used for secondary rays
+  //! @param environment_weight Weight of the environment if the ray escapes
+  //!  the scenery (multiple importance sampling of the diffuse rays)
+  //! @param throughput Throughput of the path (russian roulette)
   void CastRay(Scenery& scenery, LightVector& light_data, int depth = -1, 
-               Object* last_object = 0, bool precise = true);
+               Object* last_object = 0, bool precise = true, 
+               Real environment_weight = 1, Real throughput = 1);
+  //! @brief Compute the bounding box of the objects
+  void ComputeBounds(Scenery& scenery);
+  //! @brief Mark the directions in which a source reaches the objects
+  //! @details Probe photons of the source are cast: the cells of the 
+  //!  directions hitting an object (a specular object for the caustic maps) 
+  //!  are marked, then dilated.
+  //! @param scenery Scenery ready for rendering
+  //! @param source Source casting the photons
+  //! @param caustic True for the caustic maps
+  //! @param map Projection map of the source
+  //! @return Fraction of the photons of the source in the marked cells
+  Real BuildProjectionMap(Scenery& scenery, Source& source, bool caustic, 
+                          ProjectionMap& map);
+  //! @brief Generate a photon of a source in the marked cells of its map
+  //! @details The photon carries its power divided by the probability of 
+  //!  the marked cells (fraction).
+  //! @param source Source casting the photon
+  //! @param map Projection map of the source (NULL: all the directions)
+  //! @param fraction Fraction of the photons in the marked cells
+  //! @param photon Photon to be generated
+  void EmitPhoton(Source& source, const ProjectionMap* map, Real fraction, 
+                  MultispectralPhoton& photon);
+  //! @brief Build the importance grid from importons of the cameras
+  //! @param scenery Scenery ready for rendering
+  void BuildImportanceGrid(Scenery& scenery);
+  //! @brief Cast an importon and add its hit points to the importance grid
+  //! @param scenery Scenery ready for rendering
+  //! @param importon Importon to be cast (bounced like a photon)
+  //! @param nb_diffuse Number of diffuse bounces left
+  //! @param depth Counter for recursions
+  //! @param last_object_hit Last object hit
+  void CastImporton(Scenery& scenery, MultispectralPhoton& importon, 
+                    int nb_diffuse, int depth, Object* last_object_hit = 0);
+  //! @brief Store a photon in a map, or not, depending on the importance 
+  //!  of its position
+  //! @details The stored photons are scaled by the inverse of their storage
+  //!  probability (russian roulette), the photon itself is left unchanged.
+  //! @param map Photon map
+  //! @param photon Photon to be stored
+  void StorePhoton(MultispectralPhotonMap& map, 
+                   const MultispectralPhoton& photon);
+  //! @brief Maximum number of bounces of a photon
+  int GetPhotonDepth(void) const;
   //! @brief Build the global photon maps
   //! @param scenery Scenery ready for rendering
   void BuildGlobalPhotonMaps(Scenery& scenery);
@@ -154,18 +223,38 @@ class PhotonMappingRenderer: public Renderer {
                                    const Basis& local_basis, 
                                    const Point2D& surface_coordinate);
   //! @brief Add the contribution of glossiness and reflections 
+  //! @param throughput Throughput of the path (russian roulette)
   void AddGlossyContribution(Scenery& scenery, 
                              LightVector& light_data, 
                              Object* object, 
                              const Basis& local_basis, 
                              const Point2D& surface_coordinate, 
-                             int depth, bool precise);
+                             int depth, bool precise, Real throughput);
   //! @brief Add the contribution ot the direct light
+  //! @param nb_diffuse_samples Number of diffuse rays cast from the same 
+  //!  point (weights of the sampled environment)
+  //! @param guiding_leaf Leaf of the guiding tree of the diffuse rays (-1 if
+  //!  they are not guided)
   void AddDirectContribution(Scenery& scenery, 
                              LightVector& light_data, 
                              Object* object, 
                              const Basis& local_basis, 
-                             const Point2D& surface_coordinate);
+                             const Point2D& surface_coordinate,
+                             unsigned int nb_diffuse_samples, 
+                             int guiding_leaf = -1);
+  //! @brief Add the contribution of the sampled directions of the 
+  //!  environment
+  //! @param nb_diffuse_samples Number of diffuse rays cast from the same 
+  //!  point: the two samplings are combined with the power heuristic
+  //! @param guiding_leaf Leaf of the guiding tree of the diffuse rays (-1 if
+  //!  they are not guided)
+  void AddEnvironmentContribution(Scenery& scenery, 
+                                  LightVector& light_data, 
+                                  Object* object, 
+                                  const Basis& local_basis, 
+                                  const Point2D& surface_coordinate,
+                                  unsigned int nb_diffuse_samples, 
+                                  int guiding_leaf = -1);
   //! @brief Estimate the caustic contribution
   void AddCausticContribution(Scenery& scenery, 
                              LightVector& light_data, 
@@ -173,12 +262,44 @@ class PhotonMappingRenderer: public Renderer {
                              const Basis& local_basis, 
                              const Point2D& surface_coordinate);
   //! @brief Add the indirect diffuse light contribution
+  //! @param guiding_leaf Leaf of the guiding tree (-1: no guided rays)
   void AddDiffuseContribution(Scenery& scenery, 
                              LightVector& light_data, 
                              Object* object, 
                              const Basis& local_basis, 
                              const Point2D& surface_coordinate, 
-                             int depth, bool precise);
+                             int depth, bool precise, 
+                             int guiding_leaf = -1);
+  //! @brief Leaf of the guiding tree for the precise diffuse rays of a point
+  //! @return -1 if the rays are not guided (no guiding, irradiance cache or
+  //!  unknown distribution of the diffuse rays of the material)
+  int GetGuidingLeaf(Object* object, const Basis& local_basis, 
+                     const Point2D& surface_coordinate, 
+                     const LightVector& light_data);
+  //! @brief Density of the diffuse rays in a direction, for the multiple 
+  //!  importance sampling of the environment
+  //! @param guiding_leaf Leaf of the guiding tree (-1: no guided rays)
+  Real GetDiffuseRayDensity(Object* object, const Basis& local_basis, 
+                            const Point2D& surface_coordinate, 
+                            const LightVector& light_data, 
+                            int guiding_leaf, const Vector& direction);
+  //! @brief Add the indirect diffuse light contribution from the 
+  //!  irradiance cache
+  void AddCachedDiffuseContribution(Scenery& scenery, 
+                                    LightVector& light_data, 
+                                    Object* object, 
+                                    const Basis& local_basis, 
+                                    const Point2D& surface_coordinate, 
+                                    int depth);
+  //! @brief Compute the irradiance of a point and add it to the cache
+  //! @param scenery Scenery ready for rendering
+  //! @param object Object of the point
+  //! @param basis Basis of the point, normal on the side of the viewer
+  //! @param depth Counter for recursions
+  //! @param irradiance Irradiance of the wavelengths of the global spectrum
+  void ComputeIrradianceRecord(Scenery& scenery, Object* object, 
+                               const Basis& basis, int depth, 
+                               Real* irradiance);
   //! @brief Estimate the diffuse contribution
   void AddDiffuseEstimation(Scenery& scenery, 
                              LightVector& light_data, 
@@ -219,6 +340,25 @@ class PhotonMappingRenderer: public Renderer {
   unsigned int m_nb_samples;
   //! Environment
   Environment* p_environment;
+  //! Bounding box of the objects (emission of the environment photons)
+  BoundingBox m_bounds;
+  //! Emission of the photons guided by projection maps
+  bool m_projection_maps;
+  //! Number of importons traced from the cameras
+  unsigned int m_nb_importons;
+  //! Storage probabilities of the photons (empty without importons)
+  ImportanceGrid m_importance;
+  //! Guiding of the diffuse rays
+  bool m_path_guiding;
+  //! Incident light learned from the indirect photons (empty without 
+  //!  guiding)
+  GuidingTree m_guiding;
+  //! Interpolation of the indirect diffuse irradiance
+  bool m_irradiance_cache;
+  //! Maximum error allowed by the interpolation of the cached irradiance
+  Real m_cache_accuracy;
+  //! Cached irradiance (disabled without interpolation)
+  IrradianceCache m_cache;
 }; // class PhotonMappingRenderer
 
 #endif // GUARD_VRT_PHOTONMAPPINGRENDERER_HPP
@@ -28,18 +28,70 @@
 //! @remarks
 //! @details This file defines the base class all rendering engines must inherit
 //!
+#include <vector>
+
 #include <core/3DBase.hpp>
 #include <core/LightBase.hpp>
+#include <structures/Distribution.hpp>
+#include <structures/LightTree.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
 //! @see Scenery
 class Scenery;
+//! @see Object
+class Object;
 //! @class Renderer
 //! @brief Defines the base class for rendering engines
 class Renderer {
+ public:
+  //! @enum LightSelection
+  //! @brief Selection of the sources lighting a point
+  enum {
+    //! Proportionally to the power of the sources
+    kPOWER_SELECTION = 0,
+    //! With a light tree (power, distance and orientation of the sources)
+    kTREE_SELECTION = 1
+  };
+
  public :
+  //! @brief Constructor
+  inline Renderer(void) 
+    : m_nb_hero_wavelengths(0), m_nb_light_samples(0), 
+      m_light_selection(kTREE_SELECTION), m_roulette_depth(-1) { }
   //! @brief Destructor  
   virtual inline ~Renderer(void) { }
+
+ public:
+  //! @brief Set the number of wavelengths followed after a dispersive event
+  //! @details When a material splits a ray into one sub-ray per wavelength
+  //!  (e.g. dispersive refraction), only nb_wavelengths of them, stratified 
+  //!  over the spectrum, are traced. Their contribution is weighted by the
+  //!  inverse of their selection probability. 0 traces all the wavelengths.
+  inline void SetHeroWavelengths(unsigned int nb_wavelengths) {
+    m_nb_hero_wavelengths = nb_wavelengths;
+  }
+  //! @brief Set the number of sources sampled for the direct lighting
+  //! @details Instead of casting shadow rays toward every source, only
+  //!  nb_samples sources are selected at each shading point, and their
+  //!  contribution is weighted by the inverse of their selection 
+  //!  probability. 0 uses all the sources.
+  //! @param nb_samples Number of selected sources
+  //! @param selection Selection method (kPOWER_SELECTION or kTREE_SELECTION)
+  inline void SetLightSamples(unsigned int nb_samples, 
+                              int selection = kTREE_SELECTION) {
+    m_nb_light_samples = nb_samples;
+    m_light_selection = selection;
+  }
+  //! @brief Set the depth from which the paths play the russian roulette
+  //! @details Beyond min_depth bounces, a path survives with a probability 
+  //!  equal to its throughput (product of the attenuations of its bounces, 
+  //!  up to 1) and its contribution is divided by this probability. The 
+  //!  paths carrying little energy are thus terminated without bias. Only 
+  //!  the eye paths play it: the photons already play the absorption 
+  //!  roulette of the materials. A negative depth disables the roulette.
+  inline void SetRussianRoulette(int min_depth) {
+    m_roulette_depth = min_depth;
+  }
   
  public:
   //! @brief Initialize the renderer
@@ -73,6 +125,74 @@ class Renderer {
   //! @param[in, out] depth Counter for recursions
   virtual void CastRay(Scenery& scenery, LightVector& light_data, 
                        int depth = -1) = 0;
+
+ protected:
+  //! @brief Select the sub-rays of a specular event that will be traced
+  //! @details The sub-rays of a dispersive event, i.e. the sub-rays that 
+  //!  carry disjoint parts of the wavelengths of the incident ray, are 
+  //!  stratified into m_nb_hero_wavelengths strata; one sub-ray is randomly
+  //!  selected in each stratum and weighted by the size of the stratum. 
+  //!  Other sub-rays are kept with a weight of 1.
+  //! @param[in] incident Ray which has produced the sub-rays
+  //! @param[in, out] subrays Sub-rays of the specular event
+  //! @param[out] weights Weights of the selected sub-rays
+  void SelectSpectralSubRays(const LightVector& incident,
+                             std::vector<LightVector>& subrays, 
+                             std::vector<Real>& weights) const;
+  //! @brief Return true if the paths play the russian roulette
+  inline bool IsRouletteEnabled(void) const { return m_roulette_depth >= 0; }
+  //! @brief Attenuation of a specular sub-ray (largest over its wavelengths)
+  //! @details The reemited light of a unit incident light along the sub-ray
+  //! @param[in] object Object reflecting the sub-ray
+  //! @param[in] local_basis Local basis at the reflection point
+  //! @param[in] surface_coordinate Texture coordinate of the reflection point
+  //! @param[in] subray Sub-ray, not cast yet
+  //! @param[in] light_data Reemited light data
+  Real GetSpecularAttenuation(Object* object, const Basis& local_basis, 
+                              const Point2D& surface_coordinate, 
+                              const LightVector& subray, 
+                              const LightVector& light_data) const;
+  //! @brief Play the russian roulette for a sub-ray
+  //! @param[in] bounce Number of bounces of the path before the sub-ray
+  //! @param[in, out] throughput Throughput of the path, updated with the 
+  //!  attenuation and the survival probability of the sub-ray
+  //! @param[in] attenuation Attenuation of the sub-ray
+  //! @return 0 if the sub-ray is terminated, the inverse of its survival 
+  //!  probability otherwise
+  Real PlayRussianRoulette(int bounce, Real& throughput, 
+                           Real attenuation) const;
+  //! @brief Build the structures selecting the sources (see SetLightSamples)
+  //! @param[in, out] scenery Scenery ready for rendering
+  void BuildLightSelection(Scenery& scenery);
+  //! @brief Select the sources lighting a point
+  //! @details Infinite sources are always selected by the light tree. A
+  //!  source picked several times is returned once, with the sum of the 
+  //!  weights.
+  //! @param[in, out] scenery Scenery ready for rendering
+  //! @param[in] receiver Point to be lit
+  //! @param[out] sources Indices of the selected sources
+  //! @param[out] weights Weights of the selected sources
+  void SelectSources(Scenery& scenery, const Point& receiver, 
+                     std::vector<unsigned int>& sources, 
+                     std::vector<Real>& weights) const;
+
+ protected:
+  //! Number of wavelengths followed after a dispersive event (0 = all)
+  unsigned int m_nb_hero_wavelengths;
+  //! Number of sources selected for the direct lighting (0 = all)
+  unsigned int m_nb_light_samples;
+  //! Selection method of the sources
+  int m_light_selection;
+  //! Selection of the sources proportionally to their power
+  AliasTable m_light_powers;
+  //! Hierarchy of the bounded sources
+  LightTree m_light_tree;
+  //! Sources in the light tree, in the order of the tree emitters
+  std::vector<unsigned int> m_bounded_sources;
+  //! Sources always selected by the light tree (infinite sources)
+  std::vector<unsigned int> m_unbounded_sources;
+  //! Depth from which the paths play the russian roulette (< 0: never)
+  int m_roulette_depth;
 }; // class Renderer
 
 #endif // GUARD_VRT_RENDERER_HPP
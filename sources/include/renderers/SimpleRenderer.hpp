@@ -90,6 +90,10 @@ class SimpleRenderer: public Renderer {
                        int depth = -1);
 
  private:
+  //! @brief Compute the light data for a given ray
+  //! @param throughput Throughput of the path (russian roulette)
+  void CastRay(Scenery& scenery, LightVector& light_data, int depth, 
+               Real throughput);
   //! @brief Add the contribution of direct viewed source
   void AddDirectSourceContribution(Scenery& scenery, 
                                    LightVector& light_data, 
@@ -97,18 +101,26 @@ class SimpleRenderer: public Renderer {
                                    const Basis& local_basis, 
                                    const Point2D& surface_coordinate);
   //! @brief Add the contribution of glossiness and reflections 
+  //! @param throughput Throughput of the path (russian roulette)
   void AddGlossyContribution(Scenery& scenery, 
                              LightVector& light_data, 
                              Object* object, 
                              const Basis& local_basis, 
                              const Point2D& surface_coordinate, 
-                             int depth);
+                             int depth, Real throughput);
   //! @brief Add the contribution ot the direct light
   void AddDirectContribution(Scenery& scenery, 
                              LightVector& light_data, 
                              Object* object, 
                              const Basis& local_basis, 
                              const Point2D& surface_coordinate);
+  //! @brief Add the contribution of the sampled directions of the 
+  //!  environment
+  void AddEnvironmentContribution(Scenery& scenery, 
+                                  LightVector& light_data, 
+                                  Object* object, 
+                                  const Basis& local_basis, 
+                                  const Point2D& surface_coordinate);
   //! @brief Add the contribution of the ambient light
   void AddAmbientContribution(Scenery& scenery, 
                               LightVector& light_data, 
@@ -0,0 +1,155 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_DISTRIBUTION_HPP
+#define GUARD_VRT_DISTRIBUTION_HPP
+//!
+//! @file Distribution.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Sampling of tabulated distributions (importance sampling)
+//!
+#include <vector>
+
+#include <common.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class Distribution1D
+//! @brief Discrete distribution proportional to a table of values
+//! @details The cumulative distribution is built once (accumulated in double 
+//!  precision) and a sample costs a binary search. A table without any 
+//!  positive value is sampled uniformly.
+class Distribution1D {
+ public:
+  //! @brief Constructor of an empty distribution
+  Distribution1D(void);
+  //! @brief Constructor
+  //! @param values Non-negative weights of the entries
+  //! @param size Number of entries
+  Distribution1D(const Real* values, unsigned int size);
+
+ public:
+  //! @brief Build the distribution
+  //! @param values Non-negative weights of the entries
+  //! @param size Number of entries
+  void Build(const Real* values, unsigned int size);
+  //! @brief Pick an entry
+  //! @param u Uniform random number in [0, 1)
+  //! @param probability Probability of the picked entry
+  //! @param remapped Position of u inside the picked entry, in [0, 1) (may 
+  //!  be NULL), to be reused as a new random number
+  //! @return Index of the picked entry
+  unsigned int Sample(Real u, Real& probability, Real* remapped = NULL) const;
+  //! @brief Probability of an entry
+  inline Real GetProbability(unsigned int i) const {
+    return m_cdf[i + 1] - m_cdf[i];
+  }
+  //! @brief Number of entries
+  inline unsigned int GetSize(void) const { 
+    return (unsigned int)m_cdf.size() - 1; 
+  }
+  //! @brief Sum of the weights
+  inline Real GetSum(void) const { return m_sum; }
+
+ private:
+  //! Cumulative distribution (size + 1 values, from 0 to 1)
+  std::vector<Real> m_cdf;
+  //! Sum of the weights
+  Real m_sum;
+}; // class Distribution1D
+////////////////////////////////////////////////////////////////////////////////
+//! @class AliasTable
+//! @brief Discrete distribution sampled in constant time (alias method)
+//! @details Each entry of the table holds a threshold and an alias: a sample
+//!  picks an entry uniformly, then keeps it or takes its alias depending on
+//!  the threshold (Vose's construction). A table without any positive value 
+//!  is sampled uniformly.
+class AliasTable {
+ public:
+  //! @brief Constructor of an empty table
+  AliasTable(void);
+
+ public:
+  //! @brief Build the table
+  //! @param values Non-negative weights of the entries
+  //! @param size Number of entries
+  void Build(const Real* values, unsigned int size);
+  //! @brief Pick an entry
+  //! @param u Uniform random number in [0, 1)
+  //! @param probability Probability of the picked entry
+  //! @return Index of the picked entry
+  unsigned int Sample(Real u, Real& probability) const;
+  //! @brief Probability of an entry
+  inline Real GetProbability(unsigned int i) const { 
+    return m_probabilities[i]; 
+  }
+  //! @brief Number of entries
+  inline unsigned int GetSize(void) const { 
+    return (unsigned int)m_probabilities.size(); 
+  }
+
+ private:
+  //! Probability of keeping each entry (instead of its alias)
+  std::vector<Real> m_thresholds;
+  //! Alias of each entry
+  std::vector<unsigned int> m_aliases;
+  //! Probability of each entry
+  std::vector<Real> m_probabilities;
+}; // class AliasTable
+////////////////////////////////////////////////////////////////////////////////
+//! @class Distribution2D
+//! @brief Piecewise constant density over [0, 1]x[0, 1]
+//! @details The density is proportional to a grid of values. A row is picked 
+//!  with the marginal distribution of the rows, then a cell in the row with 
+//!  its conditional distribution, and the sample is uniform in the cell.
+class Distribution2D {
+ public:
+  //! @brief Constructor of an empty distribution
+  Distribution2D(void);
+
+ public:
+  //! @brief Build the distribution
+  //! @param values Non-negative weights of the cells, row by row
+  //! @param width Number of cells in a row
+  //! @param height Number of rows
+  void Build(const Real* values, unsigned int width, unsigned int height);
+  //! @brief Draw a point
+  //! @param u1 Uniform random number in [0, 1)
+  //! @param u2 Uniform random number in [0, 1)
+  //! @param x Horizontal coordinate of the point
+  //! @param y Vertical coordinate of the point
+  //! @return Density of the point (with respect to the area of the unit 
+  //!  square)
+  Real Sample(Real u1, Real u2, Real& x, Real& y) const;
+  //! @brief Density of a point (with respect to the area of the unit square)
+  Real GetDensity(Real x, Real y) const;
+  //! @brief Return true if the distribution is built
+  inline bool IsEmpty(void) const { return m_rows.empty(); }
+
+ private:
+  //! Number of cells in a row
+  unsigned int m_width;
+  //! Conditional distributions of the cells in each row
+  std::vector<Distribution1D> m_rows;
+  //! Marginal distribution of the rows
+  Distribution1D m_marginal;
+}; // class Distribution2D
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_DISTRIBUTION_HPP
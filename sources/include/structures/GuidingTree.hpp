@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_GUIDINGTREE_HPP
+#define GUARD_VRT_GUIDINGTREE_HPP
+//!
+//! @file GuidingTree.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Learned distribution of the incident light for path guiding
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <maths/BoundingBox.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class GuidingTree
+//! @brief Spatial octree of directional quadtrees (SD-tree)
+//! @details The tree is trained with records of the incident light, i.e. 
+//!  the indirect photons: the octree splits the space until a leaf holds 
+//!  few records, then each leaf distributes the energy of its records over 
+//!  the sphere of directions with a quadtree. The sphere is mapped onto the 
+//!  unit square by an equal-area mapping (z-coordinate, azimuth), and a 
+//!  quadrant is split while it holds a significant fraction of the energy 
+//!  of the leaf. Sampling descends the quadtree proportionally to the 
+//!  energy of the quadrants.
+class GuidingTree {
+ public:
+  //! @struct Record
+  //! @brief Light incident at a point
+  struct Record {
+    //! Position of the receiver
+    Point position;
+    //! Direction toward the light (unit vector)
+    Vector direction;
+    //! Energy of the light
+    Real energy;
+  }; // struct Record
+
+ public:
+  //! @brief Constructor of an empty tree
+  GuidingTree(void);
+
+ public:
+  //! @brief Add a training record
+  void AddRecord(const Point& position, const Vector& direction, 
+                 Real energy);
+  //! @brief Build the tree from the records (the records are then freed)
+  //! @param bounds Bounding box of the records
+  void Build(const BoundingBox& bounds);
+  //! @brief Leaf of a point
+  //! @return -1 if the leaf of the point has too few records for guiding
+  int GetLeaf(const Point& position) const;
+  //! @brief Sample a direction in a leaf
+  //! @param leaf Leaf returned by GetLeaf
+  //! @param u Uniform random number in [0, 1)
+  //! @param v Uniform random number in [0, 1)
+  //! @param direction Sampled direction
+  //! @return Density of the direction (per steradian)
+  Real Sample(int leaf, Real u, Real v, Vector& direction) const;
+  //! @brief Density of a direction in a leaf (per steradian)
+  Real GetDensity(int leaf, const Vector& direction) const;
+  //! @brief Return true if the tree has not been built
+  inline bool IsEmpty(void) const { return m_spatial_nodes.empty(); }
+
+ private:
+  //! @struct SpatialNode
+  //! @brief Node of the octree
+  struct SpatialNode {
+    //! Bounds of the node
+    BoundingBox bounds;
+    //! First of the 8 children (-1 for a leaf)
+    int children;
+    //! Root of the quadtree of a leaf (-1 without enough records)
+    int quadtree;
+  }; // struct SpatialNode
+
+  //! @struct QuadNode
+  //! @brief Node of a directional quadtree
+  struct QuadNode {
+    //! Energy of the quadrants (x + 2y)
+    Real energy[4];
+    //! Children of the quadrants (-1 for a leaf quadrant)
+    int children[4];
+  }; // struct QuadNode
+
+ private:
+  //! @brief Recursive construction of a spatial node
+  void BuildSpatialNode(int index, std::vector<unsigned int>& records, 
+                        unsigned int depth);
+  //! @brief Recursive construction of a quadtree node
+  //! @param records Records with their coordinates in the unit square
+  //! @param x,y Corner of the node in the unit square
+  //! @param size Size of the node
+  //! @param total Energy of the leaf
+  int BuildQuadNode(const std::vector<unsigned int>& records, 
+                    Real x, Real y, Real size, Real total, 
+                    unsigned int depth);
+  //! @brief Coordinates of a direction in the unit square
+  static void ToSquare(const Vector& direction, Real& x, Real& y);
+  //! @brief Direction of coordinates in the unit square
+  static void FromSquare(Real x, Real y, Vector& direction);
+
+ private:
+  //! Training records (freed by Build)
+  std::vector<Record> m_records;
+  //! Coordinates of the records in the unit square (during Build)
+  std::vector<Real> m_square;
+  //! Nodes of the octree, the root first
+  std::vector<SpatialNode> m_spatial_nodes;
+  //! Nodes of all the quadtrees
+  std::vector<QuadNode> m_quad_nodes;
+}; // class GuidingTree
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_GUIDINGTREE_HPP
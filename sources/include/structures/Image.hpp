@@ -62,6 +62,14 @@ public :
    */
   inline Pixel& operator=(const Pixel& pixel);
 
+  /**
+   * Use an external storage (e.g. a tile buffer) instead of an owned array.
+   * No allocation is done and the storage is never deleted by the pixel.
+   * @param nbChannels : number of channels of this pixel
+   * @param data : the external storage of the pixel
+   */
+  inline void attach(unsigned int nbChannels, float* data);
+
   /**
    * Return the number of channel of the pixel.
    * @return : the number of channel of the pixel.
@@ -97,10 +105,28 @@ public :
 private :
   float* _data;
   unsigned int _nbChannels;
+  bool _owner;
 };
 
 class Image{
 public :
+  /**
+   * Behavior of the interpolation outside of the image, along one axis.
+   * The values match the Texture::TEXTURE_REPEAT_MODE ones.
+   */
+  typedef enum {
+    WRAP_CLAMP = 0,
+    WRAP_REPEAT = 1,
+    WRAP_MIRROR = 2
+  } WRAP_MODE;
+
+  /**
+   * Index of a texel along one axis, according to the wrap mode.
+   * i : index of the texel (may be out of the image).
+   * size : size of the image along the axis.
+   */
+  static inline int wrapIndex(int i, int size, WRAP_MODE mode);
+
   /**
    * Constructor of image without initilization of the pixels colors.
    * (use clear to set all pixel to 0)
@@ -166,6 +192,18 @@ public :
    * x,y : coordinate of the wanted pixel.
    */
   Pixel getInterpolatedPixel(Real x, Real y) const;
+
+  /**
+   * Bilinear interpolation written into a caller-provided storage, without
+   * any allocation. The wrap modes are resolved once per axis, so the four
+   * texels are always fetched the same way.
+   * x,y : coordinate of the wanted pixel.
+   * result : storage of getNumberOfChannels() floats.
+   * wrapX,wrapY : behavior outside of the image along each axis.
+   */
+  void getInterpolatedPixel(Real x, Real y, float* result,
+                            WRAP_MODE wrapX = WRAP_CLAMP,
+                            WRAP_MODE wrapY = WRAP_CLAMP) const;
  
   /**
    * Set the color of one pixel of the image.
@@ -174,6 +212,16 @@ public :
    */
   void setPixel(int x, int y, const Pixel& pixel);
 
+  /**
+   * Copy a block of pixels into the image, one memcpy per row.
+   * x,y : coordinate of the upper-left pixel of the block.
+   * width,height : size of the block (clipped to the image).
+   * data : the pixels of the block, with the same number of channels.
+   * stride : number of floats between two rows of data.
+   */
+  void setBlock(int x, int y, unsigned int width, unsigned int height, 
+                const float* data, unsigned int stride);
+
   //! @details Normalize each pixel of an image so that the sum of values on 
   //!  each channels belongs to [0 1]
   void normalize(void);
@@ -191,19 +239,41 @@ private :
   std::vector<std::string> _channelsNames;
 };
 
+/**
+ * Index of a texel along one axis, according to the wrap mode.
+ * i : index of the texel (may be out of the image).
+ * size : size of the image along the axis.
+ */
+inline int Image::wrapIndex(int i, int size, WRAP_MODE mode)
+{
+  switch(mode)
+  {
+  case WRAP_REPEAT :
+    i %= size;
+    return i<0 ? i+size : i;
+  case WRAP_MIRROR :
+    i %= 2*size;
+    if(i<0) i+=2*size;
+    return i<size ? i : 2*size-1-i;
+  default :
+    return i<0 ? 0 : (i>=size ? size-1 : i);
+  }
+}
+
 inline Pixel::Pixel(void)
-    : _nbChannels(0),
-      _data(NULL) { }
+    : _data(NULL),
+      _nbChannels(0),
+      _owner(true) { }
 
 /**
  * Constructor (values are not initialised)
  * @param nbChannels : number of channels of this pixel
  */
 inline Pixel::Pixel(unsigned int nbChannels)
-: _nbChannels(nbChannels)
+: _nbChannels(nbChannels), _owner(true)
 {
   _data = new float [nbChannels];
-  for (unsigned int i; i < nbChannels; i++)
+  for (unsigned int i = 0; i < nbChannels; i++)
     _data [i] = 0.f;
 }
 
@@ -213,7 +283,7 @@ inline Pixel::Pixel(unsigned int nbChannels)
  * @param data : a raw data used to initialize the Pixel
  */
 inline Pixel::Pixel(unsigned int nbChannels, const float* data)
-: _nbChannels(nbChannels)
+: _nbChannels(nbChannels), _owner(true)
 {
   _data = new float [nbChannels];
   memcpy(_data, data, nbChannels*sizeof(float));
@@ -224,7 +294,7 @@ inline Pixel::Pixel(unsigned int nbChannels, const float* data)
  * @param pixel : the pixel to copy.
  */
 inline Pixel::Pixel(const Pixel& pixel)
-: _nbChannels(pixel._nbChannels)
+: _nbChannels(pixel._nbChannels), _owner(true)
 {
   _data = new float [_nbChannels];
   memcpy(_data, pixel._data, _nbChannels*sizeof(float));
@@ -235,7 +305,8 @@ inline Pixel::Pixel(const Pixel& pixel)
  */
 inline Pixel::~Pixel()
 {
-  delete[] _data;
+  if(_owner)
+    delete[] _data;
 }
 
 /**
@@ -245,7 +316,19 @@ inline Pixel::~Pixel()
  */
 inline Pixel& Pixel::operator=(const Pixel& pixel)
 {
-  delete[] _data;
+  if(this == &pixel)
+    return *this;
+
+  //An attached pixel keeps its external storage
+  if(!_owner && _nbChannels == pixel._nbChannels)
+  {
+    memcpy(_data, pixel._data, _nbChannels*sizeof(float));
+    return *this;
+  }
+
+  if(_owner)
+    delete[] _data;
+  _owner = true;
   _nbChannels = pixel._nbChannels;
   _data = new float [_nbChannels];
   memcpy(_data, pixel._data, _nbChannels*sizeof(float)); 
@@ -253,6 +336,21 @@ inline Pixel& Pixel::operator=(const Pixel& pixel)
   return *this;
 }
 
+/**
+ * Use an external storage (e.g. a tile buffer) instead of an owned array.
+ * No allocation is done and the storage is never deleted by the pixel.
+ * @param nbChannels : number of channels of this pixel
+ * @param data : the external storage of the pixel
+ */
+inline void Pixel::attach(unsigned int nbChannels, float* data)
+{
+  if(_owner)
+    delete[] _data;
+  _owner = false;
+  _nbChannels = nbChannels;
+  _data = data;
+}
+
 /**
  * Return the number of channel of the pixel.
  * @return : the number of channel of the pixel.
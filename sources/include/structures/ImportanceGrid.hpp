@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_IMPORTANCEGRID_HPP
+#define GUARD_VRT_IMPORTANCEGRID_HPP
+//!
+//! @file ImportanceGrid.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Coarse field of the importance of the scenery for the cameras
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <maths/BoundingBox.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class ImportanceGrid
+//! @brief Uniform grid counting the importons hitting each cell
+//! @details Importons are traced from the cameras and added to the cells of 
+//!  their hit points. The counts are then turned into storage probabilities 
+//!  of the photons: a photon landing in a cell the cameras never see is 
+//!  stored with the minimum probability only, and the stored photons are 
+//!  scaled by the inverse of their probability (russian roulette).
+class ImportanceGrid {
+ public:
+  //! Number of cells along the largest side of the bounds
+  static const unsigned int kRESOLUTION = 64;
+
+ public:
+  //! @brief Constructor of an empty grid (all probabilities equal 1)
+  ImportanceGrid(void);
+
+ public:
+  //! @brief Allocate the cells covering some bounds, without any importon
+  //! @param bounds Bounding box of the objects
+  void Init(const BoundingBox& bounds);
+  //! @brief Add an importon to the cell of a point
+  //! @param point Hit point of the importon
+  void Add(const Point& point);
+  //! @brief Turn the counts of importons into storage probabilities
+  //! @details The counts are dilated by one cell (the photon searches reach 
+  //!  the neighbour cells) then divided by their mean over the seen cells.
+  //! @param min_probability Probability of the cells without importons
+  void ComputeProbabilities(Real min_probability);
+  //! @brief Storage probability of a photon at a point
+  //! @details 1 outside the bounds or if the grid is empty
+  Real GetProbability(const Point& point) const;
+  //! @brief Return true if no cell is allocated
+  inline bool IsEmpty(void) const { return m_values.empty(); }
+
+ private:
+  //! @brief Index of the cell of a point, -1 if outside the bounds
+  int GetCell(const Point& point) const;
+
+ private:
+  //! Bounds of the grid
+  BoundingBox m_bounds;
+  //! Inverse of the size of a cell
+  Real m_inv_cell_size;
+  //! Number of cells along each axis
+  unsigned int m_size[3];
+  //! Counts of importons, then storage probabilities
+  std::vector<Real> m_values;
+}; // class ImportanceGrid
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_IMPORTANCEGRID_HPP
@@ -0,0 +1,173 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_IRRADIANCECACHE_HPP
+#define GUARD_VRT_IRRADIANCECACHE_HPP
+//!
+//! @file IrradianceCache.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Cache of the indirect diffuse irradiance (Ward's algorithm)
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <maths/BoundingBox.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class IrradianceCache
+//! @brief Octree of irradiance records with gradients
+//! @details A record stores the spectral irradiance of a point, computed by
+//!  stratified sampling of the hemisphere, its rotational and translational 
+//!  gradients (Ward and Heckbert) and the harmonic mean distance to the 
+//!  surfaces seen from the point. The irradiance of a point near some 
+//!  records is interpolated with Ward's weights, a record being valid 
+//!  inside the radius accuracy x harmonic mean distance.
+//!
+//!  Threads: the records and the nodes are stored in blocks which are 
+//!  never moved, and a record or a node is fully written before being 
+//!  linked to the octree, so the lookups take no lock. Each thread keeps its
+//!  new records in its own batch (also searched by its lookups) and inserts 
+//!  the whole batch in a critical section.
+class IrradianceCache {
+ public:
+  //! @struct Record
+  //! @brief Irradiance of a point
+  struct Record {
+    //! Position of the point
+    Point position;
+    //! Normal of the surface, on the side of the sampled hemisphere
+    Vector normal;
+    //! Harmonic mean distance to the surfaces (clamped)
+    Real radius;
+    //! Mean irradiance over the wavelengths
+    Real mean;
+    //! Rotational gradient of the mean irradiance
+    Vector rotation_gradient;
+    //! Translational gradient of the mean irradiance
+    Vector translation_gradient;
+    //! Irradiance of the wavelengths of the global spectrum
+    Real irradiance[81];
+    //! Next record of the same node (-1 for the last one)
+    int next;
+  }; // struct Record
+
+ public:
+  //! @brief Constructor of a disabled cache
+  IrradianceCache(void);
+  //! @brief Destructor
+  ~IrradianceCache(void);
+
+ public:
+  //! @brief Allocate an empty cache
+  //! @param bounds Bounding box of the objects
+  //! @param accuracy Maximum error allowed by the interpolation (Ward's a)
+  //! @param nb_threads Number of threads using the cache
+  void Init(const BoundingBox& bounds, Real accuracy, 
+            unsigned int nb_threads);
+  //! @brief Return true if the cache has been allocated
+  inline bool IsEnabled(void) const { return p_node_blocks != NULL; }
+  //! @brief Interpolate the irradiance of a point from the records
+  //! @param position Position of the point
+  //! @param normal Normal of the surface, on the side of the viewer
+  //! @param irradiance Irradiance of the wavelengths of the global spectrum
+  //! @return False if no record is valid at the point
+  bool GetIrradiance(const Point& position, const Vector& normal, 
+                     Real* irradiance) const;
+  //! @brief Create a record from the samples of the hemisphere of a point
+  //! @details The samples are stratified: nb_theta strata of the squared 
+  //!  sine of the polar angle times nb_phi strata of the azimuth, the 
+  //!  polar angle first (see GetStrata). The record is added to the batch 
+  //!  of the calling thread.
+  //! @param basis Basis of the hemisphere: position and tangents, normal k
+  //! @param nb_theta Number of strata of the polar angle
+  //! @param nb_phi Number of strata of the azimuth
+  //! @param directions Sampled directions (in the basis)
+  //! @param radiances Mean radiance over the wavelengths of the samples
+  //! @param distances Distances of the hits of the samples (0: no hit)
+  //! @param irradiance Irradiance of the wavelengths of the global spectrum
+  void AddRecord(const Basis& basis, 
+                 unsigned int nb_theta, unsigned int nb_phi, 
+                 const std::vector<Vector>& directions, 
+                 const std::vector<Real>& radiances, 
+                 const std::vector<Real>& distances, 
+                 const Real* irradiance);
+  //! @brief Number of strata of a hemisphere sampled with nb_samples rays
+  //! @details Ward's rule: nb_phi close to pi x nb_theta
+  static void GetStrata(unsigned int nb_samples, 
+                        unsigned int& nb_theta, unsigned int& nb_phi);
+
+ private:
+  //! @struct Node
+  //! @brief Cube of the octree
+  struct Node {
+    //! Center of the cube
+    Point center;
+    //! Half of the side of the cube
+    Real half_size;
+    //! Children (-1 if not created yet)
+    volatile int children[8];
+    //! First record of the node (-1 without record)
+    volatile int head;
+  }; // struct Node
+
+ private:
+  //! @brief Access to a record
+  inline const Record& GetRecord(int index) const {
+    return p_record_blocks[index >> kBLOCK_SHIFT][index & kBLOCK_MASK];
+  }
+  //! @brief Access to a node
+  inline Node& GetNode(int index) const {
+    return p_node_blocks[index >> kBLOCK_SHIFT][index & kBLOCK_MASK];
+  }
+  //! @brief Add the weighted irradiance of a record (if it is valid)
+  //! @return Weight of the record (0 if not valid)
+  Real AddContribution(const Record& record, const Point& position, 
+                       const Vector& normal, Real* irradiance) const;
+  //! @brief Insert the batch of a thread into the octree
+  void Flush(std::vector<Record>& batch);
+  //! @brief Create a node (in the critical section)
+  int CreateNode(const Point& center, Real half_size);
+
+ private:
+  //! Records or nodes per block: 2^kBLOCK_SHIFT
+  static const unsigned int kBLOCK_SHIFT = 10;
+  static const unsigned int kBLOCK_MASK = (1 << kBLOCK_SHIFT) - 1;
+  //! Maximum number of blocks
+  static const unsigned int kMAX_BLOCKS = 4096;
+
+ private:
+  //! Maximum error allowed by the interpolation
+  Real m_accuracy;
+  //! Bounds of the harmonic mean distances
+  Real m_min_radius;
+  Real m_max_radius;
+  //! Blocks of records
+  Record** p_record_blocks;
+  //! Blocks of nodes, the root first
+  Node** p_node_blocks;
+  //! Number of records and nodes (modified in the critical section only)
+  int m_nb_records;
+  int m_nb_nodes;
+  //! Batch of new records of each thread
+  std::vector<std::vector<Record> > m_batches;
+}; // class IrradianceCache
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_IRRADIANCECACHE_HPP
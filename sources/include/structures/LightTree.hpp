@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_LIGHTTREE_HPP
+#define GUARD_VRT_LIGHTTREE_HPP
+//!
+//! @file LightTree.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Hierarchy of light emitters for the selection of the sources
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <maths/BoundingBox.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class LightTree
+//! @brief Binary hierarchy of bounded emitters
+//! @details Each node bounds its emitters with a box (position) and a cone
+//!  (emitted directions), and sums their power. A sample descends from the 
+//!  root, choosing a child with a probability proportional to its importance
+//!  for the receiver: power over squared distance, times a bound of the 
+//!  cosine between the emitted directions and the receiver. The importance 
+//!  of a node never vanishes while one of its emitters can light the 
+//!  receiver, so the selection is unbiased. The nodes are stored depth 
+//!  first: the left child of an inner node directly follows its parent.
+class LightTree {
+ public:
+  //! @struct Emitter
+  //! @brief Bounds and power of an emitter
+  struct Emitter {
+    //! Bounding box of the emitting points
+    BoundingBox bounds;
+    //! Axis of the cone of the emitted directions
+    Vector axis;
+    //! Cosine of the half angle of this cone (-1 for all the directions)
+    Real cos_angle;
+    //! Emitted power
+    Real power;
+  }; // struct Emitter
+
+  //! @struct Node
+  //! @brief Node of the hierarchy
+  struct Node {
+    //! Bounding box of the emitters
+    BoundingBox bounds;
+    //! Axis of the cone of the emitted directions
+    Vector axis;
+    //! Half angle of this cone (pi for all the directions)
+    Real angle;
+    //! Sum of the power of the emitters
+    Real power;
+    //! Right child of an inner node, emitter of a leaf
+    unsigned int index;
+    //! True for a leaf
+    bool leaf;
+  }; // struct Node
+
+ public:
+  //! @brief Constructor of an empty hierarchy
+  LightTree(void);
+
+ public:
+  //! @brief Build the hierarchy (one emitter per leaf, median splits)
+  //! @param emitters Emitters, referenced by their position in this array
+  void Build(const std::vector<Emitter>& emitters);
+  //! @brief Pick an emitter for a receiver
+  //! @param receiver Point to be lit
+  //! @param u Uniform random number in [0, 1)
+  //! @param probability Probability of the picked emitter (0 if no emitter
+  //!  can light the receiver)
+  //! @return Position of the picked emitter in the array given to Build
+  unsigned int Sample(const Point& receiver, Real u, Real& probability) const;
+  //! @brief Return true if the hierarchy has no emitter
+  inline bool IsEmpty(void) const { return m_nodes.empty(); }
+
+ private:
+  //! @brief Recursive construction of a node
+  unsigned int BuildNode(const std::vector<Emitter>& emitters, 
+                         std::vector<unsigned int>& order, 
+                         unsigned int begin, unsigned int end);
+  //! @brief Importance of a node for a receiver
+  static Real GetImportance(const Node& node, const Point& receiver);
+
+ private:
+  //! Nodes of the hierarchy
+  std::vector<Node> m_nodes;
+}; // class LightTree
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_LIGHTTREE_HPP
@@ -117,6 +117,29 @@ public :
    */
   inline void setDistance(Real distance);
 
+  /**
+   * Set the ray differentials : the rays of the neighbor pixels along x and 
+   * y. They are only valid until the next call to setRay.
+   */
+  inline void setRayDifferentials(const Ray& dx, const Ray& dy);
+
+  /**
+   * Get the ray differentials. Return false if the ray has none.
+   */
+  inline bool getRayDifferentials(Ray& dx, Ray& dy) const;
+
+  /**
+   * Set the differentials of the surface coordinates at the last 
+   * intersection, along the x and y directions of the image (zero if the
+   * ray has no differentials).
+   */
+  inline void setSurfaceDifferentials(const Point2D& dx, const Point2D& dy);
+
+  /**
+   * Get the differentials of the surface coordinates at the last intersection
+   */
+  inline void getSurfaceDifferentials(Point2D& dx, Point2D& dy) const;
+
   /**
    * Flip the light vector propagation
    */
@@ -149,12 +172,27 @@ private :
                    // _framework.k : the S-polarization vector (Orthogonal to the incident plane).
   Real _distance;  //Distance from the last emission/reflexion
   Real _weight;    //The weight of the raylight in the computations
+  Ray _rayDx;      //Ray of the neighbor pixel along x
+  Ray _rayDy;      //Ray of the neighbor pixel along y
+  bool _hasRayDifferentials;
+  Point2D _surfaceDx; //Surface coordinate differentials at the last hit
+  Point2D _surfaceDy;
 };
 
 inline LightVector::LightVector()
 {
   _size=0;
   _data=0;
+  _framework.o=Point(0, 0, 0);
+  _framework.i=Vector(0, 0, 0);
+  _framework.j=Vector(0, 0, 0);
+  _framework.k=Vector(0, 0, 0);
+  _distance=0;
+  _weight=1;
+  _rayDx.o=_framework.o;
+  _rayDx.v=_framework.i;
+  _rayDy=_rayDx;
+  _hasRayDifferentials=false;
 }
 
 inline LightVector::LightVector(const LightVector& original)
@@ -175,6 +213,11 @@ inline LightVector::LightVector(const LightVector& original)
   _framework = original._framework;
   _distance = original._distance;
   _weight= original._weight;
+  _rayDx = original._rayDx;
+  _rayDy = original._rayDy;
+  _hasRayDifferentials = original._hasRayDifferentials;
+  _surfaceDx = original._surfaceDx;
+  _surfaceDy = original._surfaceDy;
 }
 
 inline LightVector::~LightVector()
@@ -208,6 +251,11 @@ inline LightVector& LightVector::operator=(const LightVector& original)
   _framework = original._framework;
   _distance = original._distance;
   _weight= original._weight;
+  _rayDx = original._rayDx;
+  _rayDy = original._rayDy;
+  _hasRayDifferentials = original._hasRayDifferentials;
+  _surfaceDx = original._surfaceDx;
+  _surfaceDy = original._surfaceDy;
 
   return *this; 
 }
@@ -282,6 +330,8 @@ inline void LightVector::initGeometricalData(const LightVector& lightdata)
 {
   
   _framework = lightdata._framework;
+  _surfaceDx = lightdata._surfaceDx;
+  _surfaceDy = lightdata._surfaceDy;
 }
 
 /**
@@ -411,12 +461,14 @@ inline void LightVector::setRay(const Ray& ray)
 {
   _framework.o = ray.o;
   _framework.i = ray.v;  
+  _hasRayDifferentials = false;
 }
 
 inline void LightVector::setRay(const Point& origin, const Vector& direction)
 {
   _framework.o = origin;
   _framework.i = direction;  
+  _hasRayDifferentials = false;
 }
 
 /**
@@ -435,6 +487,51 @@ inline void LightVector::setDistance(Real distance)
   _distance=distance;
 }
 
+/**
+ * Set the ray differentials : the rays of the neighbor pixels along x and 
+ * y. They are only valid until the next call to setRay.
+ */
+inline void LightVector::setRayDifferentials(const Ray& dx, const Ray& dy)
+{
+  _rayDx = dx;
+  _rayDy = dy;
+  _hasRayDifferentials = true;
+}
+
+/**
+ * Get the ray differentials. Return false if the ray has none.
+ */
+inline bool LightVector::getRayDifferentials(Ray& dx, Ray& dy) const
+{
+  if(!_hasRayDifferentials)
+    return false;
+  dx = _rayDx;
+  dy = _rayDy;
+  return true;
+}
+
+/**
+ * Set the differentials of the surface coordinates at the last 
+ * intersection, along the x and y directions of the image (zero if the
+ * ray has no differentials).
+ */
+inline void LightVector::setSurfaceDifferentials(const Point2D& dx, 
+                                                 const Point2D& dy)
+{
+  _surfaceDx = dx;
+  _surfaceDy = dy;
+}
+
+/**
+ * Get the differentials of the surface coordinates at the last intersection
+ */
+inline void LightVector::getSurfaceDifferentials(Point2D& dx, 
+                                                 Point2D& dy) const
+{
+  dx = _surfaceDx;
+  dy = _surfaceDy;
+}
+
 
 /**
  * Change the polarisation framework of an incident ray for matching new 
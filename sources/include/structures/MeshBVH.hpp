@@ -0,0 +1,173 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MESHBVH_HPP
+#define GUARD_VRT_MESHBVH_HPP
+//!
+//! @file MeshBVH.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Bounding volume hierarchy over the triangles of a mesh
+//!
+#include <limits>
+#include <vector>
+
+#include <core/3DBase.hpp>
+#include <maths/BoundingBox.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class MeshBVH
+//! @brief Flat binary hierarchy of axis aligned boxes
+//! @details The nodes are stored depth first in one array: the left child of
+//!  an inner node directly follows its parent, the right child is given by 
+//!  the node. A leaf covers a range of consecutive triangles, so the 
+//!  triangles must be stored in the order returned by Build. The nodes are 
+//!  plain data: they can be written in a file and used in place from a 
+//!  mapping of this file (see Adopt).
+class MeshBVH {
+ public:
+  //! @struct Node
+  //! @brief Node of the hierarchy (plain data, stored as is in files)
+  struct Node {
+    //! Bounds of the node
+    Real min[3];
+    Real max[3];
+    //! First triangle of a leaf, right child of an inner node
+    unsigned int first;
+    //! Number of triangles of a leaf
+    unsigned short count;
+    //! Split axis of an inner node, kLEAF for a leaf
+    unsigned short axis;
+  }; // struct Node
+
+  //! Axis of a leaf
+  static const unsigned short kLEAF = 3;
+  //! Maximal number of triangles in a leaf
+  static const unsigned int kMAX_LEAF_SIZE = 8;
+  //! Maximal depth of the hierarchy (size of the traversal stacks)
+  static const unsigned int kMAX_DEPTH = 64;
+
+ public:
+  //! @brief Constructor of an empty hierarchy
+  MeshBVH(void);
+  //! @brief Destructor
+  ~MeshBVH(void);
+
+ public:
+  //! @brief Build the hierarchy with a binned surface area heuristic
+  //! @param bounds Bounding box of each triangle
+  //! @param order Order in which the triangles must be stored
+  void Build(const std::vector<BoundingBox>& bounds, 
+             std::vector<unsigned int>& order);
+  //! @brief Use nodes stored elsewhere (e.g. in a mapped file)
+  //! @param nodes Nodes of the hierarchy, not copied
+  //! @param nb_nodes Number of nodes
+  //! @param owner Object keeping the nodes alive, deleted with the hierarchy
+  template<class TOwner>
+  void Adopt(const Node* nodes, unsigned int nb_nodes, TOwner* owner);
+  //! @brief Acces to the nodes
+  inline const Node* nodes(void) const { return p_nodes; }
+  //! @brief Acces to the number of nodes
+  inline unsigned int nb_nodes(void) const { return m_nb_nodes; }
+  //! @brief Bounding box of the whole hierarchy
+  void GetBoundingBox(BoundingBox& box) const;
+
+ public:
+  //! @brief Slab test of a node
+  //! @param node Node to be tested
+  //! @param origin Origin of the ray
+  //! @param inv_dir Inverse of the direction of the ray
+  //! @param max_distance Farthest distance of interest
+  //! @return true if the ray enters the node before max_distance
+  static inline bool Intersect(const Node& node, const Real origin[3], 
+                               const Real inv_dir[3], Real max_distance);
+
+ private:
+  //! @brief Recursive construction of a node
+  unsigned int BuildNode(const std::vector<BoundingBox>& bounds, 
+                         std::vector<unsigned int>& order, 
+                         unsigned int begin, unsigned int end, 
+                         unsigned int depth);
+  //! @brief Free the nodes
+  void Clear(void);
+
+ private:
+  //! @brief Not copyable
+  MeshBVH(const MeshBVH&);
+  MeshBVH& operator=(const MeshBVH&);
+
+ private:
+  //! @class OwnerBase
+  //! @brief Type erased owner of adopted nodes
+  class OwnerBase {
+   public:
+    virtual ~OwnerBase(void) { }
+  }; // class OwnerBase
+  template<class TOwner>
+  class Owner : public OwnerBase {
+   public:
+    Owner(TOwner* owner) : p_owner(owner) { }
+    virtual ~Owner(void) { delete p_owner; }
+   private:
+    TOwner* p_owner;
+  }; // class Owner
+
+ private:
+  //! Nodes built by the hierarchy
+  std::vector<Node> m_nodes;
+  //! Nodes in use (built or adopted)
+  const Node* p_nodes;
+  //! Number of nodes in use
+  unsigned int m_nb_nodes;
+  //! Owner of adopted nodes
+  OwnerBase* p_owner;
+}; // class MeshBVH
+////////////////////////////////////////////////////////////////////////////////
+template<class TOwner>
+void MeshBVH::Adopt(const Node* nodes, unsigned int nb_nodes, TOwner* owner) {
+  Clear();
+  p_nodes = nodes;
+  m_nb_nodes = nb_nodes;
+  p_owner = new Owner<TOwner>(owner);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline bool MeshBVH::Intersect(const Node& node, const Real origin[3], 
+                               const Real inv_dir[3], Real max_distance) {
+  Real t_near = 0;
+  Real t_far = max_distance;
+  for (int k = 0; k < 3; k++) {
+    Real t0 = (node.min[k] - origin[k]) * inv_dir[k];
+    Real t1 = (node.max[k] - origin[k]) * inv_dir[k];
+    if (t0 > t1) {
+      Real tmp = t0;
+      t0 = t1;
+      t1 = tmp;
+    }
+    // NaN (ray in the plane of a face) never restricts the interval
+    if (t0 > t_near)
+      t_near = t0;
+    if (t1 < t_far)
+      t_far = t1;
+  }
+  // Slack for the rounding errors of the slab distances
+  return t_near <= t_far * (1 + 4 * std::numeric_limits<Real>::epsilon());
+}
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MESHBVH_HPP
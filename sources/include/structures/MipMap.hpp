@@ -0,0 +1,128 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_MIPMAP_HPP
+#define GUARD_VRT_MIPMAP_HPP
+//!
+//! @file MipMap.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Filtered and tiled storage of the textures
+//!
+#include <vector>
+
+#include <common.hpp>
+#include <structures/Image.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class MipMap
+//! @brief Pyramid of prefiltered copies of an image, stored by tiles
+//! @details Each level halves the size of the previous one (2x2 box filter)
+//!  down to a single texel. A lookup picks the two levels matching the width
+//!  of its footprint and blends their bilinear interpolations (trilinear 
+//!  filtering): distant surfaces read a few texels of a small level instead 
+//!  of scattered texels of the full raster, and do not alias.\n
+//!  The texels of a level are stored by square tiles of kTILE_SIZE texels:
+//!  the four texels of a bilinear fetch, and the fetches of neighbor pixels,
+//!  mostly fall in the same few cache lines.
+class MipMap {
+ public:
+  //! Size of the tiles (power of two)
+  static const unsigned int kTILE_SHIFT = 5;
+  static const unsigned int kTILE_SIZE = 1 << kTILE_SHIFT;
+
+ public:
+  //! @brief Constructor, build the whole pyramid of an image
+  explicit MipMap(Image& image);
+  //! @brief Destructor
+  ~MipMap(void);
+
+ public:
+  //! @brief Trilinear lookup
+  //! @param u Horizontal coordinate (the image covers [0, 1])
+  //! @param v Vertical coordinate (the image covers [0, 1])
+  //! @param width Width of the footprint, in texels of the full image (0 or 
+  //!  less for a plain bilinear lookup in the full image)
+  //! @param result Storage of GetNbChannels() floats
+  //! @param wrap_u Behavior outside of the image along u
+  //! @param wrap_v Behavior outside of the image along v
+  void Lookup(Real u, Real v, Real width, float* result,
+              Image::WRAP_MODE wrap_u = Image::WRAP_CLAMP,
+              Image::WRAP_MODE wrap_v = Image::WRAP_CLAMP) const;
+  //! @brief Texel of a level
+  const float* GetTexel(unsigned int level, 
+                        unsigned int x, unsigned int y) const;
+  //! @brief Number of levels (the full image is the level 0)
+  inline unsigned int GetNbLevels(void) const { 
+    return (unsigned int)m_levels.size(); 
+  }
+  //! @brief Number of channels of the texels
+  inline unsigned int GetNbChannels(void) const { return m_nb_channels; }
+  //! @brief Width of a level
+  inline unsigned int GetWidth(unsigned int level = 0) const { 
+    return m_levels[level].width; 
+  }
+  //! @brief Height of a level
+  inline unsigned int GetHeight(unsigned int level = 0) const { 
+    return m_levels[level].height; 
+  }
+
+ private:
+  //! @struct Level
+  //! @brief One image of the pyramid
+  struct Level {
+    unsigned int width;
+    unsigned int height;
+    //! Number of tiles along x
+    unsigned int nb_tiles_x;
+    //! Texels, tile by tile (row by row inside a tile)
+    std::vector<float> texels;
+  };
+
+ private:
+  //! @brief Allocate a level
+  void InitLevel(unsigned int width, unsigned int height, Level& level) const;
+  //! @brief Position of a texel in the storage of a level
+  inline size_t Offset(const Level& level, 
+                       unsigned int x, unsigned int y) const {
+    size_t tile = (y >> kTILE_SHIFT) * level.nb_tiles_x + (x >> kTILE_SHIFT);
+    size_t texel = ((y & (kTILE_SIZE - 1)) << kTILE_SHIFT) 
+                 + (x & (kTILE_SIZE - 1));
+    return ((tile << (2 * kTILE_SHIFT)) + texel) * m_nb_channels;
+  }
+  //! @brief Weighted bilinear interpolation of a level
+  //! @param add Add the interpolation to the result instead of storing it
+  void Bilinear(const Level& level, Real u, Real v, float weight, bool add,
+                float* result, Image::WRAP_MODE wrap_u, 
+                Image::WRAP_MODE wrap_v) const;
+
+ private:
+  //! @brief Not copyable
+  MipMap(const MipMap&);
+  MipMap& operator=(const MipMap&);
+
+ private:
+  //! Number of channels
+  unsigned int m_nb_channels;
+  //! Levels, from the full image to a single texel
+  std::vector<Level> m_levels;
+}; // class MipMap
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_MIPMAP_HPP
@@ -0,0 +1,76 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_PROJECTIONMAP_HPP
+#define GUARD_VRT_PROJECTIONMAP_HPP
+//!
+//! @file ProjectionMap.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Directions of emission worth a photon
+//!
+#include <vector>
+
+#include <core/3DBase.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class ProjectionMap
+//! @brief Marked cells of the sphere of directions (Jensen's projection map)
+//! @details The sphere is split into cells of equal solid angle: uniform 
+//!  steps of the z-coordinate times uniform steps of the azimuth. A light 
+//!  source only emits its photons in the marked cells, i.e. toward the 
+//!  objects of interest, and scales them by the fraction of its power 
+//!  emitted in these cells.
+class ProjectionMap {
+ public:
+  //! Number of cells along the z-coordinate
+  static const unsigned int kNB_CELLS_Z = 32;
+  //! Number of cells along the azimuth
+  static const unsigned int kNB_CELLS_PHI = 64;
+
+ public:
+  //! @brief Constructor of a map without any marked cell
+  ProjectionMap(void);
+
+ public:
+  //! @brief Unmark all the cells
+  void Clear(void);
+  //! @brief Cell of a direction
+  //! @param direction Unit vector
+  unsigned int GetCell(const Vector& direction) const;
+  //! @brief Mark the cell of a direction
+  inline void Mark(const Vector& direction) { m_cells[GetCell(direction)] = 1; }
+  //! @brief Return true if the cell of a direction is marked
+  inline bool IsMarked(const Vector& direction) const {
+    return m_cells[GetCell(direction)] != 0;
+  }
+  //! @brief Mark the neighbours of the marked cells
+  //! @details The probes marking the cells are sparse: the cells next to a 
+  //!  marked one may still reach the objects.
+  void Dilate(void);
+  //! @brief Number of marked cells
+  unsigned int GetNbMarkedCells(void) const;
+
+ private:
+  //! Marks of the cells, azimuth first
+  std::vector<unsigned char> m_cells;
+}; // class ProjectionMap
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_PROJECTIONMAP_HPP
@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_RGBSPECTRUMTABLE_HPP
+#define GUARD_VRT_RGBSPECTRUMTABLE_HPP
+//!
+//! @file RGBSpectrumTable.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Lookup table of the rgb-to-spectrum conversion
+//!
+#include <vector>
+
+#include <common.hpp>
+#include <structures/Spectrum.hpp>
+////////////////////////////////////////////////////////////////////////////////
+class ReferenceSample;
+////////////////////////////////////////////////////////////////////////////////
+//! @class RGBSpectrumTable
+//! @brief Immutable rgb-to-spectrum conversion shared by all the textures
+//! @details The conversion of the sample diagram (see ReferenceSample) is 
+//!  linear in the intensity R+G+B: a color is its intensity times a mix of 
+//!  the sample spectra which only depends on its chromaticity (r, g). The 
+//!  weights of the samples are tabulated on a regular chromaticity grid and 
+//!  bilinearly interpolated, so a conversion is a table fetch and a weighted 
+//!  sum of a few spectra: no diagram walk, no allocation, no shared state.
+//!  The table is built once per set of wavelengths, from the sample files of
+//!  data/textures/spectralization.
+class RGBSpectrumTable {
+ public:
+  //! Number of cells of the grid along r and g
+  static const unsigned int kRESOLUTION = 128;
+
+ public:
+  //! @brief Table of the current wavelengths (built on the first call)
+  //! @remarks Thread safe; the table lives until the end of the process
+  static const RGBSpectrumTable* Get(void);
+
+ public:
+  //! @brief Spectralize a triplet (R, G, B)
+  //! @param R Red value
+  //! @param G Green value
+  //! @param B Blue value
+  //! @param spectrum Spectralized color
+  void Spectralize(Real R, Real G, Real B, Spectrum& spectrum) const;
+  //! @brief Weights of the sample spectra for a triplet (R, G, B)
+  //! @details The weights are linear in the spectrum: the weights of a mix 
+  //!  of colors are the mix of their weights, so they can be stored and 
+  //!  interpolated instead of the colors (see Texture::Prespectralize).
+  //! @param weights Storage of nb_samples() floats
+  void GetWeights(Real R, Real G, Real B, float* weights) const;
+  //! @brief Weighted sum of the sample spectra
+  //! @param weights Weights of the nb_samples() sample spectra
+  //! @param spectrum Spectralized color
+  void Reconstruct(const float* weights, Spectrum& spectrum) const;
+  //! @brief Acces to the number of sample spectra
+  inline unsigned int nb_samples(void) const { return m_nb_samples; }
+
+ private:
+  //! @brief Constructor, tabulate a sample diagram
+  explicit RGBSpectrumTable(ReferenceSample& reference);
+  //! @brief Not copyable
+  RGBSpectrumTable(const RGBSpectrumTable&);
+  RGBSpectrumTable& operator=(const RGBSpectrumTable&);
+
+ private:
+  //! Wavelengths of the spectra
+  std::vector<Real> m_wavelengths;
+  //! Number of samples
+  unsigned int m_nb_samples;
+  //! Spectra of the samples, one after the other
+  std::vector<Real> m_spectra;
+  //! Weights of the samples at each node of the grid, row by row (g, then r)
+  std::vector<float> m_weights;
+}; // class RGBSpectrumTable
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_RGBSPECTRUMTABLE_HPP
@@ -0,0 +1,71 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_SCRATCHBUFFER_HPP
+#define GUARD_VRT_SCRATCHBUFFER_HPP
+//!
+//! @file ScratchBuffer.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Temporary storage of a few floats in the lookups
+//!
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+//! @class ScratchBuffer
+//! @brief Array of floats on the stack, on the heap when it is too large
+//! @details The lookups (pixels of images, weights of spectra) need a few 
+//!  floats per call: up to kSTACK_SIZE floats, no allocation is done.
+class ScratchBuffer {
+ public:
+  //! @brief Number of floats stored on the stack
+  static const unsigned int kSTACK_SIZE = 16;
+
+ public:
+  //! @brief Constructor
+  //! @param size Number of floats
+  explicit inline ScratchBuffer(unsigned int size) : p_data(m_stack) {
+    if (size > kSTACK_SIZE) {
+      m_heap.resize(size);
+      p_data = &m_heap[0];
+    }
+  }
+
+ public:
+  //! @brief Acces to the floats
+  inline float* data(void) { return p_data; }
+  inline float& operator[](unsigned int i) { return p_data[i]; }
+
+ private:
+  //! @brief Forbidden copy constructor
+  ScratchBuffer(const ScratchBuffer&);
+  //! @brief Forbidden assignement operator
+  ScratchBuffer& operator=(const ScratchBuffer&);
+
+ private:
+  //! Storage of the small arrays
+  float m_stack[kSTACK_SIZE];
+  //! Storage of the large arrays
+  std::vector<float> m_heap;
+  //! Floats in use
+  float* p_data;
+}; // class ScratchBuffer
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_SCRATCHBUFFER_HPP
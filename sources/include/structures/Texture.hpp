@@ -28,7 +28,9 @@
 #include <io/image/ImageParser.hpp>
 
 #include <structures/Image.hpp>
+#include <structures/MipMap.hpp>
 #include <structures/Spectrum.hpp>
+#include <structures/RGBSpectrumTable.hpp>
 //!
 //! @file Texture.hpp
 //! @author Remi "Programmix" Cerise
@@ -42,7 +44,8 @@
 //!  the sample points in order to allow the definition of every rgb points as
 //!  a barycenter of known points. Here we make the hypothesis the  
 //!  spectralization process is linear despites the colorimetric concept of 
-//!  black metamerism.
+//!  black metamerism. The diagram is only used to build the lookup table
+//!  shared by all the textures (see RGBSpectrumTable).
 //!
 ////////////////////////////////////////////////////////////////////////////////
 //! @see ReferenceSample
@@ -242,6 +245,18 @@ class ReferenceSample {
  public:
   //! @brief Do the spectralization
 	Spectrum RGBtoSpectrum(double R, double G, double B);
+  //! @brief Samples and weights of the spectralization of a color
+  //! @param points Indices of the three samples
+  //! @param weights Weights of the three samples (null if not found)
+  //! @param inside False if the color is projected on the diagram
+  //! @return False if the color could not be spectralized (null weights), 
+  //!  RGBtoSpectrum then flags the spectrum with kERROR
+  bool GetWeights(double R, double G, double B, int points[3], 
+                  double weights[3], bool& inside);
+  //! @brief Get the number of samples
+  inline unsigned int GetNbColors(void) const { 
+    return (unsigned int)m_list_points.size(); 
+  }
 
  private:
   //! List of the sample points of the diagram
@@ -289,35 +304,70 @@ class Texture {
   
  public:
   //! @brief Load an image file and link it to the class
+  //! @details The image is stored as a MIP pyramid (see MipMap)
 	void SetImage(const char* image_file);
-  //! @brief Get the image pointer
-	Image* GetImage(void);
+  //! @brief Get the MIP pyramid of the image
+	const MipMap* GetMipMap(void) const;
   //! @brief Clear the image
 	void ClearImage(void);
+  //! @brief Convert the texels once into weights of the sample spectra of 
+  //!  RGBSpectrumTable
+  //! @details A spectralized value then costs a filtered fetch of the 
+  //!  weights (instead of the 81 bands of a full spectrum) and their sum, 
+  //!  without the chromaticity lookup. The weights being linear in the 
+  //!  spectrum, the spectra of the texels are interpolated and filtered.
+  void Prespectralize(void);
+  //! @brief Return true if the texture is pre-spectralized
+  inline bool IsPrespectralized(void) const { 
+    return p_weights != NULL; 
+  }
   //! @brief Set the texture name
 	void SetTextureName(const char* texture_name);
   //! brief Get the texture name
 	const char* GetTextureName(void) const;
+  //! @brief Width of a footprint, in texels, for the lookups
+  //! @param dx Differential of the texture coordinates along x
+  //! @param dy Differential of the texture coordinates along y
+  Real GetFilterWidth(const Point2D& dx, const Point2D& dy) const;
   
  public: 
   //! @brief Get the RGB value of a given pixel
-	void GetPixelValue(const Real& x, const Real& y, Pixel& rgb);
+  //! @details The width of the footprint (see GetFilterWidth) selects the 
+  //!  levels of the MIP pyramid; 0 reads the full image.
+	void GetPixelValue(const Real& x, const Real& y, Pixel& rgb,
+                     TEXTURE_REPEAT_MODE repeat_u = REPEAT_OFF,
+                     TEXTURE_REPEAT_MODE repeat_v = REPEAT_OFF,
+                     const Real& width = 0);
+  //! @brief Get the value of a given pixel into a caller-provided storage
+  //!  (one float per channel of the image), without any allocation
+	void GetPixelValue(const Real& x, const Real& y, float* values,
+                     TEXTURE_REPEAT_MODE repeat_u = REPEAT_OFF,
+                     TEXTURE_REPEAT_MODE repeat_v = REPEAT_OFF,
+                     const Real& width = 0);
   //! @brief Get the alpha value of a given pixel
-	void GetAlphaValue(const Real& x, const Real& y, Real& alpha);
+	void GetAlphaValue(const Real& x, const Real& y, Real& alpha,
+                     TEXTURE_REPEAT_MODE repeat_u = REPEAT_OFF,
+                     TEXTURE_REPEAT_MODE repeat_v = REPEAT_OFF,
+                     const Real& width = 0);
   //! @brief Get the spectralized value of a given pixel
 	void GetSpectrumValue(const Real& x, const Real& y, 
-                        Spectrum& spectralized_rgb);
+                        Spectrum& spectralized_rgb,
+                        TEXTURE_REPEAT_MODE repeat_u = REPEAT_OFF,
+                        TEXTURE_REPEAT_MODE repeat_v = REPEAT_OFF,
+                        const Real& width = 0);
 	//! @brief Spectralize  triplet (R, G, B)
 	void SpectralizeRGB(Real R, Real G, Real B, 
                       Spectrum& spectralized_rgb);
 
  public :
-	//! Image file linked to the texture
-	Image* p_image;
+	//! MIP pyramid of the image file linked to the texture
+	MipMap* p_mipmap;
+  //! Weights of the sample spectra of each texel (pre-spectralized texture)
+  MipMap* p_weights;
 	//! Name of the texture
 	std::string	m_name;
-  //! Reference rgb-to-spectrum conversion samples for spectralization
-  ReferenceSample* p_reference_sample;
+  //! Shared rgb-to-spectrum conversion table (not owned)
+  const RGBSpectrumTable* p_spectrum_table;
 };	// class Texture
 ////////////////////////////////////////////////////////////////////////////////
 #endif // GUARD_VRT_TEXTURE_HPP
@@ -0,0 +1,99 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GUARD_VRT_TILEBUFFER_HPP
+#define GUARD_VRT_TILEBUFFER_HPP
+//!
+//! @file TileBuffer.hpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details Thread-local framebuffer for the rendering of one task unit
+//!
+#include <cstddef>
+
+#include <structures/Image.hpp>
+////////////////////////////////////////////////////////////////////////////////
+//! @class TileBuffer
+//! @brief Cache-line aligned pixel buffer of one task unit
+//! @details Each openMP process owns one tile buffer, reused from one task
+//!  unit to the next. Pixels are written in the buffer without any
+//!  allocation, then the whole tile is copied into the shared image by Flush.
+//!  Every row starts on a cache line so that two processes never write in
+//!  the same cache line while rendering.
+class TileBuffer {
+ public:
+  //! @brief Size in bytes of a cache line
+  static const size_t kCACHE_LINE = 64;
+
+ public:
+  //! @brief Constructor
+  TileBuffer(void);
+  //! @brief Destructor
+  ~TileBuffer(void);
+
+ public:
+  //! @brief Prepare the buffer for a new tile
+  //! @remarks Memory is only reallocated when the tile is bigger than all
+  //!  the previous ones
+  //! @param width Width of the tile
+  //! @param height Height of the tile
+  //! @param nb_channels Number of channels of a pixel
+  void Resize(unsigned int width, unsigned int height,
+              unsigned int nb_channels);
+  //! @brief Set all the pixels of the tile to 0
+  void Clear(void);
+  //! @brief Attach a pixel to the storage of the pixel (x, y) of the tile
+  //! @param x Column of the pixel in the tile
+  //! @param y Row of the pixel in the tile
+  //! @param pixel Pixel attached to the buffer (no allocation)
+  inline void AttachPixel(unsigned int x, unsigned int y, Pixel& pixel) {
+    pixel.attach(m_nb_channels, &p_data[y * m_stride + x * m_nb_channels]);
+  }
+  //! @brief Copy the tile into the image (one memcpy per row)
+  //! @param image Destination image
+  //! @param ulx X-coordinate of the upper-left corner of the tile in image
+  //! @param uly Y-coordinate of the upper-left corner of the tile in image
+  void Flush(Image& image, unsigned int ulx, unsigned int uly) const;
+
+ private:
+  //! @brief Forbidden copy constructor
+  TileBuffer(const TileBuffer&);
+  //! @brief Forbidden assignement operator
+  TileBuffer& operator=(const TileBuffer&);
+
+ private:
+  //! Allocated memory (not aligned)
+  float* p_memory;
+  //! Aligned pixel data
+  float* p_data;
+  //! Number of floats allocated after p_data
+  size_t m_capacity;
+  //! Width of the tile
+  unsigned int m_width;
+  //! Height of the tile
+  unsigned int m_height;
+  //! Number of channels of a pixel
+  unsigned int m_nb_channels;
+  //! Number of floats between two rows (multiple of a cache line)
+  unsigned int m_stride;
+}; // class TileBuffer
+////////////////////////////////////////////////////////////////////////////////
+#endif // GUARD_VRT_TILEBUFFER_HPP
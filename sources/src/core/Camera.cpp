@@ -24,17 +24,21 @@ bool Camera::getRay(const int& i, const int& j, LightVector& ray) {
   if(!_shape->getRay(i, j, propagation))
     return false;
 
-  LightVector toCast;
-  toCast.initSpectralData();
-  toCast.setRay(propagation);
+  ray.initSpectralData();
+  ray.setRay(propagation);
+
+  //Footprint of the pixel, for the filtering of the textures
+  Ray dx, dy;
+  if(_shape->getRayDifferentials(i, j, propagation, dx, dy))
+    ray.setRayDifferentials(dx, dy);
   
   if (propagation.v[2] < Real(1.0 - kEPSILON) 
        && propagation.v[2] > Real(-1.0 + kEPSILON)) {
-    toCast.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
+    ray.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
   } else {
-    toCast.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
+    ray.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
   }
-  toCast.clear();
+  ray.clear();
 
   return true; 
 }
@@ -59,8 +63,38 @@ void Camera::takeShot(Scenery& scenery, Image& image)
  */
 void Camera::takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, Image& image)
 {
-  ////Initializing the camera
-  //image.clear();
+  TileBuffer tile;
+  takeShot(scenery, minx, maxx, miny, maxy, tile, image);
+}
+
+/**
+ * Compute a part of the image into a tile buffer, then copy the tile into the
+ * image in one block. The tile buffer is reused from one call to the next, so
+ * that no allocation is done for the pixels.
+ * scenery : the scereny into which we have to compute the image
+ * minx, miny, maxx, maxy : boundaries of the part to compute. These boundaries
+ *   are include in the part.
+ * tile : the (thread-local) tile buffer used to render the part.
+ * image : the computed image will be placed into this parameter.
+ */
+void Camera::takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, TileBuffer& tile, Image& image)
+{
+  renderTile(scenery, minx, maxx, miny, maxy, tile);
+  tile.Flush(image, minx, miny);
+}
+
+/**
+ * Compute a part of the image into a tile buffer.
+ * scenery : the scereny into which we have to compute the image
+ * minx, miny, maxx, maxy : boundaries of the part to compute. These boundaries
+ *   are include in the part.
+ * tile : the tile buffer, resized to the part and filled.
+ */
+void Camera::renderTile(Scenery& scenery, unsigned int minx, unsigned int maxx, unsigned int miny, unsigned int maxy, TileBuffer& tile)
+{
+  tile.Resize(maxx - minx + 1, maxy - miny + 1, getNumberOfChannels());
+  tile.Clear();
+  Pixel pixel;
 
   //Computing the image
   for(unsigned int j=miny; j<=maxy; j++)
@@ -75,6 +109,9 @@ void Camera::takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, un
       LightVector toCast;
       toCast.initSpectralData();
       toCast.setRay(propagation);
+      Ray dx, dy;
+      if(_shape->getRayDifferentials(i, j, propagation, dx, dy))
+        toCast.setRayDifferentials(dx, dy);
       if(propagation.v[2]<0.999 && propagation.v[2]>-0.999)
         toCast.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
       else
@@ -172,10 +209,10 @@ void Camera::takeShot(Scenery& scenery, unsigned int minx, unsigned int maxx, un
       //toCast[	79	].setRadiance(1);
       //toCast[	80	].setRadiance(1);
 
-      //Project the light data into the color representation and update the image
-      Pixel pixel(getNumberOfChannels());
+      //Project the light data into the color representation, directly into the
+      //tile buffer
+      tile.AttachPixel(i - minx, j - miny, pixel);
       _colorhandler->lightDataToRGB(toCast, pixel);
-      image.setPixel(i, j, pixel);
     }
   }
 }
@@ -186,33 +223,18 @@ void Camera::local_takeshot(Scenery& scenery,
                             unsigned int local_miny, 
                             unsigned int local_maxy, 
                             Image& image) {
-  //Computing the image
-  for(unsigned int j = local_miny; j <= local_maxy; j++) {
-    for(unsigned int i = local_minx; i <= local_maxx; i++) {
-      //Generate the ray to cast
-      Ray propagation;
-      if(!_shape->getRay(i, j, propagation))
-        continue;
-
-      LightVector toCast;
-      toCast.initSpectralData();
-      toCast.setRay(propagation);
-
-      if(propagation.v[2] < (Real(1.0) - kEPSILON) 
-          && propagation.v[2] > (Real(-1.0) + kEPSILON)) {
-        toCast.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
-      } else {
-        toCast.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
-      }
-      toCast.clear();
-      
-      //Compute the light data
-      scenery.getRenderer()->CastRay(scenery, toCast);
-      
-      Pixel pixel(getNumberOfChannels());
-      _colorhandler->lightDataToRGB(toCast, pixel);
-      image.setPixel(i - local_minx, j - local_miny, pixel);
-    }
-  }
+  TileBuffer tile;
+  local_takeshot(scenery, local_minx, local_maxx, local_miny, local_maxy, 
+                 tile, image);
 }
 
+void Camera::local_takeshot(Scenery& scenery, 
+                            unsigned int local_minx, 
+                            unsigned int local_maxx, 
+                            unsigned int local_miny, 
+                            unsigned int local_maxy, 
+                            TileBuffer& tile,
+                            Image& image) {
+  renderTile(scenery, local_minx, local_maxx, local_miny, local_maxy, tile);
+  tile.Flush(image, 0, 0);
+}
@@ -33,8 +33,42 @@
 #include <structures/Medium.hpp>
 #include <structures/MultispectralPhoton.hpp>
 #include <materials/Material.hpp>
+#include <cmath>
+
 #include <objectshapes/ObjectShape.hpp>
 ////////////////////////////////////////////////////////////////////////////////
+namespace {
+//! Differential of the texture coordinate along one ray differential
+//! @details The neighbor ray is intersected with the tangent plane, then the 
+//!  offset of this point is expressed with the derivatives of the surface 
+//!  (least squares, the derivatives are not always orthogonal)
+void SurfaceDifferential(const Ray& neighbor, const Basis& localBasis, 
+                         const Vector& dpdu, const Vector& dpdv, 
+                         Point2D& differential) {
+  differential = Point2D(0, 0);
+  Real cosine = neighbor.v.dot(localBasis.k);
+  if(std::fabs(cosine) < kEPSILON)
+    return;
+  Real distance = Vector(neighbor.o, localBasis.o).dot(localBasis.k) / cosine;
+  if(distance <= 0)
+    return;
+  Vector offset;
+  for(int i = 0; i < 3; i++)
+    offset[i] = neighbor.o[i] + neighbor.v[i] * distance - localBasis.o[i];
+
+  Real uu = dpdu.dot(dpdu);
+  Real uv = dpdu.dot(dpdv);
+  Real vv = dpdv.dot(dpdv);
+  Real determinant = uu * vv - uv * uv;
+  if(determinant <= kEPSILON * uu * vv)
+    return;
+  Real ou = dpdu.dot(offset);
+  Real ov = dpdv.dot(offset);
+  differential[0] = (vv * ou - uv * ov) / determinant;
+  differential[1] = (uu * ov - uv * ou) / determinant;
+}
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
 Object::Object(void)
     : p_shape(NULL), 
       p_material(NULL), 
@@ -152,6 +186,20 @@ void Object::getRandomDiffuseRay(const Basis& localBasis,
                                     reemitedLight, nbRays, subrays);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool Object::getDiffuseDensity(const Basis& localBasis, 
+                               const Point2D& surfaceCoordinate, 
+                               const LightVector& reemitedLight, 
+                               const Vector& direction, 
+                               Real& density, Real& weight) {
+  density = 0;
+  weight = 0;
+  if(p_material==0)
+    return false;
+  return p_material->getDiffuseDensity(localBasis, surfaceCoordinate, 
+                                       reemitedLight, direction, 
+                                       density, weight);
+}
+////////////////////////////////////////////////////////////////////////////////
 bool Object::isDiffuse(void) const {
   if(p_material!=0)
     return p_material->isDiffuse();
@@ -176,6 +224,24 @@ void Object::getLocalBasis(const Ray& ray, const Real& distance,
     p_shape->getLocalBasis(ray, distance, localBasis, surfaceCoordinate);
 }
 ////////////////////////////////////////////////////////////////////////////////
+void Object::getSurfaceDifferentials(const LightVector& light, 
+                                     const Basis& localBasis, 
+                                     const Point2D& surfaceCoordinate, 
+                                     Point2D& dx, Point2D& dy) {
+  dx = Point2D(0, 0);
+  dy = Point2D(0, 0);
+  Ray ray_dx, ray_dy;
+  if(p_shape == NULL || !light.getRayDifferentials(ray_dx, ray_dy))
+    return;
+  Ray ray = light.getRay();
+  Real distance = Vector(ray.o, localBasis.o).dot(ray.v) / ray.v.dot(ray.v);
+  Vector dpdu, dpdv;
+  if(!p_shape->getSurfaceDerivatives(ray, distance, dpdu, dpdv))
+    return;
+  SurfaceDifferential(ray_dx, localBasis, dpdu, dpdv, dx);
+  SurfaceDifferential(ray_dy, localBasis, dpdu, dpdv, dy);
+}
+////////////////////////////////////////////////////////////////////////////////
 void Object::getBoundingBox(BoundingBox& boundingBox) {
   if(p_shape!=0)
     p_shape->getBoundingBox(boundingBox);
@@ -17,6 +17,8 @@
 #include <core/Scenery.hpp>
 #include <core/Camera.hpp>
 
+#include <limits>
+
 // -----------------------------------------------------------------------------
 // Scenery ---------------------------------------------------------------------
 // -----------------------------------------------------------------------------
@@ -27,11 +29,10 @@
  * globalbounds : the overall bounding box. Must contain all the object of the scene.
  */
 Scenery::Scenery(int nbObject, int nbSource, const BoundingBox& globalbounds, const Real& bias)
-: _objects(globalbounds, nbObject, (std::log10((float)nbObject)>1)? (int)std::log10((float)nbObject) : 1),
-  _sources(globalbounds, nbSource, (std::log10((float)nbSource)>1)? (int)std::log10((float)nbSource) : 1),
+: _sources(globalbounds, nbSource, (std::log10((float)nbSource)>1)? (int)std::log10((float)nbSource) : 1),
   _renderer(0), _bias(bias)
 { 
-  //Nothing to do more
+  _objects.reserve(nbObject);
 }
 
 /**
@@ -39,8 +40,8 @@ Scenery::Scenery(int nbObject, int nbSource, const BoundingBox& globalbounds, co
  */
 Scenery::~Scenery()
 {
-  for(unsigned int i=0; i<_objects.getSize(); i++)
-    delete _objects.getElement(i);
+  for(unsigned int i=0; i<_objects.size(); i++)
+    delete _objects[i];
   for(unsigned int i=0; i<_sources.getSize(); i++)
     delete _sources.getElement(i);
   for(unsigned int i=0; i<_cameras.size(); i++)
@@ -57,21 +58,34 @@ Scenery::~Scenery()
  */
 void Scenery::addObject(Object* object)
 {
-  //Adding into the octree
-  BoundingBox bound;
-  object->getBoundingBox(bound);
-  object->setIndex(_objects.getSize());
-  _objects.add(object, bound);
+  //The hierarchy is built once all the objects are added
+  object->setIndex(_objects.size());
+  _objects.push_back(object);
 }
 
 unsigned int Scenery::getNbObject() const
 {
-  return _objects.getSize();
+  return _objects.size();
 }
 
 Object* Scenery::getObject(unsigned int i)
 {
-  return _objects.getElement(i);
+  return _objects[i];
+}
+
+void Scenery::buildHierarchy()
+{
+  std::vector<BoundingBox> bounds(_objects.size());
+  for(unsigned int i=0; i<_objects.size(); i++)
+    _objects[i]->getBoundingBox(bounds[i]);
+
+  std::vector<unsigned int> order;
+  _objectHierarchy.Build(bounds, order);
+
+  //The leaves cover consecutive objects
+  _orderedObjects.resize(order.size());
+  for(unsigned int i=0; i<order.size(); i++)
+    _orderedObjects[i] = _objects[order[i]];
 }
 
 /**
@@ -162,17 +176,74 @@ Renderer* Scenery::getRenderer()
  */
 bool Scenery::getNearestIntersection(const Ray& ray, Real& distance, Object*& object, Object* startingobject)
 {
-  SceneryOctreeVisitor visitor(_bias);
-  //Initialize visitor
-  visitor.init(startingobject);
-  
-  //Lauch visit process
-  _objects.accept(ray, visitor);
-  
-  //Get result
-  distance = visitor.getMinDistance();
-  object = visitor.getMinDistanceObject();
-  
+  distance = -1;
+  object = 0;
+  if(_objectHierarchy.nb_nodes() == 0)
+    return false;
+
+  const MeshBVH::Node* nodes = _objectHierarchy.nodes();
+  Real origin[3] = {ray.o[0], ray.o[1], ray.o[2]};
+  Real invDir[3];
+  for(int k=0; k<3; k++)
+    invDir[k] = Real(1) / ray.v[k];
+  Real maxDistance = std::numeric_limits<Real>::max();
+
+  //The starting object is tested from a biased origin
+  Ray biasedRay = ray;
+  biasedRay.o[0] += _bias*biasedRay.v[0];
+  biasedRay.o[1] += _bias*biasedRay.v[1];
+  biasedRay.o[2] += _bias*biasedRay.v[2];
+
+  //Depth first traversal, nearest child first : the farther objects are 
+  //skipped once a nearer intersection is found
+  unsigned int stack[2*MeshBVH::kMAX_DEPTH];
+  int top = 0;
+  stack[top++] = 0;
+  while(top > 0)
+  {
+    const MeshBVH::Node& node = nodes[stack[--top]];
+    if(!MeshBVH::Intersect(node, origin, invDir, maxDistance))
+      continue;
+
+    if(node.axis == MeshBVH::kLEAF)
+    {
+      for(unsigned int i=node.first; i<node.first+node.count; i++)
+      {
+        Object* candidate = _orderedObjects[i];
+        Real d = -1;
+        if(candidate==startingobject)
+        {
+          if(!candidate->intersect(biasedRay, d) || d<=0.0)
+            continue;
+          d += _bias;
+        }
+        else if(!candidate->intersect(ray, d) || d<=0)
+          continue;
+
+        if(distance<0 || d<distance)
+        {
+          distance = d;
+          object = candidate;
+          maxDistance = d;
+        }
+      }
+    }
+    else
+    {
+      unsigned int left = (unsigned int)(&node - nodes) + 1;
+      if(ray.v[node.axis] < 0)
+      {
+        stack[top++] = left;
+        stack[top++] = node.first;
+      }
+      else
+      {
+        stack[top++] = node.first;
+        stack[top++] = left;
+      }
+    }
+  }
+
   return object!=0;
 }
 
@@ -249,77 +320,6 @@ bool Scenery::getNearestIntersectionWithSource(const Ray& ray, Real& distance, S
 }
 
 
-// -----------------------------------------------------------------------------
-// SceneryOctreeVisitor --------------------------------------------------------
-// -----------------------------------------------------------------------------
-
-/**
- * Constructor
- */
-SceneryOctreeVisitor::SceneryOctreeVisitor(Real bias)
-{
-  _bias=bias;
-}
-
-/**
- * Initialize the visitor and errase the old results.
- */
-void SceneryOctreeVisitor::init(Object* startingobject)
-{
-  //Initialize result data
-  _distance=-1;
-  _object=0;
-  _startingobject=startingobject;
-}
-
-/**
- * Used by Octree : apply the visitor to the given object (that is able to 
- * intersect the given ray).
- */
-void SceneryOctreeVisitor::apply(const Ray& ray, Object*& object)
-{
-  if(object==_startingobject)
-  {
-    Ray newray=ray;
-    newray.o[0] += _bias*newray.v[0];
-    newray.o[1] += _bias*newray.v[1];
-    newray.o[2] += _bias*newray.v[2];
-    Real distance = -1;
-    if(object->intersect(newray, distance) && distance>0.0)
-      if(_distance<0 || _distance>distance+_bias)
-      {
-        _object=object;
-        _distance=distance+_bias;
-      }    
-  }
-  else
-  {
-    Real distance = -1;
-    if(object->intersect(ray, distance) && distance>0)
-      if(_distance<0 || _distance>distance)
-      {
-        _distance=distance;
-        _object=object;
-      }
-  }
-}
-
-/**
- * Return the minimal intersection distance found at the last visit of the octree.
- */
-Real SceneryOctreeVisitor::getMinDistance()
-{
-  return _distance;
-}
-
-/**
- * Return the minimal intersection object found at the last visit of the octree.
- */
-Object* SceneryOctreeVisitor::getMinDistanceObject()
-{
-  return _object;
-}
-
 // -----------------------------------------------------------------------------
 // ScenerySourceOctreeVisitor --------------------------------------------------------
 // -----------------------------------------------------------------------------
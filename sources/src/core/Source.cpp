@@ -89,6 +89,13 @@ void Source::getRandomPhoton(MultispectralPhoton& photon) {
     p_source->getRandomPhoton(photon);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool Source::getEmissionBounds(BoundingBox& bounds, Vector& axis, 
+                               Real& cosAngle) {
+  if(p_source != NULL)
+    return p_source->getEmissionBounds(bounds, axis, cosAngle);
+  return false;
+}
+////////////////////////////////////////////////////////////////////////////////
 bool Source::intersect(const Ray& ray, Real& distance) {
   if(p_shape != NULL)
     return p_shape->intersect(ray, distance);
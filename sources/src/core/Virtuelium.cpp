@@ -41,6 +41,8 @@
 #include <core/taskexecutor/TaskExecutorBase.hpp>
 #include <core/taskexecutor/StandAloneExecutor.hpp>
 #include <core/taskexecutor/ClientServerExecutor.hpp>
+#include <io/mesh/MeshCache.hpp>
+#include <physics/LayerTableCache.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 Virtuelium::Virtuelium(int argc, char* argv[]) 
     : m_mpi_rank(0), 
@@ -139,7 +141,8 @@ bool Virtuelium::ParseAreaParam(const char* area_str,
 ////////////////////////////////////////////////////////////////////////////////
 void Virtuelium::ParseAlgoParam(const std::string& str_line,
                                 const std::string& str_line_snake,
-                                bool spiral_trigo, bool spiral_inverse) {                                 
+                                bool spiral_trigo, bool spiral_inverse,
+                                int cost_step, int cost_split) {                                 
   // Line 
   if (str_line.compare("LRTB") == 0) {
     m_algorithm = "Line";
@@ -208,6 +211,12 @@ void Virtuelium::ParseAlgoParam(const std::string& str_line,
     m_algorithm = "Spiral";
     m_algo_params.push_back(TaskManagerSpiral::kNONTRIGO);
 
+    // cost-aware
+  } else if (cost_step > 0) {
+    m_algorithm = "Cost";
+    m_algo_params.push_back(cost_step);
+    m_algo_params.push_back(cost_split);
+
     // default case = LKRTB without snaking
   } else {
     m_algorithm = "Line";
@@ -285,6 +294,16 @@ trigonometric spiral pattern.", cmd, false);
     TCLAP::SwitchArg arg_spiral_inverse("", "spiral-inverse",
 "Use the Spiral Algorithm. The image will be renderer by following a \
 non-trigonometric spiral pattern.", cmd, false);
+    TCLAP::ValueArg<int> arg_cost("", "cost",
+"Use the Cost Algorithm. A sparse prepass estimates the cost of each task \
+unit; the expensive ones are split and the tasks are rendered from the most \
+expensive to the cheapest. The value is the distance in pixels between two \
+probes of the prepass.",
+false, 0, "integer", cmd);
+    TCLAP::ValueArg<int> arg_cost_split("", "cost-split",
+"Used with --cost. Task units whose predicted cost exceeds this percentage of \
+the mean cost are split.",
+false, TaskManagerCost::kDEFAULT_SPLIT_RATIO, "integer", cmd);
 
     // Fragmented mode
     TCLAP::SwitchArg arg_fragment_mode("", "fragment", 
@@ -348,6 +367,20 @@ false, -1, "integer", cmd);
 Set to 0, for irregular sampling.",
 false, -1, "integer", cmd);
 
+    // Cache of the layered material tables
+    TCLAP::ValueArg<std::string> arg_table_cache("", "table-cache", 
+"Directory where the precomputed tables of layered materials are stored. The \
+tables are reused by the next renderings (and by all the MPI ranks) of sceneries \
+using the same media, instead of being computed again.",
+false, "", "string", cmd);
+
+    // Cache of the parsed meshes
+    TCLAP::ValueArg<std::string> arg_mesh_cache("", "mesh-cache", 
+"Directory where the binary caches of the mesh files (.vmesh) are stored. By \
+default, each cache is written next to its mesh file. A cache is rebuilt when \
+its mesh file is modified.",
+false, "", "string", cmd);
+
     // Area of the image to be rendered
     TCLAP::ValueArg<std::string> arg_area("a", "area", 
 "Only compute this sub-area of the image. By default, the whole image will be \
@@ -408,12 +441,19 @@ xmin:ymin:xmax:ymax", "area");
 
     // Retrieve the algorithm pattern
     ParseAlgoParam(arg_line.getValue(), arg_line_snake.getValue(),
-                    arg_spiral_trigo.getValue(), arg_spiral_inverse.getValue());
+                    arg_spiral_trigo.getValue(), arg_spiral_inverse.getValue(),
+                    arg_cost.getValue(), arg_cost_split.getValue());
     
     // Retrieve the save / load for rendering inits
     m_save_init_file = arg_save_init.getValue();
     m_load_init_file = arg_load_init.getValue();
 
+    // Retrieve the directory of the layered material tables
+    LayerTableCache::SetDirectory(arg_table_cache.getValue());
+
+    // Retrieve the directory of the mesh caches
+    MeshCache::SetDirectory(arg_mesh_cache.getValue());
+
       // Catch any exceptions
   } catch (TCLAP::ArgException &e) { 
     std::cerr << "Error: " << e.error() 
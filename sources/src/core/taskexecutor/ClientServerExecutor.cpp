@@ -40,13 +40,14 @@
 #include <exceptions/Exception.hpp>
 ////////////////////////////// class TaskBlock /////////////////////////////////
 TaskBlock::TaskBlock(void) 
-    : m_blk_orig(0), m_blk_size(0), m_status(0) {}
+    : m_blk_orig(0), m_blk_size(0), m_blk_stride(1), m_status(0) {}
 ////////////////////////////// class TaskBlock /////////////////////////////////
 TaskBlock::~TaskBlock(void) {}
 ////////////////////////////// class TaskBlock /////////////////////////////////
 TaskBlock::TaskBlock(const TaskBlock& src) {
   m_blk_orig = src.m_blk_orig;
   m_blk_size = src.m_blk_size;
+  m_blk_stride = src.m_blk_stride;
   m_status = src.m_status;
 }
 ////////////////////////////// class TaskBlock /////////////////////////////////
@@ -54,14 +55,15 @@ TaskBlock& TaskBlock::operator=(const TaskBlock& src) {
   if (this != &src) {
     m_blk_orig = src.m_blk_orig;
     m_blk_size = src.m_blk_size;
+    m_blk_stride = src.m_blk_stride;
     m_status = src.m_status;
   }
   return *this;
 }
 ////////////////////////////// class TaskBlock /////////////////////////////////
 void TaskBlock::Print(void) {
-  VrtLog::Write(" -- Task Block: origin = %u, size %u, status = %u", 
-                m_blk_orig, m_blk_size, m_status);
+  VrtLog::Write(" -- Task Block: origin = %u, size %u, stride %u, \
+status = %u", m_blk_orig, m_blk_size, m_blk_stride, m_status);
 }
 //////////////////////////// class ClientServerExecutor ////////////////////////
 ClientServerExecutor::ClientServerExecutor(void)
@@ -158,6 +160,14 @@ void ClientServerExecutor::CreateTaskManager(
     // Spiral Algorithm
   } else if (manager_class.compare("Spiral") == 0) {
     p_task_mngr = new TaskManagerSpiral;
+    // Cost-aware Algorithm: tasks are sorted longest-first, so they must be
+    // dealt one by one to the processes
+  } else if (manager_class.compare("Cost") == 0) {
+    TaskManagerCost* cost_mngr = new TaskManagerCost;
+    cost_mngr->SetScenery(p_scenery);
+    p_task_mngr = cost_mngr;
+    if (m_chunk == -1)
+      m_chunk = 1;
     // Unknown
   } else {
     throw Exception("This Task manager has not been implemented yet: " 
@@ -172,6 +182,19 @@ void ClientServerExecutor::CreateTaskManager(
   for (unsigned int arg = 0; arg < manager_params.size(); arg++)
     p_task_mngr->SetAdditionalParameters((int)arg, manager_params[arg]);
 
+  // The cost map is estimated by the server only, then shared so that every 
+  // process builds the same list of tasks
+  TaskManagerCost* cost_mngr = dynamic_cast<TaskManagerCost*>(p_task_mngr);
+  if (cost_mngr != NULL) {
+    std::vector<double> cost(p_task_mngr->nb_tasks(), 0.0);
+    if (m_mpi_rank == 0) {
+      cost_mngr->EstimateCost();
+      cost = cost_mngr->cost_map();
+    }
+    MPI::COMM_WORLD.Bcast(&cost[0], (int)cost.size(), MPI_DOUBLE, 0);
+    cost_mngr->SetCostMap(cost);
+  }
+
   // Create Task list
   p_task_mngr->CreateTaskList();
   //p_task_mngr->PrintTaskList();
@@ -214,6 +237,24 @@ void ClientServerExecutor::InitializeBlocks(void) {
     m_chunk = p_task_mngr->nb_tasks() / m_nb_openmp_process;
   }
 
+  // Task units dealt one by one: the units of this MPI process are gathered
+  // in blocks of one unit per OpenMP process
+  if (m_chunk == 1) {
+    unsigned int stride = (unsigned int)m_nb_mpi_process;
+    unsigned int size = (unsigned int)m_nb_openmp_process;
+    for (unsigned int t = (unsigned int)m_mpi_rank; 
+         t < p_task_mngr->nb_tasks(); t += size * stride) {
+      TaskBlock block;
+      block.m_blk_orig = t;
+      block.m_blk_stride = stride;
+      block.m_blk_size = (p_task_mngr->nb_tasks() - t + stride - 1) / stride;
+      if (block.m_blk_size > size)
+        block.m_blk_size = size;
+      m_blocks.push_back(block);
+    }
+    return;
+  }
+
   // Traverse the list of task units, create blocks and add them in the right 
   // place in the list of blocks
   for (unsigned int t = 0; t < p_task_mngr->nb_tasks(); t += m_chunk) {
@@ -345,26 +386,33 @@ void ClientServerExecutor::Execute(void) {
     //VrtLog::WriteArray("p_counter after Allgather", p_counter, m_nb_mpi_process);
 
     // OpenMP Loop
-#   pragma omp parallel for private(i, ulx, uly, brx, bry) schedule(dynamic, 1)
-    for (i = m_blocks[b].m_blk_orig; 
-         i < m_blocks[b].m_blk_orig + m_blocks[b].m_blk_size; i++) {         
+#   pragma omp parallel private(i, ulx, uly, brx, bry)
+    {
+    // Tile buffer of the current OpenMP process, reused for every task unit
+    TileBuffer tile;
+
+#   pragma omp for schedule(dynamic, 1)
+    for (i = 0; i < (int)m_blocks[b].m_blk_size; i++) {         
       // Get the current task unit for the current OpenMP process
-      p_task_mngr->GetTaskAt((unsigned int)i).Retrieve((unsigned int&)ulx, 
-                                                       (unsigned int&)uly, 
-                                                       (unsigned int&)brx, 
-                                                       (unsigned int&)bry);
+      unsigned int task = m_blocks[b].GetTaskUnit((unsigned int)i);
+      p_task_mngr->GetTaskAt(task).Retrieve((unsigned int&)ulx, 
+                                            (unsigned int&)uly, 
+                                            (unsigned int&)brx, 
+                                            (unsigned int&)bry);
 
       // Compute this task unit
       Image* img = new Image(brx - ulx, bry - uly, 
                              p_image->getNumberOfChannels());
-      camera->local_takeshot(*p_scenery, ulx, brx, uly, bry, *img);    
+      camera->local_takeshot(*p_scenery, ulx, brx, uly, bry, tile, *img);    
 
       // Save
       char local_output[200];
       sprintf(local_output, "%u-%u_%u_%u.png", ulx, brx, uly, bry);
+#     pragma omp critical
       vec_img.insert( std::pair<std::string, Image*>(std::string(local_output), 
                                                      img) );
 
+    } 
     } // End of the OpenMP loop
 
     std::map<std::string, Image*>::iterator it;
@@ -34,6 +34,8 @@
 
 #include <core/Scenery.hpp>
 #include "io/image/ImageParser.hpp"
+#include "io/image/EXRImageParser.hpp"
+#include "io/image/MHDRImageStream.hpp"
 #include <structures/Image.hpp>
 #include <exceptions/Exception.hpp>
 ////////////////////////////// class StandAloneExecutor //////////////////////////
@@ -76,6 +78,15 @@ void StandAloneExecutor::Initialize(Scenery* scenery,
   } else if (manager_class.compare("Spiral") == 0) {
     p_task_mngr = new TaskManagerSpiral;
 
+  // Cost-aware Algorithm: tasks are sorted longest-first, so they must be
+  // distributed one by one to the OpenMP processes
+  } else if (manager_class.compare("Cost") == 0) {
+    TaskManagerCost* cost_mngr = new TaskManagerCost;
+    cost_mngr->SetScenery(p_scenery);
+    p_task_mngr = cost_mngr;
+    if (m_chunk == -1)
+      m_chunk = 1;
+
   // Unknown
   } else {
     throw Exception("This Task manager has not been implemented yet: " 
@@ -140,8 +151,31 @@ void StandAloneExecutor::Execute(void) {
   ImageParser parser;
   int nbtask = 0;
 
+  // EXR outputs are written tile by tile, as soon as the tiles are rendered,
+  // instead of saving the whole image every m_nb_task_refresh task units
+  std::string output = camera->getOutputFilename();
+  bool incremental = (output.size() > 4 
+                   && output.compare(output.size() - 4, 4, ".exr") == 0);
+  EXRImageParser exr;
+  if (incremental)
+    exr.Open(*p_image, output, m_tsk_width, m_tsk_height);
+
+  // MHDRI outputs are tiled files: every m_nb_task_refresh task units, only
+  // the tiles modified since the last checkpoint are rewritten
+  bool checkpointed = (output.size() > 6 
+                    && output.compare(output.size() - 6, 6, ".mhdri") == 0);
+  MHDRImageStream mhdri;
+  if (checkpointed)
+    mhdri.Create(output, *p_image, m_tsk_width, m_tsk_height);
+
   // OpenMP Loop
-# pragma omp parallel for private(i, ulx, uly, brx, bry) schedule(dynamic, m_chunk)
+# pragma omp parallel private(i, ulx, uly, brx, bry)
+  {
+  // Each OpenMP process renders its task units in its own tile buffer, 
+  // reused from one task unit to the next
+  TileBuffer tile;
+
+# pragma omp for schedule(dynamic, m_chunk)
   for (i = 0; i < p_task_mngr->nb_tasks(); i++) {
     
     // Get the current task unit for the current OpenMP process
@@ -150,7 +184,7 @@ void StandAloneExecutor::Execute(void) {
                                                      (unsigned int&)brx, 
                                                      (unsigned int&)bry);
     // Compute this task unit
-    camera->takeShot(*p_scenery, ulx, brx, uly, bry, *p_image);
+    camera->takeShot(*p_scenery, ulx, brx, uly, bry, tile, *p_image);
 
 		// Increment the visual counter in command console
     std::cout << "\rCamera " << 0 << " : " 
@@ -159,16 +193,39 @@ void StandAloneExecutor::Execute(void) {
     // Increment the number of task units that has been computed
     nbtask++;
 
+    // Write the tiles of the EXR output that are complete
+    if (incremental) {
+#     pragma omp critical (exr_output)
+      exr.WriteRegion(*p_image, ulx, uly, brx, bry);
+
+    // Write the dirty tiles of the MHDRI output that are complete (every
+    // m_nb_task_refresh task units)
+    } else if (checkpointed) {
+#     pragma omp critical (mhdri_output)
+      {
+      mhdri.MarkRegion(ulx, uly, brx, bry);
+      if (nbtask % m_nb_task_refresh == 0)
+        mhdri.FlushDirty(*p_image);
+      }
+
     // Save the image (every m_nb_task_refresh task units)
-    if (nbtask % m_nb_task_refresh == 0) {
+    } else if (nbtask % m_nb_task_refresh == 0) {
       // This is the same image data, so must be a critical section
 #     pragma omp critical
       parser.save(*p_image, camera->getOutputFilename());
     }
   
+  } 
   } // end of the OpenMP loop, do a last saving operation to ensure all the 
   // image is saved
-  parser.save(*p_image, camera->getOutputFilename());
+  if (incremental) {
+    exr.Close(*p_image);
+  } else if (checkpointed) {
+    mhdri.FlushDirty(*p_image, false);
+    mhdri.Close();
+  } else {
+    parser.save(*p_image, camera->getOutputFilename());
+  }
 
 //  // Private
 //  int h, w;
@@ -0,0 +1,189 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <core/taskmanager/TaskManagerCost.hpp>
+//!
+//! @file TaskManagerCost.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in TaskManagerCost.hpp
+//!  @arg TaskManagerCost
+//!
+#include <algorithm>
+#include <omp.h>
+
+#include <core/VrtLog.hpp>
+#include <core/Scenery.hpp>
+#include <core/Camera.hpp>
+#include <structures/LightVector.hpp>
+#include <exceptions/Exception.hpp>
+
+////////////////////////////// class TaskManagerCost ///////////////////////////
+TaskManagerCost::TaskManagerCost(void)
+    : p_scenery(NULL),
+      m_probe_step(kDEFAULT_PROBE_STEP),
+      m_split_ratio(kDEFAULT_SPLIT_RATIO) {}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+TaskManagerCost::~TaskManagerCost(void) {}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+void TaskManagerCost::SetAdditionalParameters(int idx, int value) {
+  // First parameter
+  if (idx == 0) {
+    m_probe_step = (value > 0) ? (unsigned int)value : 1;
+
+  // Second parameter
+  } else if (idx == 1) {
+    m_split_ratio = (value > 100) ? (unsigned int)value : 100;
+
+  // Bad number of parameters
+  } else {
+   throw Exception("(TaskManagerCost::SetAdditionalParameters) Nombre \
+incorrect de parametres");
+  }
+}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+void TaskManagerCost::SetCostMap(const std::vector<double>& cost) {
+  if (cost.size() != m_nb_tasks_per_width * m_nb_tasks_per_height)
+    throw Exception("(TaskManagerCost::SetCostMap) Taille de la carte de \
+couts incorrecte");
+  m_cost = cost;
+}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+void TaskManagerCost::EstimateCost(void) {
+  if (p_scenery == NULL)
+    throw Exception("(TaskManagerCost::EstimateCost) Aucune scene attachee");
+
+  Camera* camera = p_scenery->getCamera(0);
+  int nb_tiles = (int)(m_nb_tasks_per_width * m_nb_tasks_per_height);
+  m_cost.assign(nb_tiles, 0.0);
+
+  // Every tile traces a sparse grid of primary rays; the elapsed time is then
+  // extrapolated to the whole area of the tile
+  int t;
+# pragma omp parallel for private(t) schedule(dynamic, 1)
+  for (t = 0; t < nb_tiles; t++) {
+    unsigned int ulx, uly, brx, bry;
+    CreateAreaFromTask((unsigned int)t).Retrieve(ulx, uly, brx, bry);
+
+    unsigned int nb_probes = 0;
+    LightVector ray;
+    double start = omp_get_wtime();
+    unsigned int half = m_probe_step / 2;
+    for (unsigned int j = uly + half; j <= bry; j += m_probe_step) {
+      for (unsigned int i = ulx + half; i <= brx; i += m_probe_step) {
+        nb_probes++;
+        if (!camera->getRay(i, j, ray))
+          continue;
+        p_scenery->getRenderer()->CastRay(*p_scenery, ray);
+      }
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    // Small tiles may have been missed by the probe grid
+    if (nb_probes == 0) {
+      nb_probes = 1;
+      if (camera->getRay((ulx + brx) / 2, (uly + bry) / 2, ray))
+        p_scenery->getRenderer()->CastRay(*p_scenery, ray);
+      elapsed = omp_get_wtime() - start;
+    }
+
+    double area = double(brx - ulx + 1) * double(bry - uly + 1);
+    m_cost[t] = elapsed * area / double(nb_probes);
+  }
+}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+void TaskManagerCost::CreateTaskList(void) {
+  unsigned int nb_tiles = m_nb_tasks_per_width * m_nb_tasks_per_height;
+
+  if (m_cost.size() != nb_tiles)
+    EstimateCost();
+
+  // Split threshold
+  double mean = 0.0;
+  for (unsigned int t = 0; t < nb_tiles; t++)
+    mean += m_cost[t];
+  if (nb_tiles > 0)
+    mean /= double(nb_tiles);
+  double threshold = mean * double(m_split_ratio) / 100.0;
+
+  // Split the expensive task units
+  std::vector<CostTask> list;
+  list.reserve(nb_tiles);
+  for (unsigned int t = 0; t < nb_tiles; t++) {
+    CostTask task;
+    task.unit = CreateAreaFromTask(t);
+    task.cost = m_cost[t];
+    task.tile = t;
+
+    unsigned int n = 1;
+    if (threshold > 0.0 && task.cost > threshold)
+      n = (unsigned int)ceil(sqrt(task.cost / threshold));
+    SplitTask(task, n, list);
+  }
+
+  // Longest first
+  std::stable_sort(list.begin(), list.end(), MoreExpensive);
+
+  // Create the task array
+  EraseTasks();
+  m_nb_tasks = (unsigned int)list.size();
+  p_tasks = new TaskUnit[m_nb_tasks];
+  for (unsigned int i = 0; i < m_nb_tasks; i++)
+    p_tasks[i] = list[i].unit;
+
+  VrtLog::Write("(TaskManagerCost) %u task units from %u tiles (mean cost \
+%g s)", m_nb_tasks, nb_tiles, mean);
+}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+bool TaskManagerCost::MoreExpensive(const CostTask& a, const CostTask& b) {
+  if (a.cost != b.cost)
+    return a.cost > b.cost;
+  return a.tile < b.tile;
+}
+////////////////////////////// class TaskManagerCost ///////////////////////////
+void TaskManagerCost::SplitTask(const CostTask& task, unsigned int n,
+                                std::vector<CostTask>& list) {
+  unsigned int ulx, uly, brx, bry;
+  TaskUnit unit = task.unit;
+  unit.Retrieve(ulx, uly, brx, bry);
+  unsigned int w = brx - ulx + 1;
+  unsigned int h = bry - uly + 1;
+
+  // Do not create task units smaller than kMIN_SPLIT_SIZE
+  unsigned int nw = (n < w / kMIN_SPLIT_SIZE) ? n : w / kMIN_SPLIT_SIZE;
+  unsigned int nh = (n < h / kMIN_SPLIT_SIZE) ? n : h / kMIN_SPLIT_SIZE;
+  if (nw < 1) nw = 1;
+  if (nh < 1) nh = 1;
+
+  for (unsigned int y = 0; y < nh; y++) {
+    for (unsigned int x = 0; x < nw; x++) {
+      CostTask sub;
+      sub.unit.Define(ulx + (x * w) / nw, 
+                      uly + (y * h) / nh,
+                      ulx + ((x + 1) * w) / nw - 1, 
+                      uly + ((y + 1) * h) / nh - 1);
+      sub.cost = task.cost / double(nw * nh);
+      sub.tile = task.tile;
+      list.push_back(sub);
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -33,3 +33,22 @@ Environment::Environment(void) { }
 ////////////////////////////////////////////////////////////////////////////////
 Environment::~Environment(void) { }
 ////////////////////////////////////////////////////////////////////////////////
+void Environment::GetIncidentLight(const Point& receiver, 
+                                   const LightVector& reemited, 
+                                   std::vector<LightVector>& incidents) { }
+////////////////////////////////////////////////////////////////////////////////
+Real Environment::GetDensity(const Vector& direction) { 
+  return Real(0.0); 
+}
+////////////////////////////////////////////////////////////////////////////////
+unsigned int Environment::GetNbSamples(void) const { 
+  return 0; 
+}
+////////////////////////////////////////////////////////////////////////////////
+Real Environment::GetPower(const BoundingBox& bounds) { 
+  return Real(0.0); 
+}
+////////////////////////////////////////////////////////////////////////////////
+void Environment::GetRandomPhoton(const BoundingBox& bounds, 
+                                  MultispectralPhoton& photon) { }
+////////////////////////////////////////////////////////////////////////////////
@@ -29,15 +29,24 @@
 //! @todo 
 //! @remarks 
 //!
+#include <cmath>
+#include <cstdlib>
+
+#include <structures/MipMap.hpp>
+#include <structures/MultispectralPhoton.hpp>
 #include <structures/Texture.hpp>
 #include <structures/Spectrum.hpp>
 ////////////////////////////////////////////////////////////////////////////////
-SphericalEnvironment::SphericalEnvironment(Texture* envir, Real envir_power)
-    : p_environment(NULL), m_amount(0) {
+SphericalEnvironment::SphericalEnvironment(Texture* envir, Real envir_power,
+                                           unsigned int nb_samples)
+    : p_environment(NULL), m_amount(0), m_nb_samples(nb_samples), 
+      m_integral(0) {
 
   // WARNING : simple pointer affectation !
   p_environment = envir;
   m_amount = envir_power;
+
+  BuildDensity();
 }
 ////////////////////////////////////////////////////////////////////////////////
 SphericalEnvironment::~SphericalEnvironment(void) { 
@@ -84,22 +93,14 @@ void SphericalEnvironment::AddContribution(LightVector& lightdata) {
 ////////////////////////////////////////////////////////////////////////////////
 
   LightVector env(lightdata);
-  Vector view = lightdata.getRay().v;
-  Point origin = lightdata.getRay().o;
-
-  Real x = view.x();
-  Real y = view.y();
-  Real z = view.z();
-
-  Real m = sqrt ( x*x + y*y + (z+1)*(z+1) );
-  Real u = x / (2 * m) + 0.5f;
-  Real v = y / (2 * m) + 0.5f;
+  Real u, v;
+  GetCoordinates(lightdata.getRay().v, u, v);
   
   Spectrum Spix;
   p_environment->GetSpectrumValue(u, v, Spix);
 
   for(unsigned int i=0; i<lightdata.size(); i++)
-    env[i].setRadiance(m_amount * Spix[i]);
+    env[i].setRadiance(m_amount * Spix[env[i].getIndex()]);
 
   lightdata.add(env);
   
@@ -131,3 +132,205 @@ void SphericalEnvironment::AddContribution(LightVector& lightdata) {
   //}
 }
 ////////////////////////////////////////////////////////////////////////////////
+void SphericalEnvironment::GetIncidentLight(const Point& receiver, 
+                                            const LightVector& reemited, 
+                                            std::vector<LightVector>& incidents) {
+  if (m_density.IsEmpty())
+    return;
+
+  for (unsigned int s = 0; s < m_nb_samples; s++) {
+    Real u, v;
+    Vector direction;
+    Real density = SampleDirection(u, v, direction);
+    if (density <= 0)
+      continue;
+
+    // The ray goes from the environment to the receiver
+    LightVector lightdata;
+    lightdata.setRay(receiver, Vector(-direction[0], -direction[1], 
+                                      -direction[2]));
+    lightdata.initSpectralData(reemited);
+
+    Spectrum Spix;
+    p_environment->GetSpectrumValue(u, v, Spix);
+    Real factor = m_amount / (density * m_nb_samples);
+    for (unsigned int i = 0; i < lightdata.size(); i++)
+      lightdata[i].setRadiance(Spix[lightdata[i].getIndex()] * factor);
+
+    //Initialize the polarisation framework
+    if (direction[2] < 0.999 && direction[2] > -0.999)
+      lightdata.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
+    else
+      lightdata.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
+
+    incidents.push_back(lightdata);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+Real SphericalEnvironment::GetDensity(const Vector& direction) {
+  if (m_density.IsEmpty())
+    return Real(0.0);
+
+  // The mapping preserves the areas: 16 steradians per unit of texture area
+  Real u, v;
+  GetCoordinates(direction, u, v);
+  return m_density.GetDensity(u, v) / Real(16.0);
+}
+////////////////////////////////////////////////////////////////////////////////
+unsigned int SphericalEnvironment::GetNbSamples(void) const {
+  return m_density.IsEmpty() ? 0 : m_nb_samples;
+}
+////////////////////////////////////////////////////////////////////////////////
+Real SphericalEnvironment::GetPower(const BoundingBox& bounds) {
+  // Light crossing the disk of the bounding sphere, summed over the 
+  // wavelengths (as the power of the sources)
+  Vector diagonal(bounds.min, bounds.max);
+  Real radius = Real(0.5) * diagonal.norm();
+  return Real(M_PI) * radius * radius * m_integral 
+       * GlobalSpectrum::nbWaveLengths();
+}
+////////////////////////////////////////////////////////////////////////////////
+void SphericalEnvironment::GetRandomPhoton(const BoundingBox& bounds, 
+                                           MultispectralPhoton& photon) {
+  Vector diagonal(bounds.min, bounds.max);
+  Real radius = Real(0.5) * diagonal.norm();
+
+  // Direction (the few coordinates outside of the sphere map are drawn again)
+  Real u, v;
+  Vector direction;
+  Real density = 0;
+  for (unsigned int attempt = 0; attempt < 16 && density <= 0 
+       && !m_density.IsEmpty(); attempt++)
+    density = SampleDirection(u, v, direction);
+
+  // No direction: a black photon leaving the scenery
+  if (density <= 0 || m_integral <= 0) {
+    for (unsigned int i = 0; i < 3; i++) {
+      photon.position[i] = bounds.center[i] + ((i == 2) ? 2 * radius : 0);
+      photon.direction[i] = (i == 2) ? Real(1.0) : Real(0.0);
+    }
+    for (unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+      photon.radiance[i] = 0;
+    return;
+  }
+
+  // Position on the disk of the bounding sphere facing the direction
+  Vector t1 = (std::fabs(direction[0]) < Real(0.9)) 
+            ? Vector(1.0, 0.0, 0.0) : Vector(0.0, 1.0, 0.0);
+  t1 = t1.vect(direction);
+  t1.normalize();
+  Vector t2 = direction.vect(t1);
+  Real r = radius * std::sqrt(rand() / (Real)RAND_MAX);
+  Real phi = Real(2.0 * M_PI) * rand() / (Real)RAND_MAX;
+  Real a = r * std::cos(phi);
+  Real b = r * std::sin(phi);
+  for (unsigned int i = 0; i < 3; i++) {
+    photon.position[i] = bounds.center[i] + radius * direction[i] 
+                       + a * t1[i] + b * t2[i];
+    photon.direction[i] = -direction[i];
+  }
+
+  // The sum of the radiances over the wavelengths is 1 on average, as for
+  // the photons of the sources (see GetPower)
+  Spectrum Spix;
+  p_environment->GetSpectrumValue(u, v, Spix);
+  Real factor = m_amount 
+              / (density * m_integral * GlobalSpectrum::nbWaveLengths());
+  for (unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+    photon.radiance[i] = Spix[i] * factor;
+}
+////////////////////////////////////////////////////////////////////////////////
+void SphericalEnvironment::BuildDensity(void) {
+  if (p_environment == NULL || p_environment->GetMipMap() == NULL)
+    return;
+
+  // Grid of the first level of the pyramid small enough
+  const MipMap* mipmap = p_environment->GetMipMap();
+  unsigned int level = 0;
+  while (level + 1 < mipmap->GetNbLevels() 
+         && (mipmap->GetWidth(level) > kMAX_DENSITY_SIZE 
+             || mipmap->GetHeight(level) > kMAX_DENSITY_SIZE))
+    level++;
+  unsigned int width = mipmap->GetWidth(level);
+  unsigned int height = mipmap->GetHeight(level);
+  Real filter_width = Real(1 << level);
+
+  // Mean radiance of the wavelengths at the center of the cells
+  std::vector<Real> radiances((size_t)width * height, Real(0.0));
+  Spectrum Spix;
+  double integral = 0;
+  for (unsigned int y = 0; y < height; y++) {
+    for (unsigned int x = 0; x < width; x++) {
+      Real u = (x + Real(0.5)) / width;
+      Real v = (y + Real(0.5)) / height;
+      Vector direction;
+      if (!GetDirection(u, v, direction))
+        continue;
+      p_environment->GetSpectrumValue(u, v, Spix, Texture::REPEAT_OFF, 
+                                      Texture::REPEAT_OFF, filter_width);
+      Real mean = 0;
+      for (unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+        mean += Spix[i];
+      mean *= m_amount / GlobalSpectrum::nbWaveLengths();
+      radiances[(size_t)y * width + x] = (mean > 0) ? mean : Real(0.0);
+      integral += radiances[(size_t)y * width + x];
+    }
+  }
+  m_integral = (Real)(integral * 16.0 / ((double)width * height));
+  if (m_integral <= 0)
+    return;
+
+  // The lookups are interpolated: each cell takes the largest radiance of its
+  // neighbors, so that the density is never 0 where the radiance is not
+  std::vector<Real> weights(radiances.size());
+  for (unsigned int y = 0; y < height; y++) {
+    for (unsigned int x = 0; x < width; x++) {
+      Real weight = 0;
+      for (unsigned int ny = (y > 0 ? y - 1 : 0); 
+           ny <= y + 1 && ny < height; ny++) {
+        for (unsigned int nx = (x > 0 ? x - 1 : 0); 
+             nx <= x + 1 && nx < width; nx++) {
+          if (radiances[(size_t)ny * width + nx] > weight)
+            weight = radiances[(size_t)ny * width + nx];
+        }
+      }
+      weights[(size_t)y * width + x] = weight;
+    }
+  }
+  m_density.Build(&weights[0], width, height);
+}
+////////////////////////////////////////////////////////////////////////////////
+void SphericalEnvironment::GetCoordinates(const Vector& direction, 
+                                          Real& u, Real& v) {
+  Real x = direction.x();
+  Real y = direction.y();
+  Real z = direction.z();
+
+  Real m = sqrt ( x*x + y*y + (z+1)*(z+1) );
+  u = x / (2 * m) + 0.5f;
+  v = y / (2 * m) + 0.5f;
+}
+////////////////////////////////////////////////////////////////////////////////
+bool SphericalEnvironment::GetDirection(Real u, Real v, Vector& direction) {
+  // Inverse of GetCoordinates: a point at the distance r of the center of the
+  // disk (of radius 1) maps to z = 1 - 2 r^2
+  Real a = 2 * u - 1;
+  Real b = 2 * v - 1;
+  Real r2 = a * a + b * b;
+  if (r2 > 1)
+    return false;
+
+  Real m = 2 * std::sqrt(1 - r2);
+  direction = Vector(a * m, b * m, 1 - 2 * r2);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+Real SphericalEnvironment::SampleDirection(Real& u, Real& v, 
+                                           Vector& direction) const {
+  Real density = m_density.Sample(rand() / (Real)RAND_MAX, 
+                                  rand() / (Real)RAND_MAX, u, v);
+  if (!GetDirection(u, v, direction))
+    return Real(0.0);
+  return density / Real(16.0);
+}
+////////////////////////////////////////////////////////////////////////////////
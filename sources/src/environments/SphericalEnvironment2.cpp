@@ -30,12 +30,11 @@
 //! @remarks 
 //!
 #include <structures/Texture.hpp>
-#include <structures/Spectrum.hpp>
 ////////////////////////////////////////////////////////////////////////////////
-SphericalEnvironment2::SphericalEnvironment2(const char* file, Real envir_power)
-  : m_amount(0) {
-
-  // WARNING : simple pointer affectation !
+SphericalEnvironment2::SphericalEnvironment2(const char* file, Real envir_power,
+                                             unsigned int nb_samples)
+  : SphericalEnvironment(LoadTexture(file), envir_power, nb_samples), 
+    m_amount(0) {
   m_file = file;
   m_amount = envir_power;
 }
@@ -43,28 +42,16 @@ SphericalEnvironment2::SphericalEnvironment2(const char* file, Real envir_power)
 SphericalEnvironment2::~SphericalEnvironment2(void) { 
 }
 ////////////////////////////////////////////////////////////////////////////////
-void SphericalEnvironment2::AddContribution(LightVector& lightdata) {
-  if (m_file.empty() == true)
-    return;
-
-  LightVector env(lightdata);
-  //Vector view = lightdata.getRay().v;
-  //Point origin = lightdata.getRay().o;
-
-  //Real x = view.x();
-  //Real y = view.y();
-  //Real z = view.z();
-
-  //Real m = sqrt ( x*x + y*y + (z+1)*(z+1) );
-  //Real u = x / (2 * m) + 0.5f;
-  //Real v = y / (2 * m) + 0.5f;
-  //
-  //Spectrum Spix;
-  // p_environment->GetSpectrumValue(u, v, Spix);
-
-  //for(unsigned int i=0; i<lightdata.size(); i++)
-  //  env[i].setRadiance(m_amount * Spix[i]);
-
-  lightdata.add(env);
+Texture* SphericalEnvironment2::LoadTexture(const char* file) {
+  // The texture is owned (and freed) by SphericalEnvironment
+  Texture* texture = new Texture();
+  try {
+    texture->SetImage(file);
+  } catch (...) {
+    delete texture;
+    throw;
+  }
+  texture->SetTextureName(file);
+  return texture;
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/MappedFile.hpp>
+//!
+//! @file MappedFile.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in MappedFile.hpp
+//!  @arg MappedFile
+//!
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include <exceptions/Exception.hpp>
+////////////////////////////// class MappedFile ////////////////////////////////
+MappedFile::MappedFile(void)
+    : p_data(NULL),
+      m_size(0),
+#ifdef _WIN32
+      p_file(INVALID_HANDLE_VALUE),
+      p_mapping(NULL) {
+#else
+      m_fd(-1) {
+#endif
+}
+////////////////////////////// class MappedFile ////////////////////////////////
+MappedFile::~MappedFile(void) {
+  Close();
+}
+////////////////////////////// class MappedFile ////////////////////////////////
+void MappedFile::Open(const std::string& filename) {
+  Close();
+
+#ifdef _WIN32
+  p_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (p_file == INVALID_HANDLE_VALUE) {
+    throw Exception("(MappedFile::Open) Ouverture du fichier " 
+                    + filename + " impossible.");
+  }
+  LARGE_INTEGER size;
+  GetFileSizeEx(p_file, &size);
+  m_size = (size_t)size.QuadPart;
+  if (m_size == 0)
+    return;
+
+  p_mapping = CreateFileMappingA(p_file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (p_mapping != NULL)
+    p_data = (const char*)MapViewOfFile(p_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+  m_fd = open(filename.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    throw Exception("(MappedFile::Open) Ouverture du fichier " 
+                    + filename + " impossible.");
+  }
+  struct stat status;
+  fstat(m_fd, &status);
+  m_size = (size_t)status.st_size;
+  if (m_size == 0)
+    return;
+
+  void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (data != MAP_FAILED) {
+    p_data = (const char*)data;
+    // The file is read from the beginning to the end
+    madvise(data, m_size, MADV_SEQUENTIAL);
+  }
+#endif
+
+  if (p_data == NULL) {
+    Close();
+    throw Exception("(MappedFile::Open) Projection en memoire du fichier " 
+                    + filename + " impossible.");
+  }
+}
+////////////////////////////// class MappedFile ////////////////////////////////
+void MappedFile::Close(void) {
+#ifdef _WIN32
+  if (p_data != NULL)
+    UnmapViewOfFile(p_data);
+  if (p_mapping != NULL)
+    CloseHandle(p_mapping);
+  if (p_file != INVALID_HANDLE_VALUE)
+    CloseHandle(p_file);
+  p_mapping = NULL;
+  p_file = INVALID_HANDLE_VALUE;
+#else
+  if (p_data != NULL)
+    munmap((void*)p_data, m_size);
+  if (m_fd >= 0)
+    close(m_fd);
+  m_fd = -1;
+#endif
+  p_data = NULL;
+  m_size = 0;
+}
+////////////////////////////////////////////////////////////////////////////////
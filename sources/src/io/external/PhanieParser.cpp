@@ -55,6 +55,22 @@
 
 #include <core/VrtLog.hpp>
 #include <exceptions/Exception.hpp>
+#include <io/mesh/MeshParser.hpp>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+//! Append a flat triangle to a mesh
+void AddTriangle(const Point vertices[3], const Point2D texcoords[3],
+                 MeshData& data) {
+  for (int k = 0; k < 3; k++) {
+    data.vertex_indices.push_back((unsigned int)data.vertices.size());
+    data.texcoord_indices.push_back((unsigned int)data.texcoords.size());
+    data.normal_indices.push_back((unsigned int)MeshData::kNO_INDEX);
+    data.vertices.push_back(vertices[k]);
+    data.texcoords.push_back(texcoords[k]);
+  }
+}
+} // namespace
 ////////////////////////////// class PhanieParser //////////////////////////////
 bool PhanieParser::LoadPhanie(std::string filename, 
                               std::vector<Object*>& objects,
@@ -173,7 +189,7 @@ bool PhanieParser::LoadPhanie(std::string filename,
       nb_faces = atoi(value.c_str());
       VrtLog::Write("Number of faces to come: %d", nb_faces);
       // Fill the list of triangles
-      std::vector<Triangle> triangle_list;
+      MeshData triangle_list;
       for (int i = 0; i < nb_faces; i++) {
         // Get the type of face
         input >> word;
@@ -198,9 +214,7 @@ bool PhanieParser::LoadPhanie(std::string filename,
             t[2][0] = Real(1); t[2][1] = Real(1);
           }
 
-          Triangle tri_1(v, t);
-          triangle_list.push_back(tri_1);
-          tri_1.Print();
+          AddTriangle(v, t, triangle_list);
 
         // Quad : must be triangulated         
         } else if (word.compare("Q") == 0) {
@@ -230,13 +244,9 @@ bool PhanieParser::LoadPhanie(std::string filename,
             t_2[2][0] = Real(1); t_2[2][1] = Real(1);
           }
           // Fill first triangle
-          Triangle tri_1(v_1, t_1);
-          triangle_list.push_back(tri_1);
-          tri_1.Print();
+          AddTriangle(v_1, t_1, triangle_list);
           // Fille second triangle
-          Triangle tri_2(v_2, t_2);
-          triangle_list.push_back(tri_2);
-          tri_2.Print();
+          AddTriangle(v_2, t_2, triangle_list);
 
           // Error case 
         } else {
@@ -246,9 +256,8 @@ bool PhanieParser::LoadPhanie(std::string filename,
       } // end of face loop
       
       // Create shape
-      ObjectShape* current_shape = new Mesh(&triangle_list[0], 
-                                            triangle_list.size());
-      triangle_list.clear();
+      MeshParser mesh_parser;
+      ObjectShape* current_shape = mesh_parser.buildMesh(triangle_list, false);
       
       // Case: Object => new Object
       if (layer_type == 1) {
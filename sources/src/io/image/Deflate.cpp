@@ -0,0 +1,216 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/image/Deflate.hpp>
+//!
+//! @file Deflate.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in Deflate.hpp
+//!  @arg Deflate
+//!
+namespace {
+//! Size of the LZ77 window
+const unsigned int kWINDOW_SIZE = 32768;
+//! Number of bits of the hash of a 3-byte sequence
+const unsigned int kHASH_BITS = 15;
+//! Maximal number of candidates visited in a hash chain
+const unsigned int kMAX_CHAIN = 64;
+//! Shortest and longest matches
+const unsigned int kMIN_MATCH = 3;
+const unsigned int kMAX_MATCH = 258;
+//! Base lengths of the length symbols 257..285
+const unsigned short kLENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+//! Extra bits of the length symbols 257..285
+const unsigned char kLENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+//! Base distances of the distance symbols 0..29
+const unsigned short kDIST_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577 };
+//! Extra bits of the distance symbols 0..29
+const unsigned char kDIST_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Hash3(const unsigned char* p) {
+  unsigned int h = (unsigned int)p[0] << 16 | (unsigned int)p[1] << 8 | p[2];
+  return (h * 2654435761u) >> (32 - kHASH_BITS);
+}
+} // namespace
+////////////////////////////// class Deflate::BitWriter ////////////////////////
+Deflate::BitWriter::BitWriter(std::vector<unsigned char>& out)
+    : m_out(out),
+      m_bits(0),
+      m_nb_bits(0) {}
+////////////////////////////// class Deflate::BitWriter ////////////////////////
+void Deflate::BitWriter::PutBits(unsigned int value, int nb) {
+  m_bits |= value << m_nb_bits;
+  m_nb_bits += nb;
+  while (m_nb_bits >= 8) {
+    m_out.push_back((unsigned char)(m_bits & 0xff));
+    m_bits >>= 8;
+    m_nb_bits -= 8;
+  }
+}
+////////////////////////////// class Deflate::BitWriter ////////////////////////
+void Deflate::BitWriter::PutCode(unsigned int code, int nb) {
+  unsigned int reversed = 0;
+  for (int i = 0; i < nb; i++) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  PutBits(reversed, nb);
+}
+////////////////////////////// class Deflate::BitWriter ////////////////////////
+void Deflate::BitWriter::Flush(void) {
+  if (m_nb_bits > 0)
+    m_out.push_back((unsigned char)(m_bits & 0xff));
+  m_bits = 0;
+  m_nb_bits = 0;
+}
+////////////////////////////// class Deflate ///////////////////////////////////
+void Deflate::PutSymbol(BitWriter& writer, unsigned int symbol) {
+  if (symbol < 144)
+    writer.PutCode(0x30 + symbol, 8);
+  else if (symbol < 256)
+    writer.PutCode(0x190 + symbol - 144, 9);
+  else if (symbol < 280)
+    writer.PutCode(symbol - 256, 7);
+  else
+    writer.PutCode(0xc0 + symbol - 280, 8);
+}
+////////////////////////////// class Deflate ///////////////////////////////////
+void Deflate::PutMatch(BitWriter& writer, unsigned int length,
+                       unsigned int distance) {
+  int l = 28;
+  while (kLENGTH_BASE[l] > length)
+    l--;
+  PutSymbol(writer, 257 + l);
+  if (kLENGTH_EXTRA[l] > 0)
+    writer.PutBits(length - kLENGTH_BASE[l], kLENGTH_EXTRA[l]);
+
+  int d = 29;
+  while (kDIST_BASE[d] > distance)
+    d--;
+  writer.PutCode(d, 5);
+  if (kDIST_EXTRA[d] > 0)
+    writer.PutBits(distance - kDIST_BASE[d], kDIST_EXTRA[d]);
+}
+////////////////////////////// class Deflate ///////////////////////////////////
+unsigned int Deflate::Adler32(const unsigned char* data, size_t size) {
+  unsigned int a = 1, b = 0;
+  while (size > 0) {
+    // 5552 is the largest block for which b cannot overflow
+    size_t block = (size < 5552) ? size : 5552;
+    size -= block;
+    while (block-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+////////////////////////////// class Deflate ///////////////////////////////////
+void Deflate::Compress(const unsigned char* data, size_t size,
+                       std::vector<unsigned char>& out) {
+  out.clear();
+  out.reserve(size / 2 + 64);
+
+  // zlib header: deflate, 32K window, fastest level
+  out.push_back(0x78);
+  out.push_back(0x01);
+
+  // One final block with fixed Huffman codes
+  BitWriter writer(out);
+  writer.PutBits(1, 1);
+  writer.PutBits(1, 2);
+
+  // Hash chains
+  std::vector<int> head(1 << kHASH_BITS, -1);
+  std::vector<int> prev(kWINDOW_SIZE, -1);
+
+  size_t pos = 0;
+  while (pos < size) {
+    unsigned int best_len = 0;
+    unsigned int best_dist = 0;
+
+    if (pos + kMIN_MATCH <= size) {
+      unsigned int h = Hash3(&data[pos]);
+      int candidate = head[h];
+      unsigned int max_len = (size - pos < kMAX_MATCH)
+                           ? (unsigned int)(size - pos) : kMAX_MATCH;
+
+      for (unsigned int chain = 0;
+           candidate >= 0 && chain < kMAX_CHAIN; chain++) {
+        size_t dist = pos - (size_t)candidate;
+        if (dist > kWINDOW_SIZE)
+          break;
+        unsigned int len = 0;
+        while (len < max_len && data[candidate + len] == data[pos + len])
+          len++;
+        if (len > best_len) {
+          best_len = len;
+          best_dist = (unsigned int)dist;
+          if (len == max_len)
+            break;
+        }
+        candidate = prev[candidate & (kWINDOW_SIZE - 1)];
+      }
+      prev[pos & (kWINDOW_SIZE - 1)] = head[h];
+      head[h] = (int)pos;
+    }
+
+    if (best_len >= kMIN_MATCH) {
+      PutMatch(writer, best_len, best_dist);
+      // Insert the positions covered by the match in the hash chains
+      for (size_t p = pos + 1; p < pos + best_len; p++) {
+        if (p + kMIN_MATCH > size)
+          break;
+        unsigned int h = Hash3(&data[p]);
+        prev[p & (kWINDOW_SIZE - 1)] = head[h];
+        head[h] = (int)p;
+      }
+      pos += best_len;
+    } else {
+      PutSymbol(writer, data[pos]);
+      pos++;
+    }
+  }
+
+  // End of block
+  PutSymbol(writer, 256);
+  writer.Flush();
+
+  // zlib trailer (big endian)
+  unsigned int adler = Adler32(data, size);
+  out.push_back((unsigned char)(adler >> 24));
+  out.push_back((unsigned char)(adler >> 16));
+  out.push_back((unsigned char)(adler >> 8));
+  out.push_back((unsigned char)(adler));
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,527 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/image/EXRImageParser.hpp>
+//!
+//! @file EXRImageParser.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in EXRImageParser.hpp
+//!  @arg EXRImageParser
+//!
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <set>
+
+#include <io/image/Deflate.hpp>
+#include <io/FileOffset.hpp>
+#include <exceptions/Exception.hpp>
+
+namespace {
+//! Number of chunks encoded in parallel before being written
+const unsigned int kCHUNK_BATCH = 256;
+////////////////////////////////////////////////////////////////////////////////
+inline void PutByte(std::vector<unsigned char>& out, unsigned char value) {
+  out.push_back(value);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutInt(std::vector<unsigned char>& out, unsigned int value) {
+  out.push_back((unsigned char)(value));
+  out.push_back((unsigned char)(value >> 8));
+  out.push_back((unsigned char)(value >> 16));
+  out.push_back((unsigned char)(value >> 24));
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutFloat(std::vector<unsigned char>& out, float value) {
+  unsigned int bits;
+  memcpy(&bits, &value, sizeof(float));
+  PutInt(out, bits);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutString(std::vector<unsigned char>& out, const std::string& s) {
+  out.insert(out.end(), s.begin(), s.end());
+  out.push_back(0);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutAttribute(std::vector<unsigned char>& out,
+                         const std::string& name, const std::string& type,
+                         unsigned int size) {
+  PutString(out, name);
+  PutString(out, type);
+  PutInt(out, size);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void WriteOffset(FILE* file, long long table_pos, unsigned int idx,
+                        unsigned long long offset) {
+  unsigned char bytes[8];
+  for (int b = 0; b < 8; b++)
+    bytes[b] = (unsigned char)(offset >> (8 * b));
+  FileOffset::Seek(file, table_pos + 8 * (long long)idx, SEEK_SET);
+  fwrite(bytes, 1, 8, file);
+}
+////////////////////////////////////////////////////////////////////////////////
+struct ChannelSort {
+  const std::vector<std::string>* names;
+  bool operator()(unsigned int a, unsigned int b) const {
+    return (*names)[a] < (*names)[b];
+  }
+};
+} // namespace
+////////////////////////////// class EXRImageParser ///////////////////////////
+EXRImageParser::EXRImageParser(int compression, int pixel_type)
+    : m_compression(compression),
+      m_pixel_type(pixel_type),
+      p_file(NULL),
+      m_tile_width(0),
+      m_tile_height(0),
+      m_nb_tiles_x(0),
+      m_nb_tiles_y(0),
+      m_table_pos(0) {}
+////////////////////////////// class EXRImageParser ///////////////////////////
+EXRImageParser::~EXRImageParser(void) {
+  if (p_file != NULL) {
+    fclose(p_file);
+    p_file = NULL;
+  }
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::save(Image& image, std::string filename) {
+  PrepareChannels(image);
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == NULL)
+    throw Exception("(EXRImageParser::save) Echec de la sauvegarde du \
+fichier " + filename);
+
+  // Header and empty offset table
+  std::vector<unsigned char> header;
+  BuildHeader(image, false, header);
+  fwrite(&header[0], 1, header.size(), file);
+  long long table_pos = FileOffset::Tell(file);
+
+  unsigned int lines = LinesPerChunk();
+  unsigned int nb_chunks = (image.getHeight() + lines - 1) / lines;
+  std::vector<unsigned char> table(8 * nb_chunks, 0);
+  if (nb_chunks > 0)
+    fwrite(&table[0], 1, table.size(), file);
+
+  // Chunks are encoded in parallel, then written in order
+  std::vector< std::vector<unsigned char> > batch(kCHUNK_BATCH);
+  std::vector<unsigned long long> offsets(nb_chunks, 0);
+  for (unsigned int first = 0; first < nb_chunks; first += kCHUNK_BATCH) {
+    int nb = (int)std::min(kCHUNK_BATCH, nb_chunks - first);
+    int c;
+#   pragma omp parallel for private(c) schedule(dynamic, 1)
+    for (c = 0; c < nb; c++) {
+      unsigned int y = (first + c) * lines;
+      unsigned int h = std::min(lines, image.getHeight() - y);
+      EncodeBlock(image, 0, y, image.getWidth(), h, batch[c]);
+    }
+
+    for (c = 0; c < nb; c++) {
+      std::vector<unsigned char> chunk_header;
+      PutInt(chunk_header, (first + c) * lines);
+      PutInt(chunk_header, (unsigned int)batch[c].size());
+      offsets[first + c] = (unsigned long long)FileOffset::Tell(file);
+      fwrite(&chunk_header[0], 1, chunk_header.size(), file);
+      if (!batch[c].empty())
+        fwrite(&batch[c][0], 1, batch[c].size(), file);
+    }
+  }
+
+  // Offset table
+  for (unsigned int c = 0; c < nb_chunks; c++)
+    WriteOffset(file, table_pos, c, offsets[c]);
+
+  if (ferror(file)) {
+    fclose(file);
+    throw Exception("(EXRImageParser::save) Echec de la sauvegarde du \
+fichier " + filename);
+  }
+  fclose(file);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::Open(Image& image, const std::string& filename,
+                          unsigned int tile_width, unsigned int tile_height) {
+  if (p_file != NULL)
+    Close(image);
+
+  PrepareChannels(image);
+  m_filename = filename;
+  m_tile_width = (tile_width > 0) ? tile_width : 64;
+  m_tile_height = (tile_height > 0) ? tile_height : 64;
+  m_nb_tiles_x = (image.getWidth() + m_tile_width - 1) / m_tile_width;
+  m_nb_tiles_y = (image.getHeight() + m_tile_height - 1) / m_tile_height;
+  m_coverage.assign(m_nb_tiles_x * m_nb_tiles_y, 0);
+  m_written.assign(m_nb_tiles_x * m_nb_tiles_y, false);
+
+  p_file = fopen(filename.c_str(), "wb+");
+  if (p_file == NULL)
+    throw Exception("(EXRImageParser::Open) Echec de la creation du \
+fichier " + filename);
+
+  // Header and offset table; missing tiles keep a null offset, which lets
+  // readers reconstruct the table of an interrupted rendering
+  std::vector<unsigned char> header;
+  BuildHeader(image, true, header);
+  fwrite(&header[0], 1, header.size(), p_file);
+  m_table_pos = FileOffset::Tell(p_file);
+  std::vector<unsigned char> table(8 * m_coverage.size(), 0);
+  if (!table.empty())
+    fwrite(&table[0], 1, table.size(), p_file);
+  fflush(p_file);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::WriteRegion(Image& image,
+                                 unsigned int ulx, unsigned int uly,
+                                 unsigned int brx, unsigned int bry) {
+  if (p_file == NULL)
+    return;
+  if (brx >= image.getWidth()) brx = image.getWidth() - 1;
+  if (bry >= image.getHeight()) bry = image.getHeight() - 1;
+  if (ulx > brx || uly > bry)
+    return;
+
+  for (unsigned int ty = uly / m_tile_height; ty <= bry / m_tile_height; ty++) {
+    for (unsigned int tx = ulx / m_tile_width; tx <= brx / m_tile_width; tx++) {
+      unsigned int tile = ty * m_nb_tiles_x + tx;
+      if (m_written[tile])
+        continue;
+
+      // Overlap between the rendered area and the tile
+      unsigned int x0 = std::max(ulx, tx * m_tile_width);
+      unsigned int y0 = std::max(uly, ty * m_tile_height);
+      unsigned int x1 = std::min(brx, (tx + 1) * m_tile_width - 1);
+      unsigned int y1 = std::min(bry, (ty + 1) * m_tile_height - 1);
+      m_coverage[tile] += (x1 - x0 + 1) * (y1 - y0 + 1);
+
+      // Size of the tile (clipped to the image)
+      unsigned int w = std::min(m_tile_width,
+                                image.getWidth() - tx * m_tile_width);
+      unsigned int h = std::min(m_tile_height,
+                                image.getHeight() - ty * m_tile_height);
+      if (m_coverage[tile] >= w * h)
+        WriteTile(image, tile);
+    }
+  }
+  fflush(p_file);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::Close(Image& image) {
+  if (p_file == NULL)
+    return;
+
+  // Areas that have not been rendered are written as they are in the image
+  for (unsigned int tile = 0; tile < m_written.size(); tile++) {
+    if (!m_written[tile])
+      WriteTile(image, tile);
+  }
+
+  bool failed = (ferror(p_file) != 0);
+  fclose(p_file);
+  p_file = NULL;
+  if (failed)
+    throw Exception("(EXRImageParser::Close) Echec de la sauvegarde du \
+fichier " + m_filename);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::WriteTile(Image& image, unsigned int tile) {
+  unsigned int tx = tile % m_nb_tiles_x;
+  unsigned int ty = tile / m_nb_tiles_x;
+  unsigned int x = tx * m_tile_width;
+  unsigned int y = ty * m_tile_height;
+  unsigned int w = std::min(m_tile_width, image.getWidth() - x);
+  unsigned int h = std::min(m_tile_height, image.getHeight() - y);
+
+  std::vector<unsigned char> data;
+  EncodeBlock(image, x, y, w, h, data);
+
+  // Tile coordinates, level (one level only) and data
+  std::vector<unsigned char> chunk_header;
+  PutInt(chunk_header, tx);
+  PutInt(chunk_header, ty);
+  PutInt(chunk_header, 0);
+  PutInt(chunk_header, 0);
+  PutInt(chunk_header, (unsigned int)data.size());
+
+  FileOffset::Seek(p_file, 0, SEEK_END);
+  unsigned long long offset = (unsigned long long)FileOffset::Tell(p_file);
+  fwrite(&chunk_header[0], 1, chunk_header.size(), p_file);
+  if (!data.empty())
+    fwrite(&data[0], 1, data.size(), p_file);
+  WriteOffset(p_file, m_table_pos, tile, offset);
+  FileOffset::Seek(p_file, 0, SEEK_END);
+
+  m_written[tile] = true;
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::PrepareChannels(Image& image) {
+  unsigned int nb = image.getNumberOfChannels();
+  m_channel_names.resize(nb);
+
+  // Names must be non-empty and unique
+  std::set<std::string> used;
+  for (unsigned int c = 0; c < nb; c++) {
+    std::string name = image.getChannelName(c);
+    size_t end = name.find_last_not_of(" \t\r\n");
+    name = (end == std::string::npos) ? "" : name.substr(0, end + 1);
+    if (name.empty() || used.find(name) != used.end()) {
+      std::ostringstream oss;
+      oss << "channel" << c;
+      name = oss.str();
+    }
+    used.insert(name);
+    m_channel_names[c] = name;
+  }
+
+  // The channel list of an EXR file is sorted by name
+  m_channel_order.resize(nb);
+  for (unsigned int c = 0; c < nb; c++)
+    m_channel_order[c] = c;
+  ChannelSort sort;
+  sort.names = &m_channel_names;
+  std::sort(m_channel_order.begin(), m_channel_order.end(), sort);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::BuildHeader(Image& image, bool tiled,
+                                 std::vector<unsigned char>& header) {
+  header.clear();
+
+  // Magic number and version (single part, tiled and long names flags)
+  unsigned int version = 2;
+  if (tiled)
+    version |= 0x200;
+  for (unsigned int c = 0; c < m_channel_names.size(); c++) {
+    if (m_channel_names[c].size() > 31)
+      version |= 0x400;
+  }
+  PutInt(header, 20000630);
+  PutInt(header, version);
+
+  // Channels
+  unsigned int chlist_size = 1;
+  for (unsigned int c = 0; c < m_channel_order.size(); c++)
+    chlist_size += (unsigned int)m_channel_names[m_channel_order[c]].size()
+                 + 1 + 16;
+  PutAttribute(header, "channels", "chlist", chlist_size);
+  for (unsigned int c = 0; c < m_channel_order.size(); c++) {
+    PutString(header, m_channel_names[m_channel_order[c]]);
+    PutInt(header, m_pixel_type);
+    PutByte(header, 0);             // pLinear
+    PutByte(header, 0);             // reserved
+    PutByte(header, 0);
+    PutByte(header, 0);
+    PutInt(header, 1);              // xSampling
+    PutInt(header, 1);              // ySampling
+  }
+  PutByte(header, 0);
+
+  PutAttribute(header, "compression", "compression", 1);
+  PutByte(header, (unsigned char)m_compression);
+
+  PutAttribute(header, "dataWindow", "box2i", 16);
+  PutInt(header, 0);
+  PutInt(header, 0);
+  PutInt(header, image.getWidth() - 1);
+  PutInt(header, image.getHeight() - 1);
+
+  PutAttribute(header, "displayWindow", "box2i", 16);
+  PutInt(header, 0);
+  PutInt(header, 0);
+  PutInt(header, image.getWidth() - 1);
+  PutInt(header, image.getHeight() - 1);
+
+  // Tiles are written in the order they are rendered
+  PutAttribute(header, "lineOrder", "lineOrder", 1);
+  PutByte(header, tiled ? 2 : 0);
+
+  PutAttribute(header, "pixelAspectRatio", "float", 4);
+  PutFloat(header, 1.0f);
+
+  PutAttribute(header, "screenWindowCenter", "v2f", 8);
+  PutFloat(header, 0.0f);
+  PutFloat(header, 0.0f);
+
+  PutAttribute(header, "screenWindowWidth", "float", 4);
+  PutFloat(header, 1.0f);
+
+  if (tiled) {
+    PutAttribute(header, "tiles", "tiledesc", 9);
+    PutInt(header, m_tile_width);
+    PutInt(header, m_tile_height);
+    PutByte(header, 0);             // ONE_LEVEL, ROUND_DOWN
+  }
+
+  // End of header
+  PutByte(header, 0);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::EncodeBlock(Image& image, unsigned int x, unsigned int y,
+                                 unsigned int w, unsigned int h,
+                                 std::vector<unsigned char>& data) {
+  unsigned int nb = image.getNumberOfChannels();
+  unsigned int value_size = (m_pixel_type == kHALF) ? 2 : 4;
+  const float* raster = image.getRaster();
+
+  // Raw data: for each scanline, all the values of each channel
+  std::vector<unsigned char> raw;
+  raw.reserve((size_t)w * h * nb * value_size);
+  for (unsigned int j = y; j < y + h; j++) {
+    const float* row = &raster[((size_t)j * image.getWidth() + x) * nb];
+    for (unsigned int c = 0; c < nb; c++) {
+      unsigned int channel = m_channel_order[c];
+      for (unsigned int i = 0; i < w; i++) {
+        float value = row[i * nb + channel];
+        if (m_pixel_type == kHALF) {
+          unsigned short half = FloatToHalf(value);
+          raw.push_back((unsigned char)(half));
+          raw.push_back((unsigned char)(half >> 8));
+        } else {
+          PutFloat(raw, value);
+        }
+      }
+    }
+  }
+
+  if (m_compression == kNO_COMPRESSION || raw.empty()) {
+    data.swap(raw);
+    return;
+  }
+
+  std::vector<unsigned char> predicted;
+  Predict(raw, predicted);
+  if (m_compression == kRLE_COMPRESSION)
+    RunLength(predicted, data);
+  else
+    Deflate::Compress(&predicted[0], predicted.size(), data);
+
+  // Data that do not compress are stored as they are
+  if (data.size() >= raw.size())
+    data.swap(raw);
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+unsigned int EXRImageParser::LinesPerChunk(void) const {
+  return (m_compression == kZIP_COMPRESSION) ? 16 : 1;
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+unsigned short EXRImageParser::FloatToHalf(float value) {
+  unsigned int bits;
+  memcpy(&bits, &value, sizeof(float));
+
+  unsigned int sign = (bits >> 16) & 0x8000;
+  int exponent = (int)((bits >> 23) & 0xff);
+  unsigned int mantissa = bits & 0x7fffff;
+
+  // Infinity and NaN
+  if (exponent == 255)
+    return (unsigned short)(sign | 0x7c00
+                            | (mantissa ? (0x200 | (mantissa >> 13)) : 0));
+
+  int e = exponent - 127 + 15;
+  // Overflow
+  if (e >= 31)
+    return (unsigned short)(sign | 0x7c00);
+
+  // Denormals
+  if (e <= 0) {
+    if (e < -10)
+      return (unsigned short)sign;
+    mantissa |= 0x800000;
+    unsigned int shift = (unsigned int)(14 - e);
+    unsigned int half = mantissa >> shift;
+    unsigned int rest = mantissa & ((1u << shift) - 1);
+    unsigned int halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return (unsigned short)(sign | half);
+  }
+
+  // Normals; a carry of the rounding correctly increments the exponent
+  unsigned int half = sign | ((unsigned int)e << 10) | (mantissa >> 13);
+  unsigned int rest = mantissa & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return (unsigned short)half;
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::Predict(const std::vector<unsigned char>& raw,
+                             std::vector<unsigned char>& out) {
+  size_t n = raw.size();
+  out.resize(n);
+  if (n == 0)
+    return;
+
+  // Even bytes in the first half, odd bytes in the second one
+  size_t half = (n + 1) / 2;
+  for (size_t i = 0; i < n; i++) {
+    if (i % 2 == 0)
+      out[i / 2] = raw[i];
+    else
+      out[half + i / 2] = raw[i];
+  }
+
+  // Differences between consecutive bytes
+  int previous = out[0];
+  for (size_t i = 1; i < n; i++) {
+    int current = out[i];
+    out[i] = (unsigned char)(current - previous + (128 + 256));
+    previous = current;
+  }
+}
+////////////////////////////// class EXRImageParser ///////////////////////////
+void EXRImageParser::RunLength(const std::vector<unsigned char>& in,
+                               std::vector<unsigned char>& out) {
+  const int kMIN_RUN = 3;
+  const int kMAX_RUN = 127;
+
+  out.clear();
+  out.reserve(in.size() + in.size() / 128 + 2);
+  const unsigned char* start = in.empty() ? NULL : &in[0];
+  const unsigned char* end = start + in.size();
+  const unsigned char* run_start = start;
+  const unsigned char* run_end = start + 1;
+
+  while (run_start < end) {
+    while (run_end < end && *run_start == *run_end
+           && run_end - run_start - 1 < kMAX_RUN)
+      ++run_end;
+
+    if (run_end - run_start >= kMIN_RUN) {
+      // Repeated byte
+      out.push_back((unsigned char)((run_end - run_start) - 1));
+      out.push_back(*run_start);
+      run_start = run_end;
+    } else {
+      // Literal bytes, up to the next run
+      while (run_end < end
+             && ((run_end + 1 >= end || *run_end != *(run_end + 1))
+                 || (run_end + 2 >= end || *(run_end + 1) != *(run_end + 2)))
+             && run_end - run_start < kMAX_RUN)
+        ++run_end;
+      out.push_back((unsigned char)(run_start - run_end));
+      while (run_start < run_end)
+        out.push_back(*run_start++);
+    }
+    ++run_end;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
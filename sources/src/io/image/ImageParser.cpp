@@ -17,6 +17,7 @@
 #include <io/image/ImageParser.hpp>
 #include <io/image/RGBImageParser.hpp>
 #include <io/image/MHDRImageParser.hpp>
+#include <io/image/EXRImageParser.hpp>
 #include <exceptions/Exception.hpp>
 #include <iostream>
 
@@ -52,6 +53,11 @@ void ImageParser::save(Image& image, std::string filename)
     MHDRImageParser parser;
     parser.save(image, filename);
   }
+  else if(filename.length()>4 && filename.compare(filename.length()-4, 4, ".exr")==0)
+  {
+    EXRImageParser parser;
+    parser.save(image, filename);
+  }
   else
   {
     RGBImageParser parser;
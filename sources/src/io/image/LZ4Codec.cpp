@@ -0,0 +1,198 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/image/LZ4Codec.hpp>
+//!
+//! @file LZ4Codec.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in LZ4Codec.hpp
+//!  @arg LZ4Codec
+//!
+#include <cstring>
+
+namespace {
+//! Shortest match
+const size_t kMIN_MATCH = 4;
+//! The last bytes of a block are always literals
+const size_t kLAST_LITERALS = 5;
+//! No match can start in the last bytes of a block
+const size_t kMATCH_LIMIT = 12;
+//! Largest offset of a match
+const size_t kMAX_OFFSET = 65535;
+//! Number of bits of the hash of a 4-byte sequence
+const unsigned int kHASH_BITS = 14;
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Read32(const unsigned char* p) {
+  unsigned int v;
+  memcpy(&v, p, 4);
+  return v;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned int Hash4(unsigned int v) {
+  return (v * 2654435761u) >> (32 - kHASH_BITS);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutLength(std::vector<unsigned char>& out, size_t length) {
+  while (length >= 255) {
+    out.push_back(255);
+    length -= 255;
+  }
+  out.push_back((unsigned char)length);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void PutSequence(std::vector<unsigned char>& out,
+                        const unsigned char* literals, size_t nb_literals,
+                        size_t offset, size_t match) {
+  size_t lit_code = (nb_literals < 15) ? nb_literals : 15;
+  size_t match_code = 0;
+  if (match > 0)
+    match_code = (match - kMIN_MATCH < 15) ? match - kMIN_MATCH : 15;
+  out.push_back((unsigned char)((lit_code << 4) | match_code));
+  if (lit_code == 15)
+    PutLength(out, nb_literals - 15);
+  out.insert(out.end(), literals, literals + nb_literals);
+
+  // The last sequence only contains literals
+  if (match == 0)
+    return;
+  out.push_back((unsigned char)(offset & 0xff));
+  out.push_back((unsigned char)(offset >> 8));
+  if (match_code == 15)
+    PutLength(out, match - kMIN_MATCH - 15);
+}
+////////////////////////////////////////////////////////////////////////////////
+inline bool GetLength(const unsigned char* data, size_t size, size_t& pos,
+                      size_t& length) {
+  unsigned char b;
+  do {
+    if (pos >= size)
+      return false;
+    b = data[pos++];
+    length += b;
+  } while (b == 255);
+  return true;
+}
+} // namespace
+////////////////////////////// class LZ4Codec //////////////////////////////////
+void LZ4Codec::Compress(const unsigned char* data, size_t size,
+                        std::vector<unsigned char>& out) {
+  out.clear();
+  out.reserve(size / 2 + 16);
+
+  size_t anchor = 0;
+  if (size > kMATCH_LIMIT) {
+    std::vector<int> table(1 << kHASH_BITS, -1);
+    size_t limit = size - kMATCH_LIMIT;
+    size_t pos = 0;
+
+    while (pos < limit) {
+      unsigned int sequence = Read32(&data[pos]);
+      unsigned int h = Hash4(sequence);
+      int candidate = table[h];
+      table[h] = (int)pos;
+
+      if (candidate < 0 || pos - (size_t)candidate > kMAX_OFFSET
+          || Read32(&data[candidate]) != sequence) {
+        pos++;
+        continue;
+      }
+
+      // Extend the match, keeping the last literals
+      size_t match = kMIN_MATCH;
+      size_t max_match = size - kLAST_LITERALS - pos;
+      while (match < max_match && data[candidate + match] == data[pos + match])
+        match++;
+
+      PutSequence(out, &data[anchor], pos - anchor, pos - candidate, match);
+      pos += match;
+      anchor = pos;
+    }
+  }
+
+  // Last literals
+  PutSequence(out, data + anchor, size - anchor, 0, 0);
+}
+////////////////////////////// class LZ4Codec //////////////////////////////////
+bool LZ4Codec::Decompress(const unsigned char* data, size_t size,
+                          unsigned char* out, size_t out_size) {
+  size_t in = 0;
+  size_t op = 0;
+
+  while (in < size) {
+    unsigned char token = data[in++];
+
+    // Literals
+    size_t nb_literals = token >> 4;
+    if (nb_literals == 15 && !GetLength(data, size, in, nb_literals))
+      return false;
+    if (in + nb_literals > size || op + nb_literals > out_size)
+      return false;
+    memcpy(&out[op], &data[in], nb_literals);
+    in += nb_literals;
+    op += nb_literals;
+
+    // End of block
+    if (in == size)
+      break;
+
+    // Match
+    if (in + 2 > size)
+      return false;
+    size_t offset = data[in] | ((size_t)data[in + 1] << 8);
+    in += 2;
+    if (offset == 0 || offset > op)
+      return false;
+    size_t match = token & 0x0f;
+    if (match == 15 && !GetLength(data, size, in, match))
+      return false;
+    match += kMIN_MATCH;
+    if (op + match > out_size)
+      return false;
+
+    // Byte per byte: the match may overlap the output
+    const unsigned char* src = &out[op - offset];
+    for (size_t i = 0; i < match; i++)
+      out[op + i] = src[i];
+    op += match;
+  }
+
+  return op == out_size;
+}
+////////////////////////////// class LZ4Codec //////////////////////////////////
+void LZ4Codec::Shuffle(const unsigned char* data, size_t size,
+                       size_t word_size, unsigned char* out) {
+  size_t nb_words = size / word_size;
+  for (size_t w = 0; w < nb_words; w++) {
+    for (size_t b = 0; b < word_size; b++)
+      out[b * nb_words + w] = data[w * word_size + b];
+  }
+}
+////////////////////////////// class LZ4Codec //////////////////////////////////
+void LZ4Codec::Unshuffle(const unsigned char* data, size_t size,
+                         size_t word_size, unsigned char* out) {
+  size_t nb_words = size / word_size;
+  for (size_t w = 0; w < nb_words; w++) {
+    for (size_t b = 0; b < word_size; b++)
+      out[w * word_size + b] = data[b * nb_words + w];
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
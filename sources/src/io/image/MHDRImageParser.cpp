@@ -15,9 +15,13 @@
  */
 
 #include <io/image/MHDRImageParser.hpp>
+#include <io/image/MHDRImageStream.hpp>
 #include <exceptions/Exception.hpp>
 #include <cstdio>
 
+//Size of the tiles of the files written by save
+#define MHDRI_TILE_SIZE 64
+
 /**
  * Load an image from a file. The file type will be determined by the
  * extension.
@@ -25,8 +29,25 @@
  */
 Image* MHDRImageParser::load(std::string filename)
 {
+  //Tiled files (version 2)
+  if(MHDRImageStream::IsStreamFile(filename))
+  {
+    MHDRImageStream stream;
+    stream.Open(filename);
+    Image* image = stream.CreateImage();
+    try {
+      for(unsigned int i=0; i<stream.nb_tiles(); i++)
+        stream.ReadTile(i, *image);
+    } catch(...) {
+      delete image;
+      throw;
+    }
+    stream.Close();
+    return image;
+  }
+
   //Open the file
-  FILE* file = fopen(filename.c_str(), "r");
+  FILE* file = fopen(filename.c_str(), "rb");
   if(file==NULL)
     throw Exception("(MHDRImageParser::saveImage)Echec de la lecture du fichier "+filename);
 
@@ -47,12 +68,15 @@ Image* MHDRImageParser::load(std::string filename)
       throw Exception("(MHDRImageParser::saveImage)Echec de la lecture du fichier "+filename);
     }
     channels_names[i]=buffer;
+    if(!channels_names[i].empty() && channels_names[i][channels_names[i].size()-1]=='\n')
+      channels_names[i].erase(channels_names[i].size()-1);
   }
 
   //Read the data
   unsigned int datanb = width*height*channels;
   float* raster = new float[datanb];
   if(fread(raster, sizeof(float), datanb, file)!=datanb){
+    delete[] raster;
     fclose(file);
     throw Exception("(MHDRImageParser::saveImage)Echec de la lecture du fichier "+filename);
   }
@@ -76,25 +100,8 @@ Image* MHDRImageParser::load(std::string filename)
  */
 void MHDRImageParser::save(Image& image, std::string filename)
 {
-  //Open the file
-  FILE* file = fopen(filename.c_str(), "w");
-  if(file==NULL)
-    throw Exception("(MHDRImageParser::saveImage)Echec de la sauvegarde du fichier "+filename);
-
-  //Write the header
-  fprintf(file, "MHDRI\n%d\t%d\t%d\n", image.getWidth(), image.getHeight(), image.getNumberOfChannels());
-  for(unsigned int i=0; i<image.getNumberOfChannels(); i++)
-    fprintf(file, "%s\n", image.getChannelName(i).c_str());
-
-  //Write the data
-  float* raster = image.getRaster();
-  unsigned int datanb = image.getWidth()*image.getHeight()*image.getNumberOfChannels();  
-  if(fwrite(raster, sizeof(float), datanb, file)!=datanb){
-    fclose(file);
-    throw Exception("(MHDRImageParser::saveImage)Echec de la sauvegarde du fichier "+filename);
-  }
-  
-  //Close the file
-  fclose(file);
+  //Tiled and compressed file (version 2)
+  MHDRImageStream stream;
+  stream.Create(filename, image, MHDRI_TILE_SIZE, MHDRI_TILE_SIZE);
+  stream.Close();
 }
-
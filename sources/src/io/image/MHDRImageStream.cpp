@@ -0,0 +1,372 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/image/MHDRImageStream.hpp>
+//!
+//! @file MHDRImageStream.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in MHDRImageStream.hpp
+//!  @arg MHDRImageStream
+//!
+#include <cstring>
+#include <algorithm>
+
+#include <io/image/LZ4Codec.hpp>
+#include <io/FileOffset.hpp>
+#include <exceptions/Exception.hpp>
+
+namespace {
+//! Size of one entry of the chunk table
+const long long kENTRY_SIZE = 16;
+//! Number of tiles encoded in parallel before being written
+const unsigned int kTILE_BATCH = 64;
+////////////////////////////////////////////////////////////////////////////////
+inline void PutLE(unsigned char* out, unsigned long long value, int nb) {
+  for (int b = 0; b < nb; b++)
+    out[b] = (unsigned char)(value >> (8 * b));
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned long long GetLE(const unsigned char* in, int nb) {
+  unsigned long long value = 0;
+  for (int b = nb - 1; b >= 0; b--)
+    value = (value << 8) | in[b];
+  return value;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline std::string StripEndOfLine(const char* buffer) {
+  std::string s = buffer;
+  while (!s.empty() && (s[s.size() - 1] == '\n' || s[s.size() - 1] == '\r'))
+    s.erase(s.size() - 1);
+  return s;
+}
+} // namespace
+////////////////////////////// class MHDRImageStream ///////////////////////////
+MHDRImageStream::MHDRImageStream(void)
+    : p_file(NULL),
+      m_width(0),
+      m_height(0),
+      m_nb_channels(0),
+      m_tile_width(0),
+      m_tile_height(0),
+      m_nb_tiles_x(0),
+      m_nb_tiles_y(0),
+      m_compression(kNO_COMPRESSION),
+      m_table_pos(0) {}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+MHDRImageStream::~MHDRImageStream(void) {
+  Close();
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+bool MHDRImageStream::IsStreamFile(const std::string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == NULL)
+    return false;
+  char magic[8] = {0};
+  size_t nb = fread(magic, 1, 7, file);
+  fclose(file);
+  return nb == 7 && memcmp(magic, "MHDRI2\n", 7) == 0;
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::Create(const std::string& filename, Image& image,
+                             unsigned int tile_width, unsigned int tile_height,
+                             int compression) {
+  Close();
+
+  m_filename = filename;
+  m_width = image.getWidth();
+  m_height = image.getHeight();
+  m_nb_channels = image.getNumberOfChannels();
+  m_channel_names.resize(m_nb_channels);
+  for (unsigned int c = 0; c < m_nb_channels; c++)
+    m_channel_names[c] = StripEndOfLine(image.getChannelName(c).c_str());
+  m_tile_width = (tile_width > 0) ? tile_width : 64;
+  m_tile_height = (tile_height > 0) ? tile_height : 64;
+  m_nb_tiles_x = (m_width + m_tile_width - 1) / m_tile_width;
+  m_nb_tiles_y = (m_height + m_tile_height - 1) / m_tile_height;
+  m_compression = compression;
+
+  p_file = fopen(filename.c_str(), "wb+");
+  if (p_file == NULL)
+    throw Exception("(MHDRImageStream::Create) Echec de la sauvegarde du \
+fichier " + filename);
+
+  // Header
+  fprintf(p_file, "MHDRI2\n%u\t%u\t%u\t%u\t%u\t%d\n", m_width, m_height,
+          m_nb_channels, m_tile_width, m_tile_height, m_compression);
+  for (unsigned int c = 0; c < m_nb_channels; c++)
+    fprintf(p_file, "%s\n", m_channel_names[c].c_str());
+
+  // Empty chunk table
+  m_table_pos = FileOffset::Tell(p_file);
+  m_offsets.assign(nb_tiles(), 0);
+  m_sizes.assign(nb_tiles(), 0);
+  m_capacities.assign(nb_tiles(), 0);
+  m_dirty.assign(nb_tiles(), false);
+  m_coverage.assign(nb_tiles(), 0);
+  std::vector<unsigned char> table(kENTRY_SIZE * nb_tiles(), 0);
+  if (!table.empty())
+    fwrite(&table[0], 1, table.size(), p_file);
+
+  // All the tiles
+  std::vector<unsigned int> tiles(nb_tiles());
+  for (unsigned int t = 0; t < nb_tiles(); t++)
+    tiles[t] = t;
+  WriteTiles(image, tiles);
+  fflush(p_file);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::Open(const std::string& filename) {
+  Close();
+
+  m_filename = filename;
+  p_file = fopen(filename.c_str(), "rb+");
+  if (p_file == NULL)
+    p_file = fopen(filename.c_str(), "rb");
+  if (p_file == NULL)
+    throw Exception("(MHDRImageStream::Open) Echec de la lecture du fichier "
+                    + filename);
+
+  // Header
+  if (fscanf(p_file, "MHDRI2\n%u\t%u\t%u\t%u\t%u\t%d", &m_width, &m_height,
+             &m_nb_channels, &m_tile_width, &m_tile_height,
+             &m_compression) != 6 || fgetc(p_file) != '\n'
+      || m_tile_width == 0 || m_tile_height == 0) {
+    Close();
+    throw Exception("(MHDRImageStream::Open) Echec de la lecture du fichier "
+                    + filename);
+  }
+  m_nb_tiles_x = (m_width + m_tile_width - 1) / m_tile_width;
+  m_nb_tiles_y = (m_height + m_tile_height - 1) / m_tile_height;
+
+  m_channel_names.resize(m_nb_channels);
+  for (unsigned int c = 0; c < m_nb_channels; c++) {
+    char buffer[1024];
+    if (fgets(buffer, 1024, p_file) == NULL) {
+      Close();
+      throw Exception("(MHDRImageStream::Open) Echec de la lecture du \
+fichier " + filename);
+    }
+    m_channel_names[c] = StripEndOfLine(buffer);
+  }
+
+  // Chunk table
+  m_table_pos = FileOffset::Tell(p_file);
+  std::vector<unsigned char> table(kENTRY_SIZE * nb_tiles());
+  if (!table.empty()
+      && fread(&table[0], 1, table.size(), p_file) != table.size()) {
+    Close();
+    throw Exception("(MHDRImageStream::Open) Echec de la lecture du fichier "
+                    + filename);
+  }
+  m_offsets.resize(nb_tiles());
+  m_sizes.resize(nb_tiles());
+  m_capacities.resize(nb_tiles());
+  m_dirty.assign(nb_tiles(), false);
+  m_coverage.assign(nb_tiles(), 0);
+  for (unsigned int t = 0; t < nb_tiles(); t++) {
+    const unsigned char* entry = &table[kENTRY_SIZE * t];
+    m_offsets[t] = GetLE(entry, 8);
+    m_sizes[t] = (unsigned int)GetLE(entry + 8, 4);
+    m_capacities[t] = (unsigned int)GetLE(entry + 12, 4);
+  }
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::Close(void) {
+  if (p_file != NULL) {
+    fclose(p_file);
+    p_file = NULL;
+  }
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+Image* MHDRImageStream::CreateImage(void) const {
+  Image* image = new Image(m_width, m_height, m_nb_channels);
+  for (unsigned int c = 0; c < m_nb_channels; c++)
+    image->setChannelName(c, m_channel_names[c]);
+  image->clear();
+  return image;
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::GetTileArea(unsigned int tile,
+                                  unsigned int& x, unsigned int& y,
+                                  unsigned int& w, unsigned int& h) const {
+  x = (tile % m_nb_tiles_x) * m_tile_width;
+  y = (tile / m_nb_tiles_x) * m_tile_height;
+  w = std::min(m_tile_width, m_width - x);
+  h = std::min(m_tile_height, m_height - y);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::ReadTile(unsigned int tile, Image& image) {
+  if (p_file == NULL || tile >= nb_tiles())
+    return;
+  // A tile that has never been written is black
+  if (m_sizes[tile] == 0)
+    return;
+
+  unsigned int x, y, w, h;
+  GetTileArea(tile, x, y, w, h);
+  size_t row_size = (size_t)w * m_nb_channels * sizeof(float);
+  size_t raw_size = row_size * h;
+
+  std::vector<unsigned char> chunk(m_sizes[tile]);
+  FileOffset::Seek(p_file, (long long)m_offsets[tile], SEEK_SET);
+  if (fread(&chunk[0], 1, chunk.size(), p_file) != chunk.size())
+    throw Exception("(MHDRImageStream::ReadTile) Echec de la lecture du \
+fichier " + m_filename);
+
+  // Chunks smaller than the raw tile are compressed
+  std::vector<unsigned char> raw;
+  if (chunk.size() == raw_size) {
+    raw.swap(chunk);
+  } else {
+    std::vector<unsigned char> planes(raw_size);
+    raw.resize(raw_size);
+    if (!LZ4Codec::Decompress(&chunk[0], chunk.size(), &planes[0], raw_size))
+      throw Exception("(MHDRImageStream::ReadTile) Donnees corrompues dans \
+le fichier " + m_filename);
+    LZ4Codec::Unshuffle(&planes[0], raw_size, sizeof(float), &raw[0]);
+  }
+
+  image.setBlock((int)x, (int)y, w, h, (const float*)&raw[0],
+                 w * m_nb_channels);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::EncodeTile(Image& image, unsigned int tile,
+                                 std::vector<unsigned char>& chunk) const {
+  unsigned int x, y, w, h;
+  GetTileArea(tile, x, y, w, h);
+  size_t row_size = (size_t)w * m_nb_channels * sizeof(float);
+
+  // Raw pixels of the tile
+  std::vector<unsigned char> raw(row_size * h);
+  const float* raster = image.getRaster();
+  for (unsigned int j = 0; j < h; j++) {
+    memcpy(&raw[row_size * j],
+           &raster[((size_t)(y + j) * m_width + x) * m_nb_channels],
+           row_size);
+  }
+
+  if (m_compression == kNO_COMPRESSION || raw.empty()) {
+    chunk.swap(raw);
+    return;
+  }
+
+  std::vector<unsigned char> planes(raw.size());
+  LZ4Codec::Shuffle(&raw[0], raw.size(), sizeof(float), &planes[0]);
+  LZ4Codec::Compress(&planes[0], planes.size(), chunk);
+
+  // Data that do not compress are stored as they are
+  if (chunk.size() >= raw.size())
+    chunk.swap(raw);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::WriteTile(Image& image, unsigned int tile) {
+  if (p_file == NULL || tile >= nb_tiles())
+    return;
+  std::vector<unsigned char> chunk;
+  EncodeTile(image, tile, chunk);
+  WriteChunk(tile, chunk);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::WriteTiles(Image& image,
+                                 const std::vector<unsigned int>& tiles) {
+  std::vector< std::vector<unsigned char> > batch(kTILE_BATCH);
+  unsigned int nb_tiles = (unsigned int)tiles.size();
+  for (unsigned int first = 0; first < nb_tiles; first += kTILE_BATCH) {
+    int nb = (int)std::min(kTILE_BATCH, nb_tiles - first);
+    int t;
+#   pragma omp parallel for private(t) schedule(dynamic, 1)
+    for (t = 0; t < nb; t++)
+      EncodeTile(image, tiles[first + t], batch[t]);
+    for (t = 0; t < nb; t++)
+      WriteChunk(tiles[first + t], batch[t]);
+  }
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::WriteChunk(unsigned int tile,
+                                 const std::vector<unsigned char>& chunk) {
+  unsigned int size = (unsigned int)chunk.size();
+
+  // In place if it fits, at the end of the file otherwise
+  if (m_offsets[tile] != 0 && size <= m_capacities[tile]) {
+    FileOffset::Seek(p_file, (long long)m_offsets[tile], SEEK_SET);
+  } else {
+    FileOffset::Seek(p_file, 0, SEEK_END);
+    m_offsets[tile] = (unsigned long long)FileOffset::Tell(p_file);
+    m_capacities[tile] = size;
+  }
+  if (size > 0 && fwrite(&chunk[0], 1, size, p_file) != size)
+    throw Exception("(MHDRImageStream::WriteChunk) Echec de la sauvegarde \
+du fichier " + m_filename);
+  m_sizes[tile] = size;
+  m_dirty[tile] = false;
+  WriteEntry(tile);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::WriteEntry(unsigned int tile) {
+  unsigned char entry[kENTRY_SIZE];
+  PutLE(entry, m_offsets[tile], 8);
+  PutLE(entry + 8, m_sizes[tile], 4);
+  PutLE(entry + 12, m_capacities[tile], 4);
+  FileOffset::Seek(p_file, m_table_pos + kENTRY_SIZE * (long long)tile, SEEK_SET);
+  fwrite(entry, 1, kENTRY_SIZE, p_file);
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::MarkRegion(unsigned int ulx, unsigned int uly,
+                                 unsigned int brx, unsigned int bry) {
+  if (p_file == NULL || m_width == 0 || m_height == 0)
+    return;
+  if (brx >= m_width) brx = m_width - 1;
+  if (bry >= m_height) bry = m_height - 1;
+  if (ulx > brx || uly > bry)
+    return;
+
+  for (unsigned int ty = uly / m_tile_height; ty <= bry / m_tile_height; ty++)
+    for (unsigned int tx = ulx / m_tile_width; tx <= brx / m_tile_width; tx++) {
+      unsigned int tile = ty * m_nb_tiles_x + tx;
+      m_dirty[tile] = true;
+
+      // Overlap between the rendered area and the tile
+      unsigned int x0 = std::max(ulx, tx * m_tile_width);
+      unsigned int y0 = std::max(uly, ty * m_tile_height);
+      unsigned int x1 = std::min(brx, (tx + 1) * m_tile_width - 1);
+      unsigned int y1 = std::min(bry, (ty + 1) * m_tile_height - 1);
+      m_coverage[tile] += (x1 - x0 + 1) * (y1 - y0 + 1);
+    }
+}
+////////////////////////////// class MHDRImageStream ///////////////////////////
+void MHDRImageStream::FlushDirty(Image& image, bool finished_only) {
+  if (p_file == NULL)
+    return;
+  std::vector<unsigned int> tiles;
+  for (unsigned int t = 0; t < nb_tiles(); t++) {
+    if (!m_dirty[t])
+      continue;
+    // Tiles still being rendered by other threads are kept for later
+    unsigned int x, y, w, h;
+    GetTileArea(t, x, y, w, h);
+    if (!finished_only || m_coverage[t] >= w * h)
+      tiles.push_back(t);
+  }
+  WriteTiles(image, tiles);
+  fflush(p_file);
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,8 @@ bool RGBImageParser::_init=false;
  */
 RGBImageParser::RGBImageParser()
 {
+  //DevIL keeps a global state: all the calls are serialized
+# pragma omp critical (devil)
   if(!RGBImageParser::_init)
   {
     ilInit();
@@ -43,26 +45,34 @@ RGBImageParser::RGBImageParser()
  */
 Image* RGBImageParser::load(std::string filename)
 {
-  //Creating DevIL image name
-  ILuint ImageName;
-  ilGenImages(1, &ImageName);
-  ilBindImage(ImageName);
+  ILuint width  = 0;
+  ILuint height = 0;
+  unsigned char* raster = NULL;
 
-  //Open the file
-  if(!ilLoadImage((char*)filename.c_str()))
+# pragma omp critical (devil)
   {
-    ilDeleteImages(1, &ImageName);
-    throw Exception("(RGBImageParser::loadImage)Echec de l'ouverture du fichier "+filename);
-  }
+    //Creating DevIL image name
+    ILuint ImageName;
+    ilGenImages(1, &ImageName);
+    ilBindImage(ImageName);
 
+    //Open the file
+    if(ilLoadImage((char*)filename.c_str()))
+    {
+      //Create and load the raster
+      width  = ilGetInteger(IL_IMAGE_WIDTH);
+      height = ilGetInteger(IL_IMAGE_HEIGHT);
+      raster = new unsigned char[width*height*3];
+      ilCopyPixels(0, 0, 0, width, height, 1, IL_RGB, IL_UNSIGNED_BYTE, raster);
+    }
 
-  //Create the raster
-  ILuint width  = ilGetInteger(IL_IMAGE_WIDTH);
-  ILuint height = ilGetInteger(IL_IMAGE_HEIGHT);
-  unsigned char* raster = new unsigned char[width*height*3];
+    //Free DevIL data
+    ilDeleteImages(1, &ImageName);
+  }
 
-  //Load the raster
-  ilCopyPixels(0, 0, 0, width, height, 1, IL_RGB, IL_UNSIGNED_BYTE, raster);
+  //The exception can't be thrown from the critical section
+  if(raster == NULL)
+    throw Exception("(RGBImageParser::loadImage)Echec de l'ouverture du fichier "+filename);
 
   //Converting the raster from unsigned char to float format
   float* fraster = new float[width*height*3];
@@ -73,9 +83,6 @@ Image* RGBImageParser::load(std::string filename)
   //Create the image
   Image* image = new Image(width, height, 3, fraster);
 
-  //Free DevIL data
-  ilDeleteImages(1, &ImageName);
-
   //Done !
   return image;
 }
@@ -86,11 +93,6 @@ Image* RGBImageParser::load(std::string filename)
  */
 void RGBImageParser::save(Image& image, std::string filename)
 {
-  //Creating DevIL image name
-  ILuint ImageName;
-  ilGenImages(1, &ImageName);
-  ilBindImage(ImageName);
-
   //Converting the raster from float to unsigned char format
   ILuint width  = image.getWidth();
   ILuint height = image.getHeight();
@@ -106,20 +108,27 @@ void RGBImageParser::save(Image& image, std::string filename)
       raster[i*3 + k] = (unsigned char)data;
     }
   }
-  
-  //Creating DevIL image
-  ilTexImage(width, height, 1, 3, IL_RGB, IL_UNSIGNED_BYTE, raster);
-  iluFlipImage();
-  delete[] raster;
 
-  //Saving the file
-  if(!ilSaveImage((char*)filename.c_str()))
+  bool saved = false;
+# pragma omp critical (devil)
   {
+    //Creating DevIL image name
+    ILuint ImageName;
+    ilGenImages(1, &ImageName);
+    ilBindImage(ImageName);
+
+    //Creating DevIL image
+    ilTexImage(width, height, 1, 3, IL_RGB, IL_UNSIGNED_BYTE, raster);
+    iluFlipImage();
+
+    //Saving the file
+    saved = ilSaveImage((char*)filename.c_str());
+
+    //Free DevIL data
     ilDeleteImages(1, &ImageName);
-    throw Exception("(RGBImageParser::saveImage)Echec de la sauvegarde du fichier "+filename);
   }
-  
-  //Free DevIL data
-  ilDeleteImages(1, &ImageName);
-}
+  delete[] raster;
 
+  if(!saved)
+    throw Exception("(RGBImageParser::saveImage)Echec de la sauvegarde du fichier "+filename);
+}
@@ -0,0 +1,384 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/mesh/MeshCache.hpp>
+//!
+//! @file MeshCache.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in MeshCache.hpp
+//!  @arg MeshCache
+//!
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <core/VrtLog.hpp>
+#include <exceptions/Exception.hpp>
+#include <io/FileOffset.hpp>
+#include <io/MappedFile.hpp>
+
+namespace {
+//! Identifier of the cache files
+const char kMAGIC[4] = {'V', 'M', 'S', 'H'};
+//! Version of the cache files
+const unsigned int kVERSION = 1;
+//! Alignment of the sections
+const size_t kALIGNMENT = 16;
+//! Number of bytes hashed at both ends of the source files
+const size_t kSIGNATURE_SIZE = 65536;
+//! FNV-1a parameters
+const unsigned long long kFNV_OFFSET = 14695981039346656037ULL;
+const unsigned long long kFNV_PRIME = 1099511628211ULL;
+//! Sections of the cache files
+enum {
+  kVERTICES = 0,
+  kNORMALS,
+  kTEXCOORDS,
+  kVERTEX_INDICES,
+  kNORMAL_INDICES,
+  kTEXCOORD_INDICES,
+  kNODES,
+  kNB_SECTIONS
+};
+//! Size of an element of each section
+const size_t kELEMENT_SIZES[kNB_SECTIONS] = {
+  sizeof(Point), sizeof(Vector), sizeof(Point2D), 
+  sizeof(unsigned int), sizeof(unsigned int), sizeof(unsigned int),
+  sizeof(MeshBVH::Node)
+};
+////////////////////////////////////////////////////////////////////////////////
+//! Header of the cache files (multiple of the alignment)
+struct CacheHeader {
+  char magic[4];
+  unsigned int version;
+  unsigned int real_size;
+  unsigned int node_size;
+  unsigned long long source_size;
+  long long source_time;
+  unsigned long long source_hash;
+  unsigned long long counts[kNB_SECTIONS];
+  unsigned long long offsets[kNB_SECTIONS];
+  unsigned long long checksum;
+};
+////////////////////////////////////////////////////////////////////////////////
+inline size_t Padding(size_t size) {
+  return (kALIGNMENT - size % kALIGNMENT) % kALIGNMENT;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! FNV-1a on 64-bit words of a section padded with zeros
+inline unsigned long long HashSection(unsigned long long hash, 
+                                      const void* data, size_t size) {
+  const char* bytes = (const char*)data;
+  size_t padded = size + Padding(size);
+  for (size_t i = 0; i < padded; i += 8) {
+    unsigned long long word = 0;
+    if (i < size)
+      memcpy(&word, bytes + i, (size - i < 8) ? size - i : 8);
+    hash ^= word;
+    hash *= kFNV_PRIME;
+  }
+  return hash;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned long long HashBytes(const std::string& text) {
+  unsigned long long hash = kFNV_OFFSET;
+  for (size_t i = 0; i < text.size(); i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= kFNV_PRIME;
+  }
+  return hash;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Signature of a source file: size, modification time, and hash of its first
+//! and last bytes (modifications within the resolution of the time)
+struct SourceSignature {
+  unsigned long long size;
+  long long time;
+  unsigned long long hash;
+};
+////////////////////////////////////////////////////////////////////////////////
+inline bool GetSignature(const std::string& filename, 
+                         SourceSignature& signature) {
+  struct stat status;
+  if (stat(filename.c_str(), &status) != 0)
+    return false;
+  signature.size = (unsigned long long)status.st_size;
+  signature.time = (long long)status.st_mtime;
+
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == NULL)
+    return false;
+  std::vector<char> buffer(2 * kSIGNATURE_SIZE);
+  size_t size = fread(&buffer[0], 1, kSIGNATURE_SIZE, file);
+  // Last bytes of large files
+  if (signature.size > 2 * kSIGNATURE_SIZE)
+    FileOffset::Seek(file, -(long long)kSIGNATURE_SIZE, SEEK_END);
+  size += fread(&buffer[size], 1, kSIGNATURE_SIZE, file);
+  fclose(file);
+  signature.hash = HashSection(kFNV_OFFSET, &buffer[0], size);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Check the header and the bounds of the sections of a mapped cache file
+inline bool CheckHeader(const MappedFile& file, CacheHeader& header,
+                        const SourceSignature& source) {
+  if (file.size() < sizeof(header))
+    return false;
+  memcpy(&header, file.data(), sizeof(header));
+  if (memcmp(header.magic, kMAGIC, 4) != 0 || header.version != kVERSION 
+      || header.real_size != sizeof(Real) 
+      || header.node_size != sizeof(MeshBVH::Node)
+      || header.source_size != source.size 
+      || header.source_time != source.time
+      || header.source_hash != source.hash)
+    return false;
+
+  unsigned long long end = sizeof(header);
+  for (int s = 0; s < kNB_SECTIONS; s++) {
+    if (header.offsets[s] != end 
+        || header.counts[s] > (file.size() - end) / kELEMENT_SIZES[s])
+      return false;
+    size_t size = (size_t)header.counts[s] * kELEMENT_SIZES[s];
+    end += size + Padding(size);
+  }
+  unsigned long long nb_corners = header.counts[kVERTEX_INDICES];
+  return end == file.size() && nb_corners % 3 == 0
+      && header.counts[kNORMAL_INDICES] == nb_corners
+      && header.counts[kTEXCOORD_INDICES] == nb_corners;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline void CopySection(const MappedFile& file, const CacheHeader& header, 
+                        int section, std::vector<unsigned int>& values) {
+  values.resize((size_t)header.counts[section]);
+  if (!values.empty()) {
+    memcpy(&values[0], file.data() + header.offsets[section], 
+           values.size() * sizeof(unsigned int));
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Points, vectors and texture coordinates are not trivially copyable: their 
+//! coordinates are copied through a Real array, then set in the elements
+template<class T>
+inline void CopySection(const MappedFile& file, const CacheHeader& header, 
+                        int section, std::vector<T>& values) {
+  const size_t nb_coords = sizeof(T) / sizeof(Real);
+  std::vector<Real> coords((size_t)header.counts[section] * nb_coords);
+  if (!coords.empty()) {
+    memcpy(&coords[0], file.data() + header.offsets[section], 
+           coords.size() * sizeof(Real));
+  }
+  values.resize((size_t)header.counts[section]);
+  for (size_t e = 0; e < values.size(); e++) {
+    for (size_t c = 0; c < nb_coords; c++)
+      values[e][(int)c] = coords[e * nb_coords + c];
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Check that every index of a section refers to an element
+inline bool CheckIndices(const std::vector<unsigned int>& indices, 
+                         size_t nb_elements, bool optional) {
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= nb_elements 
+        && !(optional && indices[i] == MeshData::kNO_INDEX))
+      return false;
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Check the links of the nodes and the ranges of the leaves
+inline bool CheckNodes(const MeshBVH::Node* nodes, unsigned long long nb_nodes,
+                       unsigned long long nb_triangles) {
+  if (nb_nodes == 0)
+    return nb_triangles == 0;
+  for (unsigned long long n = 0; n < nb_nodes; n++) {
+    const MeshBVH::Node& node = nodes[n];
+    if (node.axis == MeshBVH::kLEAF) {
+      if ((unsigned long long)node.first + node.count > nb_triangles)
+        return false;
+    } else if (node.axis > 2 || node.first <= n + 1 || node.first >= nb_nodes) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+std::string MeshCache::s_directory;
+////////////////////////////// class MeshCache /////////////////////////////////
+void MeshCache::SetDirectory(const std::string& directory) {
+  s_directory = directory;
+  if (!s_directory.empty() && s_directory[s_directory.size() - 1] != '/'
+      && s_directory[s_directory.size() - 1] != '\\')
+    s_directory += '/';
+}
+////////////////////////////// class MeshCache /////////////////////////////////
+std::string MeshCache::GetFilename(const std::string& source) {
+  if (s_directory.empty())
+    return source + ".vmesh";
+
+  // Meshes with the same name in different directories must not collide
+  size_t slash = source.find_last_of("/\\");
+  std::string name = (slash == std::string::npos) 
+                   ? source : source.substr(slash + 1);
+  unsigned long long hash = HashBytes(source);
+  char suffix[32];
+  sprintf(suffix, ".%08x%08x.vmesh", (unsigned int)(hash >> 32), 
+          (unsigned int)(hash & 0xffffffffULL));
+  return s_directory + name + suffix;
+}
+////////////////////////////// class MeshCache /////////////////////////////////
+bool MeshCache::Load(const std::string& source, MeshData& data, 
+                     MeshBVH& hierarchy) {
+  SourceSignature signature;
+  if (!GetSignature(source, signature))
+    return false;
+
+  std::string filename = GetFilename(source);
+  MappedFile* file = new MappedFile();
+  try {
+    file->Open(filename);
+  } catch(Exception exc) {
+    delete file;
+    return false;
+  }
+
+  // Outdated or corrupted file
+  CacheHeader header;
+  bool valid = CheckHeader(*file, header, signature);
+  if (valid) {
+    unsigned long long checksum 
+        = HashSection(kFNV_OFFSET, file->data() + sizeof(header), 
+                      file->size() - sizeof(header));
+    valid = (checksum == header.checksum);
+  }
+  if (valid) {
+    CopySection(*file, header, kVERTICES, data.vertices);
+    CopySection(*file, header, kNORMALS, data.normals);
+    CopySection(*file, header, kTEXCOORDS, data.texcoords);
+    CopySection(*file, header, kVERTEX_INDICES, data.vertex_indices);
+    CopySection(*file, header, kNORMAL_INDICES, data.normal_indices);
+    CopySection(*file, header, kTEXCOORD_INDICES, data.texcoord_indices);
+    valid = CheckIndices(data.vertex_indices, data.vertices.size(), false)
+         && CheckIndices(data.normal_indices, data.normals.size(), true)
+         && CheckIndices(data.texcoord_indices, data.texcoords.size(), true)
+         && CheckNodes((const MeshBVH::Node*)(file->data() 
+                                              + header.offsets[kNODES]),
+                       header.counts[kNODES], data.nb_triangles());
+  }
+  if (!valid) {
+    VrtLog::Write("(MeshCache::Load) Fichier de cache perime ou invalide: %s",
+                  filename.c_str());
+    data.clear();
+    delete file;
+    return false;
+  }
+
+  // The nodes are used in place, the mapping lives with the hierarchy
+  hierarchy.Adopt((const MeshBVH::Node*)(file->data() 
+                                         + header.offsets[kNODES]),
+                  (unsigned int)header.counts[kNODES], file);
+  VrtLog::Write("-- MeshCache::Load(%s)", filename.c_str());
+  return true;
+}
+////////////////////////////// class MeshCache /////////////////////////////////
+void MeshCache::Save(const std::string& source, const MeshData& data, 
+                     const MeshBVH& hierarchy) {
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  SourceSignature signature;
+  if (!GetSignature(source, signature))
+    return;
+  header.source_size = signature.size;
+  header.source_time = signature.time;
+  header.source_hash = signature.hash;
+  memcpy(header.magic, kMAGIC, 4);
+  header.version = kVERSION;
+  header.real_size = sizeof(Real);
+  header.node_size = sizeof(MeshBVH::Node);
+
+  const void* sections[kNB_SECTIONS] = {
+    data.vertices.empty() ? NULL : &data.vertices[0],
+    data.normals.empty() ? NULL : &data.normals[0],
+    data.texcoords.empty() ? NULL : &data.texcoords[0],
+    data.vertex_indices.empty() ? NULL : &data.vertex_indices[0],
+    data.normal_indices.empty() ? NULL : &data.normal_indices[0],
+    data.texcoord_indices.empty() ? NULL : &data.texcoord_indices[0],
+    hierarchy.nodes()
+  };
+  header.counts[kVERTICES] = data.vertices.size();
+  header.counts[kNORMALS] = data.normals.size();
+  header.counts[kTEXCOORDS] = data.texcoords.size();
+  header.counts[kVERTEX_INDICES] = data.vertex_indices.size();
+  header.counts[kNORMAL_INDICES] = data.normal_indices.size();
+  header.counts[kTEXCOORD_INDICES] = data.texcoord_indices.size();
+  header.counts[kNODES] = hierarchy.nb_nodes();
+
+  unsigned long long offset = sizeof(header);
+  header.checksum = kFNV_OFFSET;
+  for (int s = 0; s < kNB_SECTIONS; s++) {
+    size_t size = (size_t)header.counts[s] * kELEMENT_SIZES[s];
+    header.offsets[s] = offset;
+    header.checksum = HashSection(header.checksum, sections[s], size);
+    offset += size + Padding(size);
+  }
+
+  // Several jobs (or MPI ranks) may write the same file: write a temporary
+  // file, then rename it
+  std::string filename = GetFilename(source);
+  char suffix[32];
+  sprintf(suffix, ".%08x.tmp", 
+          (unsigned int)rand() ^ (unsigned int)clock() 
+          ^ (unsigned int)(size_t)&header);
+  std::string temporary = filename + suffix;
+
+  FILE* file = fopen(temporary.c_str(), "wb");
+  if (file == NULL) {
+    VrtLog::Write("(MeshCache::Save) Echec de l'ecriture du fichier %s",
+                  temporary.c_str());
+    return;
+  }
+  const char zeros[kALIGNMENT] = {0};
+  bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+  for (int s = 0; ok && s < kNB_SECTIONS; s++) {
+    size_t size = (size_t)header.counts[s] * kELEMENT_SIZES[s];
+    size_t padding = Padding(size);
+    ok = (size == 0 || fwrite(sections[s], 1, size, file) == size)
+      && (padding == 0 || fwrite(zeros, 1, padding, file) == padding);
+  }
+  ok = (fclose(file) == 0) && ok;
+
+  // Replace the file (rename fails on Windows if the file already exists)
+  if (ok && std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(filename.c_str());
+    ok = (std::rename(temporary.c_str(), filename.c_str()) == 0);
+  }
+  if (!ok) {
+    VrtLog::Write("(MeshCache::Save) Echec de l'ecriture du fichier %s",
+                  filename.c_str());
+    std::remove(temporary.c_str());
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -30,10 +30,34 @@
 #include <fstream>
 #include <iostream>
 
+#include <omp.h>
+
 #include <core/VrtLog.hpp>
 #include <exceptions/Exception.hpp>
+#include <io/mesh/MeshCache.hpp>
+#include <io/mesh/OBJLoader.hpp>
 //////////////////////////////// class MeshParser //////////////////////////////
-Mesh* MeshParser::loadMesh3(std::string filename, bool double_sided)
+Mesh* MeshParser::loadMesh3(std::string filename, bool double_sided, 
+                            bool compact)
+{
+  MeshBVH* hierarchy = new MeshBVH();
+  MeshData data;
+  try {
+    if(!MeshCache::Load(filename, data, *hierarchy)) {
+      readMesh3(filename, data);
+      buildHierarchy(data, *hierarchy);
+      MeshCache::Save(filename, data, *hierarchy);
+    }
+  } catch(...) {
+    delete hierarchy;
+    throw;
+  }
+  Mesh* mesh = createMesh(data, hierarchy, double_sided, compact);
+  mesh->printMemoryReport(filename);
+  return mesh;
+}
+//////////////////////////////// class MeshParser //////////////////////////////
+void MeshParser::readMesh3(const std::string& filename, MeshData& data)
 {
   //Open the file
   std::fstream input(filename.c_str(), std::fstream::in);
@@ -50,16 +74,16 @@ Mesh* MeshParser::loadMesh3(std::string filename, bool double_sided)
   for(int i=0; i<6; i++)
     input >> ignoref;
 
-  //Reading vertex data
-  Point* vertices = new Point[nbVertex];
-  Vector* normals = new Vector[nbVertex];
-  int* faces = new int[3*nbFace];
+  //Reading vertex data (one normal per vertex)
+  data.vertices.resize(nbVertex);
+  data.normals.resize(nbVertex);
   for(int i = 0; i < nbVertex; i++) {
-    input >> vertices[i][0] >> vertices[i][1] >> vertices[i][2]
-          >> normals[i][0]  >> normals[i][1]  >> normals[i][2];
+    input >> data.vertices[i][0] >> data.vertices[i][1] >> data.vertices[i][2]
+          >> data.normals[i][0]  >> data.normals[i][1]  >> data.normals[i][2];
   }
 
   //Reading face data
+  data.vertex_indices.resize(3*nbFace);
   int current_face=0;
   int numInBound=0;
   for(int i = 0; i < nbBoundingBox; i++) {
@@ -70,143 +94,108 @@ Mesh* MeshParser::loadMesh3(std::string filename, bool double_sided)
       input >> ignoref;
    
     //Reading face contained in the bounding box
-    for(int j = 0; j < numInBound; j++) {
+    for(int j = 0; j < numInBound && current_face < nbFace; j++) {
       //Reading face information
-      for(int k = 0; k < 3; k++)
-        input >> faces[current_face*3 + k];
+      for(int k = 0; k < 3; k++) {
+        int index;
+        input >> index;
+        if(index < 0 || index >= nbVertex)
+          throw Exception("(MeshParser::loadMesh3) Indice hors limites dans "
+                          "le fichier " + filename);
+        data.vertex_indices[current_face*3 + k] = (unsigned int)index;
+      }
       //Ignoring face normal
       for(int k = 0; k < 3; k++)
         input >> ignoref;
       current_face++;
     }
   }
+  data.vertex_indices.resize(3*current_face);
+  data.normal_indices = data.vertex_indices;
+  data.texcoord_indices.assign(data.vertex_indices.size(), 
+                               (unsigned int)MeshData::kNO_INDEX);
   
   //Closing file
   input.close();
+}
+//////////////////////////////// class MeshParser //////////////////////////////
+Mesh* MeshParser::loadOBJ(std::string filename, bool double_sided, 
+                          bool compact) {
+  VrtLog::Write("-- MeshParser::loadOBJ(%s)", filename.c_str());
+  double start = omp_get_wtime();
 
-  //Building triangles
-  Triangle* triangles = new Triangle[nbFace];
-  for(int i = 0; i < nbFace; i++) { 
-    Point2D surfaceCoordinates[3];
-    surfaceCoordinates[0][0] = 0; surfaceCoordinates[0][1] = 0;
-    surfaceCoordinates[1][0] = 0; surfaceCoordinates[1][1] = 0;
-    surfaceCoordinates[2][0] = 0; surfaceCoordinates[2][1] = 0;
-
-    Point verticestopass[3] = { vertices[faces[i*3]], 
-                                vertices[faces[i*3+1]], 
-                                vertices[faces[i*3+2]] };
-    Vector normalstopass[3] = { normals[faces[i*3]], 
-                                normals[faces[i*3+1]], 
-                                normals[faces[i*3+2]] };
-
-    triangles[i].set(verticestopass, normalstopass, surfaceCoordinates, double_sided);
+  MeshBVH* hierarchy = new MeshBVH();
+  MeshData data;
+  bool cached = false;
+  try {
+    cached = MeshCache::Load(filename, data, *hierarchy);
+    if(!cached) {
+      OBJLoader::Load(filename, data);
+      buildHierarchy(data, *hierarchy);
+      MeshCache::Save(filename, data, *hierarchy);
+    }
+  } catch(...) {
+    delete hierarchy;
+    throw;
   }
+  double loaded = omp_get_wtime();
+  unsigned int nb_vertices = (unsigned int)data.vertices.size();
 
-  //Building mesh
-  Mesh* mesh= new Mesh(triangles, nbFace);
-  
-  //Free temporary arrays.
-  delete[] vertices;
-  delete[] normals;
-  delete[] faces;
-  delete[] triangles;
-  
-  //Done !
+  Mesh* mesh = createMesh(data, hierarchy, double_sided, compact);
+  VrtLog::Write("-- MeshParser::loadOBJ : %u triangles, %u vertices, "
+                "%s in %.3f s, built in %.3f s", 
+                mesh->getNbTriangles(), nb_vertices,
+                cached ? "cache loaded" : "parsed and cached", 
+                loaded - start, omp_get_wtime() - loaded);
+  mesh->printMemoryReport(filename);
   return mesh;
 }
 //////////////////////////////// class MeshParser //////////////////////////////
-Mesh* MeshParser::loadOBJ(std::string filename, bool double_sided) {
-  VrtLog::Write("-- MeshParser::loadOBJ(%s)", filename.c_str());
-  
-  //Open the file
-  std::fstream input(filename.c_str(), std::fstream::in);
-  if(!input.is_open()) {
-    throw Exception("(MeshParser::loadOBJ) Ouverture du fichier " 
-                    + filename + " impossible.");
+Mesh* MeshParser::buildMesh(MeshData& data, bool double_sided, 
+                            bool compact) {
+  MeshBVH* hierarchy = new MeshBVH();
+  buildHierarchy(data, *hierarchy);
+  return createMesh(data, hierarchy, double_sided, compact);
+}
+//////////////////////////////// class MeshParser //////////////////////////////
+void MeshParser::buildHierarchy(MeshData& data, MeshBVH& hierarchy) {
+  int nbTriangles = (int)data.nb_triangles();
+
+  //Bounds of the triangles
+  std::vector<BoundingBox> bounds(nbTriangles);
+  int i;
+# pragma omp parallel for private(i) schedule(static)
+  for(i = 0; i < nbTriangles; i++) {
+    const Point& p = data.vertices[data.vertex_indices[3*i]];
+    bounds[i] = BoundingBox(p[0], p[0], p[1], p[1], p[2], p[2]);
+    bounds[i].updateWith(data.vertices[data.vertex_indices[3*i + 1]]);
+    bounds[i].updateWith(data.vertices[data.vertex_indices[3*i + 2]]);
   }
-  std::vector<Point> vertices;
-  std::vector<Vector> normals;
-  std::vector<Point2D> texcoords;
-  std::vector<Face> faces;
 
-  while(input.good()) {
-    eatWhiteSpace(input);
+  std::vector<unsigned int> order;
+  hierarchy.Build(bounds, order);
 
-    char tmp;
-    input >> tmp;
-    switch(tmp) {
-    case 'v': {
-      input >> tmp;
-      if(tmp == 'n') {
-        Vector norm;
-        input >> norm[0] >> norm[1] >> norm[2];
-        normals.push_back(norm);
-      } else if(tmp=='t') {
-        Point2D coord;
-        input >> coord[0] >> coord[1];
-        texcoords.push_back(coord);
-      } else {
-        input.unget();
-        Point vert;
-        input >> vert[0] >> vert[1] >> vert[2];
-        vertices.push_back(vert);
-      }
-      break;
-    }
-    case 'f': {
-      Face face;
-      for(int i = 0; i < 3; i++) {
-        int index;
-        //Vertex
-        input >> index;
-        face.vertices[i] = vertices[index-1];
-        input.ignore(1);
-        //Texture coordinate
-        input >> tmp;
-        if(tmp != '/') {
-          input.unget();
-          input >> index;
-          face.texcoords[i] = texcoords[index-1];
-          input.ignore(1);
-        }
-        //Normal
-        input >> index;
-        face.normals[i] = normals[index-1];
-      }
-      faces.push_back(face);
-      break;
+  //Sorting the corners in the order of the leaves
+  std::vector<unsigned int>* indices[3] = { &data.vertex_indices, 
+                                            &data.normal_indices,
+                                            &data.texcoord_indices };
+  for(int a = 0; a < 3; a++) {
+    std::vector<unsigned int> sorted(indices[a]->size());
+#   pragma omp parallel for private(i) schedule(static)
+    for(i = 0; i < nbTriangles; i++) {
+      for(int k = 0; k < 3; k++)
+        sorted[3*i + k] = (*indices[a])[3*order[i] + k];
     }
-    default:  {
-      std::string trashline;
-      getline(input, trashline);
-      break;
-      }
-    } 
-  }
-  
-  //Building triangles
-  Triangle* triangles = new Triangle[faces.size()];
-  for(unsigned int i=0; i<faces.size(); i++) {
-    triangles[i].set(faces[i].vertices, faces[i].normals, faces[i].texcoords, double_sided);
-    triangles[i].Print();
+    indices[a]->swap(sorted);
   }
-  //Building mesh
-  Mesh* mesh = new Mesh(triangles, faces.size());
-  
-  //Free temporary arrays.
-  delete[] triangles;
-  
-  //Done !
-  return mesh;
 }
 //////////////////////////////// class MeshParser //////////////////////////////
-void MeshParser::eatWhiteSpace(std::istream& stream)
-{
-  char tmp = 0;
-  stream >> tmp;
-  while(tmp==' ' || tmp=='\t' || tmp=='\n' || tmp=='\r'){
-    stream >> tmp;
+Mesh* MeshParser::createMesh(MeshData& data, MeshBVH* hierarchy, 
+                             bool double_sided, bool compact) {
+  if(data.nb_triangles() == 0) {
+    delete hierarchy;
+    throw Exception("(MeshParser::buildMesh) Le maillage est vide.");
   }
-  stream.unget();
+  return new Mesh(data, hierarchy, double_sided, compact);
 }
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,475 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <io/mesh/OBJLoader.hpp>
+//!
+//! @file OBJLoader.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in OBJLoader.hpp
+//!  @arg OBJLoader
+//!
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <omp.h>
+
+#include <io/MappedFile.hpp>
+#include <exceptions/Exception.hpp>
+
+namespace {
+//! Smallest chunk parsed by a thread
+const size_t kMIN_CHUNK_SIZE = 1 << 20;
+//! Number of chunks per thread (balances lines of different lengths)
+const size_t kCHUNKS_PER_THREAD = 4;
+//! Powers of ten exactly represented by a double
+const double kPOW10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int kMAX_POW10 = 22;
+//! Largest number of significant digits kept in the mantissa
+const int kMAX_DIGITS = 19;
+////////////////////////////////////////////////////////////////////////////////
+//! Triangles parsed from a chunk of lines
+struct OBJChunk {
+  //! Lines of the chunk
+  const char* begin;
+  const char* end;
+  //! Parsed vertices and attributes
+  std::vector<Point> vertices;
+  std::vector<Vector> normals;
+  std::vector<Point2D> texcoords;
+  //! Indices of the corners: absolute, relative to the beginning of the chunk
+  //! (see relative_*) or -1 if the attribute is not given
+  std::vector<int> vertex_indices;
+  std::vector<int> normal_indices;
+  std::vector<int> texcoord_indices;
+  //! Positions of the relative indices
+  std::vector<size_t> relative_vertices;
+  std::vector<size_t> relative_normals;
+  std::vector<size_t> relative_texcoords;
+  //! Number of lines of the chunk
+  unsigned int nb_lines;
+  //! Error message and line (from the beginning of the chunk)
+  std::string error;
+  unsigned int error_line;
+};
+////////////////////////////////////////////////////////////////////////////////
+//! Corners of the polygon being parsed
+struct OBJPolygon {
+  std::vector<int> indices[3];
+  std::vector<bool> relative[3];
+};
+////////////////////////////////////////////////////////////////////////////////
+inline bool IsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+////////////////////////////////////////////////////////////////////////////////
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+////////////////////////////////////////////////////////////////////////////////
+inline const char* SkipBlanks(const char* p, const char* end) {
+  while (p < end && IsBlank(*p))
+    p++;
+  return p;
+}
+////////////////////////////////////////////////////////////////////////////////
+inline const char* SkipLine(const char* p, const char* end) {
+  while (p < end && *p != '\n')
+    p++;
+  return (p < end) ? p + 1 : end;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Parse a decimal real number (p is moved after the number on success)
+bool ParseReal(const char*& p, const char* end, Real& value) {
+  const char* q = p;
+  bool negative = false;
+  if (q < end && (*q == '-' || *q == '+')) {
+    negative = (*q == '-');
+    q++;
+  }
+
+  // Significant digits and decimal exponent
+  unsigned long long mantissa = 0;
+  int nb_digits = 0;
+  int exponent = 0;
+  bool found = false;
+  for (; q < end && IsDigit(*q); q++) {
+    found = true;
+    if (nb_digits < kMAX_DIGITS) {
+      mantissa = mantissa * 10 + (*q - '0');
+      if (mantissa != 0)
+        nb_digits++;
+    } else {
+      exponent++;
+    }
+  }
+  if (q < end && *q == '.') {
+    for (q++; q < end && IsDigit(*q); q++) {
+      found = true;
+      if (nb_digits < kMAX_DIGITS) {
+        mantissa = mantissa * 10 + (*q - '0');
+        if (mantissa != 0)
+          nb_digits++;
+        exponent--;
+      }
+    }
+  }
+  if (!found)
+    return false;
+
+  // Exponent part (ignored if it is not followed by digits)
+  if (q < end && (*q == 'e' || *q == 'E')) {
+    const char* e = q + 1;
+    bool negative_exponent = false;
+    if (e < end && (*e == '-' || *e == '+')) {
+      negative_exponent = (*e == '-');
+      e++;
+    }
+    if (e < end && IsDigit(*e)) {
+      int value = 0;
+      for (; e < end && IsDigit(*e); e++) {
+        if (value < 10000)
+          value = value * 10 + (*e - '0');
+      }
+      exponent += negative_exponent ? -value : value;
+      q = e;
+    }
+  }
+
+  double result = (double)mantissa;
+  if (mantissa != 0 && exponent < 0) {
+    if (-exponent <= kMAX_POW10)
+      result /= kPOW10[-exponent];
+    else
+      result *= std::pow(10.0, exponent);
+  } else if (mantissa != 0 && exponent > 0) {
+    if (exponent <= kMAX_POW10)
+      result *= kPOW10[exponent];
+    else
+      result *= std::pow(10.0, exponent);
+  }
+  value = (Real)(negative ? -result : result);
+  p = q;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Parse the first coordinates of a statement (the others are optional)
+bool ParseReals(const char*& p, const char* end, Real* values,
+                int nb_required, int nb_optional) {
+  for (int k = 0; k < nb_required + nb_optional; k++) {
+    p = SkipBlanks(p, end);
+    if (!ParseReal(p, end, values[k]) && k < nb_required)
+      return false;
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Parse an integer (p is moved after the number on success)
+bool ParseIndex(const char*& p, const char* end, int& value) {
+  const char* q = p;
+  bool negative = false;
+  if (q < end && (*q == '-' || *q == '+')) {
+    negative = (*q == '-');
+    q++;
+  }
+  if (q >= end || !IsDigit(*q))
+    return false;
+
+  long long index = 0;
+  for (; q < end && IsDigit(*q); q++) {
+    if (index <= 0x7fffffffLL)
+      index = index * 10 + (*q - '0');
+  }
+  if (index > 0x7fffffffLL)
+    index = 0x7fffffffLL;
+  value = negative ? -(int)index : (int)index;
+  p = q;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Store the index of an attribute of a corner (0: attribute not given)
+inline void AddCorner(int index, size_t count,
+                      std::vector<int>& indices, std::vector<bool>& relative) {
+  if (index > 0) {
+    indices.push_back(index - 1);
+    relative.push_back(false);
+  } else if (index < 0) {
+    indices.push_back((int)count + index);
+    relative.push_back(true);
+  } else {
+    indices.push_back(-1);
+    relative.push_back(false);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Store a corner of a polygon as a corner of a triangle
+inline void EmitCorner(const OBJPolygon& polygon, size_t corner,
+                       OBJChunk& chunk) {
+  std::vector<int>* indices[3] = { &chunk.vertex_indices, 
+                                   &chunk.texcoord_indices,
+                                   &chunk.normal_indices };
+  std::vector<size_t>* relative[3] = { &chunk.relative_vertices, 
+                                       &chunk.relative_texcoords,
+                                       &chunk.relative_normals };
+  for (int a = 0; a < 3; a++) {
+    if (polygon.relative[a][corner])
+      relative[a]->push_back(indices[a]->size());
+    indices[a]->push_back(polygon.indices[a][corner]);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Parse the corners of a polygon and triangulate it as a fan
+bool ParseFace(const char*& p, const char* end, OBJPolygon& polygon,
+               OBJChunk& chunk) {
+  for (int a = 0; a < 3; a++) {
+    polygon.indices[a].clear();
+    polygon.relative[a].clear();
+  }
+
+  while (true) {
+    p = SkipBlanks(p, end);
+    if (p >= end || *p == '\n' || *p == '#')
+      break;
+
+    // v, v/vt, v//vn or v/vt/vn
+    int v = 0, vt = 0, vn = 0;
+    if (!ParseIndex(p, end, v) || v == 0)
+      return false;
+    if (p < end && *p == '/') {
+      p++;
+      if (p < end && *p != '/' && !IsBlank(*p) && *p != '\n'
+          && !ParseIndex(p, end, vt))
+        return false;
+      if (p < end && *p == '/') {
+        p++;
+        if (!ParseIndex(p, end, vn))
+          return false;
+      }
+    }
+    AddCorner(v, chunk.vertices.size(), 
+              polygon.indices[0], polygon.relative[0]);
+    AddCorner(vt, chunk.texcoords.size(), 
+              polygon.indices[1], polygon.relative[1]);
+    AddCorner(vn, chunk.normals.size(), 
+              polygon.indices[2], polygon.relative[2]);
+  }
+
+  // Degenerated polygons are ignored
+  size_t nb_corners = polygon.indices[0].size();
+  for (size_t i = 1; i + 1 < nb_corners; i++) {
+    EmitCorner(polygon, 0, chunk);
+    EmitCorner(polygon, i, chunk);
+    EmitCorner(polygon, i + 1, chunk);
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Parse the lines of a chunk
+void ParseChunk(OBJChunk& chunk) {
+  OBJPolygon polygon;
+  const char* p = chunk.begin;
+  const char* end = chunk.end;
+  chunk.nb_lines = 0;
+
+  while (p < end) {
+    // Keyword of the statement
+    p = SkipBlanks(p, end);
+    const char* keyword = p;
+    while (p < end && !IsBlank(*p) && *p != '\n')
+      p++;
+    size_t length = p - keyword;
+    bool valid = true;
+
+    if (length == 1 && keyword[0] == 'v') {
+      Point vertex;
+      valid = ParseReals(p, end, vertex.coord, 3, 0);
+      if (valid)
+        chunk.vertices.push_back(vertex);
+
+    } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+      Real normal[3];
+      valid = ParseReals(p, end, normal, 3, 0);
+      if (valid)
+        chunk.normals.push_back(Vector(normal));
+
+    } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+      // The second coordinate is optional
+      Point2D texcoord;
+      texcoord[1] = 0.0;
+      valid = ParseReals(p, end, texcoord.coord, 1, 1);
+      if (valid)
+        chunk.texcoords.push_back(texcoord);
+
+    } else if (length == 1 && keyword[0] == 'f') {
+      valid = ParseFace(p, end, polygon, chunk);
+    }
+
+    if (!valid) {
+      chunk.error = "Instruction " + std::string(keyword, length) 
+                    + " invalide";
+      chunk.error_line = chunk.nb_lines;
+      return;
+    }
+    p = SkipLine(p, end);
+    chunk.nb_lines++;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Make the indices of a chunk absolute, check them and copy them into the
+//! shared array (from position)
+bool ResolveIndices(std::vector<int>& indices, 
+                    const std::vector<size_t>& relative,
+                    size_t offset, size_t count, 
+                    std::vector<unsigned int>& result, size_t position) {
+  for (size_t i = 0; i < relative.size(); i++) {
+    indices[relative[i]] += (int)offset;
+    if (indices[relative[i]] < 0)
+      return false;
+  }
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] < 0) {
+      result[position + i] = MeshData::kNO_INDEX;
+    } else if ((size_t)indices[i] >= count) {
+      return false;
+    } else {
+      result[position + i] = (unsigned int)indices[i];
+    }
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Free the memory of a vector
+template <class T>
+inline void FreeVector(std::vector<T>& v) {
+  std::vector<T>().swap(v);
+}
+} // namespace
+////////////////////////////// class OBJLoader /////////////////////////////////
+void OBJLoader::Load(const std::string& filename, MeshData& data) {
+  MappedFile file;
+  file.Open(filename);
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+
+  // Split the file into chunks of whole lines
+  size_t nb_chunks = file.size() / kMIN_CHUNK_SIZE;
+  nb_chunks = std::min(nb_chunks, kCHUNKS_PER_THREAD * omp_get_max_threads());
+  nb_chunks = std::max(nb_chunks, (size_t)1);
+  std::vector<OBJChunk> chunks(nb_chunks);
+  const char* start = begin;
+  for (size_t c = 0; c < nb_chunks; c++) {
+    const char* stop = end;
+    if (c + 1 < nb_chunks) {
+      stop = std::max(begin + (c + 1) * (file.size() / nb_chunks), start);
+      if (stop > begin && stop[-1] != '\n')
+        stop = SkipLine(stop, end);
+    }
+    chunks[c].begin = start;
+    chunks[c].end = stop;
+    start = stop;
+  }
+
+  // Parse the chunks
+  int c;
+# pragma omp parallel for private(c) schedule(dynamic, 1)
+  for (c = 0; c < (int)nb_chunks; c++)
+    ParseChunk(chunks[c]);
+
+  // Report the first error of the file
+  unsigned int line = 0;
+  for (size_t i = 0; i < nb_chunks; i++) {
+    if (!chunks[i].error.empty()) {
+      char buffer[32];
+      sprintf(buffer, "%u", line + chunks[i].error_line + 1);
+      throw Exception("(OBJLoader::Load) " + chunks[i].error + " a la ligne "
+                      + buffer + " du fichier " + filename);
+    }
+    line += chunks[i].nb_lines;
+  }
+
+  // Position of the chunks in the shared arrays
+  std::vector<size_t> vertex_offsets(nb_chunks + 1, 0);
+  std::vector<size_t> normal_offsets(nb_chunks + 1, 0);
+  std::vector<size_t> texcoord_offsets(nb_chunks + 1, 0);
+  std::vector<size_t> corner_offsets(nb_chunks + 1, 0);
+  for (size_t i = 0; i < nb_chunks; i++) {
+    vertex_offsets[i + 1] = vertex_offsets[i] + chunks[i].vertices.size();
+    normal_offsets[i + 1] = normal_offsets[i] + chunks[i].normals.size();
+    texcoord_offsets[i + 1] = texcoord_offsets[i] + chunks[i].texcoords.size();
+    corner_offsets[i + 1] = corner_offsets[i] 
+                            + chunks[i].vertex_indices.size();
+  }
+  size_t nb_vertices = vertex_offsets[nb_chunks];
+  size_t nb_normals = normal_offsets[nb_chunks];
+  size_t nb_texcoords = texcoord_offsets[nb_chunks];
+  size_t nb_corners = corner_offsets[nb_chunks];
+  data.vertices.resize(nb_vertices);
+  data.normals.resize(nb_normals);
+  data.texcoords.resize(nb_texcoords);
+  data.vertex_indices.resize(nb_corners);
+  data.normal_indices.resize(nb_corners);
+  data.texcoord_indices.resize(nb_corners);
+
+  // Gather the chunks
+  int nb_errors = 0;
+# pragma omp parallel for private(c) schedule(dynamic, 1) \
+      reduction(+: nb_errors)
+  for (c = 0; c < (int)nb_chunks; c++) {
+    OBJChunk& chunk = chunks[c];
+    std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+              data.vertices.begin() + vertex_offsets[c]);
+    std::copy(chunk.normals.begin(), chunk.normals.end(),
+              data.normals.begin() + normal_offsets[c]);
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+              data.texcoords.begin() + texcoord_offsets[c]);
+
+    size_t corner = corner_offsets[c];
+    if (!ResolveIndices(chunk.vertex_indices, chunk.relative_vertices,
+                        vertex_offsets[c], nb_vertices, 
+                        data.vertex_indices, corner)
+        || !ResolveIndices(chunk.normal_indices, chunk.relative_normals,
+                           normal_offsets[c], nb_normals, 
+                           data.normal_indices, corner)
+        || !ResolveIndices(chunk.texcoord_indices, chunk.relative_texcoords,
+                           texcoord_offsets[c], nb_texcoords, 
+                           data.texcoord_indices, corner))
+      nb_errors++;
+
+    // Release the chunk as soon as possible (large files)
+    FreeVector(chunk.vertices);
+    FreeVector(chunk.normals);
+    FreeVector(chunk.texcoords);
+    FreeVector(chunk.vertex_indices);
+    FreeVector(chunk.normal_indices);
+    FreeVector(chunk.texcoord_indices);
+  }
+
+  if (nb_errors > 0) {
+    throw Exception("(OBJLoader::Load) Indice hors limites dans le fichier " 
+                    + filename);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -69,7 +69,11 @@ Environment* V2EnvironmentParser::CreateSphericalEnvironment(
 
   Real environment_power = getRealValue(node, "envpower", Real(0.01));
 
-  return new SphericalEnvironment(environment, environment_power);
+  // Directions of the environment sampled for the direct lighting
+  unsigned int nb_samples = getIntegerValue(node, "samples", 16);
+
+  return new SphericalEnvironment(environment, environment_power, 
+                                  nb_samples);
 }
 ////////////////////////////////////////////////////////////////////////////////
 Environment* V2EnvironmentParser::CreateSpectralEnvironment(XMLTree* node) {
@@ -24,6 +24,8 @@
 #include <lightsources/DirectionalLightSource.hpp>
 #include <lightsources/SurfaceLightSource.hpp>
 #include <lightsources/PlaneLightSource.hpp>
+#include <lightsources/MeshLightSource.hpp>
+#include <io/sceneryV2/V2ObjectShapeParser.hpp>
 
 /**
  * Create the ray caster by using the informations of the node.
@@ -41,6 +43,8 @@ LightSource* V2LightSourceParser::create(XMLTree* node)
     return createSurfaceLightSource(node);
   else if(type=="Plane")
     return createPlaneLightSource(node);
+  else if(type=="Mesh")
+    return createMeshLightSource(node);
 
   throw Exception("(V1V2LightSourceParser::create) Type de <source> " + type + " inconnu.");
 }
@@ -165,3 +169,28 @@ Real power = getRealValue(node, "power", 0.0);
     return new PlaneLightSource(spectrum, power, o, normal, u, v, nbSamples);
 }
 
+/**
+ * Create the light source by using the informations of the node. The mesh
+ * is shared with the geometries loading the same file with the same options.
+ * @param node : the XML node to use for the creation.
+ * @return : the parsed LightSource
+ */
+LightSource* V2LightSourceParser::createMeshLightSource(XMLTree* node)
+{
+  Real power = getRealValue(node, "power", 0.0);
+  unsigned int nbSamples = getIntegerValue(node, "samples", 10);
+
+  std::string filename = node->getAttributeValue("file");
+  std::string format = node->getAttributeValue("format");
+  if(format != "" && format != "OBJ" && format != "Mesh3")
+    throw Exception("(V2LightSourceParser::createMeshLightSource) Format de maillage " + format + " inconnu.");
+  bool double_sided = getBooleanValue(node, "backface", false);
+  bool compact = getBooleanValue(node, "compact", false);
+  Mesh* mesh = V2ObjectShapeParser::getSharedMesh(filename, format != "Mesh3", double_sided, compact);
+
+  Spectrum spectrum;
+  DataParser parser;
+  parser.loadSpectralIlluminant(node->getAttributeValue("spectrum"), spectrum);
+
+  return new MeshLightSource(spectrum, power, mesh, double_sided, nbSamples);
+}
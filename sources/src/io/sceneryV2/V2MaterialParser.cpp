@@ -87,9 +87,15 @@ Material* V2MaterialParser::create(
   }
 
   //Try to get the material from the library
+  //(the library is shared by the surfaces built in parallel)
   std::string name = node->getAttributeValue("name");
+  Material* libraryMaterial = NULL;
+# pragma omp critical (material_library)
   if(name != "" && _materialLibrary.contain(name)) {
-    return new InstanceBRDF(_materialLibrary.get(name));
+    libraryMaterial = _materialLibrary.get(name);
+  }
+  if(libraryMaterial != NULL) {
+    return new InstanceBRDF(libraryMaterial);
   }
 
   //Create the material
@@ -133,6 +139,7 @@ Material* V2MaterialParser::create(
   }
   //Add the material to the library
   if(name != "") {
+#   pragma omp critical (material_library)
     _materialLibrary.add(name, material);
   }
   //Return the material
@@ -546,12 +553,11 @@ Material* V2MaterialParser::createSpecularLayeredMaterial(
 
   //Compute reflectance and transmittance
   std::vector<Spectrum> Rp(SAMPLES), Rs(SAMPLES), Tp(SAMPLES), Ts(SAMPLES);
+  LayeredSystemComputer::computeSpecularLayerTable(
+      Rs, Rp, Ts, Tp, 
+      SAMPLES, layers, thickness);
   for(unsigned int iOi = 0; iOi < SAMPLES; iOi++) {
     Real Oi = iOi*M_PI*0.5/(Real)SAMPLES;
-    Real cosOi = std::cos(Oi);
-    LayeredSystemComputer::computeSpecularLayerSystem(Rs[iOi], Rp[iOi], Ts[iOi], 
-                                                      Tp[iOi], cosOi, 
-                                                      layers, thickness);
 
     for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++) { 
       if(!(Rp[iOi][i] < 1.0001)) {
@@ -637,18 +643,17 @@ Material* V2MaterialParser::createVarnishedLayeredMaterial(
   std::vector<Spectrum> R13p(SAMPLES), R13s(SAMPLES);
   std::vector<Spectrum> T13p(SAMPLES), T13s(SAMPLES);
   
+  LayeredSystemComputer::computeSpecularLayerTable(
+      R12s, R12p, T12s, T12p, 
+      SAMPLES, var_layers, var_thickness);
+  LayeredSystemComputer::computeSpecularLayerTable(
+      R21s, R21p, T21s, T21p, 
+      SAMPLES, ivar_layers, ivar_thickness);
+  LayeredSystemComputer::computeSpecularLayerTable(
+      R13s, R13p, T13s, T13p, 
+      SAMPLES, layers, thickness);
   for(unsigned int iOi = 0; iOi < SAMPLES; iOi++) {
     Real Oi = iOi*M_PI*0.5/(Real)SAMPLES;
-    Real cosOi = std::cos(Oi);
-    LayeredSystemComputer::computeSpecularLayerSystem(
-                            R12s[iOi], R12p[iOi], T12s[iOi], T12p[iOi], 
-                            cosOi, var_layers, var_thickness);
-    LayeredSystemComputer::computeSpecularLayerSystem(
-                            R21s[iOi], R21p[iOi], T21s[iOi], T21p[iOi], 
-                            cosOi, ivar_layers, ivar_thickness);
-    LayeredSystemComputer::computeSpecularLayerSystem(
-                            R13s[iOi], R13p[iOi], T13s[iOi], T13p[iOi], 
-                            cosOi, layers, thickness);
 
     for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++) {
       if(!(R12p[iOi][i] < 1.0001)) {
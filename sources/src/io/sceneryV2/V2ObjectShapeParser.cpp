@@ -19,6 +19,9 @@
 #include <io/image/ImageParser.hpp>
 #include <exceptions/Exception.hpp>
 #include <string>
+#include <cstdlib>
+#include <climits>
+#include <cmath>
 #include <core/3DBase.hpp>
 
 #include <objectshapes/Sphere.hpp>
@@ -28,6 +31,7 @@
 #include <objectshapes/NormalMap.hpp>
 #include <objectshapes/NullGeometry.hpp>
 #include <objectshapes/InstanceObjectShape.hpp>
+#include <objectshapes/Instance.hpp>
 
 #include <objectshapes/Translation.hpp>
 #include <objectshapes/Scale.hpp>
@@ -35,6 +39,27 @@
 #include <objectshapes/Transformation.hpp>
 
 HashMap<std::string, ObjectShape*,StringHashFunctor> V2ObjectShapeParser::_shapeLibrary(StringHashFunctor(), 100);
+HashMap<std::string, ObjectShape*,StringHashFunctor> V2ObjectShapeParser::_meshLibrary(StringHashFunctor(), 100);
+
+namespace {
+/**
+ * Absolute name of a file, so that the different paths to a same file give
+ * the same mesh. The name is kept as is if the file can not be resolved.
+ */
+std::string canonicalFilename(const std::string& filename)
+{
+#ifdef _WIN32
+  char buffer[_MAX_PATH];
+  if(_fullpath(buffer, filename.c_str(), _MAX_PATH) != NULL)
+    return buffer;
+#else
+  char buffer[PATH_MAX];
+  if(realpath(filename.c_str(), buffer) != NULL)
+    return buffer;
+#endif
+  return filename;
+}
+} // namespace
 
 /**
  * Create the object shape by using the informations of the node.
@@ -44,9 +69,14 @@ ObjectShape* V2ObjectShapeParser::create(XMLTree* node)
 {
 
   //Try to get the shape from the library
+  //(the library is shared by the surfaces built in parallel)
   std::string name = node->getAttributeValue("name");
+  ObjectShape* libraryShape = NULL;
+# pragma omp critical (shape_library)
   if(name!="" && _shapeLibrary.contain(name))
-    return new InstanceObjectShape(_shapeLibrary.get(name));
+    libraryShape = _shapeLibrary.get(name);
+  if(libraryShape != NULL)
+    return new InstanceObjectShape(libraryShape);
 
   //Create the shape
   ObjectShape* shape;
@@ -69,6 +99,8 @@ ObjectShape* V2ObjectShapeParser::create(XMLTree* node)
     shape = createRotate(node);
   else if(type=="Scale")
     shape = createScale(node);
+  else if(type=="Instance")
+    shape = createInstance(node);
   else if(type=="NormalMap")
     shape = createNormalMap(node);
   else
@@ -77,7 +109,10 @@ ObjectShape* V2ObjectShapeParser::create(XMLTree* node)
 
     //Add the shape to the library
   if(name!="")
+  {
+#   pragma omp critical (shape_library)
     _shapeLibrary.add(name, shape);
+  }
 
   //Return the shape
   return shape;
@@ -186,12 +221,7 @@ ObjectShape* V2ObjectShapeParser::createTriangle(XMLTree* node)
  */
 ObjectShape* V2ObjectShapeParser::createMesh3(XMLTree* node)
 {
-  MeshParser parser;
-  std::string filename = node->getAttributeValue("file");
-
-	bool double_sided = getBooleanValue( node, "backface", false);
-
-  return parser.loadMesh3(filename, double_sided);
+  return createSharedMesh(node, false);
 }
 
 /**
@@ -201,12 +231,75 @@ ObjectShape* V2ObjectShapeParser::createMesh3(XMLTree* node)
  */
 ObjectShape* V2ObjectShapeParser::createOBJ(XMLTree* node)
 {
-  MeshParser parser;
+  return createSharedMesh(node, true);
+}
+
+/**
+ * Load a mesh file once and share it between all the shapes which use it
+ * with the same options. The mesh (and its hierarchy) belongs to the library:
+ * each shape is an instance of it.
+ * @param node : the XML node to use for the creation.
+ * @param obj : true for an OBJ file, false for a Mesh3 file
+ * @return : the parsed ObjectShape
+ */
+ObjectShape* V2ObjectShapeParser::createSharedMesh(XMLTree* node, bool obj)
+{
   std::string filename = node->getAttributeValue("file");
 
 	bool double_sided = getBooleanValue( node, "backface", false);
+  bool compact = getBooleanValue(node, "compact", false);
 
-  return parser.loadOBJ(filename, double_sided);
+  return new InstanceObjectShape(getSharedMesh(filename, obj, double_sided, compact));
+}
+
+/**
+ * Return the mesh loaded from a file, the file being loaded only by the
+ * first shape (or light source) which uses it.
+ * @param filename : the file of the mesh.
+ * @param obj : true for an OBJ file, false for a Mesh3 file
+ * @param double_sided : true if the normal must be turned toward the ray
+ * @param compact : true to quantize the normals and texture coordinates
+ * @return : the shared mesh
+ */
+Mesh* V2ObjectShapeParser::getSharedMesh(const std::string& filename, bool obj, bool double_sided, bool compact)
+{
+  std::string key = std::string(obj ? "OBJ:" : "Mesh3:") 
+                  + canonicalFilename(filename)
+                  + (double_sided ? ":backface" : "") 
+                  + (compact ? ":compact" : "");
+
+  ObjectShape* mesh = NULL;
+# pragma omp critical (shape_library)
+  if(_meshLibrary.contain(key))
+    mesh = _meshLibrary.get(key);
+
+  if(mesh == NULL)
+  {
+    //The surfaces sharing a file are built in different waves, so the file
+    //is loaded once. Should two loads still race, the first one is kept.
+    MeshParser parser;
+    ObjectShape* loaded;
+    if(obj)
+      loaded = parser.loadOBJ(filename, double_sided, compact);
+    else
+      loaded = parser.loadMesh3(filename, double_sided, compact);
+
+#   pragma omp critical (shape_library)
+    {
+      if(_meshLibrary.contain(key))
+        mesh = _meshLibrary.get(key);
+      else
+      {
+        _meshLibrary.add(key, loaded);
+        mesh = loaded;
+      }
+    }
+    if(mesh != loaded)
+      delete loaded;
+  }
+
+  //The library only holds meshes
+  return static_cast<Mesh*>(mesh);
 }
 
 /**
@@ -286,6 +379,67 @@ ObjectShape* V2ObjectShapeParser::createRotate(XMLTree* node)
   //return new Transformation(shape, axis, angle);
 }
 
+/**
+ * Create the object shape by using the informations of the node.
+ * The transformation is either given by the 12 coefficients of a 3x4 matrix
+ * (attribute "matrix", row by row) or composed as translation * rotation *
+ * scale, with the rotation around x, then y, then z (angles in degrees).
+ * @param node : the XML node to use for the creation.
+ * @return : the parsed ObjectShape
+ */
+ObjectShape* V2ObjectShapeParser::createInstance(XMLTree* node)
+{
+  if(node->getNumberOfChildren()<1 || node->getChild(0)->getMarkup()!="geometry")
+    throw Exception("(V2ObjectShapeParser::createInstance) Pas de <geometry> a instancier.");
+
+  Real matrix[12];
+  std::string coefficients = node->getAttributeValue("matrix");
+  if(coefficients != "")
+  {
+    const char* begin = coefficients.c_str();
+    for(int i=0; i<12; i++)
+    {
+      char* end;
+      matrix[i] = strtod(begin, &end);
+      if(end == begin)
+        throw Exception("(V2ObjectShapeParser::createInstance) La matrice doit avoir 12 coefficients.");
+      begin = end;
+    }
+  }
+  else
+  {
+    Real scale[3] = {getRealValue(node, "sx", 1.0), 
+                     getRealValue(node, "sy", 1.0), 
+                     getRealValue(node, "sz", 1.0)};
+    Real angles[3] = {Real(getRealValue(node, "rx", 0.0) * M_PI/180.0),
+                      Real(getRealValue(node, "ry", 0.0) * M_PI/180.0),
+                      Real(getRealValue(node, "rz", 0.0) * M_PI/180.0)};
+    Real cx = std::cos(angles[0]), sx = std::sin(angles[0]);
+    Real cy = std::cos(angles[1]), sy = std::sin(angles[1]);
+    Real cz = std::cos(angles[2]), sz = std::sin(angles[2]);
+
+    //Rz * Ry * Rx
+    Real rotation[9] = {
+      cz*cy, cz*sy*sx - sz*cx, cz*sy*cx + sz*sx,
+      sz*cy, sz*sy*sx + cz*cx, sz*sy*cx - cz*sx,
+      -sy,   cy*sx,            cy*cx};
+    for(int r=0; r<3; r++)
+      for(int c=0; c<3; c++)
+        matrix[4*r+c] = rotation[3*r+c] * scale[c];
+    matrix[3]  = getRealValue(node, "x", 0.0);
+    matrix[7]  = getRealValue(node, "y", 0.0);
+    matrix[11] = getRealValue(node, "z", 0.0);
+  }
+
+  ObjectShape* shape = create(node->getChild(0));
+  try {
+    return new Instance(matrix, shape);
+  } catch(Exception exc) {
+    delete shape;
+    throw;
+  }
+}
+
 /**
  * Create the object shape by using the informations of the node.
  * @param node : the XML node to use for the creation.
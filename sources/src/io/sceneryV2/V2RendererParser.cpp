@@ -41,6 +41,7 @@
 #include <renderers/TestRenderer.hpp>
 #include <renderers/SimpleRenderer.hpp>
 #include <renderers/PhotonMappingRenderer.hpp>
+#include <renderers/PathTracingRenderer.hpp>
 
 #include <environments/Environment.hpp>
 /////////////////////// class V2RendererParser /////////////////////////////////
@@ -49,23 +50,50 @@ Renderer* V2RendererParser::Create(
     const HashMap<std::string, Texture*, StringHashFunctor> *textureMap) {
 
   std::string type = node->getAttributeValue("type");
+  Renderer* renderer = NULL;
   
   // Simple renderer
   if(type == "SimpleRenderer") {
-    return CreateSimpleRenderer(node, *textureMap);
+    renderer = CreateSimpleRenderer(node, *textureMap);
 
   // photon mapping
   } else if(type == "PhotonMapping") {
-    return CreatePhotonMapping(node, *textureMap);
+    renderer = CreatePhotonMapping(node, *textureMap);
+
+  // path tracing
+  } else if(type == "PathTracing") {
+    renderer = CreatePathTracing(node, *textureMap);
 
   // Test
   } else if(type == "Test") {
-    return CreateTestRenderer(node, *textureMap);
-  }
+    renderer = CreateTestRenderer(node, *textureMap);
 
   // error case
-  throw Exception("(V2RendererParser::create) Type de <Renderer> " 
-                  + type + " inconnu.");
+  } else {
+    throw Exception("(V2RendererParser::create) Type de <Renderer> " 
+                    + type + " inconnu.");
+  }
+
+  // Hero wavelengths: number of wavelengths traced after a dispersive event
+  renderer->SetHeroWavelengths(getIntegerValue(node, "herowavelengths", 0));
+
+  // Light samples: number of sources selected at each shading point, either
+  // proportionally to their power or with a light tree
+  std::string selection = node->getAttributeValue("lightselection");
+  int light_selection = Renderer::kTREE_SELECTION;
+  if(selection == "power") {
+    light_selection = Renderer::kPOWER_SELECTION;
+  } else if(selection != "" && selection != "tree") {
+    throw Exception("(V2RendererParser::create) Selection des sources " 
+                    + selection + " inconnue.");
+  }
+  renderer->SetLightSamples(getIntegerValue(node, "lightsamples", 0), 
+                            light_selection);
+
+  // Russian roulette: depth from which the paths may be terminated (the 
+  // roulette is disabled by default)
+  renderer->SetRussianRoulette(getIntegerValue(node, "roulettedepth", -1));
+  return renderer;
 }
 /////////////////////// class V2RendererParser /////////////////////////////////
 Renderer* V2RendererParser::CreateTestRenderer(
@@ -140,6 +168,11 @@ Renderer* V2RendererParser::CreatePhotonMapping(
                                                          "nbcausticsamples", 0);
   unsigned int nb_samples = getIntegerValue(node, "nbsamples", 0);
   Real estimation_min_distance = getRealValue(node, "estimationdistance", 0.2);
+  bool projection_maps = getBooleanValue(node, "projectionmaps", false);
+  unsigned int nb_importons = getIntegerValue(node, "importons", 0);
+  bool path_guiding = getBooleanValue(node, "pathguiding", false);
+  bool irradiance_cache = getBooleanValue(node, "irradiancecache", false);
+  Real cache_accuracy = getRealValue(node, "cacheaccuracy", 0.2);
 
   // Environment: see child node
   Environment* environment = NULL;
@@ -169,7 +202,41 @@ Renderer* V2RendererParser::CreatePhotonMapping(
                                    search_caustic_radius, 
                                    nb_samples, 
                                    estimation_min_distance, 
-                                   environment);
+                                   environment, 
+                                   projection_maps, 
+                                   nb_importons, 
+                                   path_guiding, 
+                                   irradiance_cache, 
+                                   cache_accuracy);
+}
+/////////////////////// class V2RendererParser /////////////////////////////////
+Renderer* V2RendererParser::CreatePathTracing(
+    XMLTree* node,
+    const HashMap<std::string, Texture*, StringHashFunctor> &textureMap) {
+
+  int max_depth = getIntegerValue(node, "maxdepth", 10);
+  Real scale = getRealValue(node, "scale", 1.0);
+
+  // Environment: see child node
+  Environment* environment = NULL;
+  if(node->getNumberOfChildren() > 0 ) {
+    XMLTree* envnode = node->getChild(0);
+    
+    // parse environment
+    if (envnode != NULL && envnode->getMarkup() == "environment") {
+      V2EnvironmentParser parser;
+      environment = parser.Create(node->getChild(0), textureMap); 
+
+    // error case
+    } else {
+      throw Exception("(V2RendererParser::CreatePathTracing) Balise <"
+                        + envnode->getMarkup()
+                        + "> inconnue dans le noeud du renderer.");
+    }
+  }
+
+  // Create Renderer object
+  return new PathTracingRenderer(max_depth, scale, environment);
 }
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -27,6 +27,8 @@
 //! @details This file implements classs declared in V2SceneryParser.hpp 
 //!  @arg V2SceneryParser
 //!
+#include <exception>
+
 #include <exceptions/Exception.hpp>
 #include <core/VrtLog.hpp>
 
@@ -71,23 +73,31 @@ Scenery* V2SceneryParser::ParseAndBuildScenery(
   m_mediaMap.add("default", defaultmedium);
   m_mediaList.push_back(defaultmedium);
 
-  //Loading all elements of the scene
+  //Loading all elements of the scene: the cheap ones are built right now,
+  //the costly ones (textures, surfaces and sources) are deferred until the
+  //next renderer or inclusion, which must see the elements declared before
   for(unsigned int i = 0; i < root->getNumberOfChildren(); i++) {
     XMLTree* child = root->getChild(i);
     
     if(child->getMarkup() == "camera") {
       AddCamera(child);
-    } else if(child->getMarkup() == "renderer") {
-      AddRenderer(child);
     } else if(child->getMarkup() == "medium") {
       AddMedium(child);
- 		} else if(child->getMarkup() == "texture") {
-			AddTexture(child);
-    } else if(child->getMarkup() == "source") {
-      AddSource(child);
-    } else if(child->getMarkup() == "surface") {
-      AddSurface(child);
+    } else if(child->getMarkup() == "texture"
+              || child->getMarkup() == "source"
+              || child->getMarkup() == "surface") {
+      BuildJob job;
+      job.node = child;
+      job.wave = 0;
+      job.texture = NULL;
+      job.object = NULL;
+      job.source = NULL;
+      m_jobs.push_back(job);
+    } else if(child->getMarkup() == "renderer") {
+      BuildElements();
+      AddRenderer(child);
     } else if(child->getMarkup() == "include") {
+      BuildElements();
       AddIncludeScenery(child);
     } else {
       throw Exception("(V2SceneryParser::parseAndBuildScenery) Balise " 
@@ -96,6 +106,7 @@ Scenery* V2SceneryParser::ParseAndBuildScenery(
                         + sceneryFilename);
     }
   }
+  BuildElements();
 
   return GenerateScenery();
 }
@@ -231,12 +242,16 @@ Medium* V2SceneryParser::GetMedium(std::string name) {
                   + " n'a pas été déclaré.");
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
-void V2SceneryParser::AddTexture(XMLTree* node) {
+Texture* V2SceneryParser::CreateTexture(XMLTree* node) {
   Texture* tex = new Texture();
 
 	// texture file
 	if(node->getAttributeValue("file") != "") {
     tex->SetImage(node->getAttributeValue("file").c_str());
+
+    // texels converted once into spectral coefficients
+    if(getBooleanValue(node, "prespectralize", false))
+      tex->Prespectralize();
 	}
 
 	// texture name
@@ -246,9 +261,7 @@ void V2SceneryParser::AddTexture(XMLTree* node) {
 	//tex->SetAlphaMode( static_cast<unsigned int>(getIntegerValue(node, 
   //                                                             "alpha", 0)) );
 
-	//Add the texture into the media map and the media list
-	m_textureMap.add(tex->GetTextureName(), tex);
-	m_textureList.push_back(tex);
+	return tex;
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
 Texture* V2SceneryParser::GetTexture(std::string name) {
@@ -260,7 +273,7 @@ Texture* V2SceneryParser::GetTexture(std::string name) {
                   + " n'a pas été déclarée.");
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
-void V2SceneryParser::AddSource(XMLTree* node) {
+Source* V2SceneryParser::CreateSource(XMLTree* node) {
   //Verify the number of child
   if(node->getNumberOfChildren() != 2) {
     throw Exception("(V2SceneryParser::addSource) La source " 
@@ -302,10 +315,10 @@ double dans le noeud de l'objet " + node->getAttributeValue("name"));
   }
 
   //Build the object
-  m_sources.push_back(new Source(source, geometry));
+  return new Source(source, geometry);
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
-void V2SceneryParser::AddSurface(XMLTree* node)
+Object* V2SceneryParser::CreateSurface(XMLTree* node)
 {
   //Verify the number of child
   if(node->getNumberOfChildren() < 2) {
@@ -393,10 +406,10 @@ noeud de la surface " + node->getAttributeValue("name"));
   //Build the object
   VrtLog::Write("V2SceneryParser::addSurface");
   V2MaterialParser parser;
-  m_objects.push_back(new Object(geometry, 
-                                 parser.create(material, external, internal, 
-                                               m_mediaMap, &m_textureMap), 
-                                 internal, external));
+  return new Object(geometry, 
+                    parser.create(material, external, internal, 
+                                  m_mediaMap, &m_textureMap), 
+                    internal, external);
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
 void V2SceneryParser::AddIncludeScenery(XMLTree* child) {
@@ -418,6 +431,148 @@ lecture du fichier de scene de format " + format + " : " + filename);
   }
 }
 ////////////////////////////// class V2SceneryParser /////////////////////////////
+void V2SceneryParser::BuildElements(void) {
+  //Schedule the jobs
+  HashMap<std::string, unsigned int, StringHashFunctor> 
+      declarations(StringHashFunctor(), 100);
+  unsigned int nbWaves = 0;
+  for(unsigned int i = 0; i < m_jobs.size(); i++) {
+    ScheduleJob(m_jobs[i], declarations);
+    if(m_jobs[i].wave + 1 > nbWaves)
+      nbWaves = m_jobs[i].wave + 1;
+  }
+
+  for(unsigned int wave = 0; wave < nbWaves; wave++) {
+    std::vector<unsigned int> jobs;
+    for(unsigned int i = 0; i < m_jobs.size(); i++) {
+      if(m_jobs[i].wave == wave)
+        jobs.push_back(i);
+    }
+    VrtLog::Write("V2SceneryParser::BuildElements - wave %u : %u jobs", 
+                  wave, (unsigned int)jobs.size());
+
+    //A lonely job keeps all the threads for its own parallel loops 
+    //(layered tables)
+    int j;
+#   pragma omp parallel for private(j) schedule(dynamic, 1) \
+        if(jobs.size() > 1)
+    for(j = 0; j < (int)jobs.size(); j++)
+      RunJob(m_jobs[jobs[j]]);
+
+    //Report the first error of the file, the elements already built by the
+    //jobs are freed
+    for(unsigned int k = 0; k < jobs.size(); k++) {
+      if(m_jobs[jobs[k]].error != "") {
+        std::string error = m_jobs[jobs[k]].error;
+        DiscardJobs();
+        throw Exception(error);
+      }
+    }
+
+    //The textures are available for the next waves
+    for(unsigned int k = 0; k < jobs.size(); k++) {
+      Texture* tex = m_jobs[jobs[k]].texture;
+      if(tex != NULL) {
+        m_textureMap.add(tex->GetTextureName(), tex);
+        m_textureList.push_back(tex);
+        m_jobs[jobs[k]].texture = NULL;
+      }
+    }
+  }
+
+  //Add the elements in the order of the file
+  for(unsigned int i = 0; i < m_jobs.size(); i++) {
+    if(m_jobs[i].object != NULL)
+      m_objects.push_back(m_jobs[i].object);
+    else if(m_jobs[i].source != NULL)
+      m_sources.push_back(m_jobs[i].source);
+  }
+  m_jobs.clear();
+}
+////////////////////////////// class V2SceneryParser /////////////////////////////
+void V2SceneryParser::DiscardJobs(void) {
+  for(unsigned int i = 0; i < m_jobs.size(); i++) {
+    delete m_jobs[i].texture;
+    delete m_jobs[i].object;
+    delete m_jobs[i].source;
+  }
+  m_jobs.clear();
+}
+////////////////////////////// class V2SceneryParser /////////////////////////////
+void V2SceneryParser::ScheduleJob(
+    BuildJob& job,
+    HashMap<std::string, unsigned int, StringHashFunctor>& declarations) {
+  job.wave = 0;
+  if(job.node->getMarkup() == "texture")
+    return;
+
+  //Names of the shapes and the materials of the element
+  std::vector<std::string> names;
+  bool textured = false;
+  for(unsigned int i = 0; i < job.node->getNumberOfChildren(); i++) {
+    XMLTree* child = job.node->getChild(i);
+    if(child->getMarkup() == "geometry")
+      CollectNames(child, "shape:", names, textured);
+    else if(child->getMarkup() == "material")
+      CollectNames(child, "material:", names, textured);
+  }
+
+  //Textures are built by the first wave
+  if(textured)
+    job.wave = 1;
+
+  //Wait for the elements which declare the reused names
+  for(unsigned int i = 0; i < names.size(); i++) {
+    if(declarations.contain(names[i]) 
+        && declarations.get(names[i]) + 1 > job.wave)
+      job.wave = declarations.get(names[i]) + 1;
+  }
+
+  //The other names are declared by this element
+  for(unsigned int i = 0; i < names.size(); i++) {
+    if(!declarations.contain(names[i]))
+      declarations.add(names[i], job.wave);
+  }
+}
+////////////////////////////// class V2SceneryParser /////////////////////////////
+void V2SceneryParser::CollectNames(XMLTree* node, 
+                                   const std::string& library,
+                                   std::vector<std::string>& names, 
+                                   bool& textured) {
+  if(node->getAttributeValue("name") != "")
+    names.push_back(library + node->getAttributeValue("name"));
+
+  std::string type = node->getAttributeValue("type");
+  if(type == "Textured" || type == "Concentration")
+    textured = true;
+
+  //The surfaces sharing a mesh file wait for the first one to load it
+  if(library == "shape:" && (type == "OBJ" || type == "Mesh3"))
+    names.push_back("mesh:" + node->getAttributeValue("file"));
+
+  for(unsigned int i = 0; i < node->getNumberOfChildren(); i++)
+    CollectNames(node->getChild(i), library, names, textured);
+}
+////////////////////////////// class V2SceneryParser /////////////////////////////
+void V2SceneryParser::RunJob(BuildJob& job) {
+  try {
+    if(job.node->getMarkup() == "texture")
+      job.texture = CreateTexture(job.node);
+    else if(job.node->getMarkup() == "surface")
+      job.object = CreateSurface(job.node);
+    else if(job.node->getMarkup() == "source")
+      job.source = CreateSource(job.node);
+  } catch(Exception& exc) {
+    job.error = exc.getMessage();
+  } catch(std::exception& exc) {
+    job.error = "(V2SceneryParser::RunJob) " + std::string(exc.what());
+  } catch(...) {
+    //No exception may leave the parallel loop: it is rethrown after it
+    job.error = "(V2SceneryParser::RunJob) Erreur inconnue lors de la \
+construction de l'lment " + job.node->getAttributeValue("name");
+  }
+}
+////////////////////////////// class V2SceneryParser /////////////////////////////
 Scenery* V2SceneryParser::GenerateScenery() {
   //Compute the global bounding box
   BoundingBox globalBounds(0, 0, 0, 0, 0, 0);
@@ -441,6 +596,7 @@ Scenery* V2SceneryParser::GenerateScenery() {
   //Fill the scenery
   for(unsigned int i = 0; i < m_objects.size(); i++)
     scenery->addObject(m_objects[i]);
+  scenery->buildHierarchy();
   for(unsigned int i = 0; i < m_sources.size(); i++)
     scenery->addSource(m_sources[i]);
   for(unsigned int i = 0; i < m_cameras.size(); i++)
@@ -103,3 +103,17 @@ void DirectionalLightSource::getRandomPhoton(MultispectralPhoton& photon)
   for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
     photon.radiance[i]=_spectrum[i]/mean;
 }
+
+/**
+ * Give the spatial and directional extent of the emission.
+ * bounds : the bounding box of the emitting points.
+ * axis : the axis of the cone bounding the emitted directions.
+ * cosAngle : the cosine of the half angle of this cone.
+ */
+bool DirectionalLightSource::getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)
+{
+  //Infinite source : always taken into account
+  axis = _direction;
+  cosAngle = 1.0;
+  return false;
+}
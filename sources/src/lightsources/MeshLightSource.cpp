@@ -0,0 +1,247 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <lightsources/MeshLightSource.hpp>
+
+#include <cmath>
+
+#include <maths/LowDiscrepancy.hpp>
+
+/**
+ * Constructor
+ * spectrum : the emited spectrum
+ * power : the power of this source (multiplier factor)
+ * mesh : the emitting mesh, not owned by the source
+ * doubleSided : true if both sides of the triangles emit
+ * nbSamples : the number of points sampled for the direct lighting
+ */
+MeshLightSource::MeshLightSource(const Spectrum& spectrum, const Real& power, const Mesh* mesh, bool doubleSided, unsigned int nbSamples)
+: _mesh(mesh), _spectrum(spectrum), _lightPower(power), _area(0), _doubleSided(doubleSided), _nbSamples(nbSamples)
+{
+  _spectrum.normalizePower();
+
+  //Area and normal of the triangles
+  unsigned int nbTriangles = _mesh->getNbTriangles();
+  std::vector<Real> areas(nbTriangles);
+  _normals.resize(nbTriangles);
+  Vector sum(0.0, 0.0, 0.0);
+  _bounds = BoundingBox(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  for(unsigned int t=0; t<nbTriangles; t++)
+  {
+    Point a, b, c;
+    _mesh->getTriangle(t, a, b, c);
+    if(t==0)
+      _bounds = BoundingBox(a[0], a[0], a[1], a[1], a[2], a[2]);
+    _bounds.updateWith(a);
+    _bounds.updateWith(b);
+    _bounds.updateWith(c);
+
+    Vector normal = Vector(a, b).vect(Vector(a, c));
+    Real norm = normal.norm();
+    areas[t] = 0.5*norm;
+    _area += areas[t];
+    for(int k=0; k<3; k++)
+      sum[k] += 0.5*normal[k];
+    if(norm>0)
+      normal.mul(1.0/norm);
+    _normals[t] = normal;
+  }
+  _triangles.Build(nbTriangles>0 ? &areas[0] : NULL, nbTriangles);
+
+  //Lambertian emission : the power is spread over pi steradians per side
+  _radiance = 0;
+  if(_area>0)
+    _radiance = _lightPower/(M_PI*_area*(_doubleSided ? 2.0 : 1.0));
+
+  //Axis of the normals (see getEmissionBounds)
+  _axis = sum;
+  Real norm = _axis.norm();
+  _cosNormals = -1.0;
+  if(norm>0 && !_doubleSided)
+  {
+    _axis.mul(1.0/norm);
+    _cosNormals = 1.0;
+    for(unsigned int t=0; t<nbTriangles; t++)
+    {
+      if(areas[t]>0 && _normals[t].dot(_axis)<_cosNormals)
+        _cosNormals = _normals[t].dot(_axis);
+    }
+  }
+}
+
+/**
+ * Sample a point of the mesh, uniformly distributed over its area.
+ * u : random number picking the triangle, then reused in it.
+ * v : random number picking the point in the triangle.
+ * point : the sampled point.
+ * normal : the normal of the triangle (unit vector).
+ */
+void MeshLightSource::samplePoint(Real u, Real v, Point& point, Vector& normal) const
+{
+  Real probability, remapped;
+  unsigned int t = _triangles.Sample(u, probability, &remapped);
+
+  //Uniform barycentric coordinates
+  Point a, b, c;
+  _mesh->getTriangle(t, a, b, c);
+  Real su = sqrt(remapped);
+  Real ba = 1.0 - su;
+  Real bb = v*su;
+  Real bc = 1.0 - ba - bb;
+  for(int k=0; k<3; k++)
+    point[k] = ba*a[k] + bb*b[k] + bc*c[k];
+  normal = _normals[t];
+}
+
+/**
+ * Place incidents light data casted form this source to the given.
+ * The points are a randomly shifted Hammersley point set mapped to the area
+ * of the mesh.
+ * receiver : the point where we need to have the incidents lights rays.
+ * incidents : incidents light data will be placed into this vector.
+ */
+void MeshLightSource::getIncidentLight(const Point& receiver, const LightVector& reemited, std::vector<LightVector>& incidents)
+{
+  if(_area<=0)
+    return;
+
+  //Random shift of the point set (Cranley-Patterson rotation)
+  Real shiftX = rand()/((Real)RAND_MAX+1);
+  Real shiftY = rand()/((Real)RAND_MAX+1);
+
+  incidents.reserve(incidents.size()+_nbSamples);
+  for(unsigned int i=0; i<_nbSamples; i++)
+  {
+    Real x, y;
+    LowDiscrepancy::Hammersley(i, _nbSamples, shiftX, shiftY, x, y);
+
+    //Generate the origin
+    Point origin;
+    Vector normal;
+    samplePoint(x, y, origin, normal);
+
+    //Generate the direction
+    Vector direction(origin, receiver);
+    Real distance = direction.norm();
+    if(distance<=0)
+      continue;
+    direction.mul(1.0/distance);
+
+    Real cosine = normal.dot(direction);
+    if(_doubleSided && cosine<0)
+      cosine = -cosine;
+    if(cosine<=0)
+      continue;
+
+    //Built in place in the output
+    incidents.push_back(LightVector());
+    LightVector& lightdata = incidents.back();
+    lightdata.setRay(receiver, direction);
+    lightdata.setDistance(distance);
+
+    //Building the spectral part of this light data : radiance over the
+    //probability density of the direction (area density 1/_area)
+    lightdata.initSpectralData(reemited);
+    Real power = _radiance*cosine*_area/(distance*distance*_nbSamples);
+    for(unsigned int wl=0; wl<lightdata.size() ;wl++)
+      lightdata[wl].setRadiance(_spectrum[lightdata[wl].getIndex()]*power);
+
+    //Initialize the polarisation framework
+    if(direction[2]<0.999 && direction[2]>-0.999)
+      lightdata.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
+    else
+      lightdata.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
+  }
+}
+
+/**
+ * Return the power of this source (the sum of all wavelenght)
+ */
+Real MeshLightSource::getPower()
+{
+  return _lightPower;
+}
+
+/**
+ * Compute the emitted light for direct source view.
+ * @param localBasis : the local basis on the surface of the source.
+ * @param surfaceCoordinate : the surface coordinate on the source surface.
+ * @param emitted : the light data to compute.
+ */
+void MeshLightSource::getEmittedLight(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& emitted)
+{
+  //Back of a single sided emitter
+  if(!_doubleSided && localBasis.k.dot(emitted.getRay().v)>0)
+  {
+    emitted.clear();
+    emitted.changeReemitedPolarisationFramework(localBasis.k);
+    return;
+  }
+
+  for(unsigned int i=0; i<emitted.size(); i++)
+    emitted[i].setRadiance(_spectrum[emitted[i].getIndex()]*_radiance);
+  emitted.changeReemitedPolarisationFramework(localBasis.k);
+}
+
+/**
+ * Generate a random photon according this source spectral and spatial
+ * distribution.
+ * photon : the photon to generate;
+ */
+void MeshLightSource::getRandomPhoton(MultispectralPhoton& photon)
+{
+  //Position
+  Vector normal;
+  samplePoint(rand()/((Real)RAND_MAX+1), rand()/((Real)RAND_MAX+1), photon.position, normal);
+  if(_doubleSided && rand()%2)
+    normal.mul(-1.0);
+
+  //Direction : cosine distribution around the normal
+  Vector tangent = (normal[0]>0.9 || normal[0]<-0.9) ? Vector(0.0, 1.0, 0.0) : Vector(1.0, 0.0, 0.0);
+  tangent = normal.vect(tangent);
+  tangent.normalize();
+  Vector bitangent = normal.vect(tangent);
+  Real r2 = rand()/(Real)RAND_MAX;
+  Real phi = 2.0*M_PI*rand()/(Real)RAND_MAX;
+  Real r = sqrt(r2);
+  Real z = sqrt(1.0 - r2);
+  for(int k=0; k<3; k++)
+    photon.direction[k] = r*cos(phi)*tangent[k] + r*sin(phi)*bitangent[k] + z*normal[k];
+
+  //Building spectral part of the photon
+  Real mean=0;
+  for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
+    mean+=_spectrum[i];
+  for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
+    photon.radiance[i]=_spectrum[i]/mean;
+}
+
+/**
+ * Give the spatial and directional extent of the emission : the cone of the
+ * normals of the triangles, widened by a right angle.
+ * bounds : the bounding box of the emitting points.
+ * axis : the axis of the cone bounding the emitted directions.
+ * cosAngle : the cosine of the half angle of this cone.
+ */
+bool MeshLightSource::getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)
+{
+  bounds = _bounds;
+  axis = _axis;
+  cosAngle = -1.0;
+  if(_cosNormals>0)
+    cosAngle = -sqrt(1.0 - _cosNormals*_cosNormals);
+  return true;
+}
@@ -16,6 +16,8 @@
 
 #include <lightsources/PlaneLightSource.hpp>
 
+#include <maths/LowDiscrepancy.hpp>
+
 /**
  * Constructor
  * spectrum : the emited spectrum
@@ -32,51 +34,180 @@ PlaneLightSource::PlaneLightSource(const Spectrum& spectrum, const Real& power,
   _basis.j = v;
   _powerFactor=_lightPower;
   _area=u.norm()*v.norm();
+  _rectangle = _area>0 && fabs(u.dot(v)) <= 1e-4*_area;
 }
 
+namespace
+{
+
+/**
+ * A rectangle seen from a point, for the sampling of its solid angle
+ * (Urena et al., "An Area-Preserving Parametrization for Spherical 
+ * Rectangles", 2013). Computed in double precision : the solid angle of
+ * far sources is the difference of close angles.
+ */
+struct SphericalRectangle
+{
+  double o[3], x[3], y[3], z[3];
+  double x0, y0, z0, x1, y1;
+  double b0, b1, k;
+  double solidAngle;
+
+  /**
+   * Build the spherical rectangle of the rectangle (corner, ex, ey) seen
+   * from the receiver. Return false if it is too small to be sampled.
+   */
+  bool init(const Point& receiver, const Point& corner, const Vector& ex, const Vector& ey)
+  {
+    double exl = ex.norm(), eyl = ey.norm();
+    double d[3];
+    for(int c=0; c<3; c++)
+    {
+      o[c] = receiver[c];
+      x[c] = ex[c]/exl;
+      y[c] = ey[c]/eyl;
+      d[c] = corner[c] - receiver[c];
+    }
+    z[0] = x[1]*y[2] - x[2]*y[1];
+    z[1] = x[2]*y[0] - x[0]*y[2];
+    z[2] = x[0]*y[1] - x[1]*y[0];
+    z0 = d[0]*z[0] + d[1]*z[1] + d[2]*z[2];
+    if(z0>0)
+    {
+      z0 = -z0;
+      for(int c=0; c<3; c++)
+        z[c] = -z[c];
+    }
+    x0 = d[0]*x[0] + d[1]*x[1] + d[2]*x[2];
+    y0 = d[0]*y[0] + d[1]*y[1] + d[2]*y[2];
+    x1 = x0 + exl;
+    y1 = y0 + eyl;
+
+    //Normals of the great circles of the edges
+    double n0[3] = { 0.0, z0, -y0 };
+    double n1[3] = { -z0, 0.0, x1 };
+    double n2[3] = { 0.0, -z0, y1 };
+    double n3[3] = { z0, 0.0, -x0 };
+    double l0 = sqrt(n0[1]*n0[1] + n0[2]*n0[2]);
+    double l1 = sqrt(n1[0]*n1[0] + n1[2]*n1[2]);
+    double l2 = sqrt(n2[1]*n2[1] + n2[2]*n2[2]);
+    double l3 = sqrt(n3[0]*n3[0] + n3[2]*n3[2]);
+    if(l0<=0 || l1<=0 || l2<=0 || l3<=0)
+      return false;
+
+    //Internal angles
+    double g0 = acos(clamp(-(n0[2]*n1[2])/(l0*l1)));
+    double g1 = acos(clamp(-(n1[2]*n2[2])/(l1*l2)));
+    double g2 = acos(clamp(-(n2[2]*n3[2])/(l2*l3)));
+    double g3 = acos(clamp(-(n3[2]*n0[2])/(l3*l0)));
+    b0 = n0[2]/l0;
+    b1 = n2[2]/l2;
+    k = 2.0*M_PI - g2 - g3;
+    solidAngle = g0 + g1 - k;
+    return solidAngle > 1e-6;
+  }
+
+  /**
+   * Point of the rectangle matching (u, v) in [0, 1)^2, uniformly 
+   * distributed in solid angle.
+   */
+  Point sample(Real u, Real v) const
+  {
+    double au = u*solidAngle + k;
+    double fu = (cos(au)*b0 - b1)/sin(au);
+    double cu = 1.0/sqrt(fu*fu + b0*b0);
+    cu = clamp(fu>0 ? cu : -cu);
+    double xu = -(cu*z0)/sqrt(1.0 - cu*cu);
+    xu = (xu<x0) ? x0 : ((xu>x1) ? x1 : xu);
+    double dd = sqrt(xu*xu + z0*z0);
+    double h0 = y0/sqrt(dd*dd + y0*y0);
+    double h1 = y1/sqrt(dd*dd + y1*y1);
+    double hv = h0 + v*(h1 - h0);
+    double yv = (hv*hv < 1.0 - 1e-12) ? (hv*dd)/sqrt(1.0 - hv*hv) : y1;
+    return Point((Real)(o[0] + xu*x[0] + yv*y[0] + z0*z[0]),
+                 (Real)(o[1] + xu*x[1] + yv*y[1] + z0*z[1]),
+                 (Real)(o[2] + xu*x[2] + yv*y[2] + z0*z[2]));
+  }
+
+  static double clamp(double c)
+  {
+    return (c<-1.0) ? -1.0 : ((c>1.0) ? 1.0 : c);
+  }
+};
+
+} //namespace
+
 /**
  * Place incidents light data casted form this source to the given.
+ * The samples are a randomly shifted Hammersley point set, mapped to the
+ * solid angle of the source when it is a rectangle, to its area otherwise.
  * receiver : the point where we need to have the incidents lights rays.
  * incidents : incidents light data will be placed into this vector.
  */
 void PlaneLightSource::getIncidentLight(const Point& receiver, const LightVector& reemited, std::vector<LightVector>& incidents)
 {
+  //The source only lights the side of its normal
+  if(_basis.k.dot(Vector(_basis.o, receiver))<=0)
+    return;
+
+  //Value-initialized (all zero), the init may be skipped
+  SphericalRectangle rectangle = SphericalRectangle();
+  bool solidAngle = _rectangle && rectangle.init(receiver, _basis.o, _basis.i, _basis.j);
+
+  //Random shift of the point set (Cranley-Patterson rotation)
+  Real shiftX = rand()/((Real)RAND_MAX+1);
+  Real shiftY = rand()/((Real)RAND_MAX+1);
+
+  incidents.reserve(incidents.size()+_nbSamples);
   for(unsigned int i=0; i<_nbSamples; i++)
   {
-    LightVector lightdata;
+    Real x, y;
+    LowDiscrepancy::Hammersley(i, _nbSamples, shiftX, shiftY, x, y);
 
     //Generate the origin
     Point origin;
-    Real x = rand()/(Real)RAND_MAX;
-    Real y = rand()/(Real)RAND_MAX;
-    origin[0] = _basis.o[0] + x*_basis.i[0] + y*_basis.j[0];
-    origin[1] = _basis.o[1] + x*_basis.i[1] + y*_basis.j[1];
-    origin[2] = _basis.o[2] + x*_basis.i[2] + y*_basis.j[2];
+    if(solidAngle)
+      origin = rectangle.sample(x, y);
+    else
+    {
+      origin[0] = _basis.o[0] + x*_basis.i[0] + y*_basis.j[0];
+      origin[1] = _basis.o[1] + x*_basis.i[1] + y*_basis.j[1];
+      origin[2] = _basis.o[2] + x*_basis.i[2] + y*_basis.j[2];
+    }
 
     //Generate the direction
     Vector direction(origin, receiver);
     Real distance = direction.norm();
+    if(distance<=0)
+      continue;
     direction.mul(1.0/distance);
 
-    if(_basis.k.dot(direction)<0)
-      return;
+    Real cosine = _basis.k.dot(direction);
+    if(cosine<=0)
+      continue;
 
+    //Built in place in the output
+    incidents.push_back(LightVector());
+    LightVector& lightdata = incidents.back();
     lightdata.setRay(receiver, direction);
     lightdata.setDistance(distance);
     
-    //Building the spectral part of this light data
+    //Building the spectral part of this light data : radiance over the
+    //probability density (solid angle or area)
     lightdata.initSpectralData(reemited);
-    Real power= _basis.k.dot(direction) * _powerFactor/(lightdata.getDistance()*lightdata.getDistance()*_nbSamples*M_PI);
-    for(unsigned int i=0; i<lightdata.size() ;i++)
-      lightdata[i].setRadiance(_spectrum[lightdata[i].getIndex()]*power);
+    Real power;
+    if(solidAngle)
+      power = (Real)rectangle.solidAngle * _powerFactor/(_area*_nbSamples*M_PI);
+    else
+      power = cosine * _powerFactor/(distance*distance*_nbSamples*M_PI);
+    for(unsigned int wl=0; wl<lightdata.size() ;wl++)
+      lightdata[wl].setRadiance(_spectrum[lightdata[wl].getIndex()]*power);
 
     //Initialize the polarisation framework
     if(direction[2]<0.999 && direction[2]>-0.999)
       lightdata.changeReemitedPolarisationFramework(Vector(0.0, 0.0, 1.0));
     else
       lightdata.changeReemitedPolarisationFramework(Vector(1.0, 0.0, 0.0));
-
-    incidents.push_back(lightdata);
   }
 }
 
@@ -135,3 +266,22 @@ void PlaneLightSource::getRandomPhoton(MultispectralPhoton& photon)
   for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
     photon.radiance[i]=_spectrum[i]/mean;
 }
+
+/**
+ * Give the spatial and directional extent of the emission.
+ * bounds : the bounding box of the emitting points.
+ * axis : the axis of the cone bounding the emitted directions.
+ * cosAngle : the cosine of the half angle of this cone.
+ */
+bool PlaneLightSource::getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)
+{
+  const Point& o = _basis.o;
+  bounds = BoundingBox(o[0], o[0], o[1], o[1], o[2], o[2]);
+  bounds.updateWith(Point(o[0]+_basis.i[0], o[1]+_basis.i[1], o[2]+_basis.i[2]));
+  bounds.updateWith(Point(o[0]+_basis.j[0], o[1]+_basis.j[1], o[2]+_basis.j[2]));
+  bounds.updateWith(Point(o[0]+_basis.i[0]+_basis.j[0], o[1]+_basis.i[1]+_basis.j[1], o[2]+_basis.i[2]+_basis.j[2]));
+  axis = _basis.k;
+  axis.normalize();
+  cosAngle = 0.0;
+  return true;
+}
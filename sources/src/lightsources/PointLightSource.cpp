@@ -108,3 +108,17 @@ void PointLightSource::getRandomPhoton(MultispectralPhoton& photon)
   for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
     photon.radiance[i]=_spectrum[i]/mean;
 }
+
+/**
+ * Give the spatial and directional extent of the emission.
+ * bounds : the bounding box of the emitting points.
+ * axis : the axis of the cone bounding the emitted directions.
+ * cosAngle : the cosine of the half angle of this cone.
+ */
+bool PointLightSource::getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)
+{
+  bounds = BoundingBox(_origin[0], _origin[0], _origin[1], _origin[1], _origin[2], _origin[2]);
+  axis = Vector(0.0, 0.0, 1.0);
+  cosAngle = -1.0;
+  return true;
+}
@@ -116,3 +116,17 @@ void SurfaceLightSource::getRandomPhoton(MultispectralPhoton& photon)
   for(unsigned int i=0; i<GlobalSpectrum::nbWaveLengths(); i++)
     photon.radiance[i]=_spectrum[i]/mean;
 }
+
+/**
+ * Give the spatial and directional extent of the emission.
+ * bounds : the bounding box of the emitting points.
+ * axis : the axis of the cone bounding the emitted directions.
+ * cosAngle : the cosine of the half angle of this cone.
+ */
+bool SurfaceLightSource::getEmissionBounds(BoundingBox& bounds, Vector& axis, Real& cosAngle)
+{
+  bounds = BoundingBox(_o[0], _o[0], _o[1], _o[1], _o[2], _o[2]);
+  axis = _normal;
+  cosAngle = 0.0;
+  return true;
+}
@@ -100,12 +100,11 @@ AlloyBRDF::AlloyBRDF(std::vector<const Medium*>& media_stack,
   //Compute specular reflectance and transmittance
   std::vector<Spectrum> R12p(kSAMPLES), R12s(kSAMPLES);
   std::vector<Spectrum> T12p(kSAMPLES), T12s(kSAMPLES);
+  LayeredSystemComputer::computeSpecularLayerTable(
+      R12s, R12p, T12s, T12p, 
+      kSAMPLES, layers, thickness);
   for(unsigned int iOi = 0; iOi < kSAMPLES; iOi++) {
     Real Oi = iOi * M_PI * 0.5 / (Real)kSAMPLES;
-    Real cosOi = std::cos(Oi);
-    LayeredSystemComputer::computeSpecularLayerSystem(
-                            R12s[iOi], R12p[iOi], T12s[iOi], T12p[iOi], 
-                            cosOi, layers, thickness);
    
     for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++) {
       if(!(R12p[iOi][i] < Real(1.0) + kEPSILON)) {
@@ -60,7 +60,8 @@ void ConcentrationMap::getDiffuseReemited(const Basis& localBasis,
   reemitedLight.clear();
  
   //get the pixel
-  Pixel pixel = getPixel(surfaceCoordinate);
+  Pixel pixel(p_map->getNumberOfChannels());
+  getPixel(surfaceCoordinate, pixel);
 
   for (unsigned int i = 0; i < pixel.numberOfChannel(); i++) {
     // add first material
@@ -93,7 +94,8 @@ void ConcentrationMap::getSpecularReemited(const Basis& localBasis,
   reemitedLight.clear();
   
   //get the pixel
-  Pixel pixel = getPixel(surfaceCoordinate);
+  Pixel pixel(p_map->getNumberOfChannels());
+  getPixel(surfaceCoordinate, pixel);
   
   for (unsigned int i = 0; i < pixel.numberOfChannel(); i++) {
     // add first material
@@ -139,7 +141,8 @@ bool ConcentrationMap::bouncePhoton(const Basis& localBasis,
                                bool& specular) {
 
   //get the pixel
-  Pixel pixel = getPixel(surfaceCoordinate);
+  Pixel pixel(p_map->getNumberOfChannels());
+  getPixel(surfaceCoordinate, pixel);
 
   //init factor
   Real* factor = new Real[m_materials.size()];
@@ -203,30 +206,17 @@ void ConcentrationMap::getDiffuseReemitedFromAmbiant(
   reemitedLight.changeReemitedPolarisationFramework(localBasis.k);
 }
 ////////////////////////////////////////////////////////////////////////////////
-Pixel& ConcentrationMap::getPixel(const Point2D& surfaceCoordinate) {
+void ConcentrationMap::getPixel(const Point2D& surfaceCoordinate,
+                                Pixel& pixel) {
 	Real u = surfaceCoordinate[0] * m_tileU;
-	int ent_u = int(u);
-    if ( m_texRepeatModeU == Texture::REPEAT_ON )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 == 0 )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 != 0 )
-		u = 1 + ent_u - u;
-
 	Real v = surfaceCoordinate[1] * m_tileV;
-	int ent_v = int(v);
-	if ( m_texRepeatModeV == Texture::REPEAT_ON )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 == 0 )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 != 0 )
-		v = 1 + ent_v - v;
 
   u *= p_map->getWidth();
   v *= p_map->getHeight();
 
-  Pixel p = p_map->getInterpolatedPixel(u, v);
-  return p;
+  p_map->getInterpolatedPixel(u, v, pixel.getRawData(),
+                              (Image::WRAP_MODE)m_texRepeatModeU,
+                              (Image::WRAP_MODE)m_texRepeatModeV);
 }
 ////////////////////////////////////////////////////////////////////////////////
 bool ConcentrationMap::hasDiffuseMaterial(
@@ -108,6 +108,11 @@ void DepolarizedBRDF::getRandomDiffuseRay(const Basis& localBasis, const Point2D
   _material->getRandomDiffuseRay(localBasis, surfaceCoordinate, reemitedLight, nbRays, subrays);
 }
 
+bool DepolarizedBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  return _material->getDiffuseDensity(localBasis, surfaceCoordinate, reemitedLight, direction, density, weight);
+}
+
 void DepolarizedBRDF::getDiffuseReemitedFromAmbiant(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& reemitedLight, const Spectrum& incident)
 {
   _material->getDiffuseReemitedFromAmbiant(localBasis, surfaceCoordinate, reemitedLight, incident);
@@ -98,6 +98,30 @@ void LambertianBRDF::getRandomDiffuseRay(const Basis& localBasis, const Point2D&
   generateRandomeDiffuseRay(normal, localBasis.o, nbRays, reemitedLight, subrays);
 }
 
+/**
+ * Give the density of the secondary rays of getRandomDiffuseRay in the given
+ * direction (among the rays of the same side of the surface) and their 
+ * weight.
+ */
+bool LambertianBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  density = 0;
+  weight = 1.0/M_PI;
+  Vector normal=localBasis.k;
+  if(normal.dot(reemitedLight.getRay().v)>0)
+    return true;
+
+  //Transmission
+  if(direction.dot(normal)<0)
+  {
+    if(_isOpaque)
+      return true;
+    normal.mul(-1.0);
+  }
+  density = getRejectionDensity(normal, direction);
+  return true;
+}
+
 void LambertianBRDF::generateRandomeDiffuseRay(const Vector& normal, const Point& origin, unsigned int nbRays, LightVector& reemitedLight, std::vector<LightVector>& subrays)
 {
   for(unsigned int i=0; i<nbRays; i++)
@@ -16,6 +16,8 @@
 
 #include <materials/MappedBRDF.hpp>
 
+#include <structures/ScratchBuffer.hpp>
+
 /**
  * Constructor
  * @param materials : the materials that compose the map
@@ -170,7 +172,11 @@ Real MappedBRDF::getFactor(unsigned int materialIndex, const Point2D& surfaceCoo
   Real x = surfaceCoordinate[0]*_maps[materialIndex]->getWidth();
   Real y = surfaceCoordinate[1]*_maps[materialIndex]->getHeight();
 
-  return _maps[materialIndex]->getPixel(x, y)[0];
+  //Only the first channel is used
+  Image* map = _maps[materialIndex];
+  ScratchBuffer pixel(map->getNumberOfChannels());
+  map->getInterpolatedPixel(x, y, pixel.data());
+  return pixel[0];
 }
 
 /**
@@ -117,3 +117,14 @@ void Material::getRandomDiffuseRay(const Basis& localBasis, const Point2D& surfa
 {
   //No ray to cast !
 }
+
+/**
+ * Give the density of the secondary rays of getRandomDiffuseRay in a given
+ * direction and their weight. The default distribution is unknown.
+ */
+bool Material::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  density = 0;
+  weight = 0;
+  return false;
+}
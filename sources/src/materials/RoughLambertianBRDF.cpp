@@ -113,6 +113,21 @@ void RoughLambertianBRDF::getRandomDiffuseRay(const Basis& localBasis, const Poi
   }
 }
 
+/**
+ * Give the density of the secondary rays of getRandomDiffuseRay in the given
+ * direction (among the rays of the same side of the surface) and their 
+ * weight.
+ */
+bool RoughLambertianBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  Vector normal=localBasis.k;
+  if(normal.dot(reemitedLight.getRay().v)>0)
+    normal.mul(-1);
+  density = getRejectionDensity(normal, direction);
+  weight = 1.0/M_PI;
+  return true;
+}
+
 /**
  * Compute the bounce of the given photon and modify it. Use the russian 
  * roulette to return if it bounce (true) or if it's absorbed. Tel also if 
@@ -275,6 +275,30 @@ void RoughVarnishedLambertianBRDF::getRandomDiffuseRay(const Basis& localBasis,
   generateRandomeDiffuseRay(normal, localBasis.o, nbRays, reemitedLight, subrays);
 }
 
+/**
+ * Give the density of the secondary rays of getRandomDiffuseRay in the given
+ * direction (among the rays of the same side of the surface) and their 
+ * weight.
+ */
+bool RoughVarnishedLambertianBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  density = 0;
+  weight = 1.0/M_PI;
+  Vector normal=localBasis.k;
+  if(normal.dot(reemitedLight.getRay().v)>0)
+    return true;
+
+  //Transmission
+  if(direction.dot(normal)<0)
+  {
+    if(_opaque)
+      return true;
+    normal.mul(-1.0);
+  }
+  density = getRejectionDensity(normal, direction);
+  return true;
+}
+
 void RoughVarnishedLambertianBRDF::generateRandomeDiffuseRay(const Vector& normal, const Point& origin, unsigned int nbRays, LightVector& reemitedLight, std::vector<LightVector>& subrays)
 {
   for(unsigned int i=0; i<nbRays; i++)
@@ -84,24 +84,11 @@ void TextureBRDF::getSpecularReemited(const Basis& localBasis,
   // get spectrum value for the current pixel
   Spectrum sPix;
   Real u = surfaceCoordinate[0] * m_tileU;
-  int ent_u = int(u);
-  if ( m_texRepeatModeU == Texture::REPEAT_ON )
-    u -= ent_u;
-  else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 == 0 )
-    u -= ent_u;
-  else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 != 0 )
-    u = 1 + ent_u - u;
-
   Real v = surfaceCoordinate[1] * m_tileV;
-  int ent_v = int(v);
-  if ( m_texRepeatModeV == Texture::REPEAT_ON )
-    v -= ent_v;
-  else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 == 0 )
-    v -= ent_v;
-  else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 != 0 )
-    v = 1 + ent_v - v;
 
-  p_map->GetSpectrumValue( u, v, sPix );
+  Real width = getFilterWidth(reemitedLight);
+  p_map->GetSpectrumValue(u, v, sPix, m_texRepeatModeU, m_texRepeatModeV, 
+                          width);
 
   // No alpha
   if (m_alphaMode == Texture::ALPHA_OFF) {
@@ -119,7 +106,8 @@ void TextureBRDF::getSpecularReemited(const Basis& localBasis,
     embedded_refl.initGeometricalData(reemitedLight);
 
     Real alpha = 1.0;
-    p_map->GetAlphaValue( u, v, alpha);
+    p_map->GetAlphaValue(u, v, alpha, m_texRepeatModeU, m_texRepeatModeV, 
+                         width);
   
     if (p_mtl != NULL) {
       p_mtl->getSpecularReemited(localBasis, surfaceCoordinate, incidentLight, 
@@ -182,24 +170,11 @@ void TextureBRDF::getDiffuseReemited(const Basis& localBasis,
   // get spectrum value for the current pixel
 	Spectrum sPix;
 	Real u = surfaceCoordinate[0] * m_tileU;
-	int ent_u = int(u);
-	if ( m_texRepeatModeU == Texture::REPEAT_ON )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 == 0 )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 != 0 )
-		u = 1 + ent_u - u;
-
 	Real v = surfaceCoordinate[1] * m_tileV;
-	int ent_v = int(v);
-	if ( m_texRepeatModeV == Texture::REPEAT_ON )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 == 0 )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 != 0 )
-		v = 1 + ent_v - v;
-
-	p_map->GetSpectrumValue( u, v, sPix );
+
+	Real width = getFilterWidth(reemitedLight);
+	p_map->GetSpectrumValue(u, v, sPix, m_texRepeatModeU, m_texRepeatModeV, 
+                          width);
   
   // No alpha
   if (m_alphaMode == Texture::ALPHA_OFF) {
@@ -217,7 +192,8 @@ void TextureBRDF::getDiffuseReemited(const Basis& localBasis,
     embedded_refl.initGeometricalData(reemitedLight);
 
     Real alpha = 1.0;
-    p_map->GetAlphaValue( u, v, alpha);
+    p_map->GetAlphaValue(u, v, alpha, m_texRepeatModeU, m_texRepeatModeV, 
+                         width);
   
     if (p_mtl != NULL) {
       p_mtl->getDiffuseReemited(localBasis, surfaceCoordinate, incidentLight, 
@@ -261,6 +237,15 @@ void TextureBRDF::getRandomDiffuseRay(const Basis& localBasis,
  //                           subrays);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool TextureBRDF::getDiffuseDensity(const Basis& localBasis, 
+                                    const Point2D& surfaceCoordinate, 
+                                    const LightVector& reemitedLight, 
+                                    const Vector& direction, 
+                                    Real& density, Real& weight) {
+  return p_mtl->getDiffuseDensity(localBasis, surfaceCoordinate, 
+                                  reemitedLight, direction, density, weight);
+}
+////////////////////////////////////////////////////////////////////////////////
 void TextureBRDF::generateRandomeDiffuseRay(const Vector& normal, 
                                             const Point& origin, 
                                             unsigned int nbRays, 
@@ -298,24 +283,9 @@ bool TextureBRDF::bouncePhoton(const Basis& localBasis,
 	// get spectrum value for the current pixel
 	Spectrum sPix;
 	Real u = surfaceCoordinate[0] * m_tileU;
-	int ent_u = int(u);
-	if ( m_texRepeatModeU == Texture::REPEAT_ON )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 == 0 )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 != 0 )
-		u = 1 + ent_u - u;
-
 	Real v = surfaceCoordinate[1] * m_tileV;
-	int ent_v = int(v);
-	if ( m_texRepeatModeV == Texture::REPEAT_ON )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 == 0 )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 != 0 )
-		v = 1 + ent_v - v;
 
-	p_map->GetSpectrumValue( u, v, sPix );
+	p_map->GetSpectrumValue(u, v, sPix, m_texRepeatModeU, m_texRepeatModeV);
 
 	//Compute photon absorption
 	Real mean=0;
@@ -385,24 +355,10 @@ void TextureBRDF::getDiffuseReemitedFromAmbiant(
  // get spectrum value for the current pixel
 	Spectrum sPix;
 	Real u = surfaceCoordinate[0] * m_tileU;
-	int ent_u = int(u);
-	if ( m_texRepeatModeU == Texture::REPEAT_ON )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 == 0 )
-		u -= ent_u;
-	else if ( m_texRepeatModeU == Texture::REPEAT_MIRROR && ent_u % 2 != 0 )
-		u = 1 + ent_u - u;
-
 	Real v = surfaceCoordinate[1] * m_tileV;
-	int ent_v = int(v);
-	if ( m_texRepeatModeV == Texture::REPEAT_ON )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 == 0 )
-		v -= ent_v;
-	else if ( m_texRepeatModeV == Texture::REPEAT_MIRROR && ent_v % 2 != 0 )
-		v = 1 + ent_v - v;
 
-	p_map->GetSpectrumValue( u, v, sPix );
+	p_map->GetSpectrumValue(u, v, sPix, m_texRepeatModeU, m_texRepeatModeV, 
+                          getFilterWidth(reemitedLight));
 
   for(unsigned int wl=0; wl < reemitedLight.size(); wl++)
     reemitedLight[wl].setRadiance(incident[wl] * oneOverPi /** cosOv*/ * sPix[wl]);
@@ -410,3 +366,13 @@ void TextureBRDF::getDiffuseReemitedFromAmbiant(
   reemitedLight.changeReemitedPolarisationFramework(localBasis.k);
 }
 ////////////////////////////////////////////////////////////////////////////////
+Real TextureBRDF::getFilterWidth(const LightVector& view) const {
+  Point2D dx, dy;
+  view.getSurfaceDifferentials(dx, dy);
+  dx[0] *= m_tileU;
+  dx[1] *= m_tileV;
+  dy[0] *= m_tileU;
+  dy[1] *= m_tileV;
+  return p_map->GetFilterWidth(dx, dy);
+}
+////////////////////////////////////////////////////////////////////////////////
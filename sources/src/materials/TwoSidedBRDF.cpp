@@ -168,6 +168,18 @@ void TwoSidedBRDF::getRandomDiffuseRay(const Basis& localBasis, const Point2D& s
   }
 }
 
+bool TwoSidedBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  if(reemitedLight.getRay().v.dot(localBasis.k)<0)
+    return _external->getDiffuseDensity(localBasis, surfaceCoordinate, reemitedLight, direction, density, weight);
+
+  Basis b = localBasis;
+  b.i.mul(-1.0);
+  b.j.mul(-1.0);
+  b.k.mul(-1.0);
+  return _internal->getDiffuseDensity(b, surfaceCoordinate, reemitedLight, direction, density, weight);
+}
+
 void TwoSidedBRDF::getDiffuseReemitedFromAmbiant(const Basis& localBasis, const Point2D& surfaceCoordinate, LightVector& reemitedLight, const Spectrum& incident)
 {
    if(reemitedLight.getRay().v.dot(localBasis.k)<0)
@@ -16,6 +16,7 @@
 
 #include <materials/VarnishedLambertianBRDF.hpp>
 #include <physics/DielectricFormula.hpp>
+#include <physics/LayerTableCache.hpp>
 #include <exceptions/Exception.hpp>
 
 /**
@@ -34,6 +35,15 @@
 VarnishedLambertianBRDF::VarnishedLambertianBRDF(std::vector<Spectrum> R12p, std::vector<Spectrum> R12s, std::vector<Spectrum> T12p, std::vector<Spectrum> T12s, std::vector<Spectrum> R21p, std::vector<Spectrum> R21s, const Spectrum& n, const Spectrum& k, Real thickness, const Spectrum& R23d)
 : Material(true, true), _opaque(true), _samples(R12s.size()), _Rs(R12p), _Rp(R12s), _Rd(R12s.size()*R12s.size()), _Td(R12s.size()*R12s.size())
 {
+  //The diffuse tables only depend on the parameters of the constructor
+  LayerTableCache::Key key("VarnishedLambertianBRDF");
+  key.Add(thickness).Add(n).Add(k).Add(R23d);
+  for(int i=0; i<_samples; i++)
+    key.Add(R21p[i]).Add(R21s[i]).Add(T12p[i]).Add(T12s[i]);
+  if(LayerTableCache::Find(key, _Rd) && _Rd.size()==(unsigned int)(_samples*_samples))
+    return;
+  _Rd.resize(_samples*_samples);
+
   //Compute the diffuse contribution
   for(unsigned int l=0; l<GlobalSpectrum::nbWaveLengths(); l++)
   {
@@ -79,6 +89,8 @@ VarnishedLambertianBRDF::VarnishedLambertianBRDF(std::vector<Spectrum> R12p, std
         }
       }
   }
+
+  LayerTableCache::Store(key, _Rd);
 }
 
 /**
@@ -98,6 +110,23 @@ VarnishedLambertianBRDF::VarnishedLambertianBRDF(std::vector<Spectrum> R12p, std
 VarnishedLambertianBRDF::VarnishedLambertianBRDF(std::vector<Spectrum> R12p, std::vector<Spectrum> R12s, std::vector<Spectrum> T12p, std::vector<Spectrum> T12s, std::vector<Spectrum> R21p, std::vector<Spectrum> R21s, const Spectrum& n, const Spectrum& k, Real thickness, const Spectrum& R23d, const Spectrum& T23d)
 : Material(true, true), _opaque(true), _samples(R12s.size()), _Rs(R12p), _Rp(R12s), _Rd(R12s.size()*R12s.size()), _Td(R12s.size()*R12s.size())
 {
+  //The diffuse tables only depend on the parameters of the constructor
+  LayerTableCache::Key key("VarnishedLambertianBRDF-T");
+  key.Add(thickness).Add(n).Add(k).Add(R23d);
+  for(int i=0; i<_samples; i++)
+    key.Add(R21p[i]).Add(R21s[i]).Add(T12p[i]).Add(T12s[i]);
+  key.Add(T23d);
+  std::vector<Spectrum> tables;
+  if(LayerTableCache::Find(key, tables) && tables.size()==(unsigned int)(2*_samples*_samples))
+  {
+    for(int i=0; i<_samples*_samples; i++)
+    {
+      _Rd[i]=tables[i];
+      _Td[i]=tables[_samples*_samples+i];
+    }
+    return;
+  }
+
   //Compute the diffuse contribution
   for(unsigned int l=0; l<GlobalSpectrum::nbWaveLengths(); l++)
   {
@@ -146,6 +175,14 @@ VarnishedLambertianBRDF::VarnishedLambertianBRDF(std::vector<Spectrum> R12p, std
         }
       }
   }
+
+  tables.resize(2*_samples*_samples);
+  for(int i=0; i<_samples*_samples; i++)
+  {
+    tables[i]=_Rd[i];
+    tables[_samples*_samples+i]=_Td[i];
+  }
+  LayerTableCache::Store(key, tables);
 }
 
 
@@ -389,6 +426,30 @@ void VarnishedLambertianBRDF::getRandomDiffuseRay(const Basis& localBasis, const
   generateRandomeDiffuseRay(normal, localBasis.o, nbRays, reemitedLight, subrays);
 }
 
+/**
+ * Give the density of the secondary rays of getRandomDiffuseRay in the given
+ * direction (among the rays of the same side of the surface) and their 
+ * weight.
+ */
+bool VarnishedLambertianBRDF::getDiffuseDensity(const Basis& localBasis, const Point2D& surfaceCoordinate, const LightVector& reemitedLight, const Vector& direction, Real& density, Real& weight)
+{
+  density = 0;
+  weight = 1.0/M_PI;
+  Vector normal=localBasis.k;
+  if(normal.dot(reemitedLight.getRay().v)>0)
+    return true;
+
+  //Transmission
+  if(direction.dot(normal)<0)
+  {
+    if(_opaque)
+      return true;
+    normal.mul(-1.0);
+  }
+  density = getRejectionDensity(normal, direction);
+  return true;
+}
+
 void VarnishedLambertianBRDF::generateRandomeDiffuseRay(const Vector& normal, const Point& origin, unsigned int nbRays, LightVector& reemitedLight, std::vector<LightVector>& subrays)
 {
   for(unsigned int i=0; i<nbRays; i++)
@@ -0,0 +1,163 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <objectshapes/Instance.hpp>
+//!
+//! @file Instance.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements the classes declared in Instance.hpp 
+//!  @arg Instance
+//!
+#include <cmath>
+
+#include <exceptions/Exception.hpp>
+////////////////////////////// class Instance //////////////////////////////////
+Instance::Instance(const Real matrix[12], ObjectShape* shape)
+    : p_shape(shape) {
+  for (int i = 0; i < 12; i++)
+    m_matrix[i] = matrix[i];
+
+  // Inverse of the linear part (cofactors)
+  const Real* m = m_matrix;
+  Real cofactors[9] = {
+    m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+    m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+    m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]
+  };
+  Real det = m[0] * cofactors[0] + m[1] * cofactors[1] + m[2] * cofactors[2];
+  if (std::fabs(det) < 1e-12)
+    throw Exception("(Instance::Instance) Matrice de transformation non "
+                    "inversible.");
+
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      // The inverse is the transposed cofactor matrix over the determinant
+      m_inverse[4 * r + c] = cofactors[3 * c + r] / det;
+      m_normal_matrix[4 * r + c] = cofactors[3 * r + c] / det;
+    }
+    m_normal_matrix[4 * r + 3] = 0;
+  }
+  for (int r = 0; r < 3; r++) {
+    m_inverse[4 * r + 3] = -(m_inverse[4 * r] * m[3] 
+                             + m_inverse[4 * r + 1] * m[7] 
+                             + m_inverse[4 * r + 2] * m[11]);
+  }
+}
+////////////////////////////// class Instance //////////////////////////////////
+Instance::~Instance() {
+  if (p_shape != NULL)
+    delete p_shape;
+  p_shape = NULL;
+}
+////////////////////////////// class Instance //////////////////////////////////
+bool Instance::intersect(const Ray& ray, Real& distance) {
+  Ray local = ray;
+  Real scale = ToLocal(ray, local);
+  if (!p_shape->intersect(local, distance))
+    return false;
+  distance /= scale;
+  return true;
+}
+////////////////////////////// class Instance //////////////////////////////////
+void Instance::getLocalBasis(const Ray& ray, const Real& distance, 
+                             Basis& localBasis, Point2D& surfaceCoordinate) {
+  Ray local = ray;
+  Real scale = ToLocal(ray, local);
+  Basis basis;
+  p_shape->getLocalBasis(local, distance * scale, basis, surfaceCoordinate);
+
+  TransformPoint(m_matrix, basis.o, localBasis.o);
+  TransformVector(m_normal_matrix, basis.k, localBasis.k);
+  localBasis.k.normalize();
+
+  // Tangent in the plane of the transformed normal
+  Vector tangent;
+  TransformVector(m_matrix, basis.i, tangent);
+  localBasis.j = localBasis.k.vect(tangent);
+  localBasis.j.normalize();
+  localBasis.i = localBasis.j.vect(localBasis.k);
+
+  // Keep the handedness of the basis of the shape (mirroring matrices)
+  Vector bitangent;
+  TransformVector(m_matrix, basis.j, bitangent);
+  if (bitangent.dot(localBasis.j) < 0)
+    localBasis.j.mul(-1);
+}
+////////////////////////////// class Instance //////////////////////////////////
+bool Instance::getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                     Vector& dpdu, Vector& dpdv) {
+  Ray local = ray;
+  Real scale = ToLocal(ray, local);
+  Vector local_dpdu, local_dpdv;
+  if (!p_shape->getSurfaceDerivatives(local, distance * scale, 
+                                      local_dpdu, local_dpdv))
+    return false;
+
+  // Tangent vectors: transformed by the linear part of the matrix
+  TransformVector(m_matrix, local_dpdu, dpdu);
+  TransformVector(m_matrix, local_dpdv, dpdv);
+  return true;
+}
+////////////////////////////// class Instance //////////////////////////////////
+void Instance::getBoundingBox(BoundingBox& boundingBox) {
+  BoundingBox tmp;
+  p_shape->getBoundingBox(tmp);
+
+  for (int corner = 0; corner < 8; corner++) {
+    Point p((corner & 1) ? tmp.max[0] : tmp.min[0],
+            (corner & 2) ? tmp.max[1] : tmp.min[1],
+            (corner & 4) ? tmp.max[2] : tmp.min[2]);
+    Point world;
+    TransformPoint(m_matrix, p, world);
+    if (corner == 0) {
+      boundingBox.min = world;
+      boundingBox.max = world;
+    } else {
+      boundingBox.updateWith(world);
+    }
+  }
+}
+////////////////////////////// class Instance //////////////////////////////////
+Real Instance::ToLocal(const Ray& ray, Ray& local) const {
+  TransformPoint(m_inverse, ray.o, local.o);
+  TransformVector(m_inverse, ray.v, local.v);
+  Real scale = local.v.norm();
+  local.v.mul(Real(1) / scale);
+  return scale;
+}
+////////////////////////////// class Instance //////////////////////////////////
+void Instance::TransformPoint(const Real matrix[12], const Point& p, 
+                              Point& result) const {
+  for (int r = 0; r < 3; r++) {
+    result[r] = matrix[4 * r] * p[0] + matrix[4 * r + 1] * p[1] 
+              + matrix[4 * r + 2] * p[2] + matrix[4 * r + 3];
+  }
+}
+////////////////////////////// class Instance //////////////////////////////////
+void Instance::TransformVector(const Real matrix[12], const Vector& v, 
+                               Vector& result) const {
+  for (int r = 0; r < 3; r++) {
+    result[r] = matrix[4 * r] * v[0] + matrix[4 * r + 1] * v[1] 
+              + matrix[4 * r + 2] * v[2];
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
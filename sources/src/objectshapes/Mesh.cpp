@@ -15,85 +15,229 @@
  */
 
 #include <objectshapes/Mesh.hpp>
+#include <objectshapes/Triangle.hpp>
 #include <iostream>
+#include <limits>
+
+#include <core/VrtLog.hpp>
+#include <maths/Quantization.hpp>
+
+namespace {
+/**
+ * Sharing of an attribute by the corners
+ */
+enum AttributeIndexing {
+  kNO_ATTRIBUTE,      //No corner has the attribute
+  kVERTEX_INDEXING,   //The attribute indices are the vertex indices
+  kOWN_INDEXING       //The attribute has its own indices
+};
+
+/**
+ * Find how the corners refer to an attribute
+ */
+AttributeIndexing getIndexing(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& vertexIndices)
+{
+  bool none = true;
+  bool shared = true;
+  for(size_t i=0; i<indices.size() && (none || shared); i++)
+  {
+    if(indices[i] != MeshData::kNO_INDEX)
+      none = false;
+    if(indices[i] != vertexIndices[i])
+      shared = false;
+  }
+  if(none)
+    return kNO_ATTRIBUTE;
+  return shared ? kVERTEX_INDEXING : kOWN_INDEXING;
+}
+
+/**
+ * Memory used by an array
+ */
+template<class T>
+size_t getArraySize(const std::vector<T>& values)
+{
+  return values.capacity() * sizeof(T);
+}
+}
 
 //------------------------------------------------------------------------------
-// SurfaceOctreeVisitor --------------------------------------------------------
+// Mesh ------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 
 /**
- * Initialize the visitor and errase the old results.
+ * Constructor from indexed triangles
+ * data : shared vertices and attributes, and corners of the triangles in the
+ *   order of the leaves of the hierarchy (see MeshBVH::Build). The arrays
+ *   are moved into the mesh: data is empty after the call.
+ * hierarchy : hierarchy of the triangles, deleted with the mesh
+ * double_sided : true if the normal must be turned toward the ray
+ * compact : true to quantize the normals (octahedral, 2x16 bits) and the
+ *   texture coordinates (half floats)
  */
-void MeshOctreeVisitor::init()
+Mesh::Mesh(MeshData& data, MeshBVH* hierarchy, bool double_sided, bool compact)
+  : _hierarchy(hierarchy), _doubleSided(double_sided)
 {
-  //Initialize result data
-  _distance=-1;
-  _object=0;
+  _hierarchy->GetBoundingBox(_boundingbox);
+
+  //Normals: dropped, shared with the vertices or indexed
+  AttributeIndexing indexing = getIndexing(data.normal_indices, data.vertex_indices);
+  if(indexing == kOWN_INDEXING)
+    _normalIndices.swap(data.normal_indices);
+  if(indexing != kNO_ATTRIBUTE && compact)
+  {
+    _packedNormals.resize(data.normals.size());
+    for(size_t i=0; i<data.normals.size(); i++)
+      _packedNormals[i] = Quantization::PackNormal(data.normals[i]);
+  }
+  else if(indexing != kNO_ATTRIBUTE)
+    _normals.swap(data.normals);
+
+  //Texture coordinates
+  indexing = getIndexing(data.texcoord_indices, data.vertex_indices);
+  if(indexing == kOWN_INDEXING)
+    _texCoordIndices.swap(data.texcoord_indices);
+  if(indexing != kNO_ATTRIBUTE && compact)
+  {
+    _packedTexCoords.resize(data.texcoords.size());
+    for(size_t i=0; i<data.texcoords.size(); i++)
+      _packedTexCoords[i] = Quantization::PackTexCoord(data.texcoords[i]);
+  }
+  else if(indexing != kNO_ATTRIBUTE)
+    _texCoords.swap(data.texcoords);
+
+  _vertices.swap(data.vertices);
+  _vertexIndices.swap(data.vertex_indices);
+  data.clear();
 }
 
 /**
- * Apply the visitor on a triangle
+ * Get the normal of a corner, return false if the corner has no normal
  */
-void MeshOctreeVisitor::apply(const Ray& ray, Triangle& object)
+bool Mesh::getCornerNormal(unsigned int corner, Vector& normal) const
 {
-  Real distance = -1;
-  if(object.intersect(ray, distance) && distance>0)
-    if(_distance<0 || _distance>distance)
-    {
-      _distance=distance;
-      _object=&object;
-    }
+  if(_normals.empty() && _packedNormals.empty())
+    return false;
+  unsigned int index = _normalIndices.empty() ? _vertexIndices[corner] : _normalIndices[corner];
+  if(index == MeshData::kNO_INDEX)
+    return false;
+  if(_packedNormals.empty())
+    normal = _normals[index];
+  else
+    normal = Quantization::UnpackNormal(_packedNormals[index]);
+  return true;
 }
 
 /**
- * Return the first intersection distance
+ * Get the texture coordinates of a corner (0 if the corner has none)
  */
-Real MeshOctreeVisitor::getMinDistance()
+void Mesh::getCornerTexCoord(unsigned int corner, Point2D& texCoord) const
 {
-  return _distance;
+  texCoord[0] = 0;
+  texCoord[1] = 0;
+  if(_texCoords.empty() && _packedTexCoords.empty())
+    return;
+  unsigned int index = _texCoordIndices.empty() ? _vertexIndices[corner] : _texCoordIndices[corner];
+  if(index == MeshData::kNO_INDEX)
+    return;
+  if(_packedTexCoords.empty())
+    texCoord = _texCoords[index];
+  else
+    texCoord = Quantization::UnpackTexCoord(_packedTexCoords[index]);
 }
 
 /**
- * Return the triangle of the first intersection, NULL otherwise
+ * Intersection test with one triangle (Moller-Trumbore).
+ * distance : we put the distance of the intersection here.
  */
-Triangle* MeshOctreeVisitor::getMinDistanceTriangle()
+bool Mesh::intersectTriangle(unsigned int triangle, const Ray& ray, Real& distance) const
 {
-  return _object;
-}
+  const Point& p0 = _vertices[_vertexIndices[3*triangle]];
+  const Point& p1 = _vertices[_vertexIndices[3*triangle + 1]];
+  const Point& p2 = _vertices[_vertexIndices[3*triangle + 2]];
+  Vector edge1(p0, p1);
+  Vector edge2(p0, p2);
 
-//------------------------------------------------------------------------------
-// Mesh ------------------------------------------------------------------------
-//------------------------------------------------------------------------------
+  //Ray parallel to the plane of the triangle
+  Vector p;
+  ray.v.vect(edge2, p);
+  Real det = edge1.dot(p);
+  if(det == 0)
+    return false;
+  Real invDet = Real(1) / det;
+
+  //Barycentric coordinates, edges included
+  Vector s(p0, ray.o);
+  Real u = s.dot(p) * invDet;
+  if(u < 0 || u > 1)
+    return false;
+  Vector q;
+  s.vect(edge1, q);
+  Real v = ray.v.dot(q) * invDet;
+  if(v < 0 || u + v > 1)
+    return false;
+
+  distance = edge2.dot(q) * invDet;
+  return distance > 0;
+}
 
 /**
- * Constructor from triangles array
- * triangles : array that contain all the triangles.
- * nbTriangles : number of triangles contained in the given array
+ * Return the nearest triangle hit by the ray, -1 if there is none.
+ * distance : we put the distance of the intersection here.
+ * maxDistance : the triangles further than this distance are ignored.
  */
-Mesh::Mesh(Triangle* triangles, int nbTriangles)
+int Mesh::getNearestTriangle(const Ray& ray, Real& distance, Real maxDistance) const
 {
-  //Initializing bounding box
-  triangles[0].getBoundingBox(_boundingbox);
-  for(int i=0; i<nbTriangles; i++)
-  {
-    BoundingBox trianglebox;
-    triangles[i].getBoundingBox(trianglebox);
-    _boundingbox.updateWith(trianglebox);
-  }
+  const MeshBVH::Node* nodes = _hierarchy->nodes();
+  int nearest = -1;
+  distance = -1;
+  if(_hierarchy->nb_nodes() == 0)
+    return -1;
 
-  //Creating octree
-  int _depth = (std::log10((float)nbTriangles)>1)? (int)std::log10((float)nbTriangles) : 1;
-  if(_depth<1)
-    _depth=1;
-  _triangles= new Octree<Triangle>(_boundingbox, nbTriangles, _depth);
-  
-  //Filling octree
-  for(int i=0; i< nbTriangles; i++)
+  Real origin[3] = {ray.o[0], ray.o[1], ray.o[2]};
+  Real invDir[3];
+  for(int k=0; k<3; k++)
+    invDir[k] = Real(1) / ray.v[k];
+
+  //Depth first traversal, nearest child first
+  unsigned int stack[2*MeshBVH::kMAX_DEPTH];
+  int top = 0;
+  stack[top++] = 0;
+  while(top > 0)
   {
-    BoundingBox trianglebox;
-    triangles[i].getBoundingBox(trianglebox);
-    _triangles->add(triangles[i], trianglebox);
+    const MeshBVH::Node& node = nodes[stack[--top]];
+    if(!MeshBVH::Intersect(node, origin, invDir, maxDistance))
+      continue;
+
+    if(node.axis == MeshBVH::kLEAF)
+    {
+      for(unsigned int i=node.first; i<node.first+node.count; i++)
+      {
+        Real d;
+        if(intersectTriangle(i, ray, d) && d<maxDistance)
+        {
+          distance = d;
+          nearest = (int)i;
+          maxDistance = d;
+        }
+      }
+    }
+    else
+    {
+      unsigned int left = (unsigned int)(&node - nodes) + 1;
+      if(ray.v[node.axis] < 0)
+      {
+        stack[top++] = left;
+        stack[top++] = node.first;
+      }
+      else
+      {
+        stack[top++] = node.first;
+        stack[top++] = left;
+      }
+    }
   }
+  return nearest;
 }
 
 /**
@@ -107,24 +251,7 @@ Mesh::Mesh(Triangle* triangles, int nbTriangles)
  */
 bool Mesh::intersect(const Ray& ray, Real& distance)
 {
-
-  //Test the bounding box
-  if(!_boundingbox.canIntersect(ray))
-    return false;
-
-  //Initialize visitor
-  MeshOctreeVisitor visitor;
-  visitor.init();
-  
-  //Applying the visitor on the octree
-  _triangles->accept(ray, visitor);
-  
-  //Getting the intersection distance
-  distance = visitor.getMinDistance();
-
-  if(distance <0)
-    return false;
-  return true;
+  return getNearestTriangle(ray, distance) >= 0;
 }
 
 /**
@@ -141,19 +268,122 @@ bool Mesh::intersect(const Ray& ray, Real& distance)
  */
 void Mesh::getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasis, Point2D& surfaceCoordinate)
 {
-  //Initialize visitor
-  MeshOctreeVisitor visitor;
-  visitor.init();
-  
-  //Applying the visitor on the octree
-  _triangles->accept(ray, visitor);
+  Real nearestDistance;
+  int triangle = getNearestTriangle(ray, nearestDistance);
 
   //If there were no intersection return !
-  if(visitor.getMinDistanceTriangle()==0)
+  if(triangle < 0)
     return;
+
+  //Gathering the corners of the triangle
+  Point vertices[3];
+  Vector normals[3];
+  Point2D texCoords[3];
+  bool hasNormals = true;
+  for(int i=0; i<3; i++)
+  {
+    unsigned int corner = 3*triangle + i;
+    vertices[i] = _vertices[_vertexIndices[corner]];
+    if(!getCornerNormal(corner, normals[i]))
+      hasNormals = false;
+    getCornerTexCoord(corner, texCoords[i]);
+  }
+
+  //Flat triangle
+  if(!hasNormals)
+  {
+    Vector normal;
+    Vector(vertices[0], vertices[1]).vect(Vector(vertices[0], vertices[2]), normal);
+    normal.normalize();
+    normals[0] = normals[1] = normals[2] = normal;
+  }
+
+  // Get the intersection point
+  Point intersection(ray, distance);
+  
+  //Computing weights
+  Real weights[3];
+  for(int i=0; i<3; i++)
+  {
+    Vector edge(vertices[i], vertices[(i+1)%3]);
+    Vector hyp(vertices[i], intersection);
+    Vector pvect;
+    edge.vect(hyp, pvect);
+    weights[(i+2)%3] = pvect.norm();
+  }
+
+  Real totalweight = weights[0] + weights[1] + weights[2];
+  weights[0]/=totalweight;
+  weights[1]/=totalweight;
+  weights[2]/=totalweight;
   
-  //Let delegate the job to the good triangle
-  visitor.getMinDistanceTriangle()->getLocalBasis(ray, distance, localBasis, surfaceCoordinate);
+  // Get Normal
+  localBasis.o=intersection;
+  localBasis.k[0]= weights[0]*normals[0][0] + weights[1]*normals[1][0] + weights[2]*normals[2][0];
+  localBasis.k[1]= weights[0]*normals[0][1] + weights[1]*normals[1][1] + weights[2]*normals[2][1];
+  localBasis.k[2]= weights[0]*normals[0][2] + weights[1]*normals[1][2] + weights[2]*normals[2][2];
+
+  // if double_sided, then k is correctly oriented to the origin of the ray
+  if(_doubleSided && ray.v.dot(localBasis.k) > 0)
+    localBasis.k.mul(-1.0f);
+
+  // Get tangents vector
+  Vector edge1(vertices[0], vertices[1]);
+  Vector edge2(vertices[0], vertices[2]);
+  Point2D uvedge1 (texCoords[1][0]-texCoords[0][0], texCoords[1][1]-texCoords[0][1]);
+  Point2D uvedge2 (texCoords[2][0]-texCoords[0][0], texCoords[2][1]-texCoords[0][1]);
+  Real cp = uvedge1[1] * uvedge2[0] - uvedge1[0] * uvedge2[1];
+  if(cp != 0.0f)
+  {
+    Real mul = 1.0f / cp;
+    localBasis.i[0] =  (edge1[0] * -uvedge2[1] + edge2[0]*uvedge1[1])*mul;
+    localBasis.i[1] =  (edge1[1] * -uvedge2[1] + edge2[1]*uvedge1[1])*mul;
+    localBasis.i[2] =  (edge1[2] * -uvedge2[1] + edge2[2]*uvedge1[1])*mul;
+  }
+  localBasis.k.vect(localBasis.i, localBasis.j);
+  localBasis.j.vect(localBasis.k, localBasis.i);
+
+  //Normalizing vectors
+  localBasis.i.normalize();
+  localBasis.j.normalize();
+  localBasis.k.normalize();
+  
+  // Get surfaceCoordinate
+  surfaceCoordinate[0] =  weights[0]*texCoords[0][0] + weights[1]*texCoords[1][0] + weights[2]*texCoords[2][0];
+  surfaceCoordinate[1] =  weights[0]*texCoords[0][1] + weights[1]*texCoords[1][1] + weights[2]*texCoords[2][1];
+}
+
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool Mesh::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  //Triangle under the intersection point, searched along a short segment
+  //around it: only the nodes that contain the point are visited
+  Real margin = distance*Real(1e-3) + kEPSILON;
+  Ray probe = ray;
+  for(int i=0; i<3; i++)
+    probe.o[i] = ray.o[i] + ray.v[i]*(distance - margin);
+  Real probeDistance;
+  int triangle = getNearestTriangle(probe, probeDistance, 2*margin);
+  if(triangle < 0)
+    return false;
+
+  Point vertices[3];
+  Point2D texCoords[3];
+  for(int i=0; i<3; i++)
+  {
+    unsigned int corner = 3*triangle + i;
+    vertices[i] = _vertices[_vertexIndices[corner]];
+    getCornerTexCoord(corner, texCoords[i]);
+  }
+  return Triangle::getTexCoordDerivatives(vertices, texCoords, dpdu, dpdv);
 }
 
 /**
@@ -164,3 +394,46 @@ void Mesh::getBoundingBox(BoundingBox& boundingBox)
 {
   boundingBox=_boundingbox;
 }
+
+/**
+ * Return the memory used by the mesh, in bytes
+ */
+size_t Mesh::getMemoryUsage() const
+{
+  return sizeof(Mesh) 
+    + getArraySize(_vertices) + getArraySize(_normals) 
+    + getArraySize(_packedNormals) + getArraySize(_texCoords) 
+    + getArraySize(_packedTexCoords) + getArraySize(_vertexIndices) 
+    + getArraySize(_normalIndices) + getArraySize(_texCoordIndices)
+    + sizeof(MeshBVH) + _hierarchy->nb_nodes() * sizeof(MeshBVH::Node);
+}
+
+/**
+ * Write the memory used by each array of the mesh in the log
+ * name : name of the mesh in the report
+ */
+void Mesh::printMemoryReport(const std::string& name) const
+{
+  const double kKB = 1024.0;
+  size_t total = getMemoryUsage();
+  VrtLog::Write("-- Mesh %s : %u triangles, %.1f Ko (%.1f octets par triangle)",
+                name.c_str(), getNbTriangles(), total / kKB,
+                getNbTriangles() > 0 ? (double)total / getNbTriangles() : 0.0);
+  VrtLog::Write("--   sommets %u : %.1f Ko", (unsigned int)_vertices.size(),
+                getArraySize(_vertices) / kKB);
+  VrtLog::Write("--   normales %u%s : %.1f Ko", 
+                (unsigned int)(_normals.size() + _packedNormals.size()),
+                _packedNormals.empty() ? "" : " (octaedriques)",
+                (getArraySize(_normals) + getArraySize(_packedNormals)) / kKB);
+  VrtLog::Write("--   coordonnees de texture %u%s : %.1f Ko", 
+                (unsigned int)(_texCoords.size() + _packedTexCoords.size()),
+                _packedTexCoords.empty() ? "" : " (demi-flottants)",
+                (getArraySize(_texCoords) + getArraySize(_packedTexCoords)) / kKB);
+  VrtLog::Write("--   indices : %.1f Ko (normales %s, textures %s)",
+                (getArraySize(_vertexIndices) + getArraySize(_normalIndices)
+                 + getArraySize(_texCoordIndices)) / kKB,
+                _normalIndices.empty() ? "partagees" : "propres",
+                _texCoordIndices.empty() ? "partagees" : "propres");
+  VrtLog::Write("--   hierarchie %u noeuds : %.1f Ko", _hierarchy->nb_nodes(),
+                _hierarchy->nb_nodes() * sizeof(MeshBVH::Node) / kKB);
+}
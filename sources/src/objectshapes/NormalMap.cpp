@@ -16,6 +16,8 @@
 
 #include <objectshapes/NormalMap.hpp>
 
+#include <structures/ScratchBuffer.hpp>
+
 /**
  * Constructor
  * shape : the shape to translate
@@ -59,7 +61,8 @@ void NormalMap::getLocalBasis(const Ray& ray, const Real& distance, Basis& local
 
   Real x = surfaceCoordinate[0]*_map->getWidth();
   Real y = surfaceCoordinate[1]*_map->getHeight();
-  Pixel pixel = _map->getInterpolatedPixel(x, y);
+  ScratchBuffer pixel(_map->getNumberOfChannels());
+  _map->getInterpolatedPixel(x, y, pixel.data());
 
   if(_isGlobal)
   {
@@ -85,6 +88,20 @@ void NormalMap::getLocalBasis(const Ray& ray, const Real& distance, Basis& local
   localBasis.k.normalize();
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool NormalMap::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  return _shape->getSurfaceDerivatives(ray, distance, dpdu, dpdv);
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
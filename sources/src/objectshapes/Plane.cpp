@@ -89,6 +89,25 @@ void Plane::getLocalBasis(const Ray& ray, const Real& distance, Basis& localBasi
   surfaceCoordinate[1] = OM.dot(_v)/(_normv);
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool Plane::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  for(int i=0; i<3; i++)
+  {
+    dpdu[i] = _u[i]*_normu;
+    dpdv[i] = _v[i]*_normv;
+  }
+  return true;
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
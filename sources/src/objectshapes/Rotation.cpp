@@ -228,6 +228,36 @@ void Rotation::getLocalBasis(const Ray& ray, const Real& distance,
   to_world(localBasis.k);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool Rotation::getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                     Vector& dpdu, Vector& dpdv) {
+  if (p_shape == NULL)
+    return false;
+
+  Ray transRay = ray;
+
+  to_local(transRay.o);
+  to_local(transRay.v);
+
+  transform(transRay.o);
+  transform(transRay.v);
+
+  to_world(transRay.o);
+  to_world(transRay.v);
+
+  if (!p_shape->getSurfaceDerivatives(transRay, distance, dpdu, dpdv))
+    return false;
+
+  to_local(dpdu);
+  to_local(dpdv);
+
+  inverse_transform(dpdu);
+  inverse_transform(dpdv);
+
+  to_world(dpdu);
+  to_world(dpdv);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
 void Rotation::getBoundingBox(BoundingBox& boundingBox) {
   if (p_shape == NULL)
     return;
@@ -86,6 +86,21 @@ void Scale::getLocalBasis(const Ray& ray, const Real& distance,
   inverse_transform(localBasis.k);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool Scale::getSurfaceDerivatives(const Ray& ray, const Real& distance, 
+                                  Vector& dpdu, Vector& dpdv) {
+  if (p_shape == NULL)
+    return false;
+
+  Ray transRay = ray;
+  transform(transRay.o);
+  transform(transRay.v);
+  if (!p_shape->getSurfaceDerivatives(transRay, distance, dpdu, dpdv))
+    return false;
+  inverse_transform(dpdu);
+  inverse_transform(dpdv);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
 void Scale::getBoundingBox(BoundingBox& boundingBox) {
   if (p_shape == NULL)
     return;
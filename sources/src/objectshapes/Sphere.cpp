@@ -98,6 +98,34 @@ void Sphere::getLocalBasis(const Ray& ray, const Real& distance, Basis& localBas
   surfaceCoordinate[1] = std::acos ((localBasis.o[2]-_center[2])/_radius)/M_PI;
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool Sphere::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  Vector radial;
+  for(int i=0; i<3; i++)
+    radial[i] = ray.o[i] + ray.v[i]*distance - _center[i];
+
+  // u = phi/(2pi) and v = theta/pi, undefined at the poles
+  Real rho = std::sqrt(radial[0]*radial[0] + radial[1]*radial[1]);
+  if(rho <= 0)
+    return false;
+  dpdu[0] = -2*M_PI*radial[1];
+  dpdu[1] = 2*M_PI*radial[0];
+  dpdu[2] = 0;
+  dpdv[0] = M_PI*radial[2]*radial[0]/rho;
+  dpdv[1] = M_PI*radial[2]*radial[1]/rho;
+  dpdv[2] = -M_PI*rho;
+  return true;
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
@@ -325,6 +325,17 @@ void Transformation::getLocalBasis(const Ray& ray, const Real& distance,
   local_basis.o = m_main_transform.Transform(local_basis.o);
 }
 ////////////////////////////////////////////////////////////////////////////////
+bool Transformation::getSurfaceDerivatives(const Ray& ray, 
+                                           const Real& distance, 
+                                           Vector& dpdu, Vector& dpdv) {
+  if (p_embedded == NULL)
+    return false;
+
+  Ray trans_ray = ray;
+  trans_ray.o = m_back_transform.Transform(trans_ray.o);
+  return p_embedded->getSurfaceDerivatives(trans_ray, distance, dpdu, dpdv);
+}
+////////////////////////////////////////////////////////////////////////////////
 void Transformation::getBoundingBox(BoundingBox& bounding_box) {
   if (p_embedded == NULL)
     return;
@@ -58,6 +58,24 @@ void Translation::getLocalBasis(const Ray& ray, const Real& distance, Basis& loc
   localBasis.o[2]+=_translate[2];
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool Translation::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  Ray transRay=ray;
+  transRay.o[0]-=_translate[0];
+  transRay.o[1]-=_translate[1];
+  transRay.o[2]-=_translate[2];
+  return _shape->getSurfaceDerivatives(transRay, distance, dpdu, dpdv);
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
@@ -194,6 +194,44 @@ void Triangle::getLocalBasis(const Ray& ray, const Real& distance, Basis& localB
   surfaceCoordinate[1] =  weights[0]*_texCoords[0][1] + weights[1]*_texCoords[1][1] + weights[2]*_texCoords[2][1];
 }
 
+/**
+ * Partial derivatives of the intersection point with respect to the surface
+ * coordinates. Return false if they are unknown.
+ * ray : the ray we use to test the intersection with the object.
+ * distance : the computed distance of the intersection point from the
+ *   origine of the ray.
+ * dpdu : we will put the derivative along the first coordinate here.
+ * dpdv : we will put the derivative along the second coordinate here.
+ */
+bool Triangle::getSurfaceDerivatives(const Ray& ray, const Real& distance, Vector& dpdu, Vector& dpdv)
+{
+  return getTexCoordDerivatives(_vertices, _texCoords, dpdu, dpdv);
+}
+
+/**
+ * Partial derivatives of the points of a triangle with respect to its
+ * texture coordinates. Return false if the texture coordinates are degenerate.
+ */
+bool Triangle::getTexCoordDerivatives(const Point vertices[3], const Point2D texCoords[3], Vector& dpdu, Vector& dpdv)
+{
+  // Solve edge = du*dpdu + dv*dpdv for the two edges from the first vertex
+  Vector edge1(vertices[0], vertices[1]);
+  Vector edge2(vertices[0], vertices[2]);
+  Real du1 = texCoords[1][0]-texCoords[0][0], dv1 = texCoords[1][1]-texCoords[0][1];
+  Real du2 = texCoords[2][0]-texCoords[0][0], dv2 = texCoords[2][1]-texCoords[0][1];
+  Real det = du1*dv2 - dv1*du2;
+  if(det == 0)
+    return false;
+
+  Real inv = Real(1)/det;
+  for(int i=0; i<3; i++)
+  {
+    dpdu[i] = (dv2*edge1[i] - dv1*edge2[i])*inv;
+    dpdv[i] = (du1*edge2[i] - du2*edge1[i])*inv;
+  }
+  return true;
+}
+
 /**
  * Return the bounding box of the object.
  * boundingBox : we will put the bounding box here
@@ -0,0 +1,252 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <physics/LayerTableCache.hpp>
+//!
+//! @file LayerTableCache.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in LayerTableCache.hpp
+//!  @arg LayerTableCache
+//!
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <core/VrtLog.hpp>
+
+namespace {
+//! Identifier of the cache files
+const char kMAGIC[4] = {'V', 'L', 'T', 'C'};
+//! Version of the cache files
+const unsigned int kVERSION = 1;
+//! FNV-1a parameters
+const unsigned long long kFNV_OFFSET = 14695981039346656037ULL;
+const unsigned long long kFNV_PRIME = 1099511628211ULL;
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned long long HashBytes(unsigned long long hash, 
+                                    const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= kFNV_PRIME;
+  }
+  return hash;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Header of the cache files
+struct CacheHeader {
+  char magic[4];
+  unsigned int version;
+  unsigned long long key;
+  unsigned int real_size;
+  unsigned int nb_wavelengths;
+  unsigned int nb_tables;
+  unsigned int padding;
+  unsigned long long checksum;
+};
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+std::string LayerTableCache::s_directory;
+std::map<unsigned long long, std::vector<Spectrum> > LayerTableCache::s_tables;
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key::Key(const char* tag)
+    : m_hash(kFNV_OFFSET) {
+  Add(tag, strlen(tag));
+  Add((unsigned int)sizeof(Real));
+  Add(GlobalSpectrum::nbWaveLengths());
+  for (unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+    Add(GlobalSpectrum::getWaveLength(i));
+}
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key& LayerTableCache::Key::Add(const void* data, 
+                                                size_t size) {
+  m_hash = HashBytes(m_hash, data, size);
+  return *this;
+}
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key& LayerTableCache::Key::Add(unsigned int value) {
+  return Add(&value, sizeof(value));
+}
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key& LayerTableCache::Key::Add(Real value) {
+  return Add(&value, sizeof(value));
+}
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key& LayerTableCache::Key::Add(const Spectrum& spectrum) {
+  for (unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+    Add(spectrum[i]);
+  return *this;
+}
+////////////////////////////// class LayerTableCache::Key //////////////////////
+LayerTableCache::Key& LayerTableCache::Key::Add(const Medium& medium) {
+  unsigned int flags = (medium.isOpaque ? 1 : 0)
+                     | (medium.useLambertianModel ? 2 : 0)
+                     | (medium.useFresnelModel ? 4 : 0)
+                     | (medium.useKubelkaMunkModel ? 8 : 0);
+  Add(flags);
+  if (medium.useLambertianModel)
+    Add(medium.r).Add(medium.t);
+  if (medium.useFresnelModel)
+    Add(medium.n).Add(medium.k);
+  if (medium.useKubelkaMunkModel)
+    Add(medium.S).Add(medium.K);
+  return *this;
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+void LayerTableCache::SetDirectory(const std::string& directory) {
+  s_directory = directory;
+  if (!s_directory.empty() && s_directory[s_directory.size() - 1] != '/'
+      && s_directory[s_directory.size() - 1] != '\\')
+    s_directory += '/';
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+bool LayerTableCache::Find(const Key& key, std::vector<Spectrum>& tables) {
+  bool found = false;
+# pragma omp critical (layer_table_cache)
+  {
+  std::map<unsigned long long, std::vector<Spectrum> >::const_iterator it 
+      = s_tables.find(key.value());
+  if (it != s_tables.end()) {
+    tables = it->second;
+    found = true;
+  }
+  }
+  if (found)
+    return true;
+
+  // Disk cache
+  if (s_directory.empty() || !Load(key.value(), tables))
+    return false;
+# pragma omp critical (layer_table_cache)
+  s_tables[key.value()] = tables;
+  return true;
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+void LayerTableCache::Store(const Key& key, 
+                            const std::vector<Spectrum>& tables) {
+# pragma omp critical (layer_table_cache)
+  s_tables[key.value()] = tables;
+  if (!s_directory.empty())
+    Save(key.value(), tables);
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+void LayerTableCache::Clear(void) {
+# pragma omp critical (layer_table_cache)
+  s_tables.clear();
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+std::string LayerTableCache::GetFilename(unsigned long long key) {
+  char name[32];
+  sprintf(name, "%08x%08x.vlt", (unsigned int)(key >> 32), 
+          (unsigned int)(key & 0xffffffffULL));
+  return s_directory + name;
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+bool LayerTableCache::Load(unsigned long long key, 
+                           std::vector<Spectrum>& tables) {
+  FILE* file = fopen(GetFilename(key).c_str(), "rb");
+  if (file == NULL)
+    return false;
+
+  CacheHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1
+      || memcmp(header.magic, kMAGIC, 4) != 0 
+      || header.version != kVERSION || header.key != key
+      || header.real_size != sizeof(Real)
+      || header.nb_wavelengths != GlobalSpectrum::nbWaveLengths()) {
+    fclose(file);
+    return false;
+  }
+
+  std::vector<Spectrum> loaded(header.nb_tables);
+  unsigned long long checksum = kFNV_OFFSET;
+  for (unsigned int t = 0; t < header.nb_tables; t++) {
+    if (fread(loaded[t].values(), sizeof(Real), header.nb_wavelengths, file) 
+          != header.nb_wavelengths) {
+      fclose(file);
+      return false;
+    }
+    checksum = HashBytes(checksum, loaded[t].values(), 
+                         sizeof(Real) * header.nb_wavelengths);
+  }
+  fclose(file);
+
+  // Partially written or corrupted file
+  if (checksum != header.checksum) {
+    VrtLog::Write("(LayerTableCache::Load) Fichier de cache invalide: %s",
+                  GetFilename(key).c_str());
+    return false;
+  }
+
+  tables.swap(loaded);
+  return true;
+}
+////////////////////////////// class LayerTableCache ///////////////////////////
+void LayerTableCache::Save(unsigned long long key, 
+                           const std::vector<Spectrum>& tables) {
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMAGIC, 4);
+  header.version = kVERSION;
+  header.key = key;
+  header.real_size = sizeof(Real);
+  header.nb_wavelengths = GlobalSpectrum::nbWaveLengths();
+  header.nb_tables = (unsigned int)tables.size();
+  header.checksum = kFNV_OFFSET;
+  for (unsigned int t = 0; t < tables.size(); t++) {
+    header.checksum = HashBytes(header.checksum, 
+                                &tables[t][0], 
+                                sizeof(Real) * header.nb_wavelengths);
+  }
+
+  // Several jobs (or MPI ranks) may write the same file: write a temporary
+  // file, then rename it
+  std::string filename = GetFilename(key);
+  char suffix[32];
+  sprintf(suffix, ".%08x.tmp", 
+          (unsigned int)rand() ^ (unsigned int)clock() 
+          ^ (unsigned int)(size_t)&header);
+  std::string temporary = filename + suffix;
+
+  FILE* file = fopen(temporary.c_str(), "wb");
+  if (file == NULL) {
+    VrtLog::Write("(LayerTableCache::Save) Echec de l'ecriture du fichier %s",
+                  temporary.c_str());
+    return;
+  }
+  bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+  for (unsigned int t = 0; ok && t < tables.size(); t++) {
+    ok = (fwrite(&tables[t][0], sizeof(Real), header.nb_wavelengths, file)
+            == header.nb_wavelengths);
+  }
+  ok = (fclose(file) == 0) && ok;
+
+  // Replace the file (rename fails on Windows if the file already exists)
+  if (ok && std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(filename.c_str());
+    ok = (std::rename(temporary.c_str(), filename.c_str()) == 0);
+  }
+  if (!ok)
+    std::remove(temporary.c_str());
+}
+////////////////////////////////////////////////////////////////////////////////
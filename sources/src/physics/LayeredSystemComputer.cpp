@@ -18,6 +18,7 @@
 #include <physics/DielectricFormula.hpp>
 #include <physics/KubelkaMunkFormula.hpp>
 #include <physics/ThinLayerSystem.hpp>
+#include <physics/LayerTableCache.hpp>
 
 #include <core/debug.hpp>
 
@@ -166,6 +167,67 @@ void LayeredSystemComputer::computeSpecularLayerSystem(Spectrum& Rs, Spectrum& R
   }
 }
 
+/**
+ * Compute the specular reflectance of a layered system for the incident
+ * angles i*PI/(2*samples), i in [0, samples[. The tables are looked up in
+ * (and added to) the LayerTableCache.
+ * 
+ * @param Rs : the reflectance for the S-polarization of each angle.
+ * @param Rp : the reflectance for the P-polarization of each angle.
+ * @param Ts : the transmittance for the S-polarization of each angle.
+ * @param Tp : the transmittance for the P-polarization of each angle.
+ * @param samples : the number of sampled angles.
+ * @param media : the medium of every layer. Note that the first medium is the external medium.
+ * @param thickness : the thickness (in meters) of each layer (note that the first one is not used).
+ */
+void LayeredSystemComputer::computeSpecularLayerTable(std::vector<Spectrum>& Rs, std::vector<Spectrum>& Rp, std::vector<Spectrum>& Ts, std::vector<Spectrum>& Tp, unsigned int samples, const std::vector<const Medium*>& media, const std::vector<Real>& thickness)
+{
+  Rs.resize(samples);
+  Rp.resize(samples);
+  Ts.resize(samples);
+  Tp.resize(samples);
+
+  //The tables only depend on the media, the thicknesses and the sampling
+  LayerTableCache::Key key("SpecularLayerTable");
+  key.Add(samples).Add((unsigned int)media.size());
+  for(unsigned int i=0; i<media.size(); i++)
+    key.Add(*media[i]);
+  for(unsigned int i=0; i<thickness.size(); i++)
+    key.Add(thickness[i]);
+
+  std::vector<Spectrum> tables;
+  if(LayerTableCache::Find(key, tables) && tables.size()==4*samples)
+  {
+    for(unsigned int i=0; i<samples; i++)
+    {
+      Rs[i]=tables[4*i];
+      Rp[i]=tables[4*i+1];
+      Ts[i]=tables[4*i+2];
+      Tp[i]=tables[4*i+3];
+    }
+    return;
+  }
+
+  //The angles are independent
+  int i;
+# pragma omp parallel for private(i) schedule(dynamic, 1)
+  for(i=0; i<(int)samples; i++)
+  {
+    Real cosOi = std::cos(i*M_PI*0.5/(Real)samples);
+    computeSpecularLayerSystem(Rs[i], Rp[i], Ts[i], Tp[i], cosOi, media, thickness);
+  }
+
+  tables.resize(4*samples);
+  for(unsigned int i=0; i<samples; i++)
+  {
+    tables[4*i]=Rs[i];
+    tables[4*i+1]=Rp[i];
+    tables[4*i+2]=Ts[i];
+    tables[4*i+3]=Tp[i];
+  }
+  LayerTableCache::Store(key, tables);
+}
+
 
 //! @brief Compute the specular amplitude reflectance of a layered system
 //! @todo Add influence of the scattering from pigments
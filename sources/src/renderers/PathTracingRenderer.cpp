@@ -0,0 +1,430 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <renderers/PathTracingRenderer.hpp>
+//!
+//! @file PathTracingRenderer.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements the classes declared in PathTracingRenderer.hpp 
+//!  @arg PathTracingRenderer
+//! @todo 
+//! @remarks 
+//!
+#include <cstdlib>
+#include <vector>
+#include <omp.h>
+
+#include <core/Scenery.hpp>
+
+#include <exceptions/Exception.hpp>
+
+#include <environments/Environment.hpp>
+////////////////////////////////////////////////////////////////////////////////
+PathTracingRenderer::PathTracingRenderer(int max_depth, Real scale, 
+                                         Environment* envir)
+    : m_max_depth(max_depth), m_scale(scale), p_environment(envir) {
+  if(m_max_depth < 0)
+    m_max_depth = 0;
+}
+////////////////////////////////////////////////////////////////////////////////
+PathTracingRenderer::~PathTracingRenderer(void) { 
+  if (p_environment != NULL)
+    delete p_environment;
+  p_environment = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::Init(Scenery& scenery, int nb_threads) {
+  BuildLightSelection(scenery);
+
+  //The paths are allocated once for all: a path has at most m_max_depth 
+  //bounces, thus m_max_depth + 1 vertices
+  unsigned int nb_paths = omp_get_max_threads();
+  if(nb_threads > 0 && (unsigned int)nb_threads > nb_paths)
+    nb_paths = nb_threads;
+  m_paths.assign(nb_paths, std::vector<PathVertex>(m_max_depth + 1));
+  m_subrays.assign(nb_paths, std::vector<LightVector>());
+}
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::InitWithData(Scenery& scenery, 
+                                       unsigned char* data, 
+                                       unsigned int data_size) {
+  Init(scenery, 1);
+}
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::ExportData(unsigned char** data, 
+                                     unsigned int* data_size) {
+  *data = NULL;
+  *data_size = 0;
+}  
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::CastRay(Scenery& scenery, 
+                                  LightVector& light_data, 
+                                  int depth) {
+  if(depth < 0 || depth > m_max_depth) 
+    depth = m_max_depth;
+
+  unsigned int thread = omp_get_thread_num();
+  if(thread >= m_paths.size()) {
+    throw Exception("(PathTracingRenderer::CastRay) Le renderer n'a pas ete "
+                    "initialise pour ce thread.");
+  }
+  std::vector<PathVertex>& path = m_paths[thread];
+  std::vector<LightVector>& subrays = m_subrays[thread];
+  std::vector<Real> weights;
+
+  //Forward pass: from the eye to the end of the path
+  path[0].light = light_data;
+  path[0].environment_weight = 1;
+  path[0].see_sources = true;
+  Object* last_object = 0;
+  Real throughput = 1;
+  int nb_vertices = 0;
+  for(int k = 0; k <= depth; k++) {
+    PathVertex& vertex = path[k];
+    vertex.object = 0;
+    vertex.weight = 0;
+    nb_vertices = k + 1;
+
+    //Computing nearest intersection (the sources are sampled by the 
+    //direct lighting of the diffuse vertices)
+    Real obj_distance = -1;
+    Real src_distance = -1;
+    Object* nearest_object = 0;
+    Source* nearest_source = 0;
+    Basis src_local_basis;
+    Point2D src_surface_coordinate;
+    bool obj_hit = scenery.getNearestIntersection(vertex.light.getRay(), 
+                                                  obj_distance, 
+                                                  nearest_object, 
+                                                  vertex.local_basis, 
+                                                  vertex.surface_coordinate, 
+                                                  last_object);
+    bool src_hit = false;
+    if(vertex.see_sources) {
+      src_hit = scenery.getNearestIntersectionWithSource(
+                  vertex.light.getRay(), src_distance, nearest_source, 
+                  src_local_basis, src_surface_coordinate);
+    }
+
+    //The path escapes the scenery
+    if(!obj_hit && !src_hit) {
+      if(p_environment != NULL) {
+        if(vertex.environment_weight < Real(1.0)) {
+          LightVector env(vertex.light);
+          env.clear();
+          p_environment->AddContribution(env);
+          env.mul(vertex.environment_weight);
+          vertex.light.add(env);
+        } else {
+          p_environment->AddContribution(vertex.light);
+        }
+      }
+      break;
+    }
+
+    //The path ends on a source
+    if(src_hit && (!obj_hit || src_distance < obj_distance)) {
+      vertex.light.setDistance(src_distance * m_scale);
+      LightVector tmp; 
+      tmp.initSpectralData(vertex.light);
+      tmp.initGeometricalData(vertex.light);
+      nearest_source->getEmittedLight(src_local_basis, 
+                                      src_surface_coordinate, tmp);
+      vertex.light.add(tmp);
+      break;
+    }
+
+    //Intersection with object
+    vertex.object = nearest_object;
+    vertex.light.setDistance(obj_distance * m_scale);
+
+    //Footprint of the pixel on the surface (filtering of the textures)
+    Point2D surface_dx, surface_dy;
+    nearest_object->getSurfaceDifferentials(vertex.light, vertex.local_basis, 
+                                            vertex.surface_coordinate, 
+                                            surface_dx, surface_dy);
+    vertex.light.setSurfaceDifferentials(surface_dx, surface_dy);
+
+    //Candidates for the continuation of the path
+    bool can_continue = k < depth;
+    subrays.clear();
+    weights.clear();
+    if(can_continue && nearest_object->isSpecular()) {
+      nearest_object->getSpecularSubRays(vertex.local_basis, 
+                                         vertex.surface_coordinate, 
+                                         vertex.light, subrays);
+      SelectSpectralSubRays(vertex.light, subrays, weights);
+    }
+    bool diffuse = nearest_object->isDiffuse();
+    unsigned int nb_choices = subrays.size();
+    if(can_continue && diffuse)
+      nb_choices++;
+
+    //Direct illumination
+    if(diffuse) {
+      AddDirectContribution(scenery, vertex, 
+                            (can_continue) ? Real(1.0) / nb_choices : 0);
+    }
+
+    if(nb_choices == 0 
+       || !SampleContinuation(vertex, k, nb_choices, subrays, weights, 
+                              throughput, path[k + 1]))
+      break;
+    last_object = nearest_object;
+  }
+
+  //Backward pass: the light of each vertex is reemited toward the previous
+  //one, from the end of the path to the eye
+  for(int k = nb_vertices - 1; k >= 0; k--) {
+    PathVertex& vertex = path[k];
+    if(vertex.object == 0)
+      continue;
+
+    if(vertex.weight > 0) {
+      LightVector& incident = path[k + 1].light;
+      incident.flip();
+
+      LightVector tmpr;
+      tmpr.initGeometricalData(vertex.light);
+      tmpr.initSpectralData(incident);
+      if(vertex.specular) {
+        vertex.object->getSpecularReemited(vertex.local_basis, 
+                                           vertex.surface_coordinate, 
+                                           incident, tmpr);
+      } else {
+        vertex.object->getDiffuseReemited(vertex.local_basis, 
+                                          vertex.surface_coordinate, 
+                                          incident, tmpr);
+      }
+      if(vertex.weight != Real(1.0))
+        tmpr.mul(vertex.weight);
+      vertex.light.add(tmpr);
+    }
+
+    //Compute medium absorption    
+    Medium* medium = 0;
+    if(vertex.light.getRay().v.dot(vertex.local_basis.k) < 0) {
+      medium = vertex.object->getOuterMedium();
+    } else {
+      medium = vertex.object->getInnerMedium();
+    }
+    medium->transportLight(vertex.light);
+  }
+
+  light_data = path[0].light;
+}
+////////////////////////////////////////////////////////////////////////////////
+bool PathTracingRenderer::SampleContinuation(
+    PathVertex& vertex, 
+    int bounce, 
+    unsigned int nb_choices, 
+    std::vector<LightVector>& subrays, 
+    const std::vector<Real>& weights, 
+    Real& throughput, 
+    PathVertex& next) {
+  unsigned int choice = (unsigned int)(rand() / (RAND_MAX + Real(1.0)) 
+                                       * nb_choices);
+  if(choice >= nb_choices)
+    choice = nb_choices - 1;
+  next.environment_weight = 1;
+
+  if(choice < subrays.size()) {
+    //Specular sub-ray
+    vertex.specular = true;
+    vertex.weight = weights[choice] * nb_choices;
+    next.light = subrays[choice];
+    next.see_sources = true;
+  } else {
+    //Diffuse ray
+    subrays.clear();
+    vertex.object->getRandomDiffuseRay(vertex.local_basis, 
+                                       vertex.surface_coordinate, 
+                                       vertex.light, 1, subrays);
+    if(subrays.empty())
+      return false;
+    vertex.specular = false;
+    vertex.weight = nb_choices / subrays[0].getWeight();
+    next.light = subrays[0];
+    next.see_sources = false;
+
+    //Weight of the environment, also sampled by the direct illumination
+    if(p_environment != NULL && p_environment->GetNbSamples() > 0) {
+      const Vector& direction = next.light.getRay().v;
+      Real density = Environment::GetDiffuseDensity(
+                       vertex.local_basis.k, vertex.light.getRay().v, 
+                       direction) / nb_choices;
+      next.environment_weight = Environment::GetMISWeight(
+        1, density, 
+        p_environment->GetNbSamples(), p_environment->GetDensity(direction));
+    }
+  }
+
+  //Russian roulette on the paths carrying little energy
+  if(IsRouletteEnabled()) {
+    Real attenuation = vertex.specular 
+      ? GetSpecularAttenuation(vertex.object, vertex.local_basis, 
+                               vertex.surface_coordinate, next.light, 
+                               vertex.light)
+      : GetDiffuseAttenuation(vertex, next.light);
+    Real roulette_weight = PlayRussianRoulette(bounce, throughput, 
+                                               attenuation * vertex.weight);
+    if(roulette_weight <= 0) {
+      vertex.weight = 0;
+      return false;
+    }
+    vertex.weight *= roulette_weight;
+  }
+
+  next.light.clear();
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+Real PathTracingRenderer::GetDiffuseAttenuation(const PathVertex& vertex, 
+                                                const LightVector& ray) const {
+  LightVector unit(ray);
+  unit.flip();
+  for (unsigned int l = 0; l < unit.size(); l++)
+    unit[l].setRadiance(Real(1.0));
+
+  LightVector reemited;
+  reemited.initGeometricalData(vertex.light);
+  reemited.initSpectralData(unit);
+  vertex.object->getDiffuseReemited(vertex.local_basis, 
+                                    vertex.surface_coordinate, 
+                                    unit, reemited);
+
+  Real attenuation = 0;
+  for (unsigned int l = 0; l < reemited.size(); l++) {
+    if (reemited[l].getRadiance() > attenuation)
+      attenuation = reemited[l].getRadiance();
+  }
+  return attenuation;
+}
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::AddDirectContribution(Scenery& scenery, 
+                                                PathVertex& vertex, 
+                                                Real diffuse_probability) {
+  //Adding lights contributions (no intersection !)
+  LightVector tmpr; 
+  tmpr.initSpectralData(vertex.light);
+  tmpr.initGeometricalData(vertex.light);
+
+  //Selected sources (all of them by default)
+  std::vector<unsigned int> sources;
+  std::vector<Real> weights;
+  SelectSources(scenery, vertex.local_basis.o, sources, weights);
+
+  std::vector<LightVector> incidents;
+  for(unsigned int i = 0; i < sources.size(); i++) {
+    //Get the incoming rays
+    Source* light = scenery.getSource(sources[i]);
+    incidents.clear();
+    light->getIncidentLight(vertex.local_basis.o, vertex.light, incidents);
+
+    //For each incoming ray
+    for(unsigned int j = 0; j < incidents.size(); j++) {
+      Ray incoming = incidents[j].getRay();
+      incoming.v.mul(-1.0);
+
+      Real src_distance = -1;
+      Real obj_distance = -1;
+      Source* source = 0;
+      Object* occ_obj = 0;
+      
+      bool src_hit = scenery.getNearestIntersectionWithSource(incoming, 
+                                                              src_distance, 
+                                                              source);
+      bool obj_hit = scenery.getNearestIntersection(incoming, obj_distance, 
+                                                    occ_obj, vertex.object);
+
+      if(src_hit && source != light 
+                 && src_distance < incidents[j].getDistance())
+        continue;
+
+      if(obj_hit && ((src_hit && obj_distance < src_distance 
+                              && obj_distance < incidents[j].getDistance()) 
+                     || (!src_hit 
+                         && obj_distance < incidents[j].getDistance())))
+        continue;
+
+      //Get the received light, compute the reemited light and then add it 
+      // to the result
+      vertex.object->getDiffuseReemited(vertex.local_basis, 
+                                        vertex.surface_coordinate, 
+                                        incidents[j], tmpr);
+      if(weights[i] != Real(1.0))
+        tmpr.mul(weights[i]);
+      vertex.light.add(tmpr);
+    }
+  }
+
+  //Light of the environment
+  AddEnvironmentContribution(scenery, vertex, diffuse_probability);
+}
+////////////////////////////////////////////////////////////////////////////////
+void PathTracingRenderer::AddEnvironmentContribution(
+    Scenery& scenery, 
+    PathVertex& vertex, 
+    Real diffuse_probability) {
+  if(p_environment == NULL || p_environment->GetNbSamples() == 0)
+    return;
+
+  LightVector tmpr; 
+  tmpr.initSpectralData(vertex.light);
+  tmpr.initGeometricalData(vertex.light);
+
+  std::vector<LightVector> incidents;
+  p_environment->GetIncidentLight(vertex.local_basis.o, vertex.light, 
+                                  incidents);
+  for(unsigned int j = 0; j < incidents.size(); j++) {
+    Ray incoming = incidents[j].getRay();
+    incoming.v.mul(-1.0);
+
+    //Only the directions escaping the scenery see the environment
+    Real distance = -1;
+    Source* source = 0;
+    Object* occ_obj = 0;
+    if(scenery.getNearestIntersection(incoming, distance, occ_obj, 
+                                      vertex.object) 
+       || scenery.getNearestIntersectionWithSource(incoming, distance, 
+                                                   source))
+      continue;
+
+    vertex.object->getDiffuseReemited(vertex.local_basis, 
+                                      vertex.surface_coordinate, 
+                                      incidents[j], tmpr);
+
+    //The diffuse continuation of the path may also see these directions
+    if(diffuse_probability > 0) {
+      Real diffuse_density = diffuse_probability 
+                           * Environment::GetDiffuseDensity(
+                               vertex.local_basis.k, 
+                               vertex.light.getRay().v, incoming.v);
+      tmpr.mul(Environment::GetMISWeight(
+                 p_environment->GetNbSamples(), 
+                 p_environment->GetDensity(incoming.v), 
+                 1, diffuse_density));
+    }
+    vertex.light.add(tmpr);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
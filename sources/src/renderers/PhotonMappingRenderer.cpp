@@ -29,11 +29,31 @@
 //! @todo 
 //! @remarks 
 //!
+#include <cstdlib>
 #include <vector>
 #include <iostream>
+#include <omp.h>
+
 #include <core/Scenery.hpp>
 
 #include <environments/Environment.hpp>
+
+namespace {
+//! Number of probe photons per cell of a projection map
+const unsigned int kNB_PROBES_PER_CELL = 16;
+//! Storage probability of the photons in the cells without importons
+const Real kMIN_STORAGE_PROBABILITY = 0.05;
+//! Maximum number of bounces of a photon
+const int kMAX_PHOTON_DEPTH = 20;
+//! Maximum number of bounces of a photon when the paths play the russian 
+//! roulette (the absorption roulette of the materials terminates the photons
+//! long before)
+const int kMAX_ROULETTE_PHOTON_DEPTH = 256;
+//! Probability of replacing a diffuse ray by a guided one
+const Real kGUIDING_FRACTION = 0.5;
+//! Maximum number of wavelengths of an irradiance (see MultispectralPhoton)
+const unsigned int kMAX_WAVELENGTHS = 81;
+} // namespace
 ////////////////////////////////////////////////////////////////////////////////
 PhotonMappingRenderer::PhotonMappingRenderer(
     int maxDepth, Real scale, 
@@ -45,7 +65,12 @@ PhotonMappingRenderer::PhotonMappingRenderer(
     Real search_caustic_radius, 
     unsigned int nb_samples, 
     Real estimation_min_distance,
-    Environment* envir)
+    Environment* envir,
+    bool projection_maps,
+    unsigned int nb_importons,
+    bool path_guiding,
+    bool irradiance_cache,
+    Real cache_accuracy)
     // Initialization list
     : m_max_depth(maxDepth), 
       m_scale(scale), 
@@ -57,7 +82,12 @@ PhotonMappingRenderer::PhotonMappingRenderer(
       m_nb_caustic_sample_photon(nb_sample_caustic_photon), 
       m_caustic_search_radius(search_caustic_radius), 
       m_nb_samples(nb_samples),
-      p_environment(NULL) {
+      p_environment(NULL),
+      m_projection_maps(projection_maps),
+      m_nb_importons(nb_importons),
+      m_path_guiding(path_guiding),
+      m_irradiance_cache(irradiance_cache),
+      m_cache_accuracy(cache_accuracy) {
 
   p_environment = envir;
 }
@@ -76,17 +106,168 @@ PhotonMappingRenderer::~PhotonMappingRenderer(void)
   p_environment = NULL;
 }
 ////////////////////////////////////////////////////////////////////////////////
+Real PhotonMappingRenderer::BuildProjectionMap(Scenery& scenery, 
+                                               Source& source, bool caustic, 
+                                               ProjectionMap& map) {
+  map.Clear();
+  unsigned int nb_probes = kNB_PROBES_PER_CELL * ProjectionMap::kNB_CELLS_Z 
+                         * ProjectionMap::kNB_CELLS_PHI;
+  std::vector<Vector> directions(nb_probes);
+  for(unsigned int j = 0; j < nb_probes; j++) {
+    MultispectralPhoton photon;
+    source.getRandomPhoton(photon);
+    directions[j] = photon.direction;
+
+    Ray ray; 
+    ray.v = photon.direction; 
+    ray.o = photon.position;
+    Real distance = -1;
+    Object* object = 0;
+    if(scenery.getNearestIntersection(ray, distance, object) 
+       && (!caustic || object->isSpecular()))
+      map.Mark(photon.direction);
+  }
+  map.Dilate();
+
+  //Fraction of the emission in the marked cells
+  unsigned int nb_marked = 0;
+  for(unsigned int j = 0; j < nb_probes; j++) {
+    if(map.IsMarked(directions[j]))
+      nb_marked++;
+  }
+  return nb_marked / (Real)nb_probes;
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::EmitPhoton(Source& source, 
+                                       const ProjectionMap* map, 
+                                       Real fraction, 
+                                       MultispectralPhoton& photon) {
+  source.getRandomPhoton(photon);
+  if(map == NULL || fraction >= 1)
+    return;
+
+  while(!map->IsMarked(photon.direction))
+    source.getRandomPhoton(photon);
+  for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+    photon.radiance[i] *= fraction;
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::BuildImportanceGrid(Scenery& scenery) {
+  m_importance.Init(m_bounds);
+  if(scenery.getNbCamera() == 0)
+    return;
+
+  //The global maps are read at the hits of the diffuse rays
+  int nb_diffuse = (m_nb_samples > 0) ? 1 : 0;
+  unsigned int nb_per_camera = m_nb_importons / scenery.getNbCamera();
+  for(unsigned int c = 0; c < scenery.getNbCamera(); c++) {
+    Camera* camera = scenery.getCamera(c);
+    if(camera->getWidth() == 0 || camera->getHeight() == 0)
+      continue;
+    for(unsigned int j = 0; j < nb_per_camera; j++) {
+      LightVector ray;
+      if(!camera->getRay(rand() % camera->getWidth(), 
+                         rand() % camera->getHeight(), ray))
+        continue;
+      MultispectralPhoton importon;
+      for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+        importon.radiance[i] = 1;
+      importon.position = ray.getRay().o;
+      importon.direction = ray.getRay().v;
+      CastImporton(scenery, importon, nb_diffuse, m_max_depth);
+    }
+  }
+  m_importance.ComputeProbabilities(kMIN_STORAGE_PROBABILITY);
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::CastImporton(Scenery& scenery, 
+                                         MultispectralPhoton& importon, 
+                                         int nb_diffuse, int depth, 
+                                         Object* last_object_hit) {
+  if(depth <= 0)
+    return;
+
+  Ray ray; 
+  ray.v = importon.direction; 
+  ray.o = importon.position;
+  Real distance = -1;
+  Object* nearest_object = 0;
+  Basis local_basis;
+  Point2D surface_coordinate;
+  if(!scenery.getNearestIntersection(ray, distance, nearest_object, 
+                                     local_basis, surface_coordinate, 
+                                     last_object_hit))
+    return;
+  m_importance.Add(local_basis.o);
+
+  importon.position = local_basis.o;
+  importon.distance = distance * m_scale;
+  importon.normal = local_basis.k;
+
+  //The importons follow the specular paths, and the diffuse ones as long 
+  //as the map can be read there
+  bool specular;
+  if(!nearest_object->bouncePhoton(local_basis, surface_coordinate, 
+                                   importon, specular))
+    return;
+  if(!specular) {
+    if(nb_diffuse <= 0)
+      return;
+    nb_diffuse--;
+  }
+  CastImporton(scenery, importon, nb_diffuse, depth - 1, nearest_object);
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::StorePhoton(MultispectralPhotonMap& map, 
+                                        const MultispectralPhoton& photon) {
+  Real probability = m_importance.GetProbability(photon.position);
+  if(probability >= 1) {
+    map.addPhoton(photon);
+    return;
+  }
+  if(rand() / (Real)RAND_MAX >= probability)
+    return;
+
+  MultispectralPhoton stored = photon;
+  for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+    stored.radiance[i] /= probability;
+  map.addPhoton(stored);
+}
+////////////////////////////////////////////////////////////////////////////////
+int PhotonMappingRenderer::GetPhotonDepth(void) const {
+  return IsRouletteEnabled() ? kMAX_ROULETTE_PHOTON_DEPTH : kMAX_PHOTON_DEPTH;
+}
+////////////////////////////////////////////////////////////////////////////////
 void PhotonMappingRenderer::BuildGlobalPhotonMaps(Scenery& scenery)
 {
+  ProjectionMap map;
   for(unsigned int i = 0; i < scenery.getNbSource(); i++) {
     Source& source = *scenery.getSource(i);
     unsigned int nb_photon = (unsigned int)(source.getPower() 
                                               / m_global_photon_power);
 
+    //Photons toward the objects only
+    Real fraction = 1;
+    if(m_projection_maps && nb_photon > 0)
+      fraction = BuildProjectionMap(scenery, source, false, map);
+    if(fraction <= 0)
+      continue;
+
     for(unsigned int j = 0; j < nb_photon; j++) {
       MultispectralPhoton photon;
-      source.getRandomPhoton(photon);
-      CastGlobalPhoton(scenery, photon, true, 20);
+      EmitPhoton(source, m_projection_maps ? &map : NULL, fraction, photon);
+      CastGlobalPhoton(scenery, photon, true, GetPhotonDepth());
+    }
+  }
+
+  //Photons of the environment, entering the bounds of the objects
+  if(p_environment != NULL && scenery.getNbObject() > 0) {
+    unsigned int nb_photon = (unsigned int)(p_environment->GetPower(m_bounds) 
+                                              / m_global_photon_power);
+    for(unsigned int j = 0; j < nb_photon; j++) {
+      MultispectralPhoton photon;
+      p_environment->GetRandomPhoton(m_bounds, photon);
+      CastGlobalPhoton(scenery, photon, true, GetPhotonDepth());
     }
   }
 }
@@ -129,11 +310,22 @@ void PhotonMappingRenderer::CastGlobalPhoton(Scenery& scenery,
   if(!medium->transportPhoton(photon))
     return;
 
+  //Indirect light, learned for guiding the diffuse rays
+  if(!direct && m_path_guiding && m_nb_samples > 0) {
+    Real energy = 0;
+    for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++)
+      energy += photon.radiance[i];
+    m_guiding.AddRecord(photon.position, 
+                        Vector(-photon.direction[0], -photon.direction[1], 
+                               -photon.direction[2]), 
+                        energy);
+  }
+
   if(!direct || m_nb_samples > 0) {
     if(photon.direction.dot(local_basis.k) < 0) {
-      m_global_map_out[nearest_object->getIndex()]->addPhoton(photon);
+      StorePhoton(*m_global_map_out[nearest_object->getIndex()], photon);
     } else {
-      m_global_map_in[nearest_object->getIndex()]->addPhoton(photon);
+      StorePhoton(*m_global_map_in[nearest_object->getIndex()], photon);
     }
   }
 
@@ -146,16 +338,35 @@ void PhotonMappingRenderer::CastGlobalPhoton(Scenery& scenery,
 }
 ////////////////////////////////////////////////////////////////////////////////
 void PhotonMappingRenderer::BuildCausticPhotonMaps(Scenery& scenery) {
+  ProjectionMap map;
   for(unsigned int i = 0; i < scenery.getNbSource(); i++) {
     Source& source = *scenery.getSource(i);
     unsigned int nb_photon = (unsigned int)(source.getPower() 
                                               / m_caustic_photon_power);
 
+    //Photons toward the specular objects only
+    Real fraction = 1;
+    if(m_projection_maps && nb_photon > 0)
+      fraction = BuildProjectionMap(scenery, source, true, map);
+    if(fraction <= 0)
+      continue;
+
     for(unsigned int j = 0; j < nb_photon; j++)
     {
       MultispectralPhoton photon;
-      source.getRandomPhoton(photon);
-      CastCausticPhoton(scenery, photon, true, 20);
+      EmitPhoton(source, m_projection_maps ? &map : NULL, fraction, photon);
+      CastCausticPhoton(scenery, photon, true, GetPhotonDepth());
+    }
+  }
+
+  //Photons of the environment, entering the bounds of the objects
+  if(p_environment != NULL && scenery.getNbObject() > 0) {
+    unsigned int nb_photon = (unsigned int)(p_environment->GetPower(m_bounds) 
+                                              / m_caustic_photon_power);
+    for(unsigned int j = 0; j < nb_photon; j++) {
+      MultispectralPhoton photon;
+      p_environment->GetRandomPhoton(m_bounds, photon);
+      CastCausticPhoton(scenery, photon, true, GetPhotonDepth());
     }
   }
 }
@@ -199,7 +410,7 @@ void PhotonMappingRenderer::CastCausticPhoton(Scenery& scenery,
     return;
 
   if(!direct && nearest_object->isDiffuse())
-    m_caustic_map[nearest_object->getIndex()]->addPhoton(photon);
+    StorePhoton(*m_caustic_map[nearest_object->getIndex()], photon);
    
   //Photon bounce
   bool specular;
@@ -214,6 +425,12 @@ void PhotonMappingRenderer::CastCausticPhoton(Scenery& scenery,
 void PhotonMappingRenderer::InitWithData(Scenery& scenery, 
                                          unsigned char* data, 
                                          unsigned int data_size) {
+  BuildLightSelection(scenery);
+  if(m_irradiance_cache && m_nb_samples > 0 && scenery.getNbObject() > 0) {
+    ComputeBounds(scenery);
+    m_cache.Init(m_bounds, m_cache_accuracy, omp_get_max_threads());
+  }
+
   unsigned char* buffer = data;
 
   //Load photon powers
@@ -301,11 +518,31 @@ void PhotonMappingRenderer::ExportData(unsigned char** data,
   }
 }
 ////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::ComputeBounds(Scenery& scenery) {
+  scenery.getObject(0)->getBoundingBox(m_bounds);
+  for(unsigned int i = 1; i < scenery.getNbObject(); i++) {
+    BoundingBox box;
+    scenery.getObject(i)->getBoundingBox(box);
+    m_bounds.updateWith(box);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
 void PhotonMappingRenderer::Init(Scenery& scenery, int nb_threads) {
+  BuildLightSelection(scenery);
+
   Real totalPower = 0;
   for(unsigned int i = 0; i < scenery.getNbSource(); i++) {
     totalPower += scenery.getSource(i)->getPower();
   }
+  if(scenery.getNbObject() > 0) {
+    ComputeBounds(scenery);
+    if(p_environment != NULL)
+      totalPower += p_environment->GetPower(m_bounds);
+    if(m_nb_importons > 0)
+      BuildImportanceGrid(scenery);
+    if(m_irradiance_cache && m_nb_samples > 0)
+      m_cache.Init(m_bounds, m_cache_accuracy, nb_threads);
+  }
   m_global_photon_power  = totalPower / m_nb_global_photon;
   for(unsigned int i = 0; i < scenery.getNbObject(); i++) {
     m_global_map_in.push_back(
@@ -314,6 +551,8 @@ void PhotonMappingRenderer::Init(Scenery& scenery, int nb_threads) {
       new MultispectralPhotonMap(m_global_photon_power));
   }
   BuildGlobalPhotonMaps(scenery);
+  if(m_path_guiding && m_nb_samples > 0 && scenery.getNbObject() > 0)
+    m_guiding.Build(m_bounds);
   for(unsigned int i = 0; i < scenery.getNbObject(); i++) {
     m_global_map_in[i]->optimize();
     m_global_map_out[i]->optimize();
@@ -342,7 +581,7 @@ void PhotonMappingRenderer::AddGlossyContribution(
     Object* object, 
     const Basis& local_basis, 
     const Point2D& surface_coordinate, 
-    int depth, bool precise) {
+    int depth, bool precise, Real throughput) {
   if(depth < 0) 
     return;
   
@@ -350,10 +589,25 @@ void PhotonMappingRenderer::AddGlossyContribution(
   std::vector<LightVector> subrays;
   object->getSpecularSubRays(local_basis, surface_coordinate, 
                              light_data, subrays);
+  std::vector<Real> weights;
+  SelectSpectralSubRays(light_data, subrays, weights);
   for(unsigned int i = 0; i <  subrays.size(); i++) {
+    //Russian roulette on the sub-rays carrying little energy
+    Real subray_throughput = throughput;
+    Real roulette_weight = 1;
+    if(IsRouletteEnabled()) {
+      roulette_weight = PlayRussianRoulette(
+        m_max_depth - depth, subray_throughput, 
+        GetSpecularAttenuation(object, local_basis, surface_coordinate, 
+                               subrays[i], light_data));
+      if(roulette_weight <= 0)
+        continue;
+    }
+
     //Get incident luminance
     subrays[i].clear();
-    CastRay(scenery, subrays[i], depth, object, precise);
+    CastRay(scenery, subrays[i], depth, object, precise, 1, 
+            subray_throughput);
     subrays[i].flip();
 
     //Get the reemited luminance
@@ -363,6 +617,8 @@ void PhotonMappingRenderer::AddGlossyContribution(
 
     object->getSpecularReemited(local_basis, surface_coordinate, 
                                 subrays[i], tmpr);
+    if(weights[i] * roulette_weight != Real(1.0))
+      tmpr.mul(weights[i] * roulette_weight);
     light_data.add(tmpr);
   }
 }
@@ -385,18 +641,25 @@ void PhotonMappingRenderer::AddDirectContribution(
     LightVector& light_data, 
     Object* object, 
     const Basis& local_basis, 
-    const Point2D& surface_coordinate) {
+    const Point2D& surface_coordinate,
+    unsigned int nb_diffuse_samples, 
+    int guiding_leaf) {
   //Adding lights contributions (no intersection !)
   LightVector tmpr; 
   tmpr.initSpectralData(light_data);
   tmpr.initGeometricalData(light_data);
 
+  //Selected sources (all of them by default)
+  std::vector<unsigned int> sources;
+  std::vector<Real> weights;
+  SelectSources(scenery, local_basis.o, sources, weights);
+
   std::vector<LightVector> incidents;
-  for(unsigned int i = 0; i < scenery.getNbSource(); i++) {
+  for(unsigned int i = 0; i < sources.size(); i++) {
     //Get the incoming rays
+    Source* light = scenery.getSource(sources[i]);
     incidents.clear();
-    scenery.getSource(i)->getIncidentLight(local_basis.o, light_data, 
-                                           incidents);
+    light->getIncidentLight(local_basis.o, light_data, incidents);
 
     //For each incoming ray
     for(unsigned int j = 0; j < incidents.size(); j++) {
@@ -414,7 +677,7 @@ void PhotonMappingRenderer::AddDirectContribution(
       bool objHit = scenery.getNearestIntersection(incoming, obj_distance, 
                                                    occ_obj, object);
 
-      if(srcHit && source!=scenery.getSource(i) 
+      if(srcHit && source!=light 
                 && src_distance<incidents[j].getDistance())
         continue;
 
@@ -427,9 +690,64 @@ void PhotonMappingRenderer::AddDirectContribution(
       // to the result
       object->getDiffuseReemited(local_basis, surface_coordinate, 
                                  incidents[j], tmpr);
+      if(weights[i] != Real(1.0))
+        tmpr.mul(weights[i]);
       light_data.add(tmpr);
     }
   }
+
+  //Light of the environment
+  AddEnvironmentContribution(scenery, light_data, object, local_basis, 
+                             surface_coordinate, nb_diffuse_samples, 
+                             guiding_leaf);
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::AddEnvironmentContribution(
+    Scenery& scenery, 
+    LightVector& light_data, 
+    Object* object, 
+    const Basis& local_basis, 
+    const Point2D& surface_coordinate,
+    unsigned int nb_diffuse_samples, 
+    int guiding_leaf) {
+  if(p_environment == NULL || p_environment->GetNbSamples() == 0)
+    return;
+
+  LightVector tmpr; 
+  tmpr.initSpectralData(light_data);
+  tmpr.initGeometricalData(light_data);
+
+  std::vector<LightVector> incidents;
+  p_environment->GetIncidentLight(local_basis.o, light_data, incidents);
+  for(unsigned int j = 0; j < incidents.size(); j++) {
+    Ray incoming = incidents[j].getRay();
+    incoming.v.mul(-1.0);
+
+    //Only the directions escaping the scenery see the environment
+    Real distance = -1;
+    Source* source = 0;
+    Object* occ_obj = 0;
+    if(scenery.getNearestIntersection(incoming, distance, occ_obj, object) 
+       || scenery.getNearestIntersectionWithSource(incoming, distance, 
+                                                   source))
+      continue;
+
+    object->getDiffuseReemited(local_basis, surface_coordinate, 
+                               incidents[j], tmpr);
+
+    //The diffuse rays escaping the scenery also see these directions
+    if(nb_diffuse_samples > 0) {
+      Real diffuse_density = GetDiffuseRayDensity(object, local_basis, 
+                                                  surface_coordinate, 
+                                                  light_data, guiding_leaf, 
+                                                  incoming.v);
+      tmpr.mul(Environment::GetMISWeight(
+                 p_environment->GetNbSamples(), 
+                 p_environment->GetDensity(incoming.v), 
+                 nb_diffuse_samples, diffuse_density));
+    }
+    light_data.add(tmpr);
+  }
 }
 ////////////////////////////////////////////////////////////////////////////////
 void PhotonMappingRenderer::AddDiffuseContribution(
@@ -439,10 +757,17 @@ void PhotonMappingRenderer::AddDiffuseContribution(
     const Basis& local_basis, 
     const Point2D& surface_coordinate, 
     int depth, 
-    bool precise) {
+    bool precise, 
+    int guiding_leaf) {
   if(depth < 0) 
     return;
 
+  if(precise && m_cache.IsEnabled()) {
+    AddCachedDiffuseContribution(scenery, light_data, object, local_basis, 
+                                 surface_coordinate, depth);
+    return;
+  }
+
   std::vector<LightVector> incidents;
   if(precise) {
     object->getRandomDiffuseRay(local_basis, surface_coordinate, 
@@ -451,10 +776,74 @@ void PhotonMappingRenderer::AddDiffuseContribution(
     object->getRandomDiffuseRay(local_basis, surface_coordinate, light_data, 
                                 1, incidents);
   }
+  unsigned int nb_diffuse_samples = precise ? m_nb_samples : 1;
+  unsigned int nb_environment_samples = (p_environment != NULL) 
+                                      ? p_environment->GetNbSamples() : 0;
+
+  //Path guiding: each diffuse ray is replaced by a guided one with the 
+  //probability kGUIDING_FRACTION (one-sample MIS, balance heuristic). Both
+  //kinds of rays follow the convention of the material: a ray of density p
+  //and weight w estimates the reemited light times p / w, so the mean does 
+  //not depend on the guiding.
+  const Vector& view = light_data.getRay().v;
+  Real guiding_fraction = (guiding_leaf >= 0) ? kGUIDING_FRACTION 
+                                              : Real(0.0);
+  Vector normal = local_basis.k;
+  if(normal.dot(view) > 0)
+    normal.mul(-1.0);
+
   for(unsigned int i = 0; i < incidents.size(); i++) {
+    Real weight = Real(1.0) / incidents[i].getWeight();
+    if(guiding_fraction > 0) {
+      Vector side = incidents[i].getRay().v;
+      bool guided = rand() / (Real)RAND_MAX < guiding_fraction;
+      if(guided) {
+        //Guided ray, on the side of the viewer and of the replaced ray
+        Vector direction;
+        m_guiding.Sample(guiding_leaf, rand() / (RAND_MAX + Real(1.0)), 
+                         rand() / (RAND_MAX + Real(1.0)), direction);
+        if(direction.dot(normal) <= 0 || side.dot(normal) <= 0)
+          continue;
+        LightVector ray;
+        ray.setRay(local_basis.o, direction);
+        ray.changeReemitedPolarisationFramework(normal);
+        ray.initSpectralData(light_data);
+        incidents[i] = ray;
+      }
+
+      //Same mixture density for both kinds of rays
+      const Vector& direction = incidents[i].getRay().v;
+      Real density, material_weight;
+      object->getDiffuseDensity(local_basis, surface_coordinate, light_data, 
+                                direction, density, material_weight);
+      Real guided_density = (direction.dot(normal) > 0) 
+        ? m_guiding.GetDensity(guiding_leaf, direction) : Real(0.0);
+      if(density > 0 && material_weight > 0) {
+        weight = density 
+               / (material_weight 
+                  * (guiding_fraction * guided_density 
+                     + (1 - guiding_fraction) * density));
+      } else if(guided) {
+        continue;
+      } else {
+        weight /= 1 - guiding_fraction;
+      }
+    }
+
+    //Weight of the environment, also sampled by the direct illumination
+    Real environment_weight = 1;
+    if(nb_environment_samples > 0) {
+      const Vector& direction = incidents[i].getRay().v;
+      environment_weight = Environment::GetMISWeight(
+        nb_diffuse_samples, 
+        GetDiffuseRayDensity(object, local_basis, surface_coordinate, 
+                             light_data, guiding_leaf, direction), 
+        nb_environment_samples, p_environment->GetDensity(direction));
+    }
+
     //Get incident luminance
     incidents[i].clear();
-    CastRay(scenery, incidents[i], depth, object, false);
+    CastRay(scenery, incidents[i], depth, object, false, environment_weight);
     incidents[i].flip();
 
     //Get the reemited luminance
@@ -463,11 +852,178 @@ void PhotonMappingRenderer::AddDiffuseContribution(
     tmpr.initSpectralData(incidents[i]);
     object->getDiffuseReemited(local_basis, surface_coordinate, 
                                incidents[i], tmpr);
-    tmpr.mul(Real(1.0) / (incidents[i].getWeight() * incidents.size()));
+    tmpr.mul(weight / incidents.size());
     light_data.add(tmpr);    
   }
 }
 ////////////////////////////////////////////////////////////////////////////////
+int PhotonMappingRenderer::GetGuidingLeaf(Object* object, 
+                                          const Basis& local_basis, 
+                                          const Point2D& surface_coordinate, 
+                                          const LightVector& light_data) {
+  if(!m_path_guiding || m_guiding.IsEmpty() || m_cache.IsEnabled())
+    return -1;
+
+  //The guided rays are mixed with the rays of the material: its 
+  //distribution must be known
+  Real density, weight;
+  if(!object->getDiffuseDensity(local_basis, surface_coordinate, light_data, 
+                                local_basis.k, density, weight))
+    return -1;
+  return m_guiding.GetLeaf(local_basis.o);
+}
+////////////////////////////////////////////////////////////////////////////////
+Real PhotonMappingRenderer::GetDiffuseRayDensity(
+    Object* object, 
+    const Basis& local_basis, 
+    const Point2D& surface_coordinate, 
+    const LightVector& light_data, 
+    int guiding_leaf, 
+    const Vector& direction) {
+  const Vector& view = light_data.getRay().v;
+  if(guiding_leaf < 0)
+    return Environment::GetDiffuseDensity(local_basis.k, view, direction);
+
+  Real density, weight;
+  object->getDiffuseDensity(local_basis, surface_coordinate, light_data, 
+                            direction, density, weight);
+  Real guided_density = 0;
+  if(Environment::GetDiffuseDensity(local_basis.k, view, direction) > 0)
+    guided_density = m_guiding.GetDensity(guiding_leaf, direction);
+  return kGUIDING_FRACTION * guided_density 
+       + (1 - kGUIDING_FRACTION) * density;
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::AddCachedDiffuseContribution(
+    Scenery& scenery, 
+    LightVector& light_data, 
+    Object* object, 
+    const Basis& local_basis, 
+    const Point2D& surface_coordinate, 
+    int depth) {
+  //Hemisphere on the side of the viewer
+  const Vector& view = light_data.getRay().v;
+  Basis basis = local_basis;
+  if(basis.k.dot(view) > 0) {
+    basis.k.mul(-1.0);
+    basis.j.mul(-1.0);
+  }
+  Real irradiance[kMAX_WAVELENGTHS];
+  if(!m_cache.GetIrradiance(basis.o, basis.k, irradiance))
+    ComputeIrradianceRecord(scenery, object, basis, depth, irradiance);
+
+  //Diffuse reflection of the irradiance
+  LightVector incident;
+  incident.initSpectralData(light_data);
+  incident.setDistance(0);
+  incident.setRay(basis.o, Vector(-basis.k[0], -basis.k[1], -basis.k[2]));
+  for(unsigned int l = 0; l < incident.size(); l++) {
+    incident[l].setRadiance(irradiance[incident[l].getIndex()]);
+  }
+  LightVector tmpr;
+  tmpr.initGeometricalData(light_data);
+  tmpr.initSpectralData(light_data);
+  object->getDiffuseReemited(local_basis, surface_coordinate, incident, tmpr);
+  light_data.add(tmpr);
+
+  //Diffuse transmission: the rays of the material on the other side are 
+  //not cached
+  std::vector<LightVector> incidents;
+  object->getRandomDiffuseRay(local_basis, surface_coordinate, 
+                              light_data, m_nb_samples, incidents);
+  unsigned int nb_environment_samples = (p_environment != NULL) 
+                                      ? p_environment->GetNbSamples() : 0;
+  for(unsigned int i = 0; i < incidents.size(); i++) {
+    const Vector& direction = incidents[i].getRay().v;
+    if(direction.dot(basis.k) >= 0)
+      continue;
+
+    //Weight of the environment, also sampled by the direct illumination
+    Real environment_weight = 1;
+    if(nb_environment_samples > 0) {
+      environment_weight = Environment::GetMISWeight(
+        m_nb_samples, 
+        GetDiffuseRayDensity(object, local_basis, surface_coordinate, 
+                             light_data, -1, direction), 
+        nb_environment_samples, p_environment->GetDensity(direction));
+    }
+
+    incidents[i].clear();
+    CastRay(scenery, incidents[i], depth, object, false, environment_weight);
+    incidents[i].flip();
+
+    LightVector tmpr;
+    tmpr.initGeometricalData(light_data);
+    tmpr.initSpectralData(incidents[i]);
+    object->getDiffuseReemited(local_basis, surface_coordinate, 
+                               incidents[i], tmpr);
+    tmpr.mul(Real(1.0) / (incidents[i].getWeight() * incidents.size()));
+    light_data.add(tmpr);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+void PhotonMappingRenderer::ComputeIrradianceRecord(Scenery& scenery, 
+                                                    Object* object, 
+                                                    const Basis& basis, 
+                                                    int depth, 
+                                                    Real* irradiance) {
+  unsigned int nb_theta, nb_phi;
+  IrradianceCache::GetStrata(m_nb_samples, nb_theta, nb_phi);
+  unsigned int nb_rays = nb_theta * nb_phi;
+  std::vector<Vector> directions(nb_rays);
+  std::vector<Real> radiances(nb_rays);
+  std::vector<Real> distances(nb_rays);
+  for(unsigned int l = 0; l < GlobalSpectrum::nbWaveLengths(); l++)
+    irradiance[l] = 0;
+  unsigned int nb_environment_samples = (p_environment != NULL) 
+                                      ? p_environment->GetNbSamples() : 0;
+
+  //Stratified cosine-weighted rays, with all the wavelengths
+  for(unsigned int k = 0; k < nb_phi; k++) {
+    for(unsigned int j = 0; j < nb_theta; j++) {
+      unsigned int s = j + k * nb_theta;
+      Real sin2_theta = (j + rand() / (RAND_MAX + Real(1.0))) / nb_theta;
+      Real phi = Real(2.0 * M_PI) 
+               * (k + rand() / (RAND_MAX + Real(1.0))) / nb_phi;
+      Real sin_theta = sqrt(sin2_theta);
+      Real cos_theta = sqrt(1 - sin2_theta);
+      directions[s] = Vector(sin_theta * cos(phi), sin_theta * sin(phi), 
+                             cos_theta);
+      Vector direction;
+      basis.getFromBasis(directions[s], direction);
+
+      Real environment_weight = 1;
+      if(nb_environment_samples > 0) {
+        environment_weight = Environment::GetMISWeight(
+          m_nb_samples, cos_theta / Real(M_PI), 
+          nb_environment_samples, p_environment->GetDensity(direction));
+      }
+
+      LightVector ray;
+      ray.setRay(basis.o, direction);
+      ray.changeReemitedPolarisationFramework(basis.k);
+      ray.initSpectralData();
+      ray.clear();
+      ray.setDistance(0);
+      CastRay(scenery, ray, depth, object, false, environment_weight);
+
+      radiances[s] = 0;
+      for(unsigned int l = 0; l < ray.size(); l++) {
+        irradiance[ray[l].getIndex()] += ray[l].getRadiance();
+        radiances[s] += ray[l].getRadiance();
+      }
+      if(ray.size() > 0)
+        radiances[s] /= ray.size();
+      distances[s] = ray.getDistance() / m_scale;
+    }
+  }
+  for(unsigned int l = 0; l < GlobalSpectrum::nbWaveLengths(); l++)
+    irradiance[l] *= Real(M_PI) / nb_rays;
+
+  m_cache.AddRecord(basis, nb_theta, nb_phi, directions, radiances, 
+                    distances, irradiance);
+}
+////////////////////////////////////////////////////////////////////////////////
 void PhotonMappingRenderer::AddCausticContribution(
     Scenery& scenery, 
     LightVector& light_data, 
@@ -538,7 +1094,9 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
                                     LightVector& light_data, 
                                     int depth, 
                                     Object* last_object, 
-                                    bool precise) {
+                                    bool precise,
+                                    Real environment_weight, 
+                                    Real throughput) {
   if(depth < 0) 
     depth = m_max_depth;
 
@@ -571,7 +1129,15 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
   if(!obj_hit && !srcHitted) {
 
 		if (p_environment != NULL) {
-  		p_environment->AddContribution(light_data);
+      if (environment_weight < Real(1.0)) {
+        LightVector env(light_data);
+        env.clear();
+        p_environment->AddContribution(env);
+        env.mul(environment_weight);
+        light_data.add(env);
+      } else {
+  		  p_environment->AddContribution(light_data);
+      }
     }
 
     return;
@@ -581,16 +1147,23 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
   if(obj_hit && (!srcHitted || obj_distance<src_distance)) {
     light_data.setDistance(obj_distance * m_scale);  
 
+    //Footprint of the pixel on the surface (filtering of the textures)
+    Point2D surface_dx, surface_dy;
+    nearest_object->getSurfaceDifferentials(light_data, obj_local_basis, 
+                                            obj_surface_coordinate, 
+                                            surface_dx, surface_dy);
+    light_data.setSurfaceDifferentials(surface_dx, surface_dy);
+
     if(m_nb_samples <= 0) {
       //Direct illumination
       AddDirectContribution(scenery, light_data, nearest_object, 
-                            obj_local_basis, obj_surface_coordinate);
+                            obj_local_basis, obj_surface_coordinate, 0);
 
       //Glossy illumination
       if(nearest_object->isSpecular()) {
         AddGlossyContribution(scenery, light_data, nearest_object, 
                               obj_local_basis, obj_surface_coordinate, 
-                              depth - 1, precise);  
+                              depth - 1, precise, throughput);  
       }
       //Diffuse illumination
       if(nearest_object->isDiffuse()) {
@@ -598,16 +1171,23 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
                              obj_local_basis, obj_surface_coordinate);    
       }
     } else if(precise) {
+      //Leaf of the guiding tree, shared by the direct and indirect lighting
+      int guiding_leaf = -1;
+      if(nearest_object->isDiffuse()) {
+        guiding_leaf = GetGuidingLeaf(nearest_object, obj_local_basis, 
+                                      obj_surface_coordinate, light_data);
+      }
       //Direct illumination
       if(nearest_object->isDiffuse()) {
         AddDirectContribution(scenery, light_data, nearest_object, 
-                              obj_local_basis, obj_surface_coordinate);
+                              obj_local_basis, obj_surface_coordinate, 
+                              m_nb_samples, guiding_leaf);
       }
       //Glossy illumination
       if(nearest_object->isSpecular()) {
         AddGlossyContribution(scenery, light_data, nearest_object, 
                               obj_local_basis, obj_surface_coordinate, 
-                              depth - 1, precise);  
+                              depth - 1, precise, throughput);  
       }
       //Indirect diffuse illumination
       if(nearest_object->isDiffuse()) {
@@ -618,14 +1198,14 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
       if(nearest_object->isDiffuse()) {
         AddDiffuseContribution(scenery, light_data, nearest_object, 
                                obj_local_basis, obj_surface_coordinate, 
-                               depth - 1, true);
+                               depth - 1, true, guiding_leaf);
       }
     } else {
       //Glossy illumination
       if(nearest_object->isSpecular()) {
         AddGlossyContribution(scenery, light_data, nearest_object, 
                               obj_local_basis, obj_surface_coordinate, 
-                              depth - 1, precise);  
+                              depth - 1, precise, throughput);  
       }
       //Diffuse illumination
       if(nearest_object->isDiffuse()) {
@@ -639,7 +1219,7 @@ void PhotonMappingRenderer::CastRay(Scenery& scenery,
                                  obj_local_basis, obj_surface_coordinate, 
                                  depth - 1, false);
           AddDirectContribution(scenery, light_data, nearest_object, 
-                                obj_local_basis, obj_surface_coordinate);
+                                obj_local_basis, obj_surface_coordinate, 1);
         }
       }
     }
@@ -0,0 +1,204 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <renderers/Renderer.hpp>
+//!
+//! @file Renderer.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements the classes declared in Renderer.hpp 
+//!  @arg Renderer
+//! @todo 
+//! @remarks 
+//!
+#include <cstdlib>
+
+#include <core/Object.hpp>
+#include <core/Scenery.hpp>
+#include <core/Source.hpp>
+////////////////////////////////////////////////////////////////////////////////
+void Renderer::SelectSpectralSubRays(const LightVector& incident,
+                                     std::vector<LightVector>& subrays, 
+                                     std::vector<Real>& weights) const {
+  weights.assign(subrays.size(), Real(1.0));
+  if (m_nb_hero_wavelengths == 0)
+    return;
+
+  // A dispersive event splits the wavelengths of the incident ray into 
+  // disjoint sets, one per sub-ray; the other sub-rays carry all of them
+  std::vector<unsigned int> dispersed;
+  std::vector<bool> is_dispersed(subrays.size(), false);
+  std::vector<bool> carried(GlobalSpectrum::nbWaveLengths(), false);
+  for (unsigned int i = 0; i < subrays.size(); i++) {
+    if (subrays[i].size() == 0 || subrays[i].size() >= incident.size())
+      continue;
+    for (unsigned int l = 0; l < subrays[i].size(); l++) {
+      unsigned int index = subrays[i][l].getIndex();
+      // Overlapping sets: this is not a split of the wavelengths
+      if (carried[index])
+        return;
+      carried[index] = true;
+    }
+    dispersed.push_back(i);
+    is_dispersed[i] = true;
+  }
+  unsigned int nb_dispersed = (unsigned int)dispersed.size();
+  if (nb_dispersed <= m_nb_hero_wavelengths)
+    return;
+
+  // One sub-ray per stratum, weighted by the inverse of its probability
+  std::vector<LightVector> selected;
+  std::vector<Real> selected_weights;
+  for (unsigned int i = 0; i < subrays.size(); i++) {
+    if (!is_dispersed[i]) {
+      selected.push_back(subrays[i]);
+      selected_weights.push_back(Real(1.0));
+    }
+  }
+  for (unsigned int s = 0; s < m_nb_hero_wavelengths; s++) {
+    unsigned int first = s * nb_dispersed / m_nb_hero_wavelengths;
+    unsigned int last = (s + 1) * nb_dispersed / m_nb_hero_wavelengths;
+    if (last <= first)
+      continue;
+    unsigned int pick = first 
+        + (unsigned int)((last - first) * (rand() / ((Real)RAND_MAX + 1)));
+    selected.push_back(subrays[dispersed[pick]]);
+    selected_weights.push_back(Real(last - first));
+  }
+
+  subrays.swap(selected);
+  weights.swap(selected_weights);
+}
+////////////////////////////////////////////////////////////////////////////////
+Real Renderer::GetSpecularAttenuation(Object* object, 
+                                      const Basis& local_basis, 
+                                      const Point2D& surface_coordinate, 
+                                      const LightVector& subray, 
+                                      const LightVector& light_data) const {
+  LightVector unit(subray);
+  unit.flip();
+  for (unsigned int l = 0; l < unit.size(); l++)
+    unit[l].setRadiance(Real(1.0));
+
+  LightVector reemited;
+  reemited.initGeometricalData(light_data);
+  reemited.initSpectralData(unit);
+  object->getSpecularReemited(local_basis, surface_coordinate, unit, reemited);
+
+  Real attenuation = 0;
+  for (unsigned int l = 0; l < reemited.size(); l++) {
+    if (reemited[l].getRadiance() > attenuation)
+      attenuation = reemited[l].getRadiance();
+  }
+  return attenuation;
+}
+////////////////////////////////////////////////////////////////////////////////
+Real Renderer::PlayRussianRoulette(int bounce, Real& throughput, 
+                                   Real attenuation) const {
+  throughput *= attenuation;
+  if (m_roulette_depth < 0 || bounce < m_roulette_depth 
+      || throughput >= Real(1.0))
+    return Real(1.0);
+  if (throughput <= 0 || rand() / ((Real)RAND_MAX + 1) >= throughput)
+    return Real(0.0);
+
+  Real weight = Real(1.0) / throughput;
+  throughput = Real(1.0);
+  return weight;
+}
+////////////////////////////////////////////////////////////////////////////////
+void Renderer::BuildLightSelection(Scenery& scenery) {
+  unsigned int nb_sources = scenery.getNbSource();
+  m_bounded_sources.clear();
+  m_unbounded_sources.clear();
+
+  std::vector<Real> powers(nb_sources);
+  std::vector<LightTree::Emitter> emitters;
+  for (unsigned int i = 0; i < nb_sources; i++) {
+    Source* source = scenery.getSource(i);
+    powers[i] = source->getPower();
+
+    LightTree::Emitter emitter;
+    if (source->getEmissionBounds(emitter.bounds, emitter.axis, 
+                                  emitter.cos_angle)) {
+      emitter.power = powers[i];
+      emitters.push_back(emitter);
+      m_bounded_sources.push_back(i);
+    } else {
+      m_unbounded_sources.push_back(i);
+    }
+  }
+
+  m_light_powers.Build(nb_sources > 0 ? &powers[0] : NULL, nb_sources);
+  m_light_tree.Build(emitters);
+}
+////////////////////////////////////////////////////////////////////////////////
+void Renderer::SelectSources(Scenery& scenery, const Point& receiver, 
+                             std::vector<unsigned int>& sources, 
+                             std::vector<Real>& weights) const {
+  sources.clear();
+  weights.clear();
+  unsigned int nb_sources = scenery.getNbSource();
+  if (m_nb_light_samples == 0 || nb_sources <= m_nb_light_samples) {
+    for (unsigned int i = 0; i < nb_sources; i++) {
+      sources.push_back(i);
+      weights.push_back(Real(1.0));
+    }
+    return;
+  }
+
+  bool tree = m_light_selection == kTREE_SELECTION;
+  if (tree) {
+    for (unsigned int i = 0; i < m_unbounded_sources.size(); i++) {
+      sources.push_back(m_unbounded_sources[i]);
+      weights.push_back(Real(1.0));
+    }
+    if (m_light_tree.IsEmpty())
+      return;
+  }
+
+  // Stratified selection, weighted by the inverse of the probability
+  for (unsigned int s = 0; s < m_nb_light_samples; s++) {
+    Real u = (s + rand() / ((Real)RAND_MAX + 1)) / m_nb_light_samples;
+    Real probability;
+    unsigned int picked;
+    if (tree) {
+      picked = m_light_tree.Sample(receiver, u, probability);
+      picked = m_bounded_sources[picked];
+    } else {
+      picked = m_light_powers.Sample(u, probability);
+    }
+    if (probability <= 0)
+      continue;
+    Real weight = Real(1.0) / (probability * m_nb_light_samples);
+
+    unsigned int i = 0;
+    while (i < sources.size() && sources[i] != picked)
+      i++;
+    if (i < sources.size()) {
+      weights[i] += weight;
+    } else {
+      sources.push_back(picked);
+      weights.push_back(weight);
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -56,7 +56,7 @@ SimpleRenderer::~SimpleRenderer(void) {
 }
 ////////////////////////////////////////////////////////////////////////////////
 void SimpleRenderer::Init(Scenery& scenery, int nb_threads) {
-  //nothing to do more
+  BuildLightSelection(scenery);
 }
 ////////////////////////////////////////////////////////////////////////////////
 void SimpleRenderer::InitWithData(Scenery& scenery, 
@@ -74,6 +74,13 @@ void SimpleRenderer::ExportData(unsigned char** data,
 void SimpleRenderer::CastRay(Scenery& scenery, 
                              LightVector& light_data, 
                              int depth) {
+  CastRay(scenery, light_data, depth, Real(1.0));
+}
+////////////////////////////////////////////////////////////////////////////////
+void SimpleRenderer::CastRay(Scenery& scenery, 
+                             LightVector& light_data, 
+                             int depth, 
+                             Real throughput) {
 
   if(depth < 0) 
     depth = m_max_depth;
@@ -117,6 +124,13 @@ void SimpleRenderer::CastRay(Scenery& scenery,
   //Intersection with object
   if(obj_hit && (!src_hit || obj_distance < src_distance)) {
     light_data.setDistance(obj_distance * m_scale);
+
+    //Footprint of the pixel on the surface (filtering of the textures)
+    Point2D surface_dx, surface_dy;
+    nearest_object->getSurfaceDifferentials(light_data, obj_local_basis, 
+                                            obj_surface_coordinate, 
+                                            surface_dx, surface_dy);
+    light_data.setSurfaceDifferentials(surface_dx, surface_dy);
     
     //Direct illumination
     AddDirectContribution(scenery, light_data, nearest_object, 
@@ -128,7 +142,8 @@ void SimpleRenderer::CastRay(Scenery& scenery,
 
     //Glossy illumination
     AddGlossyContribution(scenery, light_data, nearest_object, 
-                          obj_local_basis, obj_surface_coordinate, depth - 1);  
+                          obj_local_basis, obj_surface_coordinate, depth - 1, 
+                          throughput);  
 
     //Compute medium absorption    
     Medium* medium = 0;
@@ -166,13 +181,16 @@ void SimpleRenderer::AddGlossyContribution(
     Object* object, 
     const Basis& localBasis, 
     const Point2D& surfaceCoordinate, 
-    int depth) {
+    int depth, 
+    Real throughput) {
   if(depth < 0)
     return;
   
   //Getting secondarys rays to cast
   std::vector<LightVector> subrays;
   object->getSpecularSubRays(localBasis, surfaceCoordinate, light_data, subrays);
+  std::vector<Real> weights;
+  SelectSpectralSubRays(light_data, subrays, weights);
   for(unsigned int i = 0; i <  subrays.size(); i++) {
     //Advance a little to avoid intersection with starting point
     Ray propagation=subrays[i].getRay();
@@ -181,9 +199,21 @@ void SimpleRenderer::AddGlossyContribution(
     propagation.o[2] += propagation.v[2] * Real(0.01);
     subrays[i].setRay(propagation);
 
+    //Russian roulette on the sub-rays carrying little energy
+    Real subray_throughput = throughput;
+    Real roulette_weight = 1;
+    if(IsRouletteEnabled()) {
+      roulette_weight = PlayRussianRoulette(
+        m_max_depth - depth, subray_throughput, 
+        GetSpecularAttenuation(object, localBasis, surfaceCoordinate, 
+                               subrays[i], light_data));
+      if(roulette_weight <= 0)
+        continue;
+    }
+
     //Get incident luminance
     subrays[i].clear();
-    CastRay(scenery, subrays[i], depth);
+    CastRay(scenery, subrays[i], depth, subray_throughput);
     subrays[i].flip();
 
     //Get the reemited luminance
@@ -193,6 +223,8 @@ void SimpleRenderer::AddGlossyContribution(
 
     object->getSpecularReemited(localBasis, surfaceCoordinate, 
                                 subrays[i], tmpr);
+    if(weights[i] * roulette_weight != Real(1.0))
+      tmpr.mul(weights[i] * roulette_weight);
     light_data.add(tmpr);
   }
 }
@@ -208,11 +240,17 @@ void SimpleRenderer::AddDirectContribution(
   tmpr.initSpectralData(light_data);
   tmpr.initGeometricalData(light_data);
 
+  //Selected sources (all of them by default)
+  std::vector<unsigned int> sources;
+  std::vector<Real> weights;
+  SelectSources(scenery, localBasis.o, sources, weights);
+
   std::vector<LightVector> incidents;
-  for(unsigned int i = 0; i < scenery.getNbSource(); i++) {
+  for(unsigned int i = 0; i < sources.size(); i++) {
     //Get the incoming rays
+    Source* light = scenery.getSource(sources[i]);
     incidents.clear();
-    scenery.getSource(i)->getIncidentLight(localBasis.o, light_data, incidents);
+    light->getIncidentLight(localBasis.o, light_data, incidents);
 
     //For each incoming ray
     for(unsigned int j = 0; j < incidents.size(); j++) {
@@ -230,7 +268,7 @@ void SimpleRenderer::AddDirectContribution(
       bool objHit = scenery.getNearestIntersection(incoming, obj_distance, 
                                                    occObj, object);
 
-      if(srcHit && source!=scenery.getSource(i) 
+      if(srcHit && source!=light 
                 && src_distance<incidents[j].getDistance())
         continue;
 
@@ -243,9 +281,49 @@ void SimpleRenderer::AddDirectContribution(
       // the result
       object->getDiffuseReemited(localBasis, surfaceCoordinate, 
                                  incidents[j], tmpr);
+      if(weights[i] != Real(1.0))
+        tmpr.mul(weights[i]);
       light_data.add(tmpr);
     }
   }
+
+  //Light of the environment
+  AddEnvironmentContribution(scenery, light_data, object, localBasis, 
+                             surfaceCoordinate);
+}
+////////////////////////////////////////////////////////////////////////////////
+void SimpleRenderer::AddEnvironmentContribution(
+    Scenery& scenery, 
+    LightVector& light_data, 
+    Object* object, 
+    const Basis& localBasis, 
+    const Point2D& surfaceCoordinate) {
+  if(p_environment == NULL || p_environment->GetNbSamples() == 0)
+    return;
+
+  LightVector tmpr; 
+  tmpr.initSpectralData(light_data);
+  tmpr.initGeometricalData(light_data);
+
+  //No diffuse ray is cast: the sampled directions are the only estimate
+  std::vector<LightVector> incidents;
+  p_environment->GetIncidentLight(localBasis.o, light_data, incidents);
+  for(unsigned int j = 0; j < incidents.size(); j++) {
+    Ray incoming = incidents[j].getRay();
+    incoming.v.mul(-1.0);
+
+    //Only the directions escaping the scenery see the environment
+    Real distance = -1;
+    Source* source = 0;
+    Object* occObj = 0;
+    if(scenery.getNearestIntersection(incoming, distance, occObj, object) 
+       || scenery.getNearestIntersectionWithSource(incoming, distance, source))
+      continue;
+
+    object->getDiffuseReemited(localBasis, surfaceCoordinate, 
+                               incidents[j], tmpr);
+    light_data.add(tmpr);
+  }
 }
 ////////////////////////////////////////////////////////////////////////////////
 void SimpleRenderer::AddAmbientContribution(
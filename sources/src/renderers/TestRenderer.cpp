@@ -90,6 +90,13 @@ void TestRenderer::CastRay(Scenery& scenery,
   //Intersection with object
   if(obj_hit && (!src_hit || obj_distance < src_distance)) {
     light_data.setDistance(obj_distance * m_scale);
+
+    //Footprint of the pixel on the surface (filtering of the textures)
+    Point2D surface_dx, surface_dy;
+    nearest_object->getSurfaceDifferentials(light_data, obj_local_basis, 
+                                            obj_surface_coordinate, 
+                                            surface_dx, surface_dy);
+    light_data.setSurfaceDifferentials(surface_dx, surface_dy);
     
     //Direct illumination
     AddDirectContribution(scenery, light_data, nearest_object, 
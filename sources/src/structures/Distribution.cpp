@@ -0,0 +1,180 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/Distribution.hpp>
+//!
+//! @file Distribution.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in Distribution.hpp
+//!  @arg Distribution1D
+//!  @arg AliasTable
+//!  @arg Distribution2D
+//!
+#include <algorithm>
+////////////////////////////// class Distribution1D ////////////////////////////
+Distribution1D::Distribution1D(void)
+    : m_cdf(1, Real(0)), m_sum(0) {
+}
+////////////////////////////// class Distribution1D ////////////////////////////
+Distribution1D::Distribution1D(const Real* values, unsigned int size)
+    : m_cdf(1, Real(0)), m_sum(0) {
+  Build(values, size);
+}
+////////////////////////////// class Distribution1D ////////////////////////////
+void Distribution1D::Build(const Real* values, unsigned int size) {
+  m_cdf.assign(size + 1, Real(0));
+  double sum = 0;
+  for (unsigned int i = 0; i < size; i++)
+    sum += (values[i] > 0) ? values[i] : 0;
+  m_sum = (Real)sum;
+
+  double accumulated = 0;
+  for (unsigned int i = 0; i < size; i++) {
+    if (sum > 0)
+      accumulated += ((values[i] > 0) ? values[i] : 0) / sum;
+    else
+      accumulated += 1.0 / size;
+    m_cdf[i + 1] = (Real)accumulated;
+  }
+  if (size > 0)
+    m_cdf[size] = Real(1);
+}
+////////////////////////////// class Distribution1D ////////////////////////////
+unsigned int Distribution1D::Sample(Real u, Real& probability, 
+                                    Real* remapped) const {
+  // First entry whose upper bound is above u (empty entries are skipped)
+  unsigned int size = GetSize();
+  unsigned int i = (unsigned int)(std::upper_bound(m_cdf.begin() + 1, 
+                                                   m_cdf.end(), u) 
+                                  - (m_cdf.begin() + 1));
+  if (i >= size)
+    i = size - 1;
+  while (i > 0 && GetProbability(i) <= 0)
+    i--;
+
+  probability = GetProbability(i);
+  if (remapped != NULL) {
+    Real position = (probability > 0) ? (u - m_cdf[i]) / probability : 0;
+    *remapped = (position < 0) ? 0 : ((position < 1) ? position : Real(0.99999));
+  }
+  return i;
+}
+////////////////////////////// class AliasTable ////////////////////////////////
+AliasTable::AliasTable(void) {
+}
+////////////////////////////// class AliasTable ////////////////////////////////
+void AliasTable::Build(const Real* values, unsigned int size) {
+  m_thresholds.assign(size, Real(1));
+  m_aliases.resize(size);
+  m_probabilities.assign(size, Real(0));
+  if (size == 0)
+    return;
+
+  double sum = 0;
+  for (unsigned int i = 0; i < size; i++)
+    sum += (values[i] > 0) ? values[i] : 0;
+
+  // Weights scaled so that their mean is 1, split into small and large ones
+  std::vector<double> scaled(size);
+  std::vector<unsigned int> small, large;
+  for (unsigned int i = 0; i < size; i++) {
+    double p = (sum > 0) ? ((values[i] > 0) ? values[i] : 0) / sum 
+                         : 1.0 / size;
+    m_probabilities[i] = (Real)p;
+    m_aliases[i] = i;
+    scaled[i] = p * size;
+    if (scaled[i] < 1)
+      small.push_back(i);
+    else
+      large.push_back(i);
+  }
+
+  // Each small entry is completed by a large one
+  while (!small.empty() && !large.empty()) {
+    unsigned int s = small.back();
+    small.pop_back();
+    unsigned int l = large.back();
+    m_thresholds[s] = (Real)scaled[s];
+    m_aliases[s] = l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // Rounding errors: the remaining entries are full
+  for (unsigned int i = 0; i < small.size(); i++)
+    m_thresholds[small[i]] = Real(1);
+  for (unsigned int i = 0; i < large.size(); i++)
+    m_thresholds[large[i]] = Real(1);
+}
+////////////////////////////// class AliasTable ////////////////////////////////
+unsigned int AliasTable::Sample(Real u, Real& probability) const {
+  unsigned int size = GetSize();
+  Real position = u * size;
+  unsigned int i = (unsigned int)position;
+  if (i >= size)
+    i = size - 1;
+  if (position - i >= m_thresholds[i])
+    i = m_aliases[i];
+  probability = m_probabilities[i];
+  return i;
+}
+////////////////////////////// class Distribution2D ////////////////////////////
+Distribution2D::Distribution2D(void)
+    : m_width(0) {
+}
+////////////////////////////// class Distribution2D ////////////////////////////
+void Distribution2D::Build(const Real* values, unsigned int width, 
+                           unsigned int height) {
+  m_width = width;
+  m_rows.assign(height, Distribution1D());
+  std::vector<Real> row_sums(height);
+  for (unsigned int y = 0; y < height; y++) {
+    m_rows[y].Build(&values[(size_t)y * width], width);
+    row_sums[y] = m_rows[y].GetSum();
+  }
+  m_marginal.Build(&row_sums[0], height);
+}
+////////////////////////////// class Distribution2D ////////////////////////////
+Real Distribution2D::Sample(Real u1, Real u2, Real& x, Real& y) const {
+  Real row_probability, cell_probability;
+  Real dy, dx;
+  unsigned int row = m_marginal.Sample(u2, row_probability, &dy);
+  unsigned int cell = m_rows[row].Sample(u1, cell_probability, &dx);
+
+  unsigned int height = (unsigned int)m_rows.size();
+  x = (cell + dx) / m_width;
+  y = (row + dy) / height;
+  return row_probability * cell_probability * m_width * height;
+}
+////////////////////////////// class Distribution2D ////////////////////////////
+Real Distribution2D::GetDensity(Real x, Real y) const {
+  unsigned int height = (unsigned int)m_rows.size();
+  if (!(x >= 0 && x < 1 && y >= 0 && y < 1))
+    return 0;
+  unsigned int cell = std::min((unsigned int)(x * m_width), m_width - 1);
+  unsigned int row = std::min((unsigned int)(y * height), height - 1);
+  return m_marginal.GetProbability(row) * m_rows[row].GetProbability(cell) 
+       * m_width * height;
+}
+////////////////////////////////////////////////////////////////////////////////
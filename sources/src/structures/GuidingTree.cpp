@@ -0,0 +1,274 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/GuidingTree.hpp>
+//!
+//! @file GuidingTree.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in GuidingTree.hpp
+//!  @arg GuidingTree
+//!
+#include <algorithm>
+#include <cmath>
+
+namespace {
+//! Maximum number of records in a leaf of the octree
+const unsigned int kMAX_RECORDS_PER_LEAF = 1000;
+//! Minimum number of records in a leaf for guiding
+const unsigned int kMIN_RECORDS_PER_LEAF = 32;
+//! Maximum depth of the octree
+const unsigned int kMAX_SPATIAL_DEPTH = 12;
+//! Maximum depth of the quadtrees
+const unsigned int kMAX_DIRECTIONAL_DEPTH = 8;
+//! A quadrant is split if it holds more than this fraction of the energy
+const Real kSPLIT_FRACTION = 0.01;
+} // namespace
+////////////////////////////// class GuidingTree ///////////////////////////////
+GuidingTree::GuidingTree(void) {
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+void GuidingTree::AddRecord(const Point& position, const Vector& direction, 
+                            Real energy) {
+  if (energy <= 0)
+    return;
+  Record record;
+  record.position = position;
+  record.direction = direction;
+  record.energy = energy;
+  m_records.push_back(record);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+void GuidingTree::Build(const BoundingBox& bounds) {
+  m_spatial_nodes.clear();
+  m_quad_nodes.clear();
+
+  m_square.resize(2 * m_records.size());
+  for (unsigned int i = 0; i < m_records.size(); i++)
+    ToSquare(m_records[i].direction, m_square[2 * i], m_square[2 * i + 1]);
+
+  std::vector<unsigned int> records(m_records.size());
+  for (unsigned int i = 0; i < records.size(); i++)
+    records[i] = i;
+  SpatialNode root;
+  root.bounds = bounds;
+  m_spatial_nodes.push_back(root);
+  BuildSpatialNode(0, records, 0);
+
+  std::vector<Record>().swap(m_records);
+  std::vector<Real>().swap(m_square);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+void GuidingTree::BuildSpatialNode(int index, 
+                                   std::vector<unsigned int>& records, 
+                                   unsigned int depth) {
+  m_spatial_nodes[index].children = -1;
+  m_spatial_nodes[index].quadtree = -1;
+
+  // Leaf: quadtree of the incident energy
+  if (records.size() <= kMAX_RECORDS_PER_LEAF 
+      || depth >= kMAX_SPATIAL_DEPTH) {
+    if (records.size() < kMIN_RECORDS_PER_LEAF)
+      return;
+    Real total = 0;
+    for (unsigned int i = 0; i < records.size(); i++)
+      total += m_records[records[i]].energy;
+    m_spatial_nodes[index].quadtree = BuildQuadNode(records, 0, 0, 1, 
+                                                    total, 0);
+    return;
+  }
+
+  // Split into octants around the center
+  BoundingBox bounds = m_spatial_nodes[index].bounds;
+  std::vector<unsigned int> octants[8];
+  for (unsigned int i = 0; i < records.size(); i++) {
+    const Point& p = m_records[records[i]].position;
+    unsigned int octant = ((p[0] >= bounds.center[0]) ? 1 : 0) 
+                        | ((p[1] >= bounds.center[1]) ? 2 : 0) 
+                        | ((p[2] >= bounds.center[2]) ? 4 : 0);
+    octants[octant].push_back(records[i]);
+  }
+  std::vector<unsigned int>().swap(records);
+
+  int children = (int)m_spatial_nodes.size();
+  m_spatial_nodes[index].children = children;
+  for (unsigned int o = 0; o < 8; o++) {
+    SpatialNode child;
+    child.bounds = BoundingBox(
+      (o & 1) ? bounds.center[0] : bounds.min[0], 
+      (o & 1) ? bounds.max[0] : bounds.center[0], 
+      (o & 2) ? bounds.center[1] : bounds.min[1], 
+      (o & 2) ? bounds.max[1] : bounds.center[1], 
+      (o & 4) ? bounds.center[2] : bounds.min[2], 
+      (o & 4) ? bounds.max[2] : bounds.center[2]);
+    m_spatial_nodes.push_back(child);
+  }
+  for (unsigned int o = 0; o < 8; o++)
+    BuildSpatialNode(children + o, octants[o], depth + 1);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+int GuidingTree::BuildQuadNode(const std::vector<unsigned int>& records, 
+                               Real x, Real y, Real size, Real total, 
+                               unsigned int depth) {
+  int index = (int)m_quad_nodes.size();
+  m_quad_nodes.push_back(QuadNode());
+
+  Real half = Real(0.5) * size;
+  std::vector<unsigned int> quadrants[4];
+  for (unsigned int i = 0; i < records.size(); i++) {
+    unsigned int q = ((m_square[2 * records[i]] >= x + half) ? 1 : 0) 
+                   | ((m_square[2 * records[i] + 1] >= y + half) ? 2 : 0);
+    quadrants[q].push_back(records[i]);
+  }
+
+  for (unsigned int q = 0; q < 4; q++) {
+    Real energy = 0;
+    for (unsigned int i = 0; i < quadrants[q].size(); i++)
+      energy += m_records[quadrants[q][i]].energy;
+    m_quad_nodes[index].energy[q] = energy;
+    m_quad_nodes[index].children[q] = -1;
+  }
+  if (depth + 1 >= kMAX_DIRECTIONAL_DEPTH)
+    return index;
+
+  for (unsigned int q = 0; q < 4; q++) {
+    if (quadrants[q].size() < 2 
+        || m_quad_nodes[index].energy[q] <= kSPLIT_FRACTION * total)
+      continue;
+    int child = BuildQuadNode(quadrants[q], 
+                              (q & 1) ? x + half : x, 
+                              (q & 2) ? y + half : y, 
+                              half, total, depth + 1);
+    m_quad_nodes[index].children[q] = child;
+  }
+  return index;
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+int GuidingTree::GetLeaf(const Point& position) const {
+  if (m_spatial_nodes.empty())
+    return -1;
+  int index = 0;
+  while (m_spatial_nodes[index].children >= 0) {
+    const Point& center = m_spatial_nodes[index].bounds.center;
+    index = m_spatial_nodes[index].children 
+          + ((position[0] >= center[0]) ? 1 : 0) 
+          + ((position[1] >= center[1]) ? 2 : 0) 
+          + ((position[2] >= center[2]) ? 4 : 0);
+  }
+  return m_spatial_nodes[index].quadtree >= 0 ? index : -1;
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+Real GuidingTree::Sample(int leaf, Real u, Real v, Vector& direction) const {
+  Real x = 0;
+  Real y = 0;
+  Real size = 1;
+  Real density = 1;
+  int index = m_spatial_nodes[leaf].quadtree;
+  while (index >= 0) {
+    const QuadNode& node = m_quad_nodes[index];
+    Real total = node.energy[0] + node.energy[1] 
+               + node.energy[2] + node.energy[3];
+
+    // Column, then row in the column (u and v are rescaled for the child)
+    Real left = node.energy[0] + node.energy[2];
+    unsigned int q = 0;
+    Real column;
+    if (u * total < left) {
+      u = u * total / left;
+      column = left;
+    } else {
+      u = (u * total - left) / (total - left);
+      column = total - left;
+      q = 1;
+    }
+    if (v * column < node.energy[q]) {
+      v = v * column / node.energy[q];
+    } else {
+      v = (v * column - node.energy[q]) / node.energy[q + 2];
+      q += 2;
+    }
+    if (u >= 1)
+      u = Real(0.999999);
+    if (v >= 1)
+      v = Real(0.999999);
+
+    density *= 4 * node.energy[q] / total;
+    size *= Real(0.5);
+    if (q & 1)
+      x += size;
+    if (q & 2)
+      y += size;
+    index = node.children[q];
+  }
+
+  FromSquare(x + u * size, y + v * size, direction);
+  return density / Real(4.0 * M_PI);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+Real GuidingTree::GetDensity(int leaf, const Vector& direction) const {
+  Real x, y;
+  ToSquare(direction, x, y);
+  Real density = 1;
+  int index = m_spatial_nodes[leaf].quadtree;
+  while (index >= 0) {
+    const QuadNode& node = m_quad_nodes[index];
+    Real total = node.energy[0] + node.energy[1] 
+               + node.energy[2] + node.energy[3];
+    x *= 2;
+    y *= 2;
+    unsigned int q = 0;
+    if (x >= 1) {
+      x -= 1;
+      q |= 1;
+    }
+    if (y >= 1) {
+      y -= 1;
+      q |= 2;
+    }
+    density *= 4 * node.energy[q] / total;
+    index = node.children[q];
+  }
+  return density / Real(4.0 * M_PI);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+void GuidingTree::ToSquare(const Vector& direction, Real& x, Real& y) {
+  x = (direction[2] + 1) * Real(0.5);
+  y = (std::atan2(direction[1], direction[0]) + Real(M_PI)) 
+    * Real(0.5 / M_PI);
+  if (x < 0)
+    x = 0;
+  if (x >= 1)
+    x = Real(0.999999);
+  if (y < 0)
+    y = 0;
+  if (y >= 1)
+    y = Real(0.999999);
+}
+////////////////////////////// class GuidingTree ///////////////////////////////
+void GuidingTree::FromSquare(Real x, Real y, Vector& direction) {
+  Real z = 2 * x - 1;
+  Real r = std::sqrt(std::max(Real(0), 1 - z * z));
+  Real phi = Real(2.0 * M_PI) * y - Real(M_PI);
+  direction[0] = r * std::cos(phi);
+  direction[1] = r * std::sin(phi);
+  direction[2] = z;
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -15,6 +15,10 @@
  */
  
 #include <structures/Image.hpp>
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
 
 /**
  * Constructor of image without initilization of the pixels colors.
@@ -131,42 +135,103 @@ void Image::setPixel(int x, int y, const Pixel& pixel)
   memcpy(&_map[((y*_width) + x)*_nbChannels], pixel.getRawData(), _nbChannels*sizeof(float));
 }
 
+/**
+ * Copy a block of pixels into the image, one memcpy per row.
+ * x,y : coordinate of the upper-left pixel of the block.
+ * width,height : size of the block (clipped to the image).
+ * data : the pixels of the block, with the same number of channels.
+ * stride : number of floats between two rows of data.
+ */
+void Image::setBlock(int x, int y, unsigned int width, unsigned int height, 
+                     const float* data, unsigned int stride)
+{
+  if(x<0 || y<0 || (unsigned int)x>=_width || (unsigned int)y>=_height)
+    return;
+  if(x+width>_width) width=_width-x;
+  if(y+height>_height) height=_height-y;
+
+  size_t row_size = width*_nbChannels*sizeof(float);
+  for(unsigned int j=0; j<height; j++)
+    memcpy(&_map[(((y+j)*_width) + x)*_nbChannels], &data[j*stride], row_size);
+}
+
 /**
  * Put the color of the pixel into the pixel array. Use linear interpolation.
- * Out of image pixel are black.
+ * Out of image pixel are clamped to the border of the image.
  * x,y : coordinate of the wanted pixel.
  */
 Pixel Image::getInterpolatedPixel(Real x, Real y) const
 {
   Pixel pixel(_nbChannels);
+  getInterpolatedPixel(x, y, pixel.getRawData());
+  return pixel;
+}
+
+/**
+ * Bilinear interpolation written into a caller-provided storage, without
+ * any allocation. The wrap modes are resolved once per axis, so the four
+ * texels are always fetched the same way.
+ * x,y : coordinate of the wanted pixel.
+ * result : storage of getNumberOfChannels() floats.
+ * wrapX,wrapY : behavior outside of the image along each axis.
+ */
+void Image::getInterpolatedPixel(Real x, Real y, float* result,
+                                 WRAP_MODE wrapX, WRAP_MODE wrapY) const
+{
+  if(_map==NULL || _width==0 || _height==0)
+  {
+    memset(result, 0, _nbChannels*sizeof(float));
+    return;
+  }
 
-  int x1 = (int) x;
-  int x2 = x1 + 1 ;
-  int y1 = (int) y;
-  int y2 = y1 + 1;
+  Real fx = std::floor(x);
+  Real fy = std::floor(y);
+  int ix = (int)fx;
+  int iy = (int)fy;
 
-  Real xFactor1 = 1.0 - x + x1;
-  Real xFactor2 = 1.0 - xFactor1;
-  Real yFactor1 = 1.0 - y + y1;
-  Real yFactor2 = 1.0 - yFactor1;
+  //Texel indices and weights along each axis
+  unsigned int x1 = wrapIndex(ix, _width, wrapX);
+  unsigned int x2 = wrapIndex(ix+1, _width, wrapX);
+  unsigned int y1 = wrapIndex(iy, _height, wrapY);
+  unsigned int y2 = wrapIndex(iy+1, _height, wrapY);
+  float xFactor2 = (float)(x - fx);
+  float xFactor1 = 1.f - xFactor2;
+  float yFactor2 = (float)(y - fy);
+  float yFactor1 = 1.f - yFactor2;
 
-  Pixel tmp = getPixel(x1, y1);
-  for(unsigned int i=0; i<_nbChannels; i++)
-    pixel[i]=tmp[i]*xFactor1*yFactor1;
+  const float* p11 = &_map[((y1*_width) + x1)*_nbChannels];
+  const float* p12 = &_map[((y2*_width) + x1)*_nbChannels];
+  const float* p21 = &_map[((y1*_width) + x2)*_nbChannels];
+  const float* p22 = &_map[((y2*_width) + x2)*_nbChannels];
+  float w11 = xFactor1*yFactor1;
+  float w12 = xFactor1*yFactor2;
+  float w21 = xFactor2*yFactor1;
+  float w22 = xFactor2*yFactor2;
 
-  tmp = getPixel(x1, y2);
-  for(unsigned int i=0; i<_nbChannels; i++)
-    pixel[i]+=tmp[i]*xFactor1*yFactor2;
+  //RGBA images : one SSE register per texel
+#if defined(__SSE__) || defined(_M_X64)
+  if(_nbChannels==4)
+  {
+    __m128 sum = _mm_mul_ps(_mm_loadu_ps(p11), _mm_set1_ps(w11));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p12), _mm_set1_ps(w12)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p21), _mm_set1_ps(w21)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p22), _mm_set1_ps(w22)));
+    _mm_storeu_ps(result, sum);
+    return;
+  }
+#endif
 
-  tmp = getPixel(x2, y1);
-  for(unsigned int i=0; i<_nbChannels; i++)
-    pixel[i]+=tmp[i]*xFactor2*yFactor1;
+  //RGB images : unrolled
+  if(_nbChannels==3)
+  {
+    result[0] = p11[0]*w11 + p12[0]*w12 + p21[0]*w21 + p22[0]*w22;
+    result[1] = p11[1]*w11 + p12[1]*w12 + p21[1]*w21 + p22[1]*w22;
+    result[2] = p11[2]*w11 + p12[2]*w12 + p21[2]*w21 + p22[2]*w22;
+    return;
+  }
 
-  tmp = getPixel(x2, y2);
   for(unsigned int i=0; i<_nbChannels; i++)
-    pixel[i]+=tmp[i]*xFactor2*yFactor2;
-
-  return pixel;
+    result[i] = p11[i]*w11 + p12[i]*w12 + p21[i]*w21 + p22[i]*w22;
 }
 
 /*Renvoie le couple des valeurs de niveaux de gris minimales et maximales... 
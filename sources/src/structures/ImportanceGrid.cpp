@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/ImportanceGrid.hpp>
+//!
+//! @file ImportanceGrid.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in ImportanceGrid.hpp
+//!  @arg ImportanceGrid
+//!
+////////////////////////////// class ImportanceGrid ////////////////////////////
+ImportanceGrid::ImportanceGrid(void)
+    : m_inv_cell_size(0) {
+  m_size[0] = m_size[1] = m_size[2] = 0;
+}
+////////////////////////////// class ImportanceGrid ////////////////////////////
+void ImportanceGrid::Init(const BoundingBox& bounds) {
+  m_bounds = bounds;
+  Real side = 0;
+  for (unsigned int k = 0; k < 3; k++) {
+    if (bounds.max[k] - bounds.min[k] > side)
+      side = bounds.max[k] - bounds.min[k];
+  }
+  if (side <= 0)
+    side = 1;
+  m_inv_cell_size = kRESOLUTION / side;
+  for (unsigned int k = 0; k < 3; k++) {
+    m_size[k] = (unsigned int)((bounds.max[k] - bounds.min[k]) 
+                                 * m_inv_cell_size) + 1;
+    if (m_size[k] > kRESOLUTION)
+      m_size[k] = kRESOLUTION;
+  }
+  m_values.assign(m_size[0] * m_size[1] * m_size[2], 0);
+}
+////////////////////////////// class ImportanceGrid ////////////////////////////
+void ImportanceGrid::Add(const Point& point) {
+  int cell = GetCell(point);
+  if (cell >= 0)
+    m_values[cell] += 1;
+}
+////////////////////////////// class ImportanceGrid ////////////////////////////
+void ImportanceGrid::ComputeProbabilities(Real min_probability) {
+  if (m_values.empty())
+    return;
+
+  // Dilation: maximum over the 27 neighbours
+  std::vector<Real> dilated(m_values.size(), 0);
+  for (unsigned int z = 0; z < m_size[2]; z++) {
+    for (unsigned int y = 0; y < m_size[1]; y++) {
+      for (unsigned int x = 0; x < m_size[0]; x++) {
+        Real value = 0;
+        for (int dz = -1; dz <= 1; dz++) {
+          int nz = (int)z + dz;
+          if (nz < 0 || nz >= (int)m_size[2])
+            continue;
+          for (int dy = -1; dy <= 1; dy++) {
+            int ny = (int)y + dy;
+            if (ny < 0 || ny >= (int)m_size[1])
+              continue;
+            for (int dx = -1; dx <= 1; dx++) {
+              int nx = (int)x + dx;
+              if (nx < 0 || nx >= (int)m_size[0])
+                continue;
+              Real v = m_values[(nz * m_size[1] + ny) * m_size[0] + nx];
+              if (v > value)
+                value = v;
+            }
+          }
+        }
+        dilated[(z * m_size[1] + y) * m_size[0] + x] = value;
+      }
+    }
+  }
+
+  // Mean count of the seen cells
+  Real sum = 0;
+  unsigned int nb_seen = 0;
+  for (unsigned int i = 0; i < dilated.size(); i++) {
+    if (dilated[i] > 0) {
+      sum += dilated[i];
+      nb_seen++;
+    }
+  }
+  if (nb_seen == 0) {
+    m_values.assign(m_values.size(), 1);
+    return;
+  }
+  Real mean = sum / nb_seen;
+
+  for (unsigned int i = 0; i < dilated.size(); i++) {
+    Real probability = dilated[i] / mean;
+    if (probability > 1)
+      probability = 1;
+    if (probability < min_probability)
+      probability = min_probability;
+    m_values[i] = probability;
+  }
+}
+////////////////////////////// class ImportanceGrid ////////////////////////////
+Real ImportanceGrid::GetProbability(const Point& point) const {
+  int cell = GetCell(point);
+  if (cell < 0)
+    return 1;
+  return m_values[cell];
+}
+////////////////////////////// class ImportanceGrid ////////////////////////////
+int ImportanceGrid::GetCell(const Point& point) const {
+  if (m_values.empty())
+    return -1;
+  int index[3];
+  for (unsigned int k = 0; k < 3; k++) {
+    Real t = (point[k] - m_bounds.min[k]) * m_inv_cell_size;
+    // The hit points may be slightly out of the bounds (precision)
+    if (t < -1 || t > m_size[k] + 1)
+      return -1;
+    index[k] = (int)t;
+    if (index[k] < 0)
+      index[k] = 0;
+    if (index[k] >= (int)m_size[k])
+      index[k] = m_size[k] - 1;
+  }
+  return (index[2] * m_size[1] + index[1]) * m_size[0] + index[0];
+}
+////////////////////////////////////////////////////////////////////////////////
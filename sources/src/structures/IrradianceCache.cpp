@@ -0,0 +1,368 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/IrradianceCache.hpp>
+//!
+//! @file IrradianceCache.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in IrradianceCache.hpp
+//!  @arg IrradianceCache
+//!
+#include <algorithm>
+#include <cmath>
+
+#include <omp.h>
+
+#include <core/LightBase.hpp>
+
+namespace {
+//! Number of records of a batch
+const unsigned int kBATCH_SIZE = 16;
+//! Bounds of the harmonic mean distance, relative to the size of the scenery
+const Real kMIN_RADIUS = 0.001;
+const Real kMAX_RADIUS = 0.1;
+//! Tolerance of the test of the records in front of a point
+const Real kFRONT_TOLERANCE = 0.05;
+////////////////////////////////////////////////////////////////////////////////
+//! Vector of a basis from its coordinates
+inline Vector FromBasis(const Basis& basis, Real x, Real y, Real z) {
+  return Vector(x * basis.i[0] + y * basis.j[0] + z * basis.k[0], 
+                x * basis.i[1] + y * basis.j[1] + z * basis.k[1], 
+                x * basis.i[2] + y * basis.j[2] + z * basis.k[2]);
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Shortest of two hit distances (0 for a sample without hit)
+inline Real MinDistance(Real a, Real b) {
+  if (a <= 0)
+    return b;
+  if (b <= 0)
+    return a;
+  return std::min(a, b);
+}
+} // namespace
+////////////////////////////// class IrradianceCache ///////////////////////////
+IrradianceCache::IrradianceCache(void)
+    : m_accuracy(0), 
+      m_min_radius(0), 
+      m_max_radius(0), 
+      p_record_blocks(NULL), 
+      p_node_blocks(NULL), 
+      m_nb_records(0), 
+      m_nb_nodes(0) {
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+IrradianceCache::~IrradianceCache(void) {
+  if (p_record_blocks != NULL) {
+    for (unsigned int i = 0; i < kMAX_BLOCKS; i++)
+      delete[] p_record_blocks[i];
+    delete[] p_record_blocks;
+  }
+  if (p_node_blocks != NULL) {
+    for (unsigned int i = 0; i < kMAX_BLOCKS; i++)
+      delete[] p_node_blocks[i];
+    delete[] p_node_blocks;
+  }
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+void IrradianceCache::Init(const BoundingBox& bounds, Real accuracy, 
+                           unsigned int nb_threads) {
+  m_accuracy = accuracy;
+  p_record_blocks = new Record*[kMAX_BLOCKS];
+  p_node_blocks = new Node*[kMAX_BLOCKS];
+  for (unsigned int i = 0; i < kMAX_BLOCKS; i++) {
+    p_record_blocks[i] = NULL;
+    p_node_blocks[i] = NULL;
+  }
+  m_nb_records = 0;
+  m_nb_nodes = 0;
+  m_batches.assign(std::max(nb_threads, 1u), std::vector<Record>());
+
+  // Root: cube containing the bounds
+  Real size = std::max(bounds.max[0] - bounds.min[0], 
+                       std::max(bounds.max[1] - bounds.min[1], 
+                                bounds.max[2] - bounds.min[2]));
+  if (size <= 0)
+    size = 1;
+  m_min_radius = kMIN_RADIUS * size;
+  m_max_radius = kMAX_RADIUS * size;
+  CreateNode(bounds.center, Real(0.5) * size);
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+bool IrradianceCache::GetIrradiance(const Point& position, 
+                                    const Vector& normal, 
+                                    Real* irradiance) const {
+  unsigned int nb_wavelengths = GlobalSpectrum::nbWaveLengths();
+  for (unsigned int l = 0; l < nb_wavelengths; l++)
+    irradiance[l] = 0;
+  Real total = 0;
+
+  // Octree: the records of a node are valid inside its cube extended by 
+  // its half size
+  int stack[64 * 8];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = GetNode(stack[--top]);
+    for (int r = node.head; r >= 0; r = GetRecord(r).next)
+      total += AddContribution(GetRecord(r), position, normal, irradiance);
+
+    for (unsigned int c = 0; c < 8; c++) {
+      int child = node.children[c];
+      if (child < 0 || top >= 64 * 8)
+        continue;
+      const Node& n = GetNode(child);
+      Real reach = 2 * n.half_size;
+      if (std::fabs(position[0] - n.center[0]) <= reach 
+          && std::fabs(position[1] - n.center[1]) <= reach 
+          && std::fabs(position[2] - n.center[2]) <= reach)
+        stack[top++] = child;
+    }
+  }
+
+  // New records of the thread
+  unsigned int thread = (unsigned int)omp_get_thread_num();
+  if (thread < m_batches.size()) {
+    const std::vector<Record>& batch = m_batches[thread];
+    for (unsigned int r = 0; r < batch.size(); r++)
+      total += AddContribution(batch[r], position, normal, irradiance);
+  }
+
+  if (total <= 0)
+    return false;
+  for (unsigned int l = 0; l < nb_wavelengths; l++)
+    irradiance[l] /= total;
+  return true;
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+Real IrradianceCache::AddContribution(const Record& record, 
+                                      const Point& position, 
+                                      const Vector& normal, 
+                                      Real* irradiance) const {
+  // Ward's error: distance over harmonic mean distance plus the curvature
+  Vector offset(record.position, position);
+  Real cos_normals = record.normal.dot(normal);
+  if (cos_normals <= 0)
+    return 0;
+  Real error = offset.norm() / record.radius 
+             + std::sqrt(std::max(Real(0), 1 - cos_normals));
+  if (error >= m_accuracy)
+    return 0;
+
+  // Record in front of the point
+  Vector mean_normal(record.normal[0] + normal[0], 
+                     record.normal[1] + normal[1], 
+                     record.normal[2] + normal[2]);
+  if (Real(0.5) * offset.dot(mean_normal) < -kFRONT_TOLERANCE * record.radius)
+    return 0;
+
+  // Smooth weight, vanishing at the border of the validity area
+  Real weight = Real(1.0) / std::max(error, Real(1e-4)) 
+              - Real(1.0) / m_accuracy;
+
+  // First order extrapolation with the gradients
+  Real scale = 1;
+  if (record.mean > 0) {
+    Vector rotation = record.normal.vect(normal);
+    scale += (rotation.dot(record.rotation_gradient) 
+              + offset.dot(record.translation_gradient)) / record.mean;
+    if (scale < 0)
+      scale = 0;
+  }
+  for (unsigned int l = 0; l < GlobalSpectrum::nbWaveLengths(); l++)
+    irradiance[l] += weight * scale * record.irradiance[l];
+  return weight;
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+void IrradianceCache::AddRecord(const Basis& basis, 
+                                unsigned int nb_theta, unsigned int nb_phi, 
+                                const std::vector<Vector>& directions, 
+                                const std::vector<Real>& radiances, 
+                                const std::vector<Real>& distances, 
+                                const Real* irradiance) {
+  Record record;
+  record.position = basis.o;
+  record.normal = basis.k;
+  record.next = -1;
+  unsigned int nb_wavelengths = GlobalSpectrum::nbWaveLengths();
+  record.mean = 0;
+  for (unsigned int l = 0; l < nb_wavelengths; l++) {
+    record.irradiance[l] = irradiance[l];
+    record.mean += irradiance[l];
+  }
+  record.mean /= nb_wavelengths;
+
+  // Harmonic mean distance
+  Real inverse_sum = 0;
+  for (unsigned int s = 0; s < distances.size(); s++) {
+    if (distances[s] > 0)
+      inverse_sum += Real(1.0) / distances[s];
+  }
+  Real radius = (inverse_sum > 0) ? distances.size() / inverse_sum 
+                                  : m_max_radius;
+
+  // Gradients (Ward and Heckbert): sample (j, k) is at j + k x nb_theta
+  Real rotation[2] = {0, 0};
+  Real translation[2] = {0, 0};
+  Real dphi = Real(2.0 * M_PI) / nb_phi;
+  for (unsigned int k = 0; k < nb_phi; k++) {
+    Real phi = (k + Real(0.5)) * dphi;
+    Real phi_border = k * dphi;
+    unsigned int previous_k = (k + nb_phi - 1) % nb_phi;
+    for (unsigned int j = 0; j < nb_theta; j++) {
+      unsigned int s = j + k * nb_theta;
+      const Vector& d = directions[s];
+
+      // Rotation: tan(theta) along the azimuth + pi / 2 of the sample
+      Real sin_theta = std::sqrt(d[0] * d[0] + d[1] * d[1]);
+      if (d[2] > 0 && sin_theta > 0) {
+        Real tan_theta = sin_theta / d[2];
+        rotation[0] -= tan_theta * radiances[s] * d[1] / sin_theta;
+        rotation[1] += tan_theta * radiances[s] * d[0] / sin_theta;
+      }
+
+      // Translation across the border with the previous polar stratum
+      Real sin2_minus = j / (Real)nb_theta;
+      Real sin_minus = std::sqrt(sin2_minus);
+      if (j > 0) {
+        Real distance = MinDistance(distances[s], distances[s - 1]);
+        if (distance > 0) {
+          Real factor = dphi * sin_minus * (1 - sin2_minus) / distance 
+                      * (radiances[s] - radiances[s - 1]);
+          translation[0] += factor * std::cos(phi);
+          translation[1] += factor * std::sin(phi);
+        }
+      }
+
+      // Translation across the border with the previous azimuth stratum
+      unsigned int p = j + previous_k * nb_theta;
+      Real distance = MinDistance(distances[s], distances[p]);
+      if (distance > 0) {
+        Real sin_plus = std::sqrt((j + 1) / (Real)nb_theta);
+        Real factor = (sin_plus - sin_minus) / distance 
+                    * (radiances[s] - radiances[p]);
+        translation[0] -= factor * std::sin(phi_border);
+        translation[1] += factor * std::cos(phi_border);
+      }
+    }
+  }
+  Real rotation_scale = Real(M_PI) / (nb_theta * nb_phi);
+  record.rotation_gradient = FromBasis(basis, rotation_scale * rotation[0], 
+                                       rotation_scale * rotation[1], 0);
+  record.translation_gradient = FromBasis(basis, translation[0], 
+                                          translation[1], 0);
+
+  // The radius is limited by the gradient (the extrapolation must not 
+  // change the sign of the irradiance) and clamped
+  Real gradient = record.translation_gradient.norm();
+  if (gradient > 0 && record.mean / gradient < radius)
+    radius = record.mean / gradient;
+  record.radius = std::min(std::max(radius, m_min_radius), m_max_radius);
+
+  // Batch of the thread
+  unsigned int thread = (unsigned int)omp_get_thread_num();
+  if (thread >= m_batches.size()) {
+    std::vector<Record> batch(1, record);
+    Flush(batch);
+    return;
+  }
+  m_batches[thread].push_back(record);
+  if (m_batches[thread].size() >= kBATCH_SIZE)
+    Flush(m_batches[thread]);
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+void IrradianceCache::GetStrata(unsigned int nb_samples, 
+                                unsigned int& nb_theta, 
+                                unsigned int& nb_phi) {
+  nb_theta = (unsigned int)(std::sqrt(nb_samples / M_PI) + 0.5);
+  if (nb_theta < 1)
+    nb_theta = 1;
+  nb_phi = nb_samples / nb_theta;
+  if (nb_phi < 1)
+    nb_phi = 1;
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+void IrradianceCache::Flush(std::vector<Record>& batch) {
+# pragma omp critical (irradiance_cache)
+  {
+  for (unsigned int b = 0; b < batch.size(); b++) {
+    if ((unsigned int)m_nb_records >= kMAX_BLOCKS << kBLOCK_SHIFT)
+      break;
+    const Record& record = batch[b];
+
+    // Deepest node whose half size covers the validity radius
+    Real validity = m_accuracy * record.radius;
+    int index = 0;
+    while (true) {
+      Node& node = GetNode(index);
+      Real half = Real(0.5) * node.half_size;
+      if (half < validity)
+        break;
+      unsigned int c = ((record.position[0] >= node.center[0]) ? 1 : 0) 
+                     | ((record.position[1] >= node.center[1]) ? 2 : 0) 
+                     | ((record.position[2] >= node.center[2]) ? 4 : 0);
+      if (node.children[c] < 0) {
+        Point center(node.center[0] + ((c & 1) ? half : -half), 
+                     node.center[1] + ((c & 2) ? half : -half), 
+                     node.center[2] + ((c & 4) ? half : -half));
+        int child = CreateNode(center, half);
+        if (child < 0)
+          break;
+        // The child is complete before being visible
+#       pragma omp flush
+        GetNode(index).children[c] = child;
+      }
+      index = GetNode(index).children[c];
+    }
+
+    // Record
+    int r = m_nb_records;
+    if (p_record_blocks[r >> kBLOCK_SHIFT] == NULL)
+      p_record_blocks[r >> kBLOCK_SHIFT] = new Record[1 << kBLOCK_SHIFT];
+    Record& stored = p_record_blocks[r >> kBLOCK_SHIFT][r & kBLOCK_MASK];
+    stored = record;
+    Node& node = GetNode(index);
+    stored.next = node.head;
+    m_nb_records++;
+    // The record is complete before being visible
+#   pragma omp flush
+    node.head = r;
+  }
+  }
+  batch.clear();
+}
+////////////////////////////// class IrradianceCache ///////////////////////////
+int IrradianceCache::CreateNode(const Point& center, Real half_size) {
+  if ((unsigned int)m_nb_nodes >= kMAX_BLOCKS << kBLOCK_SHIFT)
+    return -1;
+  int n = m_nb_nodes;
+  if (p_node_blocks[n >> kBLOCK_SHIFT] == NULL)
+    p_node_blocks[n >> kBLOCK_SHIFT] = new Node[1 << kBLOCK_SHIFT];
+  Node& node = p_node_blocks[n >> kBLOCK_SHIFT][n & kBLOCK_MASK];
+  node.center = center;
+  node.half_size = half_size;
+  for (unsigned int c = 0; c < 8; c++)
+    node.children[c] = -1;
+  node.head = -1;
+  m_nb_nodes++;
+  return n;
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,246 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/LightTree.hpp>
+//!
+//! @file LightTree.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in LightTree.hpp
+//!  @arg LightTree
+//!
+#include <algorithm>
+#include <cmath>
+
+namespace {
+//! Twice the center of a box along an axis
+inline Real Centroid(const BoundingBox& box, int axis) {
+  return box.min[axis] + box.max[axis];
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Order of the emitters along an axis
+struct CentroidLess {
+  CentroidLess(const std::vector<LightTree::Emitter>& emitters, int axis)
+      : emitters(emitters), axis(axis) { }
+  bool operator()(unsigned int a, unsigned int b) const {
+    return Centroid(emitters[a].bounds, axis) 
+         < Centroid(emitters[b].bounds, axis);
+  }
+  const std::vector<LightTree::Emitter>& emitters;
+  int axis;
+};
+////////////////////////////////////////////////////////////////////////////////
+inline Real SafeAcos(Real c) {
+  if (c <= -1)
+    return Real(M_PI);
+  if (c >= 1)
+    return 0;
+  return std::acos(c);
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Smallest cone containing the cones a and b (the result is in a)
+void MergeCones(Vector& axis_a, Real& angle_a, 
+                const Vector& axis_b, Real angle_b) {
+  if (angle_a >= Real(M_PI))
+    return;
+  if (angle_b >= Real(M_PI)) {
+    angle_a = Real(M_PI);
+    return;
+  }
+
+  // The widest cone is a
+  Vector axis_w = axis_a, axis_n = axis_b;
+  Real angle_w = angle_a, angle_n = angle_b;
+  if (angle_b > angle_a) {
+    axis_w = axis_b;
+    axis_n = axis_a;
+    angle_w = angle_b;
+    angle_n = angle_a;
+  }
+
+  // The narrow cone is inside the wide one
+  Real delta = SafeAcos(axis_w.dot(axis_n));
+  if (delta + angle_n <= angle_w) {
+    axis_a = axis_w;
+    angle_a = angle_w;
+    return;
+  }
+  Real angle = Real(0.5) * (angle_w + delta + angle_n);
+  if (angle >= Real(M_PI)) {
+    angle_a = Real(M_PI);
+    return;
+  }
+
+  // Rotation of the wide axis toward the narrow one
+  Vector ortho = axis_n;
+  Real cos_delta = axis_w.dot(axis_n);
+  for (int k = 0; k < 3; k++)
+    ortho[k] -= cos_delta * axis_w[k];
+  Real length = ortho.norm();
+  if (length <= 0) {
+    axis_a = axis_w;
+    angle_a = Real(M_PI);
+    return;
+  }
+  Real rotation = angle - angle_w;
+  Real c = std::cos(rotation);
+  Real s = std::sin(rotation) / length;
+  for (int k = 0; k < 3; k++)
+    axis_a[k] = c * axis_w[k] + s * ortho[k];
+  axis_a.normalize();
+  angle_a = angle;
+}
+} // namespace
+////////////////////////////// class LightTree /////////////////////////////////
+LightTree::LightTree(void) {
+}
+////////////////////////////// class LightTree /////////////////////////////////
+void LightTree::Build(const std::vector<Emitter>& emitters) {
+  m_nodes.clear();
+  if (emitters.empty())
+    return;
+  m_nodes.reserve(2 * emitters.size() - 1);
+  std::vector<unsigned int> order(emitters.size());
+  for (unsigned int i = 0; i < order.size(); i++)
+    order[i] = i;
+  BuildNode(emitters, order, 0, (unsigned int)order.size());
+}
+////////////////////////////// class LightTree /////////////////////////////////
+unsigned int LightTree::BuildNode(const std::vector<Emitter>& emitters, 
+                                  std::vector<unsigned int>& order, 
+                                  unsigned int begin, unsigned int end) {
+  unsigned int index = (unsigned int)m_nodes.size();
+  m_nodes.push_back(Node());
+
+  // Leaf: the emitter itself
+  if (end - begin == 1) {
+    const Emitter& emitter = emitters[order[begin]];
+    Node& node = m_nodes[index];
+    node.bounds = emitter.bounds;
+    node.axis = emitter.axis;
+    node.angle = SafeAcos(emitter.cos_angle);
+    node.power = emitter.power;
+    node.index = order[begin];
+    node.leaf = true;
+    return index;
+  }
+
+  // Median split along the largest extent of the centers
+  Point center(Centroid(emitters[order[begin]].bounds, 0), 
+               Centroid(emitters[order[begin]].bounds, 1), 
+               Centroid(emitters[order[begin]].bounds, 2));
+  BoundingBox centers(center[0], center[0], center[1], center[1], 
+                      center[2], center[2]);
+  for (unsigned int i = begin + 1; i < end; i++) {
+    const BoundingBox& bounds = emitters[order[i]].bounds;
+    centers.updateWith(Point(Centroid(bounds, 0), Centroid(bounds, 1), 
+                             Centroid(bounds, 2)));
+  }
+  int axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (centers.max[k] - centers.min[k] > centers.max[axis] - centers.min[axis])
+      axis = k;
+  }
+  unsigned int middle = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + middle, 
+                   order.begin() + end, CentroidLess(emitters, axis));
+
+  unsigned int left = BuildNode(emitters, order, begin, middle);
+  unsigned int right = BuildNode(emitters, order, middle, end);
+
+  // Union of the children
+  Node node = m_nodes[left];
+  const Node& other = m_nodes[right];
+  node.bounds.updateWith(other.bounds);
+  MergeCones(node.axis, node.angle, other.axis, other.angle);
+  node.power += other.power;
+  node.index = right;
+  node.leaf = false;
+  m_nodes[index] = node;
+  return index;
+}
+////////////////////////////// class LightTree /////////////////////////////////
+Real LightTree::GetImportance(const Node& node, const Point& receiver) {
+  if (node.power <= 0)
+    return 0;
+
+  const BoundingBox& bounds = node.bounds;
+  Vector direction(bounds.center, receiver);
+  Real distance2 = direction.square();
+  Real radius2 = 0;
+  for (int k = 0; k < 3; k++) {
+    Real half = Real(0.5) * (bounds.max[k] - bounds.min[k]);
+    radius2 += half * half;
+  }
+
+  // Bound of the cosine of the emitted directions toward the receiver
+  Real orientation = 1;
+  if (node.angle < Real(M_PI) && distance2 > radius2) {
+    Real distance = std::sqrt(distance2);
+    Real angle = SafeAcos(node.axis.dot(direction) / distance);
+    Real spread = std::asin(std::sqrt(radius2 / distance2));
+    Real bound = angle - node.angle - spread;
+    if (bound >= Real(0.5 * M_PI))
+      return 0;
+    if (bound > 0)
+      orientation = std::cos(bound);
+  }
+
+  // Closer than the size of the node: the distance is meaningless
+  if (distance2 < radius2)
+    distance2 = radius2;
+  if (distance2 <= 0)
+    return node.power * orientation;
+  return node.power * orientation / distance2;
+}
+////////////////////////////// class LightTree /////////////////////////////////
+unsigned int LightTree::Sample(const Point& receiver, Real u, 
+                               Real& probability) const {
+  probability = 1;
+  unsigned int index = 0;
+  while (!m_nodes[index].leaf) {
+    unsigned int left = index + 1;
+    unsigned int right = m_nodes[index].index;
+    Real left_importance = GetImportance(m_nodes[left], receiver);
+    Real right_importance = GetImportance(m_nodes[right], receiver);
+    Real sum = left_importance + right_importance;
+    if (sum <= 0) {
+      probability = 0;
+      return 0;
+    }
+
+    // Choose a child and reuse u inside it
+    Real p_left = left_importance / sum;
+    if (u < p_left) {
+      u /= p_left;
+      probability *= p_left;
+      index = left;
+    } else {
+      u = (u - p_left) / (1 - p_left);
+      probability *= 1 - p_left;
+      index = right;
+    }
+    if (u >= 1)
+      u = Real(0.99999);
+  }
+  return m_nodes[index].index;
+}
+////////////////////////////////////////////////////////////////////////////////
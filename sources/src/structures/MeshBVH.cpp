@@ -0,0 +1,243 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/MeshBVH.hpp>
+//!
+//! @file MeshBVH.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in MeshBVH.hpp
+//!  @arg MeshBVH
+//!
+#include <algorithm>
+
+namespace {
+//! Number of bins of the surface area heuristic
+const unsigned int kNB_BINS = 16;
+//! Below this depth, nodes are split at the median (bounded depth)
+const unsigned int kMEDIAN_DEPTH = 32;
+//! Cost of the traversal of a node, relative to a triangle test
+const Real kTRAVERSAL_COST = 1.0;
+////////////////////////////////////////////////////////////////////////////////
+inline void Reset(BoundingBox& box) {
+  for (int k = 0; k < 3; k++) {
+    box.min[k] = std::numeric_limits<Real>::max();
+    box.max[k] = -std::numeric_limits<Real>::max();
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+inline Real HalfArea(const BoundingBox& box) {
+  Real dx = box.max[0] - box.min[0];
+  Real dy = box.max[1] - box.min[1];
+  Real dz = box.max[2] - box.min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Twice the center of a box along an axis
+inline Real Centroid(const BoundingBox& box, int axis) {
+  return box.min[axis] + box.max[axis];
+}
+////////////////////////////////////////////////////////////////////////////////
+//! Order of the triangles along an axis
+struct CentroidLess {
+  CentroidLess(const std::vector<BoundingBox>& bounds, int axis)
+      : bounds(bounds), axis(axis) { }
+  bool operator()(unsigned int a, unsigned int b) const {
+    return Centroid(bounds[a], axis) < Centroid(bounds[b], axis);
+  }
+  const std::vector<BoundingBox>& bounds;
+  int axis;
+};
+////////////////////////////////////////////////////////////////////////////////
+//! Side of the split of a triangle
+struct BinBelow {
+  BinBelow(const std::vector<BoundingBox>& bounds, int axis, 
+           Real origin, Real scale, unsigned int split)
+      : bounds(bounds), axis(axis), origin(origin), scale(scale), 
+        split(split) { }
+  unsigned int Bin(unsigned int t) const {
+    unsigned int bin = (unsigned int)((Centroid(bounds[t], axis) - origin) 
+                                      * scale);
+    return (bin < kNB_BINS) ? bin : kNB_BINS - 1;
+  }
+  bool operator()(unsigned int t) const { return Bin(t) < split; }
+  const std::vector<BoundingBox>& bounds;
+  int axis;
+  Real origin;
+  Real scale;
+  unsigned int split;
+};
+} // namespace
+////////////////////////////// class MeshBVH ///////////////////////////////////
+MeshBVH::MeshBVH(void)
+    : p_nodes(NULL), m_nb_nodes(0), p_owner(NULL) {
+}
+////////////////////////////// class MeshBVH ///////////////////////////////////
+MeshBVH::~MeshBVH(void) {
+  Clear();
+}
+////////////////////////////// class MeshBVH ///////////////////////////////////
+void MeshBVH::Clear(void) {
+  delete p_owner;
+  p_owner = NULL;
+  std::vector<Node>().swap(m_nodes);
+  p_nodes = NULL;
+  m_nb_nodes = 0;
+}
+////////////////////////////// class MeshBVH ///////////////////////////////////
+void MeshBVH::Build(const std::vector<BoundingBox>& bounds, 
+                    std::vector<unsigned int>& order) {
+  Clear();
+  order.resize(bounds.size());
+  for (unsigned int i = 0; i < order.size(); i++)
+    order[i] = i;
+
+  m_nodes.reserve(bounds.size() / 2 + 1);
+  BuildNode(bounds, order, 0, (unsigned int)order.size(), 0);
+  p_nodes = &m_nodes[0];
+  m_nb_nodes = (unsigned int)m_nodes.size();
+}
+////////////////////////////// class MeshBVH ///////////////////////////////////
+void MeshBVH::GetBoundingBox(BoundingBox& box) const {
+  if (m_nb_nodes == 0) {
+    box = BoundingBox(0, 0, 0, 0, 0, 0);
+    return;
+  }
+  box = BoundingBox(p_nodes[0].min[0], p_nodes[0].max[0], 
+                    p_nodes[0].min[1], p_nodes[0].max[1], 
+                    p_nodes[0].min[2], p_nodes[0].max[2]);
+}
+////////////////////////////// class MeshBVH ///////////////////////////////////
+unsigned int MeshBVH::BuildNode(const std::vector<BoundingBox>& bounds, 
+                                std::vector<unsigned int>& order, 
+                                unsigned int begin, unsigned int end, 
+                                unsigned int depth) {
+  unsigned int index = (unsigned int)m_nodes.size();
+  m_nodes.push_back(Node());
+
+  // Bounds of the triangles and of their centers
+  BoundingBox box, centers;
+  Reset(box);
+  Reset(centers);
+  for (unsigned int i = begin; i < end; i++) {
+    const BoundingBox& triangle = bounds[order[i]];
+    box.updateWith(triangle);
+    Point center(Centroid(triangle, 0), Centroid(triangle, 1), 
+                 Centroid(triangle, 2));
+    centers.updateWith(center);
+  }
+  Node& node = m_nodes[index];
+  for (int k = 0; k < 3; k++) {
+    node.min[k] = box.min[k];
+    node.max[k] = box.max[k];
+  }
+  node.first = begin;
+  node.count = (unsigned short)(end - begin);
+  node.axis = kLEAF;
+
+  unsigned int count = end - begin;
+  if (count <= 1)
+    return index;
+
+  // Split along the largest extent of the centers
+  int axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (centers.max[k] - centers.min[k] > centers.max[axis] - centers.min[axis])
+      axis = k;
+  }
+  Real extent = centers.max[axis] - centers.min[axis];
+
+  unsigned int middle = begin;
+  if (extent > 0 && depth < kMEDIAN_DEPTH) {
+    // Binned surface area heuristic
+    BinBelow binning(bounds, axis, centers.min[axis], kNB_BINS / extent, 0);
+    BoundingBox bin_boxes[kNB_BINS];
+    unsigned int bin_counts[kNB_BINS];
+    for (unsigned int b = 0; b < kNB_BINS; b++) {
+      Reset(bin_boxes[b]);
+      bin_counts[b] = 0;
+    }
+    for (unsigned int i = begin; i < end; i++) {
+      unsigned int b = binning.Bin(order[i]);
+      bin_boxes[b].updateWith(bounds[order[i]]);
+      bin_counts[b]++;
+    }
+
+    // Right side areas, then sweep from the left
+    Real right_costs[kNB_BINS];
+    BoundingBox accumulated;
+    Reset(accumulated);
+    unsigned int accumulated_count = 0;
+    for (unsigned int b = kNB_BINS - 1; b > 0; b--) {
+      accumulated.updateWith(bin_boxes[b]);
+      accumulated_count += bin_counts[b];
+      right_costs[b] = (accumulated_count > 0) 
+                     ? HalfArea(accumulated) * accumulated_count : 0;
+    }
+    Reset(accumulated);
+    accumulated_count = 0;
+    Real best_cost = std::numeric_limits<Real>::max();
+    unsigned int best_split = 0;
+    for (unsigned int b = 1; b < kNB_BINS; b++) {
+      accumulated.updateWith(bin_boxes[b - 1]);
+      accumulated_count += bin_counts[b - 1];
+      if (accumulated_count == 0 || accumulated_count == count)
+        continue;
+      Real cost = HalfArea(accumulated) * accumulated_count + right_costs[b];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = b;
+      }
+    }
+
+    Real area = HalfArea(box);
+    if (best_split > 0 && area > 0)
+      best_cost = kTRAVERSAL_COST + best_cost / area;
+    if (count <= kMAX_LEAF_SIZE && (best_split == 0 || best_cost >= count))
+      return index;
+
+    if (best_split > 0) {
+      binning.split = best_split;
+      middle = (unsigned int)(std::partition(order.begin() + begin, 
+                                             order.begin() + end, binning) 
+                              - order.begin());
+    }
+  } else if (count <= kMAX_LEAF_SIZE) {
+    return index;
+  }
+
+  // Median split (degenerate heuristic, deep nodes, identical centers)
+  if (middle == begin || middle == end) {
+    middle = begin + count / 2;
+    if (extent > 0) {
+      std::nth_element(order.begin() + begin, order.begin() + middle, 
+                       order.begin() + end, CentroidLess(bounds, axis));
+    }
+  }
+
+  BuildNode(bounds, order, begin, middle, depth + 1);
+  unsigned int right = BuildNode(bounds, order, middle, end, depth + 1);
+  m_nodes[index].first = right;
+  m_nodes[index].count = 0;
+  m_nodes[index].axis = (unsigned short)axis;
+  return index;
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,161 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/MipMap.hpp>
+//!
+//! @file MipMap.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in MipMap.hpp
+//!  @arg MipMap
+//!
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <exceptions/Exception.hpp>
+////////////////////////////// class MipMap ////////////////////////////////////
+MipMap::MipMap(Image& image)
+    : m_nb_channels(image.getNumberOfChannels()) {
+  unsigned int width = image.getWidth();
+  unsigned int height = image.getHeight();
+  if (width == 0 || height == 0 || m_nb_channels == 0 
+      || image.getRaster() == NULL)
+    throw Exception("(MipMap::MipMap) Image vide");
+
+  // Full image: copied tile row by tile row
+  m_levels.push_back(Level());
+  InitLevel(width, height, m_levels.back());
+  const float* raster = image.getRaster();
+  for (unsigned int y = 0; y < height; y++) {
+    for (unsigned int x = 0; x < width; x += kTILE_SIZE) {
+      unsigned int run = (width - x < kTILE_SIZE) ? width - x : kTILE_SIZE;
+      memcpy(&m_levels.back().texels[Offset(m_levels.back(), x, y)],
+             &raster[((size_t)y * width + x) * m_nb_channels],
+             run * m_nb_channels * sizeof(float));
+    }
+  }
+
+  // Each level averages 2x2 texels of the previous one (the last row and 
+  // column of odd sizes are repeated)
+  while (width > 1 || height > 1) {
+    unsigned int source_width = width;
+    unsigned int source_height = height;
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+    m_levels.push_back(Level());
+    Level& level = m_levels.back();
+    const Level& source = m_levels[m_levels.size() - 2];
+    InitLevel(width, height, level);
+
+    for (unsigned int y = 0; y < height; y++) {
+      unsigned int y1 = 2 * y;
+      unsigned int y2 = std::min(y1 + 1, source_height - 1);
+      for (unsigned int x = 0; x < width; x++) {
+        unsigned int x1 = 2 * x;
+        unsigned int x2 = std::min(x1 + 1, source_width - 1);
+        const float* p11 = &source.texels[Offset(source, x1, y1)];
+        const float* p12 = &source.texels[Offset(source, x1, y2)];
+        const float* p21 = &source.texels[Offset(source, x2, y1)];
+        const float* p22 = &source.texels[Offset(source, x2, y2)];
+        float* texel = &level.texels[Offset(level, x, y)];
+        for (unsigned int c = 0; c < m_nb_channels; c++)
+          texel[c] = 0.25f * (p11[c] + p12[c] + p21[c] + p22[c]);
+      }
+    }
+  }
+}
+////////////////////////////// class MipMap ////////////////////////////////////
+MipMap::~MipMap(void) {
+}
+////////////////////////////// class MipMap ////////////////////////////////////
+void MipMap::Lookup(Real u, Real v, Real width, float* result,
+                    Image::WRAP_MODE wrap_u, Image::WRAP_MODE wrap_v) const {
+  // Magnification (or no footprint): the full image
+  unsigned int last = (unsigned int)m_levels.size() - 1;
+  if (!(width > Real(1.0)) || last == 0) {
+    Bilinear(m_levels[0], u, v, 1.f, false, result, wrap_u, wrap_v);
+    return;
+  }
+
+  // Minification: blend of the two levels around the footprint
+  Real level = std::log(width) / std::log(Real(2.0));
+  if (level >= Real(last)) {
+    Bilinear(m_levels[last], u, v, 1.f, false, result, wrap_u, wrap_v);
+    return;
+  }
+  unsigned int l = (unsigned int)level;
+  float t = (float)(level - l);
+  Bilinear(m_levels[l], u, v, 1.f - t, false, result, wrap_u, wrap_v);
+  Bilinear(m_levels[l + 1], u, v, t, true, result, wrap_u, wrap_v);
+}
+////////////////////////////// class MipMap ////////////////////////////////////
+const float* MipMap::GetTexel(unsigned int level, 
+                              unsigned int x, unsigned int y) const {
+  return &m_levels[level].texels[Offset(m_levels[level], x, y)];
+}
+////////////////////////////// class MipMap ////////////////////////////////////
+void MipMap::InitLevel(unsigned int width, unsigned int height, 
+                       Level& level) const {
+  level.width = width;
+  level.height = height;
+  level.nb_tiles_x = (width + kTILE_SIZE - 1) >> kTILE_SHIFT;
+  unsigned int nb_tiles_y = (height + kTILE_SIZE - 1) >> kTILE_SHIFT;
+  level.texels.assign((size_t)level.nb_tiles_x * nb_tiles_y 
+                      * kTILE_SIZE * kTILE_SIZE * m_nb_channels, 0.f);
+}
+////////////////////////////// class MipMap ////////////////////////////////////
+void MipMap::Bilinear(const Level& level, Real u, Real v, float weight, 
+                      bool add, float* result, Image::WRAP_MODE wrap_u, 
+                      Image::WRAP_MODE wrap_v) const {
+  // Texel centers are at half-integer coordinates on every level
+  Real x = u * level.width - Real(0.5);
+  Real y = v * level.height - Real(0.5);
+  Real fx = std::floor(x);
+  Real fy = std::floor(y);
+  int ix = (int)fx;
+  int iy = (int)fy;
+
+  unsigned int x1 = Image::wrapIndex(ix, level.width, wrap_u);
+  unsigned int x2 = Image::wrapIndex(ix + 1, level.width, wrap_u);
+  unsigned int y1 = Image::wrapIndex(iy, level.height, wrap_v);
+  unsigned int y2 = Image::wrapIndex(iy + 1, level.height, wrap_v);
+  float dx = (float)(x - fx);
+  float dy = (float)(y - fy);
+  float w11 = weight * (1.f - dx) * (1.f - dy);
+  float w12 = weight * (1.f - dx) * dy;
+  float w21 = weight * dx * (1.f - dy);
+  float w22 = weight * dx * dy;
+
+  const float* texels = &level.texels[0];
+  const float* p11 = texels + Offset(level, x1, y1);
+  const float* p12 = texels + Offset(level, x1, y2);
+  const float* p21 = texels + Offset(level, x2, y1);
+  const float* p22 = texels + Offset(level, x2, y2);
+  if (add) {
+    for (unsigned int c = 0; c < m_nb_channels; c++)
+      result[c] += p11[c] * w11 + p12[c] * w12 + p21[c] * w21 + p22[c] * w22;
+  } else {
+    for (unsigned int c = 0; c < m_nb_channels; c++)
+      result[c] = p11[c] * w11 + p12[c] * w12 + p21[c] * w21 + p22[c] * w22;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
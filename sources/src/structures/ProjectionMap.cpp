@@ -0,0 +1,82 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/ProjectionMap.hpp>
+//!
+//! @file ProjectionMap.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in ProjectionMap.hpp
+//!  @arg ProjectionMap
+//!
+#include <cmath>
+////////////////////////////// class ProjectionMap /////////////////////////////
+ProjectionMap::ProjectionMap(void)
+    : m_cells(kNB_CELLS_Z * kNB_CELLS_PHI, 0) {
+}
+////////////////////////////// class ProjectionMap /////////////////////////////
+void ProjectionMap::Clear(void) {
+  m_cells.assign(kNB_CELLS_Z * kNB_CELLS_PHI, 0);
+}
+////////////////////////////// class ProjectionMap /////////////////////////////
+unsigned int ProjectionMap::GetCell(const Vector& direction) const {
+  int z = (int)((direction[2] + 1) * Real(0.5) * kNB_CELLS_Z);
+  if (z < 0)
+    z = 0;
+  if (z >= (int)kNB_CELLS_Z)
+    z = kNB_CELLS_Z - 1;
+  Real phi = std::atan2(direction[1], direction[0]);
+  int p = (int)((phi + Real(M_PI)) * Real(0.5 / M_PI) * kNB_CELLS_PHI);
+  if (p < 0)
+    p = 0;
+  if (p >= (int)kNB_CELLS_PHI)
+    p = kNB_CELLS_PHI - 1;
+  return (unsigned int)z * kNB_CELLS_PHI + (unsigned int)p;
+}
+////////////////////////////// class ProjectionMap /////////////////////////////
+void ProjectionMap::Dilate(void) {
+  std::vector<unsigned char> dilated(m_cells);
+  for (unsigned int z = 0; z < kNB_CELLS_Z; z++) {
+    for (unsigned int p = 0; p < kNB_CELLS_PHI; p++) {
+      if (!m_cells[z * kNB_CELLS_PHI + p])
+        continue;
+      // Neighbours along z (clamped) and along the azimuth (wrapped)
+      for (int dz = -1; dz <= 1; dz++) {
+        int nz = (int)z + dz;
+        if (nz < 0 || nz >= (int)kNB_CELLS_Z)
+          continue;
+        for (int dp = -1; dp <= 1; dp++) {
+          unsigned int np = (p + kNB_CELLS_PHI + dp) % kNB_CELLS_PHI;
+          dilated[nz * kNB_CELLS_PHI + np] = 1;
+        }
+      }
+    }
+  }
+  m_cells.swap(dilated);
+}
+////////////////////////////// class ProjectionMap /////////////////////////////
+unsigned int ProjectionMap::GetNbMarkedCells(void) const {
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < m_cells.size(); i++)
+    count += m_cells[i];
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////////
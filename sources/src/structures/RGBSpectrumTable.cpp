@@ -0,0 +1,187 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/RGBSpectrumTable.hpp>
+//!
+//! @file RGBSpectrumTable.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in RGBSpectrumTable.hpp
+//!  @arg RGBSpectrumTable
+//!
+#include <string>
+
+#include <core/LightBase.hpp>
+#include <core/VrtLog.hpp>
+#include <exceptions/Exception.hpp>
+#include <structures/ScratchBuffer.hpp>
+#include <structures/Texture.hpp>
+
+namespace {
+//! Samples of the conversion diagram
+const char* kSAMPLE_FILES[] = {
+  "data/textures/spectralization/white.xml",
+  "data/textures/spectralization/red.xml",
+  "data/textures/spectralization/green.xml",
+  "data/textures/spectralization/blue.xml",
+  "data/textures/spectralization/cyan.xml",
+  "data/textures/spectralization/magenta.xml",
+  "data/textures/spectralization/yellow.xml"
+};
+const unsigned int kNB_SAMPLE_FILES = 7;
+//! Tables built so far (the last one matches the current wavelengths)
+std::vector<RGBSpectrumTable*> s_tables;
+////////////////////////////////////////////////////////////////////////////////
+bool SameWavelengths(const std::vector<Real>& wavelengths) {
+  if (wavelengths.size() != GlobalSpectrum::nbWaveLengths())
+    return false;
+  for (unsigned int i = 0; i < wavelengths.size(); i++) {
+    if (wavelengths[i] != GlobalSpectrum::getWaveLength(i))
+      return false;
+  }
+  return true;
+}
+} // namespace
+////////////////////////////// class RGBSpectrumTable //////////////////////////
+const RGBSpectrumTable* RGBSpectrumTable::Get(void) {
+  RGBSpectrumTable* table = NULL;
+  std::string error;
+# pragma omp critical (rgb_spectrum_table)
+  {
+    if (!s_tables.empty() && SameWavelengths(s_tables.back()->m_wavelengths))
+      table = s_tables.back();
+
+    // The tables of other wavelengths may still be used by old textures
+    if (table == NULL) {
+      try {
+        std::vector<std::string> files(kSAMPLE_FILES, 
+                                       kSAMPLE_FILES + kNB_SAMPLE_FILES);
+        ReferenceSample reference(files);
+        table = new RGBSpectrumTable(reference);
+        s_tables.push_back(table);
+      } catch (Exception exc) {
+        // Exceptions must not leave the critical section
+        error = exc.getMessage();
+      }
+    }
+  }
+  if (table == NULL)
+    throw Exception(error);
+  return table;
+}
+////////////////////////////// class RGBSpectrumTable //////////////////////////
+RGBSpectrumTable::RGBSpectrumTable(ReferenceSample& reference)
+    : m_nb_samples(reference.GetNbColors()) {
+  unsigned int nb_wavelengths = GlobalSpectrum::nbWaveLengths();
+  for (unsigned int i = 0; i < nb_wavelengths; i++)
+    m_wavelengths.push_back(GlobalSpectrum::getWaveLength(i));
+
+  m_spectra.resize(m_nb_samples * nb_wavelengths);
+  for (unsigned int s = 0; s < m_nb_samples; s++) {
+    Spectrum spectrum = reference.GetColor(s).GetSpectrum();
+    for (unsigned int i = 0; i < nb_wavelengths; i++)
+      m_spectra[s * nb_wavelengths + i] = spectrum[i];
+  }
+
+  // Weights for an intensity of 1 at each node (r, g). The nodes outside the
+  // chromaticity triangle (r + g > 1) are projected like any other color; 
+  // the nodes that cannot be spectralized keep null weights (black).
+  const unsigned int nb_nodes = kRESOLUTION + 1;
+  m_weights.assign(nb_nodes * nb_nodes * m_nb_samples, 0.0f);
+  for (unsigned int y = 0; y < nb_nodes; y++) {
+    for (unsigned int x = 0; x < nb_nodes; x++) {
+      double r = double(x) / kRESOLUTION;
+      double g = double(y) / kRESOLUTION;
+      int points[3];
+      double weights[3];
+      bool inside;
+      reference.GetWeights(r, g, 1.0 - r - g, points, weights, inside);
+      float* node = &m_weights[(y * nb_nodes + x) * m_nb_samples];
+      for (int k = 0; k < 3; k++)
+        node[points[k]] += (float)weights[k];
+    }
+  }
+
+  VrtLog::Write("RGBSpectrumTable : %u echantillons, grille de %ux%u, %.1f Ko",
+                m_nb_samples, nb_nodes, nb_nodes, 
+                m_weights.size() * sizeof(float) / 1024.0);
+}
+////////////////////////////// class RGBSpectrumTable //////////////////////////
+void RGBSpectrumTable::Spectralize(Real R, Real G, Real B, 
+                                   Spectrum& spectrum) const {
+  // The diagram has a few samples: the stack is enough
+  ScratchBuffer weights(m_nb_samples);
+  GetWeights(R, G, B, weights.data());
+  Reconstruct(weights.data(), spectrum);
+}
+////////////////////////////// class RGBSpectrumTable //////////////////////////
+void RGBSpectrumTable::GetWeights(Real R, Real G, Real B, 
+                                  float* weights) const {
+  Real sum = R + G + B;
+  if (!(sum > 0)) {
+    for (unsigned int s = 0; s < m_nb_samples; s++)
+      weights[s] = 0;
+    return;
+  }
+
+  // Cell of the chromaticity and bilinear weights of its corners
+  Real fx = R / sum * kRESOLUTION;
+  Real fy = G / sum * kRESOLUTION;
+  fx = (fx < 0) ? 0 : ((fx > kRESOLUTION) ? Real(kRESOLUTION) : fx);
+  fy = (fy < 0) ? 0 : ((fy > kRESOLUTION) ? Real(kRESOLUTION) : fy);
+  unsigned int x = (unsigned int)fx;
+  unsigned int y = (unsigned int)fy;
+  if (x == kRESOLUTION)
+    x--;
+  if (y == kRESOLUTION)
+    y--;
+  Real dx = fx - x;
+  Real dy = fy - y;
+
+  const unsigned int nb_nodes = kRESOLUTION + 1;
+  const float* n00 = &m_weights[(y * nb_nodes + x) * m_nb_samples];
+  const float* n10 = n00 + m_nb_samples;
+  const float* n01 = n00 + nb_nodes * m_nb_samples;
+  const float* n11 = n01 + m_nb_samples;
+  for (unsigned int s = 0; s < m_nb_samples; s++) {
+    weights[s] = (float)((((1 - dx) * n00[s] + dx * n10[s]) * (1 - dy) 
+                        + ((1 - dx) * n01[s] + dx * n11[s]) * dy) * sum);
+  }
+}
+////////////////////////////// class RGBSpectrumTable //////////////////////////
+void RGBSpectrumTable::Reconstruct(const float* weights, 
+                                   Spectrum& spectrum) const {
+  unsigned int nb_wavelengths = (unsigned int)m_wavelengths.size();
+  Real* values = &spectrum[0];
+  for (unsigned int i = 0; i < nb_wavelengths; i++)
+    values[i] = 0;
+
+  // One contiguous (vectorized) pass per sample spectrum
+  for (unsigned int s = 0; s < m_nb_samples; s++) {
+    Real weight = weights[s];
+    if (weight == 0)
+      continue;
+    const Real* sample = &m_spectra[s * nb_wavelengths];
+    for (unsigned int i = 0; i < nb_wavelengths; i++)
+      values[i] += weight * sample[i];
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -33,6 +33,8 @@
 //! @todo 
 //! @remarks 
 //!
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <core/LightBase.hpp>
@@ -43,6 +45,7 @@
 #include <io/XMLTree.hpp>
 #include <io/DataParser.hpp>
 
+#include <structures/ScratchBuffer.hpp>
 //#include <fstream>
 //std::ofstream fluxFichierSVG("visualisation.svg");
 ////////////////////////////////////////////////////////////////////////////////
@@ -810,15 +813,39 @@ int ReferenceSample::FindArea(double x, double y) {
 }
 ////////////////////////////////////////////////////////////////////////////////
 Spectrum ReferenceSample::RGBtoSpectrum(double R, double G, double B) {
-  double sum = (double) (R + G + B);
   Spectrum theSpectrum;
+  int points[3];
+  double weights[3];
+  bool inside;
+  bool found = GetWeights(R, G, B, points, weights, inside);
 
-  // black color => null spectrum
-  if (sum == 0.0) {
-    theSpectrum.clear();
-    return theSpectrum;
+  for(unsigned int i=0 ; i<GlobalSpectrum::nbWaveLengths() ; i++) {
+    theSpectrum[i] 
+      = weights[0] * (m_list_points.at(points[0]).GetSpectrum())[i];
+    theSpectrum[i] 
+      += weights[1] * (m_list_points.at(points[1]).GetSpectrum())[i];
+    theSpectrum[i] 
+      += weights[2] * (m_list_points.at(points[2]).GetSpectrum())[i];
   }
 
+  // The color could not be spectralized
+  if (!found)
+    theSpectrum[0] = kERROR;
+
+  return theSpectrum;
+}
+////////////////////////////////////////////////////////////////////////////////
+bool ReferenceSample::GetWeights(double R, double G, double B, int points[3], 
+                                 double weights[3], bool& inside) {
+  double sum = (double) (R + G + B);
+  points[0] = points[1] = points[2] = 0;
+  weights[0] = weights[1] = weights[2] = 0;
+  inside = true;
+
+  // black color => null spectrum
+  if (sum == 0.0)
+    return true;
+
   double r = (double) R / sum; 
   double g = (double) G / sum; 
   double b = (double) B / sum; 
@@ -833,9 +860,8 @@ Spectrum ReferenceSample::RGBtoSpectrum(double R, double G, double B) {
   if (zoneOfTheColor <= -2) {
     isActuallyInAZone = false;
     zoneOfTheColor = -(zoneOfTheColor+2);
-    std::cout <<"\n -- ATTENTION --  " << zoneOfTheColor << std::endl 
-              << std::cout.flush();
   }
+  inside = isActuallyInAZone;
   // If the point is in a Zone, we can calculate the coefficients
   if (isActuallyInAZone == true) {
     coeffs = m_list_areas.at(zoneOfTheColor).calculateCoefficients(r,g);
@@ -849,8 +875,7 @@ Spectrum ReferenceSample::RGBtoSpectrum(double R, double G, double B) {
       weight3 = coeffs.at(2)*sum;
 
     } else {
-      //theSpectrum->setError(true);
-      theSpectrum[0] = kERROR;
+      return false;
     }
 
   // If it is in no Zone
@@ -940,20 +965,17 @@ Spectrum ReferenceSample::RGBtoSpectrum(double R, double G, double B) {
         weight3 = lambda*sum/s3;
       }
     } else {
-      theSpectrum[0] = kERROR;
+      return false;
     }
   }
 
-    for(unsigned int i=0 ; i<GlobalSpectrum::nbWaveLengths() ; i++) {
-    theSpectrum[i] 
-      = weight1 * (m_list_points.at(point1).GetSpectrum())[i];
-    theSpectrum[i] 
-      += weight2 * (m_list_points.at(point2).GetSpectrum())[i];
-    theSpectrum[i] 
-      += weight3 * (m_list_points.at(point3).GetSpectrum())[i];
-  }
-
-  return theSpectrum;
+  points[0] = point1;
+  points[1] = point2;
+  points[2] = point3;
+  weights[0] = weight1;
+  weights[1] = weight2;
+  weights[2] = weight3;
+  return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 SampleColor& ReferenceSample::GetColor(int point)
@@ -962,50 +984,33 @@ SampleColor& ReferenceSample::GetColor(int point)
 }
 ////////////////////////////////////////////////////////////////////////////////
 Texture::Texture(void) 
-	  : p_image(0), m_name(""), p_reference_sample(NULL) {
-  std::vector<std::string> list_sample_files;
-  list_sample_files.push_back(std::string("data/textures/spectralization/white.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/red.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/green.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/blue.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/cyan.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/magenta.xml"));
-  list_sample_files.push_back(std::string("data/textures/spectralization/yellow.xml"));
-
-  p_reference_sample = new ReferenceSample(list_sample_files);
+	  : p_mipmap(NULL), p_weights(NULL), m_name(""), 
+      p_spectrum_table(NULL) {
+  p_spectrum_table = RGBSpectrumTable::Get();
 }
 ////////////////////////////////////////////////////////////////////////////////
 Texture::~Texture() {
-  if (p_reference_sample != NULL)
-    delete p_reference_sample;
-  p_reference_sample = NULL;
-
   ClearImage();
 }
 ////////////////////////////////////////////////////////////////////////////////
 Texture::Texture(const Texture& t)
-    : p_image(0), m_name(""), p_reference_sample(NULL) {
-  p_image = t.p_image;
+    : p_mipmap(NULL), p_weights(NULL), m_name(""), 
+      p_spectrum_table(NULL) {
+  p_mipmap = t.p_mipmap;
+  p_weights = t.p_weights;
   m_name = t.m_name;
-
-  if (t.p_reference_sample != NULL)
-    p_reference_sample = new ReferenceSample(*t.p_reference_sample);
+  p_spectrum_table = t.p_spectrum_table;
 }
 ////////////////////////////////////////////////////////////////////////////////
 Texture& Texture::operator=(const Texture& t) {
 	if (this != &t)
 	{
-    if (p_reference_sample != NULL)
-      delete p_reference_sample;
-    p_reference_sample = NULL;
-
     ClearImage();
 
-    p_image = t.p_image;
+    p_mipmap = t.p_mipmap;
+    p_weights = t.p_weights;
     m_name = t.m_name;
-
-    if (t.p_reference_sample != NULL)
-      p_reference_sample = new ReferenceSample(*t.p_reference_sample);
+    p_spectrum_table = t.p_spectrum_table;
 	}
 	return *this;
 }
@@ -1014,17 +1019,55 @@ void Texture::SetImage(const char* image_file) {
 	ClearImage();
 
 	ImageParser parser;
-	p_image = parser.load(image_file);
+	Image* image = parser.load(image_file);
+  if (image == NULL)
+    return;
+
+  // Only the tiled pyramid is kept
+  try {
+    p_mipmap = new MipMap(*image);
+  } catch (...) {
+    delete image;
+    throw;
+  }
+  delete image;
 }
 ////////////////////////////////////////////////////////////////////////////////
-Image* Texture::GetImage(void) {
-	return p_image;
+const MipMap* Texture::GetMipMap(void) const {
+	return p_mipmap;
 }
 ////////////////////////////////////////////////////////////////////////////////
 void Texture::ClearImage(void) {
-	if (p_image != NULL)
-		delete p_image;
-	p_image = NULL;
+	if (p_mipmap != NULL)
+		delete p_mipmap;
+	p_mipmap = NULL;
+  if (p_weights != NULL)
+    delete p_weights;
+  p_weights = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+void Texture::Prespectralize(void) {
+  if (p_mipmap == NULL || p_mipmap->GetNbChannels() < 3)
+    return;
+
+  // Weights of the full image, then their own pyramid
+  unsigned int width = p_mipmap->GetWidth();
+  unsigned int height = p_mipmap->GetHeight();
+  const unsigned int nb_samples = p_spectrum_table->nb_samples();
+  Image weights(width, height, nb_samples);
+
+  float* output = weights.getRaster();
+  for (unsigned int y = 0; y < height; y++) {
+    for (unsigned int x = 0; x < width; x++) {
+      const float* rgb = p_mipmap->GetTexel(0, x, y);
+      p_spectrum_table->GetWeights(
+          rgb[0], rgb[1], rgb[2], &output[((size_t)y * width + x) * nb_samples]);
+    }
+  }
+
+  if (p_weights != NULL)
+    delete p_weights;
+  p_weights = new MipMap(weights);
 }
 ////////////////////////////////////////////////////////////////////////////////
 void Texture::SetTextureName(const char* texture_name) {
@@ -1035,33 +1078,65 @@ const char* Texture::GetTextureName(void) const {
   return m_name.c_str();
 }
 ////////////////////////////////////////////////////////////////////////////////
-void Texture::GetPixelValue(const Real& x, const Real& y, Pixel& pixel) {
-	pixel = p_image->getInterpolatedPixel(x * p_image->getWidth(), 
-                                        y * p_image->getHeight());
+Real Texture::GetFilterWidth(const Point2D& dx, const Point2D& dy) const {
+  if (p_mipmap == NULL)
+    return 0;
+  Real width = p_mipmap->GetWidth();
+  Real height = p_mipmap->GetHeight();
+  Real width_x = dx[0] * dx[0] * width * width + dx[1] * dx[1] * height * height;
+  Real width_y = dy[0] * dy[0] * width * width + dy[1] * dy[1] * height * height;
+  return std::sqrt(std::max(width_x, width_y));
+}
+////////////////////////////////////////////////////////////////////////////////
+void Texture::GetPixelValue(const Real& x, const Real& y, Pixel& pixel,
+                            TEXTURE_REPEAT_MODE repeat_u,
+                            TEXTURE_REPEAT_MODE repeat_v, 
+                            const Real& width) {
+  if (pixel.numberOfChannel() != p_mipmap->GetNbChannels())
+    pixel = Pixel(p_mipmap->GetNbChannels());
+  GetPixelValue(x, y, pixel.getRawData(), repeat_u, repeat_v, width);
+}
+////////////////////////////////////////////////////////////////////////////////
+void Texture::GetPixelValue(const Real& x, const Real& y, float* values,
+                            TEXTURE_REPEAT_MODE repeat_u,
+                            TEXTURE_REPEAT_MODE repeat_v, 
+                            const Real& width) {
+	p_mipmap->Lookup(x, y, width, values, (Image::WRAP_MODE)repeat_u,
+                   (Image::WRAP_MODE)repeat_v);
 }
 ////////////////////////////////////////////////////////////////////////////////
-void Texture::GetSpectrumValue(const Real& x, const Real& y, Spectrum& sRGB)
+void Texture::GetSpectrumValue(const Real& x, const Real& y, Spectrum& sRGB,
+                               TEXTURE_REPEAT_MODE repeat_u,
+                               TEXTURE_REPEAT_MODE repeat_v, 
+                               const Real& width)
 {
-	Pixel p(p_image->getNumberOfChannels());
-	GetPixelValue(x, y, p);
+  // Pre-spectralized texture: filtering of the weights of the samples
+  if (p_weights != NULL) {
+    ScratchBuffer w(p_weights->GetNbChannels());
+    p_weights->Lookup(x, y, width, w.data(), (Image::WRAP_MODE)repeat_u, 
+                      (Image::WRAP_MODE)repeat_v);
+    p_spectrum_table->Reconstruct(w.data(), sRGB);
+    return;
+  }
+
+  // Textures have a few channels: the stack is enough most of the time
+  ScratchBuffer p(p_mipmap->GetNbChannels());
+	GetPixelValue(x, y, p.data(), repeat_u, repeat_v, width);
 
 	SpectralizeRGB(p[0], p[1], p[2], sRGB);
 }
 ////////////////////////////////////////////////////////////////////////////////
 void Texture::SpectralizeRGB(Real R, Real G, Real B, Spectrum& sRGB)
 {
-	Spectrum tempSpectrum;
-  if (p_reference_sample != NULL)
-    tempSpectrum = p_reference_sample->RGBtoSpectrum(R, G, B);
-
-	for(unsigned int i = 0; i < GlobalSpectrum::nbWaveLengths(); i++) {
-		sRGB[i] = tempSpectrum[i];
-	}
+  p_spectrum_table->Spectralize(R, G, B, sRGB);
 }
 ////////////////////////////////////////////////////////////////////////////////
-void Texture::GetAlphaValue(const Real& x, const Real& y, Real& alpha) {
-	Pixel p(p_image->getNumberOfChannels());
-	GetPixelValue(x, y, p);
+void Texture::GetAlphaValue(const Real& x, const Real& y, Real& alpha,
+                            TEXTURE_REPEAT_MODE repeat_u,
+                            TEXTURE_REPEAT_MODE repeat_v, 
+                            const Real& width) {
+  ScratchBuffer p(p_mipmap->GetNbChannels());
+	GetPixelValue(x, y, p.data(), repeat_u, repeat_v, width);
 
 	// Map must be in grey level
   alpha = p[0]; 
@@ -0,0 +1,89 @@
+/*
+ *  Copyright 2013 Remi "Programmix" Cerise
+ *
+ *  This file is part of Virtuelium.
+ *
+ *  Virtuelium is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+#include <structures/TileBuffer.hpp>
+//!
+//! @file TileBuffer.cpp
+//! @author Remi "Programmix" Cerise
+//! @version 5.0.0
+//! @date 2013
+//! @details This file implements classs declared in TileBuffer.hpp
+//!  @arg TileBuffer
+//!
+#include <cstring>
+
+////////////////////////////// class TileBuffer ////////////////////////////////
+const size_t TileBuffer::kCACHE_LINE;
+////////////////////////////// class TileBuffer ////////////////////////////////
+TileBuffer::TileBuffer(void)
+    : p_memory(NULL),
+      p_data(NULL),
+      m_capacity(0),
+      m_width(0),
+      m_height(0),
+      m_nb_channels(0),
+      m_stride(0) {}
+////////////////////////////// class TileBuffer ////////////////////////////////
+TileBuffer::~TileBuffer(void) {
+  if (p_memory != NULL) {
+    delete [] p_memory;
+    p_memory = NULL;
+  }
+}
+////////////////////////////// class TileBuffer ////////////////////////////////
+void TileBuffer::Resize(unsigned int width, unsigned int height,
+                        unsigned int nb_channels) {
+  const size_t floats_per_line = kCACHE_LINE / sizeof(float);
+
+  m_width = width;
+  m_height = height;
+  m_nb_channels = nb_channels;
+
+  // Rows are padded to a multiple of the cache line
+  size_t row = size_t(width) * nb_channels;
+  m_stride = (unsigned int)(((row + floats_per_line - 1) / floats_per_line)
+                            * floats_per_line);
+
+  size_t needed = size_t(m_stride) * height;
+  if (needed <= m_capacity)
+    return;
+
+  // Grow the buffer, with extra room to align the first row
+  if (p_memory != NULL)
+    delete [] p_memory;
+  p_memory = new float[needed + floats_per_line];
+  size_t misalign = (size_t)p_memory % kCACHE_LINE;
+  p_data = p_memory;
+  if (misalign != 0)
+    p_data = (float*)((char*)p_memory + (kCACHE_LINE - misalign));
+  m_capacity = needed;
+}
+////////////////////////////// class TileBuffer ////////////////////////////////
+void TileBuffer::Clear(void) {
+  if (p_data != NULL)
+    memset(p_data, 0, size_t(m_stride) * m_height * sizeof(float));
+}
+////////////////////////////// class TileBuffer ////////////////////////////////
+void TileBuffer::Flush(Image& image, unsigned int ulx, unsigned int uly) const {
+  if (p_data == NULL)
+    return;
+  image.setBlock((int)ulx, (int)uly, m_width, m_height, p_data, m_stride);
+}
+////////////////////////////////////////////////////////////////////////////////